@@ -0,0 +1,754 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Microbenchmarks for address construction and formatting.
+ *
+ * Covers every address, port and string conversion function in chif_net.h
+ * and reports ns/op and heap allocations/op. Each case can have an
+ * allocation budget, which is enforced with -g, to guard optimizations
+ * against regressions. The memory of a filter with 200k IPv6 rules is
+ * printed first, and also checked with -g.
+ *
+ * usage: address_bench [-t min time ms] [-f name filter] [-g]
+ */
+
+#include "bench.h"
+#include <chif_net.h>
+#include <chif_net_cache.h>
+#include <chif_net_filter.h>
+#include <chif_net_limiter.h>
+#include <chif_net_session.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================ //
+
+typedef struct
+{
+  chif_net_socket listener;
+  chif_net_socket client;
+  chif_net_socket server_client;
+  chif_net_address ipv4_address;
+  chif_net_address ipv6_address;
+  chif_net_cache* cache;
+  chif_net_session_table* session_table;
+  chif_net_address_key* session_keys;
+  chif_net_filter* filter;
+  chif_net_filter* ipv6_filter;
+  chif_net_limiter* limiter;
+} bench_context;
+
+// Sessions in the session table, at three quarters of its capacity.
+enum
+{
+  bench_session_capacity = 1 << 16,
+  bench_session_count = bench_session_capacity / 4 * 3
+};
+
+// Rules in the filter, mostly /24 networks, like a large deny list. The IPv6
+// filter has as many rules, mostly /64 networks, and may use at most
+// bench_filter_ipv6_bytes_per_rule bytes per rule, checked with -g.
+enum
+{
+  bench_filter_rule_count = 200000,
+  bench_filter_ipv6_bytes_per_rule = 96
+};
+
+typedef chif_net_result (*bench_function)(const bench_context* context);
+
+typedef struct
+{
+  const char* name;
+  bench_function function;
+  // -1 when not checked
+  double max_allocations_per_op;
+} bench_case;
+
+// Results are written here, so the calls are not optimized away.
+static volatile uintptr_t sink;
+
+// ============================================================ //
+// Cases
+// ============================================================ //
+
+static chif_net_result
+create_address_ipv4_numeric(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  chif_net_address addr;
+  const chif_net_result res =
+    chif_net_create_address(&addr,
+                            "10.0.0.1",
+                            "8080",
+                            CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                            CHIF_NET_ADDRESS_FAMILY_IPV4);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+create_address_ipv6_numeric(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  chif_net_address addr;
+  const chif_net_result res =
+    chif_net_create_address(&addr,
+                            "2001:db8::1",
+                            "8080",
+                            CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                            CHIF_NET_ADDRESS_FAMILY_IPV6);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+create_address_any(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  chif_net_address addr;
+  const chif_net_result res =
+    chif_net_create_address(&addr,
+                            CHIF_NET_ANY_ADDRESS,
+                            "8080",
+                            CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                            CHIF_NET_ADDRESS_FAMILY_IPV4);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+create_address_localhost(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  chif_net_address addr;
+  const chif_net_result res =
+    chif_net_create_address(&addr,
+                            "localhost",
+                            "8080",
+                            CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                            CHIF_NET_ADDRESS_FAMILY_IPV4);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+create_addresses_ipv4_numeric(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  chif_net_address addrs[4];
+  size_t count;
+  const chif_net_result res =
+    chif_net_create_addresses(addrs,
+                              4,
+                              &count,
+                              "10.0.0.1",
+                              "8080",
+                              CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                              CHIF_NET_ADDRESS_FAMILY_IPV4);
+  sink = count;
+  return res;
+}
+
+static chif_net_result
+create_addresses_localhost(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  chif_net_address addrs[4];
+  size_t count;
+  const chif_net_result res =
+    chif_net_create_addresses(addrs,
+                              4,
+                              &count,
+                              "localhost",
+                              "8080",
+                              CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                              CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED);
+  sink = count;
+  return res;
+}
+
+static chif_net_result
+sort_addresses(const bench_context* context)
+{
+  chif_net_address addrs[4] = { context->ipv4_address,
+                                context->ipv6_address,
+                                context->ipv4_address,
+                                context->ipv6_address };
+  chif_net_sort_addresses(addrs, 4);
+  sink = addrs[0].address_family;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+cache_create_address_localhost(const bench_context* context)
+{
+  chif_net_address addr;
+  const chif_net_result res =
+    chif_net_cache_create_address(context->cache,
+                                  &addr,
+                                  "localhost",
+                                  "8080",
+                                  CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                  CHIF_NET_ADDRESS_FAMILY_IPV4);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+address_key_from_address(const bench_context* context)
+{
+  chif_net_address_key key;
+  const chif_net_result res =
+    chif_net_address_key_from_address(&context->ipv4_address, &key);
+  sink = chif_net_address_key_hash(&key);
+  return res;
+}
+
+static chif_net_result
+session_table_find(const bench_context* context)
+{
+  // a different peer every call, like a busy UDP server
+  static size_t next;
+  next = (next + 7919) % bench_session_count;
+  const chif_net_session* session = chif_net_session_table_find(
+    context->session_table, &context->session_keys[next], 0);
+  sink = (uintptr_t)session;
+  return session ? CHIF_NET_RESULT_SUCCESS : CHIF_NET_RESULT_FAIL;
+}
+
+static chif_net_result
+filter_match(const bench_context* context)
+{
+  // walk the address space, so most lookups miss the caches
+  static uint32_t next;
+  next += 0x9e3779b9u;
+  chif_net_ipv4_address address;
+  address.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  address.port = 0;
+  address.address = next;
+  sink =
+    chif_net_filter_match(context->filter, (chif_net_address*)&address);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+filter_match_ipv6(const bench_context* context)
+{
+  sink = chif_net_filter_match(context->filter, &context->ipv6_address);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+filter_match_ipv6_rules(const bench_context* context)
+{
+  // walk the /64 networks under 2001:db8::/32, most lookups miss every table
+  static uint32_t next;
+  next += 0x9e3779b9u;
+  chif_net_ipv6_address address =
+    *(const chif_net_ipv6_address*)&context->ipv6_address;
+  address.address[1] = next;
+  sink =
+    chif_net_filter_match(context->ipv6_filter, (chif_net_address*)&address);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+limiter_allow(const bench_context* context)
+{
+  // a new source every call, like a spoofed flood
+  static uint32_t next;
+  next += 0x9e3779b9u;
+  chif_net_ipv4_address address;
+  address.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  address.port = 0;
+  address.address = next;
+  sink = chif_net_limiter_allow(
+    context->limiter, (chif_net_address*)&address, 1, next >> 20);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+create_address_i_ipv4_numeric(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  chif_net_address addr;
+  const chif_net_result res =
+    chif_net_create_address_i(&addr,
+                              "10.0.0.1",
+                              8080,
+                              CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                              CHIF_NET_ADDRESS_FAMILY_IPV4);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+create_address_i_ipv6_numeric(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  chif_net_address addr;
+  const chif_net_result res =
+    chif_net_create_address_i(&addr,
+                              "2001:db8::1",
+                              8080,
+                              CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                              CHIF_NET_ADDRESS_FAMILY_IPV6);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+address_from_socket(const bench_context* context)
+{
+  chif_net_address addr;
+  addr.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_result res =
+    chif_net_address_from_socket(context->listener, &addr);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+peer_address_from_socket(const bench_context* context)
+{
+  chif_net_address addr;
+  addr.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_result res =
+    chif_net_peer_address_from_socket(context->client, &addr);
+  sink = addr.data[0];
+  return res;
+}
+
+static chif_net_result
+ip_from_socket(const bench_context* context)
+{
+  char str[CHIF_NET_IPVX_STRING_LENGTH];
+  const chif_net_result res =
+    chif_net_ip_from_socket(context->listener, str, sizeof(str));
+  sink = (uintptr_t)str[0];
+  return res;
+}
+
+static chif_net_result
+ip_from_address_ipv4(const bench_context* context)
+{
+  char str[CHIF_NET_IPVX_STRING_LENGTH];
+  const chif_net_result res =
+    chif_net_ip_from_address(&context->ipv4_address, str, sizeof(str));
+  sink = (uintptr_t)str[0];
+  return res;
+}
+
+static chif_net_result
+ip_from_address_ipv6(const bench_context* context)
+{
+  char str[CHIF_NET_IPVX_STRING_LENGTH];
+  const chif_net_result res =
+    chif_net_ip_from_address(&context->ipv6_address, str, sizeof(str));
+  sink = (uintptr_t)str[0];
+  return res;
+}
+
+static chif_net_result
+address_to_string_ipv4(const bench_context* context)
+{
+  char str[CHIF_NET_ADDRESS_STRING_LENGTH];
+  const chif_net_result res = chif_net_address_to_string(
+    &context->ipv4_address, str, sizeof(str), NULL);
+  sink = (uintptr_t)str[0];
+  return res;
+}
+
+static chif_net_result
+address_to_string_ipv6(const bench_context* context)
+{
+  char str[CHIF_NET_ADDRESS_STRING_LENGTH];
+  const chif_net_result res = chif_net_address_to_string(
+    &context->ipv6_address, str, sizeof(str), NULL);
+  sink = (uintptr_t)str[0];
+  return res;
+}
+
+static chif_net_result
+addresses_to_string(const bench_context* context)
+{
+  chif_net_address addresses[2] = { context->ipv4_address,
+                                    context->ipv6_address };
+  char strs[2][CHIF_NET_ADDRESS_STRING_LENGTH];
+  const chif_net_result res = chif_net_addresses_to_string(
+    addresses, 2, &strs[0][0], CHIF_NET_ADDRESS_STRING_LENGTH);
+  sink = (uintptr_t)strs[1][0];
+  return res;
+}
+
+static chif_net_result
+port_from_socket(const bench_context* context)
+{
+  chif_net_port port;
+  const chif_net_result res =
+    chif_net_port_from_socket(context->listener, &port);
+  sink = port;
+  return res;
+}
+
+static chif_net_result
+port_from_address(const bench_context* context)
+{
+  chif_net_port port;
+  const chif_net_result res =
+    chif_net_port_from_address(&context->ipv6_address, &port);
+  sink = port;
+  return res;
+}
+
+static chif_net_result
+result_to_string(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  sink = (uintptr_t)chif_net_result_to_string(CHIF_NET_RESULT_TIMEDOUT);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+address_family_to_string(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  sink = (uintptr_t)chif_net_address_family_to_string(
+    CHIF_NET_ADDRESS_FAMILY_IPV6);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+transport_protocol_to_string(const bench_context* context)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(context);
+  sink = (uintptr_t)chif_net_transport_protocol_to_string(
+    CHIF_NET_TRANSPORT_PROTOCOL_UDP);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static const bench_case cases[] = {
+  { "create_address ipv4 numeric", create_address_ipv4_numeric, 0 },
+  { "create_address ipv6 numeric", create_address_ipv6_numeric, 0 },
+  { "create_address any", create_address_any, 0 },
+  { "create_address localhost", create_address_localhost, -1 },
+  { "cache_create_address localhost", cache_create_address_localhost, 0 },
+  { "create_addresses ipv4 numeric", create_addresses_ipv4_numeric, 0 },
+  { "create_addresses localhost", create_addresses_localhost, -1 },
+  { "sort_addresses x4", sort_addresses, 0 },
+  { "address_key_from_address", address_key_from_address, 0 },
+  { "session_table_find 48k sessions", session_table_find, 0 },
+  { "filter_match ipv4 200k rules", filter_match, 0 },
+  { "filter_match ipv6 200k rules", filter_match_ipv6, 0 },
+  { "filter_match ipv6 200k ipv6 rules", filter_match_ipv6_rules, 0 },
+  { "limiter_allow", limiter_allow, 0 },
+  { "create_address_i ipv4 numeric", create_address_i_ipv4_numeric, 0 },
+  { "create_address_i ipv6 numeric", create_address_i_ipv6_numeric, 0 },
+  { "address_from_socket", address_from_socket, 0 },
+  { "peer_address_from_socket", peer_address_from_socket, 0 },
+  { "ip_from_socket", ip_from_socket, 0 },
+  { "ip_from_address ipv4", ip_from_address_ipv4, 0 },
+  { "ip_from_address ipv6", ip_from_address_ipv6, 0 },
+  { "address_to_string ipv4", address_to_string_ipv4, 0 },
+  { "address_to_string ipv6", address_to_string_ipv6, 0 },
+  { "addresses_to_string x2", addresses_to_string, 0 },
+  { "port_from_socket", port_from_socket, 0 },
+  { "port_from_address", port_from_address, 0 },
+  { "result_to_string", result_to_string, 0 },
+  { "address_family_to_string", address_family_to_string, 0 },
+  { "transport_protocol_to_string", transport_protocol_to_string, 0 },
+};
+
+// ============================================================ //
+
+static int
+setup_context(bench_context* context)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+
+  context->cache = malloc(sizeof(chif_net_cache));
+  OK_OR_CRASH(chif_net_cache_init(context->cache));
+
+  context->session_table = malloc(sizeof(chif_net_session_table));
+  chif_net_session* sessions =
+    malloc(bench_session_capacity * sizeof(chif_net_session));
+  context->session_keys =
+    malloc(bench_session_count * sizeof(chif_net_address_key));
+  if (!context->session_table || !sessions || !context->session_keys) {
+    return -1;
+  }
+  OK_OR_CRASH(chif_net_session_table_init(
+    context->session_table, sessions, bench_session_capacity, UINT32_MAX));
+  for (uint32_t i = 0; i < bench_session_count; ++i) {
+    chif_net_ipv4_address peer;
+    peer.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    peer.port = (chif_net_port)(1024 + i % 32768);
+    peer.address = 0x0a000000u + i / 32768;
+    OK_OR_CRASH(chif_net_address_key_from_address(
+      (chif_net_address*)&peer, &context->session_keys[i]));
+    chif_net_session* session;
+    OK_OR_CRASH(chif_net_session_table_insert(
+      context->session_table, &context->session_keys[i], 0, &session));
+  }
+
+  chif_net_filter_rule* rules =
+    malloc(bench_filter_rule_count * sizeof(chif_net_filter_rule));
+  context->filter = malloc(sizeof(chif_net_filter));
+  if (!rules || !context->filter) {
+    return -1;
+  }
+  srand(1);
+  for (size_t i = 0; i < bench_filter_rule_count; ++i) {
+    char cidr[CHIF_NET_IPV6_STRING_LENGTH + 4];
+    if (i % 16 == 0) {
+      snprintf(cidr,
+               sizeof(cidr),
+               "2001:db8:%x:%x::/64",
+               (unsigned)rand() & 0xffff,
+               (unsigned)rand() & 0xffff);
+    } else {
+      snprintf(cidr,
+               sizeof(cidr),
+               "%d.%d.%d.0/%d",
+               rand() % 224,
+               rand() % 256,
+               rand() % 256,
+               i % 8 == 1 ? 20 : 24);
+    }
+    OK_OR_CRASH(chif_net_filter_rule_from_string(
+      &rules[i], cidr, CHIF_NET_FILTER_ACTION_DENY));
+  }
+  OK_OR_CRASH(chif_net_filter_init(context->filter,
+                                   rules,
+                                   bench_filter_rule_count,
+                                   CHIF_NET_FILTER_ACTION_ALLOW));
+
+  context->ipv6_filter = malloc(sizeof(chif_net_filter));
+  if (!context->ipv6_filter) {
+    return -1;
+  }
+  for (size_t i = 0; i < bench_filter_rule_count; ++i) {
+    char cidr[CHIF_NET_IPV6_STRING_LENGTH + 4];
+    if (i % 64 == 0) {
+      snprintf(cidr,
+               sizeof(cidr),
+               "2001:db8:%x:%x::%x/128",
+               (unsigned)rand() & 0xffff,
+               (unsigned)rand() & 0xffff,
+               (unsigned)rand() & 0xffff);
+    } else if (i % 16 == 0) {
+      snprintf(
+        cidr, sizeof(cidr), "2001:db8:%x::/48", (unsigned)rand() & 0xffff);
+    } else {
+      snprintf(cidr,
+               sizeof(cidr),
+               "2001:db8:%x:%x::/64",
+               (unsigned)rand() & 0xffff,
+               (unsigned)rand() & 0xffff);
+    }
+    OK_OR_CRASH(chif_net_filter_rule_from_string(
+      &rules[i], cidr, CHIF_NET_FILTER_ACTION_DENY));
+  }
+  OK_OR_CRASH(chif_net_filter_init(context->ipv6_filter,
+                                   rules,
+                                   bench_filter_rule_count,
+                                   CHIF_NET_FILTER_ACTION_ALLOW));
+  free(rules);
+
+  context->limiter = malloc(sizeof(chif_net_limiter));
+  if (!context->limiter) {
+    return -1;
+  }
+  OK_OR_CRASH(chif_net_limiter_init(context->limiter, 100, 100));
+
+  chif_net_address addr;
+  OK_OR_CRASH(chif_net_open_socket(&context->listener, proto, af));
+  OK_OR_CRASH(chif_net_create_address_i(
+    &addr, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+  OK_OR_CRASH(chif_net_bind(context->listener, &addr));
+  OK_OR_CRASH(chif_net_listen(context->listener, CHIF_NET_DEFAULT_BACKLOG));
+  addr.address_family = af;
+  OK_OR_CRASH(chif_net_address_from_socket(context->listener, &addr));
+
+  OK_OR_CRASH(chif_net_open_socket(&context->client, proto, af));
+  OK_OR_CRASH(chif_net_connect(context->client, &addr));
+  chif_net_address client_addr;
+  client_addr.address_family = af;
+  OK_OR_CRASH(
+    chif_net_accept(context->listener, &client_addr, &context->server_client));
+
+  OK_OR_CRASH(chif_net_create_address(
+    &context->ipv4_address, "192.168.100.200", "65535", proto, af));
+  OK_OR_CRASH(chif_net_create_address(&context->ipv6_address,
+                                      "2001:db8:0:0:1:0:0:1",
+                                      "443",
+                                      proto,
+                                      CHIF_NET_ADDRESS_FAMILY_IPV6));
+  return 0;
+}
+
+/**
+ * Run the case in batches until at least min_time_ns has passed.
+ *
+ * @return 0 on success, -1 if the function under test failed.
+ */
+static int
+run_case(const bench_case* bench_case,
+         const bench_context* context,
+         const uint64_t min_time_ns,
+         double* ns_per_op_out,
+         double* allocations_per_op_out)
+{
+  // warm up caches, and fail early
+  for (int i = 0; i < 16; ++i) {
+    OK_OR_CRASH(bench_case->function(context));
+  }
+
+  uint64_t iterations = 0;
+  uint64_t elapsed = 0;
+  uint64_t batch = 16;
+  const uint64_t allocations_before = bench_allocation_count();
+  while (elapsed < min_time_ns) {
+    const uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < batch; ++i) {
+      bench_case->function(context);
+    }
+    elapsed += bench_now_ns() - start;
+    iterations += batch;
+    if (batch < (1u << 20)) {
+      batch *= 2;
+    }
+  }
+  const uint64_t allocations_after = bench_allocation_count();
+
+  *ns_per_op_out = (double)elapsed / (double)iterations;
+  *allocations_per_op_out =
+    (double)(allocations_after - allocations_before) / (double)iterations;
+  return 0;
+}
+
+// ============================================================ //
+
+int
+main(int argc, char** argv)
+{
+  uint64_t min_time_ms = 200;
+  const char* filter = NULL;
+  int guard = 0;
+
+  int i = 0;
+  while (++i < argc) {
+    if ((char)argv[i][0] == '-') {
+      switch (argv[i][1]) {
+        case 't': {
+          if (i + 1 < argc) {
+            min_time_ms = (uint64_t)atol(argv[++i]);
+          }
+          break;
+        }
+        case 'f': {
+          if (i + 1 < argc) {
+            filter = argv[++i];
+          }
+          break;
+        }
+        case 'g': {
+          guard = 1;
+          break;
+        }
+      }
+    }
+  }
+
+  chif_net_startup();
+
+  bench_context context;
+  if (setup_context(&context)) {
+    return -1;
+  }
+
+  int failed = 0;
+  const size_t filter_bytes = chif_net_filter_memory_size(context.filter);
+  const size_t ipv6_filter_bytes =
+    chif_net_filter_memory_size(context.ipv6_filter);
+  // the 65536 entry IPv4 root is always there, and not counted per rule
+  const size_t ipv6_filter_budget =
+    (size_t)bench_filter_rule_count * bench_filter_ipv6_bytes_per_rule +
+    65536 * sizeof(uint32_t);
+  printf("filter memory, 200k rules: %zu KiB\n", filter_bytes / 1024);
+  printf("filter memory, 200k ipv6 rules: %zu KiB",
+         ipv6_filter_bytes / 1024);
+  if (guard && ipv6_filter_bytes > ipv6_filter_budget) {
+    printf("  FAIL, budget %zu KiB", ipv6_filter_budget / 1024);
+    failed = 1;
+  }
+  printf("\n\n");
+
+  printf("%-36s %12s %12s\n", "", "ns/op", "allocs/op");
+  const size_t case_count = sizeof(cases) / sizeof(cases[0]);
+  for (size_t c = 0; c < case_count; ++c) {
+    if (filter && !strstr(cases[c].name, filter)) {
+      continue;
+    }
+
+    double ns_per_op;
+    double allocations_per_op;
+    if (run_case(&cases[c],
+                 &context,
+                 min_time_ms * 1000000ull,
+                 &ns_per_op,
+                 &allocations_per_op)) {
+      failed = 1;
+      continue;
+    }
+
+    if (bench_allocations_supported()) {
+      printf(
+        "%-36s %12.1f %12.2f", cases[c].name, ns_per_op, allocations_per_op);
+    } else {
+      printf("%-36s %12.1f %12s", cases[c].name, ns_per_op, "n/a");
+    }
+    if (guard && bench_allocations_supported() &&
+        cases[c].max_allocations_per_op >= 0 &&
+        allocations_per_op > cases[c].max_allocations_per_op) {
+      printf("  FAIL, budget %.2f", cases[c].max_allocations_per_op);
+      failed = 1;
+    }
+    printf("\n");
+  }
+
+  chif_net_close_socket(&context.server_client);
+  chif_net_close_socket(&context.client);
+  chif_net_close_socket(&context.listener);
+  chif_net_cache_destroy(context.cache);
+  free(context.cache);
+  chif_net_filter_destroy(context.filter);
+  free(context.filter);
+  chif_net_filter_destroy(context.ipv6_filter);
+  free(context.ipv6_filter);
+  chif_net_shutdown();
+  return failed;
+}
@@ -0,0 +1,368 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// ============================================================ //
+// Clock
+// ============================================================ //
+
+uint64_t
+bench_now_ns(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+  static LARGE_INTEGER frequency;
+  if (frequency.QuadPart == 0) {
+    QueryPerformanceFrequency(&frequency);
+  }
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)((double)counter.QuadPart * 1e9 /
+                    (double)frequency.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// ============================================================ //
+// Resources
+// ============================================================ //
+
+size_t
+bench_raise_fd_limit(const size_t wanted)
+{
+#if defined(_WIN32) || defined(_WIN64)
+  return wanted;
+#else
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+    return wanted;
+  }
+  if (limit.rlim_cur < wanted && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = wanted < limit.rlim_max ? wanted : limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+  }
+  return (size_t)limit.rlim_cur;
+#endif
+}
+
+uint64_t
+bench_rss_bytes(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return (uint64_t)counters.WorkingSetSize;
+#elif defined(__linux__)
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (!file) {
+    return 0;
+  }
+  unsigned long long size;
+  unsigned long long resident;
+  const int matched = fscanf(file, "%llu %llu", &size, &resident);
+  fclose(file);
+  if (matched != 2) {
+    return 0;
+  }
+  return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif
+}
+
+#if defined(BENCH_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+
+// glibc lets the executable interpose malloc, as long as malloc, calloc,
+// realloc and free are all replaced. The allocations are forwarded to the
+// glibc implementation.
+extern void*
+__libc_malloc(size_t size);
+extern void*
+__libc_calloc(size_t count, size_t size);
+extern void*
+__libc_realloc(void* ptr, size_t size);
+extern void
+__libc_free(void* ptr);
+
+static uint64_t allocation_count;
+static uint64_t allocation_bytes;
+
+static void
+_bench_count_allocation(const size_t size)
+{
+  __atomic_fetch_add(&allocation_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&allocation_bytes, (uint64_t)size, __ATOMIC_RELAXED);
+}
+
+void*
+malloc(size_t size)
+{
+  _bench_count_allocation(size);
+  return __libc_malloc(size);
+}
+
+void*
+calloc(size_t count, size_t size)
+{
+  _bench_count_allocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+void*
+realloc(void* ptr, size_t size)
+{
+  _bench_count_allocation(size);
+  return __libc_realloc(ptr, size);
+}
+
+void
+free(void* ptr)
+{
+  __libc_free(ptr);
+}
+
+int
+bench_allocations_supported(void)
+{
+  return 1;
+}
+
+uint64_t
+bench_allocation_count(void)
+{
+  return __atomic_load_n(&allocation_count, __ATOMIC_RELAXED);
+}
+
+uint64_t
+bench_allocation_bytes(void)
+{
+  return __atomic_load_n(&allocation_bytes, __ATOMIC_RELAXED);
+}
+
+#else
+
+int
+bench_allocations_supported(void)
+{
+  return 0;
+}
+
+uint64_t
+bench_allocation_count(void)
+{
+  return 0;
+}
+
+uint64_t
+bench_allocation_bytes(void)
+{
+  return 0;
+}
+
+#endif
+
+// ============================================================ //
+// Histogram
+// ============================================================ //
+
+enum
+{
+  // Each bucket has 2^sub_bucket_bits sub buckets, where the lower half
+  // overlaps with the previous bucket and is therefore not stored.
+  sub_bucket_bits = 11,
+  sub_bucket_half_count = 1 << (sub_bucket_bits - 1),
+  // Values up to 2^40 ns (~18 minutes) can be recorded.
+  max_value_bits = 40,
+  bucket_count = max_value_bits - sub_bucket_bits + 1,
+  counts_length = (bucket_count + 1) * sub_bucket_half_count
+};
+
+static int
+_bench_msb(uint64_t value)
+{
+  int msb = 0;
+  while (value >>= 1) {
+    ++msb;
+  }
+  return msb;
+}
+
+static size_t
+_bench_histogram_index(uint64_t value)
+{
+  const uint64_t max_value = (1ull << max_value_bits) - 1;
+  if (value > max_value) {
+    value = max_value;
+  }
+  const int bucket =
+    _bench_msb(value | ((1u << sub_bucket_bits) - 1)) - (sub_bucket_bits - 1);
+  const uint64_t sub_bucket = value >> bucket;
+  return (size_t)bucket * sub_bucket_half_count + (size_t)sub_bucket;
+}
+
+static uint64_t
+_bench_histogram_highest_equivalent(const size_t index)
+{
+  const size_t bucket =
+    index < 2 * sub_bucket_half_count ? 0 : index / sub_bucket_half_count - 1;
+  const uint64_t sub_bucket = index - bucket * sub_bucket_half_count;
+  return ((sub_bucket + 1) << bucket) - 1;
+}
+
+int
+bench_histogram_init(bench_histogram* histogram)
+{
+  histogram->counts = calloc(counts_length, sizeof(uint64_t));
+  if (!histogram->counts) {
+    return -1;
+  }
+  bench_histogram_reset(histogram);
+  return 0;
+}
+
+void
+bench_histogram_free(bench_histogram* histogram)
+{
+  free(histogram->counts);
+  histogram->counts = NULL;
+}
+
+void
+bench_histogram_reset(bench_histogram* histogram)
+{
+  memset(histogram->counts, 0, counts_length * sizeof(uint64_t));
+  histogram->total_count = 0;
+  histogram->min = UINT64_MAX;
+  histogram->max = 0;
+  histogram->sum = 0;
+}
+
+void
+bench_histogram_record(bench_histogram* histogram, const uint64_t value)
+{
+  ++histogram->counts[_bench_histogram_index(value)];
+  ++histogram->total_count;
+  histogram->sum += (double)value;
+  if (value < histogram->min) {
+    histogram->min = value;
+  }
+  if (value > histogram->max) {
+    histogram->max = value;
+  }
+}
+
+void
+bench_histogram_add(bench_histogram* destination,
+                    const bench_histogram* source)
+{
+  for (size_t i = 0; i < counts_length; ++i) {
+    destination->counts[i] += source->counts[i];
+  }
+  destination->total_count += source->total_count;
+  destination->sum += source->sum;
+  if (source->min < destination->min) {
+    destination->min = source->min;
+  }
+  if (source->max > destination->max) {
+    destination->max = source->max;
+  }
+}
+
+uint64_t
+bench_histogram_percentile(const bench_histogram* histogram,
+                           const double percentile)
+{
+  if (histogram->total_count == 0) {
+    return 0;
+  }
+
+  uint64_t target =
+    (uint64_t)((percentile / 100.0) * (double)histogram->total_count + 0.5);
+  if (target < 1) {
+    target = 1;
+  }
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_length; ++i) {
+    seen += histogram->counts[i];
+    if (seen >= target) {
+      const uint64_t value = _bench_histogram_highest_equivalent(i);
+      return value < histogram->max ? value : histogram->max;
+    }
+  }
+  return histogram->max;
+}
+
+void
+bench_histogram_print_header(void)
+{
+  printf("%-24s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+         "(us)",
+         "count",
+         "min",
+         "p50",
+         "p90",
+         "p99",
+         "p99.9",
+         "max",
+         "mean");
+}
+
+void
+bench_histogram_print(const bench_histogram* histogram, const char* name)
+{
+  const double us = 1000.0;
+  const uint64_t count = histogram->total_count;
+  printf("%-24s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+         name,
+         (unsigned long long)count,
+         count ? (double)histogram->min / us : 0.0,
+         (double)bench_histogram_percentile(histogram, 50.0) / us,
+         (double)bench_histogram_percentile(histogram, 90.0) / us,
+         (double)bench_histogram_percentile(histogram, 99.0) / us,
+         (double)bench_histogram_percentile(histogram, 99.9) / us,
+         (double)histogram->max / us,
+         count ? histogram->sum / (double)count / us : 0.0);
+}
@@ -0,0 +1,165 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <chif_net.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// ============================================================ //
+// Macros
+// ============================================================ //
+
+#define OK_OR_CRASH(fn)                                                        \
+  {                                                                            \
+    const chif_net_result res = (fn);                                          \
+    if (res) {                                                                 \
+      printf("failed with error [%s] at [%s:%i]\n",                            \
+             chif_net_result_to_string(res),                                   \
+             __FILE__,                                                         \
+             __LINE__);                                                        \
+      return -1;                                                               \
+    }                                                                          \
+  }
+
+// ============================================================ //
+// Clock
+// ============================================================ //
+
+/**
+ * Monotonic high-resolution clock.
+ *
+ * @return Current time in nanoseconds, from an unspecified starting point.
+ */
+uint64_t
+bench_now_ns(void);
+
+// ============================================================ //
+// Resources
+// ============================================================ //
+
+/**
+ * Try to raise the file descriptor limit of the process.
+ *
+ * @param wanted Number of file descriptors we would like to use.
+ * @return The number of file descriptors we may use.
+ */
+size_t
+bench_raise_fd_limit(size_t wanted);
+
+/**
+ * Resident set size of the process.
+ *
+ * @return Bytes, or 0 if not available on this platform.
+ */
+uint64_t
+bench_rss_bytes(void);
+
+/**
+ * Allocation counting is only compiled in when BENCH_COUNT_ALLOCATIONS is
+ * defined, and only works with glibc, where malloc can be interposed.
+ *
+ * @return Non-zero if bench_allocation_count and bench_allocation_bytes are
+ * tracking the allocations of the process.
+ */
+int
+bench_allocations_supported(void);
+
+/**
+ * @return Number of calls to malloc, calloc and realloc so far.
+ */
+uint64_t
+bench_allocation_count(void);
+
+/**
+ * @return Number of bytes requested through malloc, calloc and realloc so far.
+ */
+uint64_t
+bench_allocation_bytes(void);
+
+// ============================================================ //
+// Histogram
+// ============================================================ //
+
+/**
+ * HDR-style (log-linear) histogram. Every power of two range is split into
+ * 1024 linear sub buckets, which gives ~3 significant digits of precision
+ * over the whole range [0, 2^40) ns, while recording stays O(1).
+ */
+typedef struct
+{
+  uint64_t* counts;
+  uint64_t total_count;
+  uint64_t min;
+  uint64_t max;
+  double sum;
+} bench_histogram;
+
+/**
+ * @return 0 on success, -1 if out of memory.
+ */
+int
+bench_histogram_init(bench_histogram* histogram);
+
+void
+bench_histogram_free(bench_histogram* histogram);
+
+void
+bench_histogram_reset(bench_histogram* histogram);
+
+void
+bench_histogram_record(bench_histogram* histogram, uint64_t value);
+
+/**
+ * Add all recorded values of source into destination.
+ */
+void
+bench_histogram_add(bench_histogram* destination,
+                    const bench_histogram* source);
+
+/**
+ * @param percentile On the range [0, 100].
+ * @return Highest value that is equivalent (within the histogram precision)
+ * to the value at the given percentile.
+ */
+uint64_t
+bench_histogram_percentile(const bench_histogram* histogram,
+                           double percentile);
+
+/**
+ * Print the header line matching bench_histogram_print.
+ */
+void
+bench_histogram_print_header(void);
+
+/**
+ * Print count, min, p50, p90, p99, p99.9, max and mean, in microseconds.
+ * Recorded values are expected to be in nanoseconds.
+ */
+void
+bench_histogram_print(const bench_histogram* histogram, const char* name);
+
+#endif // BENCH_H_
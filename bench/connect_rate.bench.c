@@ -0,0 +1,456 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Connection-rate benchmark.
+ *
+ * Many client threads open, connect and close TCP connections to a loopback
+ * listener as fast as they can, while an acceptor thread accepts and closes
+ * them. Reports connections per second, accept queue overflows and the
+ * latency of each phase (open, connect, accept, close).
+ *
+ * The server closes each connection first, so the TIME_WAIT state ends up on
+ * the server side and the clients do not run out of ephemeral ports.
+ *
+ * With -m, each client thread instead connects batches of connections at
+ * once with chif_net_connect_many, and the connect latency is that of the
+ * whole batch.
+ *
+ * usage: connect_rate_bench [-c client threads] [-n connections per thread]
+ *                           [-b listen backlog] [-m batch size] [-6]
+ */
+
+#include "bench.h"
+#include <alf_thread.h>
+#include <chif_net.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================ //
+
+typedef struct
+{
+  chif_net_socket listen_socket;
+  chif_net_address_family af;
+  int connection_count;
+  int accepted;
+  int errors;
+  bench_histogram accept_histogram;
+} acceptor_args;
+
+typedef struct
+{
+  chif_net_address server_addr;
+  int iterations;
+  int batch_size;
+  int errors;
+  bench_histogram open_histogram;
+  bench_histogram connect_histogram;
+  bench_histogram close_histogram;
+} client_args;
+
+// ============================================================ //
+
+/**
+ * Read the system wide TcpExt ListenOverflows and ListenDrops counters.
+ *
+ * @return 0 on success, -1 if the counters are not available.
+ */
+static int
+read_listen_counters(uint64_t* overflows_out, uint64_t* drops_out)
+{
+#if defined(__linux__)
+  FILE* file = fopen("/proc/net/netstat", "r");
+  if (!file) {
+    return -1;
+  }
+
+  enum
+  {
+    linelen = 4096
+  };
+  char names[linelen];
+  char values[linelen];
+  int found = 0;
+  while (!found && fgets(names, linelen, file) &&
+         fgets(values, linelen, file)) {
+    if (strncmp(names, "TcpExt:", 7) != 0) {
+      continue;
+    }
+    found = 1;
+
+    char* name_save;
+    char* value_save;
+    char* name = strtok_r(names, " \n", &name_save);
+    char* value = strtok_r(values, " \n", &value_save);
+    while (name && value) {
+      if (strcmp(name, "ListenOverflows") == 0) {
+        *overflows_out = strtoull(value, NULL, 10);
+      } else if (strcmp(name, "ListenDrops") == 0) {
+        *drops_out = strtoull(value, NULL, 10);
+      }
+      name = strtok_r(NULL, " \n", &name_save);
+      value = strtok_r(NULL, " \n", &value_save);
+    }
+  }
+
+  fclose(file);
+  return found ? 0 : -1;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(overflows_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(drops_out);
+  return -1;
+#endif
+}
+
+static uint32_t
+acceptor(void* argument)
+{
+  acceptor_args* args = (acceptor_args*)argument;
+
+  while (args->accepted < args->connection_count) {
+    int can_read;
+    const chif_net_result res =
+      chif_net_can_read(args->listen_socket, &can_read, 5000);
+    if (res || !can_read) {
+      // no client has shown up for a while, give up
+      break;
+    }
+
+    chif_net_address client_addr;
+    client_addr.address_family = args->af;
+    chif_net_socket client;
+    const uint64_t start = bench_now_ns();
+    const chif_net_result accept_res =
+      chif_net_accept(args->listen_socket, &client_addr, &client);
+    const uint64_t stop = bench_now_ns();
+
+    if (accept_res) {
+      ++args->errors;
+      continue;
+    }
+    bench_histogram_record(&args->accept_histogram, stop - start);
+    chif_net_close_socket(&client);
+    ++args->accepted;
+  }
+
+  return 0;
+}
+
+static uint32_t
+client(void* argument)
+{
+  client_args* args = (client_args*)argument;
+
+  for (int i = 0; i < args->iterations; ++i) {
+    chif_net_socket sock;
+    const uint64_t t0 = bench_now_ns();
+    if (chif_net_open_socket(&sock,
+                             CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                             args->server_addr.address_family)) {
+      ++args->errors;
+      continue;
+    }
+    const uint64_t t1 = bench_now_ns();
+    if (chif_net_connect(sock, &args->server_addr)) {
+      ++args->errors;
+      chif_net_close_socket(&sock);
+      continue;
+    }
+    const uint64_t t2 = bench_now_ns();
+
+    // wait for the server to close the connection
+    uint8_t buf[1];
+    int bytes;
+    chif_net_read(sock, buf, sizeof(buf), &bytes);
+
+    const uint64_t t3 = bench_now_ns();
+    chif_net_close_socket(&sock);
+    const uint64_t t4 = bench_now_ns();
+
+    bench_histogram_record(&args->open_histogram, t1 - t0);
+    bench_histogram_record(&args->connect_histogram, t2 - t1);
+    bench_histogram_record(&args->close_histogram, t4 - t3);
+  }
+
+  return 0;
+}
+
+static uint32_t
+client_batch(void* argument)
+{
+  client_args* args = (client_args*)argument;
+  chif_net_check* checks =
+    calloc((size_t)args->batch_size, sizeof(chif_net_check));
+  chif_net_result* results =
+    calloc((size_t)args->batch_size, sizeof(chif_net_result));
+  if (!checks || !results) {
+    args->errors = args->iterations;
+    free(checks);
+    free(results);
+    return 0;
+  }
+
+  for (int done = 0; done < args->iterations; done += args->batch_size) {
+    const int left = args->iterations - done;
+    const size_t count =
+      (size_t)(left < args->batch_size ? left : args->batch_size);
+
+    const uint64_t t0 = bench_now_ns();
+    size_t opened = 0;
+    for (; opened < count; ++opened) {
+      if (chif_net_open_socket(&checks[opened].socket,
+                               CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                               args->server_addr.address_family)) {
+        break;
+      }
+    }
+    args->errors += (int)(count - opened);
+    const uint64_t t1 = bench_now_ns();
+    if (chif_net_connect_many(
+          checks, results, opened, &args->server_addr, 1, 10000, NULL)) {
+      args->errors += (int)opened;
+      for (size_t i = 0; i < opened; ++i) {
+        chif_net_close_socket(&checks[i].socket);
+      }
+      continue;
+    }
+    const uint64_t t2 = bench_now_ns();
+
+    for (size_t i = 0; i < opened; ++i) {
+      if (results[i]) {
+        ++args->errors;
+      } else {
+        // wait for the server to close the connection
+        chif_net_set_blocking(checks[i].socket, CHIF_NET_TRUE);
+        uint8_t buf[1];
+        int bytes;
+        chif_net_read(checks[i].socket, buf, sizeof(buf), &bytes);
+      }
+    }
+
+    const uint64_t t3 = bench_now_ns();
+    for (size_t i = 0; i < opened; ++i) {
+      chif_net_close_socket(&checks[i].socket);
+    }
+    const uint64_t t4 = bench_now_ns();
+
+    bench_histogram_record(&args->open_histogram, t1 - t0);
+    bench_histogram_record(&args->connect_histogram, t2 - t1);
+    bench_histogram_record(&args->close_histogram, t4 - t3);
+  }
+
+  free(checks);
+  free(results);
+  return 0;
+}
+
+// ============================================================ //
+
+static int
+run_connect_rate(const int thread_count,
+                 const int iterations,
+                 const int backlog,
+                 const int batch_size,
+                 const chif_net_address_family af)
+{
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  const char* loopback =
+    af == CHIF_NET_ADDRESS_FAMILY_IPV4 ? "127.0.0.1" : "::1";
+
+  chif_net_socket server;
+  OK_OR_CRASH(chif_net_open_socket(&server, proto, af));
+  OK_OR_CRASH(chif_net_set_reuse_addr(server, CHIF_NET_TRUE));
+  chif_net_address server_addr;
+  OK_OR_CRASH(chif_net_create_address_i(
+    &server_addr, loopback, CHIF_NET_ANY_PORT, proto, af));
+  OK_OR_CRASH(chif_net_bind(server, &server_addr));
+  server_addr.address_family = af;
+  OK_OR_CRASH(chif_net_address_from_socket(server, &server_addr));
+  OK_OR_CRASH(chif_net_listen(server, backlog));
+
+  acceptor_args acceptor_arg;
+  acceptor_arg.listen_socket = server;
+  acceptor_arg.af = af;
+  acceptor_arg.connection_count = thread_count * iterations;
+  acceptor_arg.accepted = 0;
+  acceptor_arg.errors = 0;
+  if (bench_histogram_init(&acceptor_arg.accept_histogram)) {
+    return -1;
+  }
+
+  client_args* client_arg = calloc((size_t)thread_count, sizeof(client_args));
+  AlfThread** threads = calloc((size_t)thread_count, sizeof(AlfThread*));
+  if (!client_arg || !threads) {
+    return -1;
+  }
+  for (int i = 0; i < thread_count; ++i) {
+    client_arg[i].server_addr = server_addr;
+    client_arg[i].iterations = iterations;
+    client_arg[i].batch_size = batch_size;
+    if (bench_histogram_init(&client_arg[i].open_histogram) ||
+        bench_histogram_init(&client_arg[i].connect_histogram) ||
+        bench_histogram_init(&client_arg[i].close_histogram)) {
+      return -1;
+    }
+  }
+
+  uint64_t overflows_before = 0;
+  uint64_t drops_before = 0;
+  const int has_counters =
+    read_listen_counters(&overflows_before, &drops_before) == 0;
+
+  const uint64_t start = bench_now_ns();
+  AlfThread* acceptor_thread = alfCreateThread(acceptor, &acceptor_arg);
+  for (int i = 0; i < thread_count; ++i) {
+    threads[i] =
+      alfCreateThread(batch_size > 0 ? client_batch : client, &client_arg[i]);
+  }
+  for (int i = 0; i < thread_count; ++i) {
+    alfJoinThread(threads[i]);
+  }
+  alfJoinThread(acceptor_thread);
+  const uint64_t stop = bench_now_ns();
+
+  uint64_t overflows_after = 0;
+  uint64_t drops_after = 0;
+  read_listen_counters(&overflows_after, &drops_after);
+
+  // merge the per thread results
+  int client_errors = 0;
+  for (int i = 1; i < thread_count; ++i) {
+    bench_histogram_add(&client_arg[0].open_histogram,
+                        &client_arg[i].open_histogram);
+    bench_histogram_add(&client_arg[0].connect_histogram,
+                        &client_arg[i].connect_histogram);
+    bench_histogram_add(&client_arg[0].close_histogram,
+                        &client_arg[i].close_histogram);
+  }
+  for (int i = 0; i < thread_count; ++i) {
+    client_errors += client_arg[i].errors;
+  }
+
+  const double seconds = (double)(stop - start) / 1e9;
+  printf("%s, %d client threads x %d connections, backlog %d\n",
+         chif_net_address_family_to_string(af),
+         thread_count,
+         iterations,
+         backlog);
+  if (batch_size > 0) {
+    printf("connecting in batches of %d, latencies are per batch\n",
+           batch_size);
+  }
+  printf("accepted %d connections in %.3f s, %.0f connections/s\n",
+         acceptor_arg.accepted,
+         seconds,
+         (double)acceptor_arg.accepted / seconds);
+  printf("errors: %d client, %d accept\n", client_errors, acceptor_arg.errors);
+  if (has_counters) {
+    printf("accept queue (system wide): %llu overflows, %llu drops\n",
+           (unsigned long long)(overflows_after - overflows_before),
+           (unsigned long long)(drops_after - drops_before));
+  } else {
+    printf("accept queue: overflow counters not available on this platform\n");
+  }
+
+  printf("\n");
+  bench_histogram_print_header();
+  bench_histogram_print(&client_arg[0].open_histogram, "open");
+  bench_histogram_print(&client_arg[0].connect_histogram, "connect");
+  bench_histogram_print(&acceptor_arg.accept_histogram, "accept");
+  bench_histogram_print(&client_arg[0].close_histogram, "close");
+
+  for (int i = 0; i < thread_count; ++i) {
+    bench_histogram_free(&client_arg[i].open_histogram);
+    bench_histogram_free(&client_arg[i].connect_histogram);
+    bench_histogram_free(&client_arg[i].close_histogram);
+  }
+  bench_histogram_free(&acceptor_arg.accept_histogram);
+  free(client_arg);
+  free(threads);
+  chif_net_close_socket(&server);
+  return 0;
+}
+
+// ============================================================ //
+
+int
+main(int argc, char** argv)
+{
+  int thread_count = 8;
+  int iterations = 2000;
+  int backlog = CHIF_NET_DEFAULT_BACKLOG;
+  int batch_size = 0;
+  chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+
+  int i = 0;
+  while (++i < argc) {
+    if ((char)argv[i][0] == '-') {
+      switch (argv[i][1]) {
+        case 'c': {
+          if (i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+          }
+          break;
+        }
+        case 'n': {
+          if (i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+          }
+          break;
+        }
+        case 'b': {
+          if (i + 1 < argc) {
+            backlog = atoi(argv[++i]);
+          }
+          break;
+        }
+        case 'm': {
+          if (i + 1 < argc) {
+            batch_size = atoi(argv[++i]);
+          }
+          break;
+        }
+        case '6': {
+          af = CHIF_NET_ADDRESS_FAMILY_IPV6;
+          break;
+        }
+      }
+    }
+  }
+  if (thread_count < 1 || iterations < 1) {
+    printf("thread count and connection count must be positive\n");
+    return -1;
+  }
+
+  chif_net_startup();
+  alfThreadStartup();
+
+  const int ret =
+    run_connect_rate(thread_count, iterations, backlog, batch_size, af);
+
+  alfThreadShutdown();
+  chif_net_shutdown();
+  return ret;
+}
@@ -0,0 +1,292 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Memory footprint benchmark for idle connections.
+ *
+ * Opens N idle loopback TCP connections through chif_net and reports the
+ * memory they cost per connection: the growth of the process resident set,
+ * the kernel socket memory (Linux) and the heap allocations made while
+ * setting up the connections. The kernel numbers are system wide, so run it
+ * on an otherwise quiet machine. Both ends of each connection live in this
+ * process, so the numbers cover a client and a server socket.
+ *
+ * usage: idle_memory_bench [-n connections] [-b max bytes per connection]
+ *                          [-a max allocations per connection]
+ *
+ * Returns 1 if a given budget is exceeded.
+ */
+
+#include "bench.h"
+#include <chif_net.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+// ============================================================ //
+
+enum
+{
+  // connections per listener, keeps us well within the ephemeral port range
+  connections_per_listener = 16384
+};
+
+/**
+ * Kernel memory that is spent on sockets. Idle sockets have no buffers
+ * allocated, so most of their cost is in the slab caches (socket, inode,
+ * file and so on), which can only be read system wide from /proc/meminfo.
+ * Socket buffer memory is read from /proc/net/sockstat.
+ *
+ * @return 0 on success, -1 if not available on this platform.
+ */
+static int
+kernel_memory_bytes(uint64_t* bytes_out)
+{
+#if defined(__linux__)
+  FILE* meminfo = fopen("/proc/meminfo", "r");
+  FILE* sockstat = fopen("/proc/net/sockstat", "r");
+  if (!meminfo || !sockstat) {
+    if (meminfo) {
+      fclose(meminfo);
+    }
+    if (sockstat) {
+      fclose(sockstat);
+    }
+    return -1;
+  }
+
+  uint64_t bytes = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), meminfo)) {
+    if (strncmp(line, "Slab:", 5) == 0) {
+      // reported in kB
+      bytes += strtoull(line + 5, NULL, 10) * 1024ull;
+      break;
+    }
+  }
+  while (fgets(line, sizeof(line), sockstat)) {
+    const char* mem = strstr(line, " mem ");
+    if (strncmp(line, "TCP:", 4) == 0 && mem) {
+      // reported in pages
+      bytes += strtoull(mem + 5, NULL, 10) * (uint64_t)sysconf(_SC_PAGESIZE);
+      break;
+    }
+  }
+
+  fclose(meminfo);
+  fclose(sockstat);
+  *bytes_out = bytes;
+  return 0;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(bytes_out);
+  return -1;
+#endif
+}
+
+static int
+open_connections(const size_t connection_count,
+                 chif_net_socket* listeners,
+                 const size_t listener_count,
+                 chif_net_socket* clients,
+                 chif_net_socket* servers)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+
+  for (size_t i = 0; i < connection_count; ++i) {
+    const chif_net_socket listener = listeners[i % listener_count];
+    chif_net_address server_addr;
+    server_addr.address_family = af;
+    OK_OR_CRASH(chif_net_address_from_socket(listener, &server_addr));
+
+    OK_OR_CRASH(chif_net_open_socket(&clients[i], proto, af));
+    OK_OR_CRASH(chif_net_connect(clients[i], &server_addr));
+
+    chif_net_address client_addr;
+    client_addr.address_family = af;
+    OK_OR_CRASH(chif_net_accept(listener, &client_addr, &servers[i]));
+  }
+
+  return 0;
+}
+
+// ============================================================ //
+
+int
+main(int argc, char** argv)
+{
+  size_t connection_count = 5000;
+  double max_bytes = 0.0;
+  double max_allocations = -1.0;
+
+  int i = 0;
+  while (++i < argc) {
+    if ((char)argv[i][0] == '-') {
+      switch (argv[i][1]) {
+        case 'n': {
+          if (i + 1 < argc) {
+            connection_count = (size_t)atol(argv[++i]);
+          }
+          break;
+        }
+        case 'b': {
+          if (i + 1 < argc) {
+            max_bytes = atof(argv[++i]);
+          }
+          break;
+        }
+        case 'a': {
+          if (i + 1 < argc) {
+            max_allocations = atof(argv[++i]);
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  // two sockets per connection, and some room for the listeners and stdio
+  const size_t listener_count =
+    connection_count / connections_per_listener + 1;
+  const size_t wanted_fds = 2 * connection_count + listener_count + 32;
+  const size_t fd_limit = bench_raise_fd_limit(wanted_fds);
+  if (fd_limit < wanted_fds) {
+    const size_t reserved_fds = listener_count + 32;
+    connection_count =
+      fd_limit > reserved_fds ? (fd_limit - reserved_fds) / 2 : 0;
+    printf("note: file descriptor limit is %u, capping at %u connections\n",
+           (unsigned)fd_limit,
+           (unsigned)connection_count);
+  }
+  if (connection_count < 1) {
+    printf("need at least one connection\n");
+    return -1;
+  }
+
+  chif_net_startup();
+
+  // allocate and touch everything up front, so it is not part of the result
+  chif_net_socket* listeners = calloc(listener_count, sizeof(chif_net_socket));
+  chif_net_socket* clients = calloc(connection_count, sizeof(chif_net_socket));
+  chif_net_socket* servers = calloc(connection_count, sizeof(chif_net_socket));
+  if (!listeners || !clients || !servers) {
+    return -1;
+  }
+  memset(clients, 0xff, connection_count * sizeof(chif_net_socket));
+  memset(servers, 0xff, connection_count * sizeof(chif_net_socket));
+
+  for (size_t l = 0; l < listener_count; ++l) {
+    chif_net_address addr;
+    OK_OR_CRASH(chif_net_open_socket(&listeners[l],
+                                     CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                     CHIF_NET_ADDRESS_FAMILY_IPV4));
+    OK_OR_CRASH(chif_net_create_address_i(&addr,
+                                          "127.0.0.1",
+                                          CHIF_NET_ANY_PORT,
+                                          CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                          CHIF_NET_ADDRESS_FAMILY_IPV4));
+    OK_OR_CRASH(chif_net_bind(listeners[l], &addr));
+    OK_OR_CRASH(chif_net_listen(listeners[l], CHIF_NET_DEFAULT_BACKLOG));
+  }
+
+  const uint64_t rss_before = bench_rss_bytes();
+  uint64_t kernel_before = 0;
+  const int has_kernel = kernel_memory_bytes(&kernel_before) == 0;
+  const uint64_t allocations_before = bench_allocation_count();
+  const uint64_t allocated_before = bench_allocation_bytes();
+
+  if (open_connections(
+        connection_count, listeners, listener_count, clients, servers)) {
+    return -1;
+  }
+
+  const uint64_t allocations_after = bench_allocation_count();
+  const uint64_t allocated_after = bench_allocation_bytes();
+  const uint64_t rss_after = bench_rss_bytes();
+  uint64_t kernel_after = 0;
+  kernel_memory_bytes(&kernel_after);
+
+  const double n = (double)connection_count;
+  const double rss_per_connection =
+    rss_after > rss_before ? (double)(rss_after - rss_before) / n : 0.0;
+  const double kernel_per_connection =
+    kernel_after > kernel_before ? (double)(kernel_after - kernel_before) / n
+                                 : 0.0;
+  const double allocations_per_connection =
+    (double)(allocations_after - allocations_before) / n;
+  const double allocated_per_connection =
+    (double)(allocated_after - allocated_before) / n;
+  const double bytes_per_connection =
+    rss_per_connection + kernel_per_connection;
+
+  printf("%u idle loopback TCP connections (client and server side)\n",
+         (unsigned)connection_count);
+  printf("%-32s %12.1f\n", "process RSS bytes/connection", rss_per_connection);
+  if (has_kernel) {
+    printf("%-32s %12.1f\n", "kernel bytes/connection", kernel_per_connection);
+  } else {
+    printf("%-32s %12s\n", "kernel bytes/connection", "n/a");
+  }
+  printf("%-32s %12.1f\n", "total bytes/connection", bytes_per_connection);
+  if (bench_allocations_supported()) {
+    printf("%-32s %12.2f (%.1f bytes)\n",
+           "allocations/connection",
+           allocations_per_connection,
+           allocated_per_connection);
+  } else {
+    printf("%-32s %12s\n", "allocations/connection", "n/a");
+  }
+
+  int ret = 0;
+  if (max_bytes > 0.0 && bytes_per_connection > max_bytes) {
+    printf("FAIL: %.1f bytes/connection exceeds the budget of %.1f\n",
+           bytes_per_connection,
+           max_bytes);
+    ret = 1;
+  }
+  if (max_allocations >= 0.0 && bench_allocations_supported() &&
+      allocations_per_connection > max_allocations) {
+    printf("FAIL: %.2f allocations/connection exceeds the budget of %.2f\n",
+           allocations_per_connection,
+           max_allocations);
+    ret = 1;
+  }
+
+  for (size_t c = 0; c < connection_count; ++c) {
+    chif_net_close_socket(&clients[c]);
+    chif_net_close_socket(&servers[c]);
+  }
+  for (size_t l = 0; l < listener_count; ++l) {
+    chif_net_close_socket(&listeners[l]);
+  }
+  free(listeners);
+  free(clients);
+  free(servers);
+
+  chif_net_shutdown();
+  return ret;
+}
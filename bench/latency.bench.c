@@ -0,0 +1,423 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Ping-pong latency benchmark.
+ *
+ * A server thread echoes every message back to the client, and the client
+ * measures the round-trip time of each message with a monotonic clock. The
+ * results are recorded in an HDR-style histogram, so the tail latency is
+ * visible and not hidden behind an average.
+ *
+ * With -b the client waits for each reply with chif_net_poll_spin, spinning
+ * for up to the given number of microseconds, and busy polls the socket. The
+ * spin statistics are printed after the histogram.
+ *
+ * With -x the same runs are made over unix sockets, to compare same-host IPC
+ * with loopback TCP and UDP.
+ *
+ * usage: latency_bench [-n iterations] [-w warmup] [-s message size]
+ *                      [-b spin us] [-4] [-6] [-x] [-t] [-u]
+ */
+
+#include "bench.h"
+#include <alf_thread.h>
+#include <chif_net.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================ //
+
+enum
+{
+  max_message_size = 65000
+};
+
+static const char* server_path = "chif_net_latency_bench.sock";
+static const char* client_path = "chif_net_latency_bench_client.sock";
+
+typedef struct
+{
+  chif_net_socket listen_socket;
+  chif_net_transport_protocol proto;
+  chif_net_address_family af;
+  size_t message_size;
+} echo_server_args;
+
+typedef struct
+{
+  chif_net_address_family af;
+  chif_net_transport_protocol proto;
+  size_t message_size;
+  int iterations;
+  int warmup;
+  int spin_us;
+} latency_args;
+
+// ============================================================ //
+
+static chif_net_result
+write_all(const chif_net_socket socket, const uint8_t* buf, const size_t size)
+{
+  size_t written = 0;
+  while (written < size) {
+    int bytes;
+    const chif_net_result res =
+      chif_net_write(socket, buf + written, size - written, &bytes);
+    if (res) {
+      return res;
+    }
+    written += (size_t)bytes;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+read_all(const chif_net_socket socket, uint8_t* buf, const size_t size)
+{
+  size_t read = 0;
+  while (read < size) {
+    int bytes;
+    const chif_net_result res =
+      chif_net_read(socket, buf + read, size - read, &bytes);
+    if (res) {
+      return res;
+    }
+    read += (size_t)bytes;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static uint32_t
+echo_server(void* argument)
+{
+  const echo_server_args* args = (const echo_server_args*)argument;
+  uint8_t* buf = malloc(max_message_size);
+  if (!buf) {
+    return 1;
+  }
+
+  // big enough for an address of any family
+  chif_net_unix_address addr;
+  if (args->proto == CHIF_NET_TRANSPORT_PROTOCOL_TCP) {
+    addr.address_family = args->af;
+    chif_net_socket client;
+    if (chif_net_accept(
+          args->listen_socket, (chif_net_address*)&addr, &client) ==
+        CHIF_NET_RESULT_SUCCESS) {
+      chif_net_tcp_set_nodelay(client, CHIF_NET_TRUE);
+      while (read_all(client, buf, args->message_size) ==
+               CHIF_NET_RESULT_SUCCESS &&
+             write_all(client, buf, args->message_size) ==
+               CHIF_NET_RESULT_SUCCESS) {
+      }
+      chif_net_close_socket(&client);
+    }
+  } else {
+    for (;;) {
+      addr.address_family = args->af;
+      int bytes;
+      if (chif_net_readfrom(args->listen_socket,
+                            buf,
+                            max_message_size,
+                            &bytes,
+                            (chif_net_address*)&addr) !=
+            CHIF_NET_RESULT_SUCCESS ||
+          bytes == 0) {
+        // a zero length datagram tells us to stop
+        break;
+      }
+      chif_net_writeto(args->listen_socket,
+                       buf,
+                       (size_t)bytes,
+                       &bytes,
+                       (chif_net_address*)&addr);
+    }
+  }
+
+  free(buf);
+  return 0;
+}
+
+// ============================================================ //
+
+static int
+run_latency(const latency_args* args,
+            bench_histogram* histogram,
+            chif_net_spin_stats* spin_stats)
+{
+  const char* loopback =
+    args->af == CHIF_NET_ADDRESS_FAMILY_IPV4 ? "127.0.0.1" : "::1";
+  const int is_unix = args->af == CHIF_NET_ADDRESS_FAMILY_UNIX;
+
+  chif_net_socket server;
+  OK_OR_CRASH(chif_net_open_socket(&server, args->proto, args->af));
+  chif_net_unix_address server_storage;
+  chif_net_address* server_addr = (chif_net_address*)&server_storage;
+  if (is_unix) {
+    remove(server_path);
+    OK_OR_CRASH(chif_net_create_unix_address(&server_storage, server_path));
+    OK_OR_CRASH(chif_net_bind(server, server_addr));
+  } else {
+    OK_OR_CRASH(chif_net_create_address_i(
+      server_addr, loopback, CHIF_NET_ANY_PORT, args->proto, args->af));
+    OK_OR_CRASH(chif_net_bind(server, server_addr));
+    server_addr->address_family = args->af;
+    OK_OR_CRASH(chif_net_address_from_socket(server, server_addr));
+  }
+  if (args->proto == CHIF_NET_TRANSPORT_PROTOCOL_TCP) {
+    OK_OR_CRASH(chif_net_listen(server, CHIF_NET_DEFAULT_BACKLOG));
+    // the client talks first, accept once it has, where supported
+    chif_net_tcp_set_defer_accept(server, 1);
+  }
+
+  echo_server_args server_args;
+  server_args.listen_socket = server;
+  server_args.proto = args->proto;
+  server_args.af = args->af;
+  server_args.message_size = args->message_size;
+  AlfThread* thread = alfCreateThread(echo_server, &server_args);
+
+  chif_net_socket client;
+  OK_OR_CRASH(chif_net_open_socket(&client, args->proto, args->af));
+  if (is_unix && args->proto == CHIF_NET_TRANSPORT_PROTOCOL_UDP) {
+    // unix datagrams can only be answered if the sender has a name
+    chif_net_unix_address client_addr;
+    remove(client_path);
+    OK_OR_CRASH(chif_net_create_unix_address(&client_addr, client_path));
+    OK_OR_CRASH(chif_net_bind(client, (chif_net_address*)&client_addr));
+  }
+  OK_OR_CRASH(chif_net_connect(client, server_addr));
+  if (args->proto == CHIF_NET_TRANSPORT_PROTOCOL_TCP) {
+    if (!is_unix) {
+      OK_OR_CRASH(chif_net_tcp_set_nodelay(client, CHIF_NET_TRUE));
+    }
+  } else {
+    // a lost datagram should not hang the benchmark
+    OK_OR_CRASH(chif_net_set_recv_timeout(client, 1000));
+  }
+  chif_net_check check;
+  check.socket = client;
+  check.request_events = CHIF_NET_CHECK_EVENT_READ;
+  check.return_events = 0;
+  if (args->spin_us > 0) {
+    // needs CAP_NET_ADMIN above net.core.busy_read, spin without it then
+    chif_net_set_busy_poll(client, args->spin_us);
+  }
+
+  uint8_t* buf = calloc(1, args->message_size);
+  if (!buf) {
+    return -1;
+  }
+
+  int lost = 0;
+  for (int i = 0; i < args->warmup + args->iterations; ++i) {
+    const uint64_t start = bench_now_ns();
+    chif_net_result result = write_all(client, buf, args->message_size);
+    if (!result && args->spin_us > 0) {
+      int ready_count;
+      result = chif_net_poll_spin(
+        &check, 1, &ready_count, args->spin_us, 1000, spin_stats);
+    }
+    if (!result) {
+      result = read_all(client, buf, args->message_size);
+    }
+    const uint64_t stop = bench_now_ns();
+
+    if (result == CHIF_NET_RESULT_NO_FREE_PORT /* EAGAIN, timed out */ &&
+        args->proto == CHIF_NET_TRANSPORT_PROTOCOL_UDP) {
+      ++lost;
+      continue;
+    }
+    OK_OR_CRASH(result);
+    if (i >= args->warmup) {
+      bench_histogram_record(histogram, stop - start);
+    }
+  }
+
+  // stop the server
+  if (args->proto == CHIF_NET_TRANSPORT_PROTOCOL_UDP) {
+    int bytes;
+    chif_net_write(client, buf, 0, &bytes);
+  }
+  chif_net_close_socket(&client);
+  alfJoinThread(thread);
+  chif_net_close_socket(&server);
+  free(buf);
+  if (is_unix) {
+    remove(server_path);
+    remove(client_path);
+  }
+
+  if (lost) {
+    printf("warning: %d datagrams lost\n", lost);
+  }
+  return 0;
+}
+
+// ============================================================ //
+
+int
+main(int argc, char** argv)
+{
+  int iterations = 100000;
+  int warmup = 1000;
+  size_t message_size = 64;
+  int spin_us = 0;
+  int run_ipv4 = 0;
+  int run_ipv6 = 0;
+  int run_unix = 0;
+  int run_tcp = 0;
+  int run_udp = 0;
+
+  int i = 0;
+  while (++i < argc) {
+    if ((char)argv[i][0] == '-') {
+      switch (argv[i][1]) {
+        case 'n': {
+          if (i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+          }
+          break;
+        }
+        case 'w': {
+          if (i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+          }
+          break;
+        }
+        case 's': {
+          if (i + 1 < argc) {
+            message_size = (size_t)atoi(argv[++i]);
+          }
+          break;
+        }
+        case 'b': {
+          if (i + 1 < argc) {
+            spin_us = atoi(argv[++i]);
+          }
+          break;
+        }
+        case '4': {
+          run_ipv4 = 1;
+          break;
+        }
+        case '6': {
+          run_ipv6 = 1;
+          break;
+        }
+        case 'x': {
+          run_unix = 1;
+          break;
+        }
+        case 't': {
+          run_tcp = 1;
+          break;
+        }
+        case 'u': {
+          run_udp = 1;
+          break;
+        }
+      }
+    }
+  }
+  if (!run_ipv4 && !run_ipv6 && !run_unix) {
+    run_ipv4 = run_ipv6 = run_unix = 1;
+  }
+  if (!run_tcp && !run_udp) {
+    run_tcp = run_udp = 1;
+  }
+  if (message_size < 1 || message_size > max_message_size) {
+    printf("message size must be on the range [1, %d]\n", max_message_size);
+    return -1;
+  }
+
+  chif_net_startup();
+  alfThreadStartup();
+
+  bench_histogram histogram;
+  if (bench_histogram_init(&histogram)) {
+    return -1;
+  }
+
+  printf("round-trip latency, %d iterations, %d warmup, %u byte messages\n",
+         iterations,
+         warmup,
+         (unsigned)message_size);
+  bench_histogram_print_header();
+
+  const chif_net_transport_protocol protos[] = {
+    CHIF_NET_TRANSPORT_PROTOCOL_TCP, CHIF_NET_TRANSPORT_PROTOCOL_UDP
+  };
+  const chif_net_address_family afs[] = { CHIF_NET_ADDRESS_FAMILY_IPV4,
+                                          CHIF_NET_ADDRESS_FAMILY_IPV6,
+                                          CHIF_NET_ADDRESS_FAMILY_UNIX };
+  int ret = 0;
+  for (int p = 0; p < 2 && !ret; ++p) {
+    if ((protos[p] == CHIF_NET_TRANSPORT_PROTOCOL_TCP && !run_tcp) ||
+        (protos[p] == CHIF_NET_TRANSPORT_PROTOCOL_UDP && !run_udp)) {
+      continue;
+    }
+    for (int a = 0; a < 3 && !ret; ++a) {
+      if ((afs[a] == CHIF_NET_ADDRESS_FAMILY_IPV4 && !run_ipv4) ||
+          (afs[a] == CHIF_NET_ADDRESS_FAMILY_IPV6 && !run_ipv6) ||
+          (afs[a] == CHIF_NET_ADDRESS_FAMILY_UNIX && !run_unix)) {
+        continue;
+      }
+
+      latency_args args;
+      args.af = afs[a];
+      args.proto = protos[p];
+      args.message_size = message_size;
+      args.iterations = iterations;
+      args.warmup = warmup;
+      args.spin_us = spin_us;
+
+      bench_histogram_reset(&histogram);
+      chif_net_spin_stats spin_stats = { 0, 0, 0, 0 };
+      ret = run_latency(&args, &histogram, &spin_stats);
+      if (!ret) {
+        char name[32];
+        snprintf(name,
+                 sizeof(name),
+                 "%s %s",
+                 chif_net_transport_protocol_to_string(args.proto),
+                 chif_net_address_family_to_string(args.af));
+        bench_histogram_print(&histogram, name);
+        if (spin_stats.polls) {
+          printf("  spin: %.1f%% hits, %.2f us spun per wait\n",
+                 100.0 * (double)spin_stats.spin_hits /
+                   (double)spin_stats.polls,
+                 (double)spin_stats.spin_ns / 1000.0 /
+                   (double)spin_stats.polls);
+        }
+      }
+    }
+  }
+
+  bench_histogram_free(&histogram);
+  alfThreadShutdown();
+  chif_net_shutdown();
+  return ret;
+}
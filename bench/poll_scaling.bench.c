@@ -0,0 +1,323 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Readiness backend scaling benchmark.
+ *
+ * Registers from 100 up to 100,000 UDP sockets with a readiness backend, of
+ * which only a small active fraction ever becomes ready. A sender thread
+ * makes one active socket ready per round, by sending it a datagram that
+ * carries the send timestamp, and the waiting thread records how long it
+ * took until the backend reported the socket as ready and it was found in
+ * the result set. CPU time of the waiting thread is reported per event.
+ *
+ * chif_net currently offers chif_net_poll (poll, or WSAPoll on Windows) as
+ * its only readiness backend. New backends are benchmarked by adding them to
+ * the backends table.
+ *
+ * usage: poll_scaling_bench [-r rounds] [-a active per mille] [-m max fds]
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// for RUSAGE_THREAD
+#define _GNU_SOURCE
+#endif
+
+#include "bench.h"
+#include <alf_thread.h>
+#include <chif_net.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/resource.h>
+#endif
+
+// ============================================================ //
+
+typedef chif_net_result (*wait_function)(chif_net_check* check,
+                                         size_t check_count,
+                                         int* ready_count_out,
+                                         int timeout_ms);
+
+typedef struct
+{
+  const char* name;
+  wait_function wait;
+} backend;
+
+static const backend backends[] = { { "poll", chif_net_poll } };
+
+typedef struct
+{
+  chif_net_socket sender;
+  const chif_net_address* active_addrs;
+  size_t active_count;
+  int rounds;
+  AlfSemaphore* go;
+} sender_args;
+
+// ============================================================ //
+
+/**
+ * @return CPU time (user + system) used by the calling thread, in ns, or 0
+ * if not available.
+ */
+static uint64_t
+thread_cpu_ns(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+  return 0;
+#else
+#if defined(__linux__)
+  const int who = RUSAGE_THREAD;
+#else
+  const int who = RUSAGE_SELF;
+#endif
+  struct rusage usage;
+  getrusage(who, &usage);
+  return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) *
+           1000000000ull +
+         ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) *
+           1000ull;
+#endif
+}
+
+static uint32_t
+sender(void* argument)
+{
+  const sender_args* args = (const sender_args*)argument;
+
+  for (int i = 0; i < args->rounds; ++i) {
+    alfAcquireSemaphore(args->go);
+    const chif_net_address* to = &args->active_addrs[i % args->active_count];
+    const uint64_t now = bench_now_ns();
+    int bytes;
+    chif_net_writeto(
+      args->sender, (const uint8_t*)&now, sizeof(now), &bytes, to);
+  }
+
+  return 0;
+}
+
+// ============================================================ //
+
+static int
+run_scaling(const backend* backend,
+            const size_t fd_count,
+            const size_t active_count,
+            const int rounds,
+            bench_histogram* histogram,
+            double* cpu_per_event_us_out)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_UDP;
+
+  chif_net_check* checks = calloc(fd_count, sizeof(chif_net_check));
+  chif_net_address* active_addrs =
+    calloc(active_count, sizeof(chif_net_address));
+  if (!checks || !active_addrs) {
+    return -1;
+  }
+
+  chif_net_address bind_addr;
+  OK_OR_CRASH(chif_net_create_address_i(
+    &bind_addr, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+
+  // Idle sockets are left unbound, so they never become readable. The
+  // active sockets are spread evenly over the check array.
+  const size_t stride = fd_count / active_count;
+  size_t active = 0;
+  for (size_t i = 0; i < fd_count; ++i) {
+    OK_OR_CRASH(chif_net_open_socket(&checks[i].socket, proto, af));
+    checks[i].request_events = CHIF_NET_CHECK_EVENT_READ;
+    checks[i].return_events = 0;
+    if (i % stride == 0 && active < active_count) {
+      OK_OR_CRASH(chif_net_bind(checks[i].socket, &bind_addr));
+      active_addrs[active].address_family = af;
+      OK_OR_CRASH(
+        chif_net_address_from_socket(checks[i].socket, &active_addrs[active]));
+      ++active;
+    }
+  }
+
+  sender_args args;
+  OK_OR_CRASH(chif_net_open_socket(&args.sender, proto, af));
+  args.active_addrs = active_addrs;
+  args.active_count = active;
+  args.rounds = rounds;
+  args.go = alfCreateSemaphore(0);
+  AlfThread* thread = alfCreateThread(sender, &args);
+
+  uint64_t events = 0;
+  const uint64_t cpu_start = thread_cpu_ns();
+  for (int round = 0; round < rounds; ++round) {
+    alfReleaseSemaphore(args.go);
+
+    int ready_count = 0;
+    while (ready_count == 0) {
+      OK_OR_CRASH(backend->wait(checks, fd_count, &ready_count, 1000));
+    }
+
+    for (size_t i = 0; i < fd_count && ready_count > 0; ++i) {
+      if (!(checks[i].return_events & CHIF_NET_CHECK_EVENT_READ)) {
+        continue;
+      }
+      --ready_count;
+      uint64_t sent_ns;
+      int bytes;
+      OK_OR_CRASH(chif_net_read(
+        checks[i].socket, (uint8_t*)&sent_ns, sizeof(sent_ns), &bytes));
+      bench_histogram_record(histogram, bench_now_ns() - sent_ns);
+      ++events;
+    }
+  }
+  const uint64_t cpu_stop = thread_cpu_ns();
+
+  alfJoinThread(thread);
+  alfDeleteSemaphore(args.go);
+  chif_net_close_socket(&args.sender);
+  for (size_t i = 0; i < fd_count; ++i) {
+    chif_net_close_socket(&checks[i].socket);
+  }
+  free(checks);
+  free(active_addrs);
+
+  *cpu_per_event_us_out =
+    events ? (double)(cpu_stop - cpu_start) / (double)events / 1000.0 : 0.0;
+  return 0;
+}
+
+// ============================================================ //
+
+int
+main(int argc, char** argv)
+{
+  int rounds = 2000;
+  int active_per_mille = 10;
+  size_t max_fds = 100000;
+
+  int i = 0;
+  while (++i < argc) {
+    if ((char)argv[i][0] == '-') {
+      switch (argv[i][1]) {
+        case 'r': {
+          if (i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+          }
+          break;
+        }
+        case 'a': {
+          if (i + 1 < argc) {
+            active_per_mille = atoi(argv[++i]);
+          }
+          break;
+        }
+        case 'm': {
+          if (i + 1 < argc) {
+            max_fds = (size_t)atol(argv[++i]);
+          }
+          break;
+        }
+      }
+    }
+  }
+  if (rounds < 1 || active_per_mille < 1 || active_per_mille > 1000) {
+    printf("rounds must be positive and active per mille on [1, 1000]\n");
+    return -1;
+  }
+
+  // leave some room for stdio, the sender socket and so on
+  const size_t reserved_fds = 32;
+  const size_t fd_limit = bench_raise_fd_limit(max_fds + reserved_fds);
+  if (fd_limit <= reserved_fds) {
+    printf("file descriptor limit is %u, need more than %u\n",
+           (unsigned)fd_limit,
+           (unsigned)reserved_fds);
+    return -1;
+  }
+  if (fd_limit < max_fds + reserved_fds) {
+    printf("note: file descriptor limit is %u, capping the socket count\n",
+           (unsigned)fd_limit);
+    max_fds = fd_limit - reserved_fds;
+  }
+
+  chif_net_startup();
+  alfThreadStartup();
+
+  bench_histogram histogram;
+  if (bench_histogram_init(&histogram)) {
+    return -1;
+  }
+
+  printf("readiness wakeup latency, %d rounds, %d per mille active\n",
+         rounds,
+         active_per_mille);
+
+  const size_t fd_counts[] = { 100, 1000, 10000, 100000 };
+  const size_t fd_counts_length = sizeof(fd_counts) / sizeof(fd_counts[0]);
+  const size_t backends_length = sizeof(backends) / sizeof(backends[0]);
+  int ret = 0;
+  for (size_t b = 0; b < backends_length && !ret; ++b) {
+    bench_histogram_print_header();
+    for (size_t f = 0; f < fd_counts_length && !ret; ++f) {
+      size_t fd_count = fd_counts[f];
+      if (fd_count > max_fds) {
+        if (f > 0 && fd_counts[f - 1] >= max_fds) {
+          break;
+        }
+        fd_count = max_fds;
+      }
+      size_t active_count = fd_count * (size_t)active_per_mille / 1000;
+      if (active_count < 1) {
+        active_count = 1;
+      }
+
+      bench_histogram_reset(&histogram);
+      double cpu_per_event_us;
+      ret = run_scaling(&backends[b],
+                        fd_count,
+                        active_count,
+                        rounds,
+                        &histogram,
+                        &cpu_per_event_us);
+      if (!ret) {
+        char name[48];
+        snprintf(name,
+                 sizeof(name),
+                 "%s %u/%u",
+                 backends[b].name,
+                 (unsigned)active_count,
+                 (unsigned)fd_count);
+        bench_histogram_print(&histogram, name);
+        printf("%-24s %10s %10.2f us cpu/event\n", "", "", cpu_per_event_us);
+      }
+    }
+  }
+
+  bench_histogram_free(&histogram);
+  alfThreadShutdown();
+  chif_net_shutdown();
+  return ret;
+}
@@ -48,22 +48,52 @@
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
 #if defined(__linux__)
+#include <linux/errqueue.h>
+#include <linux/filter.h>
 #include <linux/icmp.h>
+#include <linux/net_tstamp.h>
 #endif
 
 #include <assert.h>
 #include <stdint.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #if defined(CHIF_NET_BERKLEY_SOCKET)
 #include <netdb.h>
 #endif
 
+// not in the headers of older C libraries
+#if defined(__linux__) && !defined(SO_BUSY_POLL)
+#define SO_BUSY_POLL 46
+#endif
+#if defined(__linux__) && !defined(SO_PREFER_BUSY_POLL)
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#if defined(__linux__) && !defined(TCP_FASTOPEN_CONNECT)
+#define TCP_FASTOPEN_CONNECT 30
+#endif
+#if defined(__linux__) && !defined(SO_MAX_PACING_RATE)
+#define SO_MAX_PACING_RATE 47
+#endif
+#if defined(__linux__) && !defined(SO_TXTIME)
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
+#endif
+#if defined(__linux__) && !defined(SO_INCOMING_CPU)
+#define SO_INCOMING_CPU 49
+#endif
+#if defined(__linux__) && !defined(SO_ATTACH_REUSEPORT_CBPF)
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
 // ============================================================ //
 // Types
 // ============================================================ //
@@ -73,10 +103,81 @@ typedef TIMEVAL timeval;
 typedef unsigned long nfds_t;
 #endif
 
+// ============================================================ //
+// Options
+// ============================================================ //
+
+typedef struct
+{
+  int level;
+  int name; // 0 if the platform does not have the option
+  const char* string;
+} chif_net_option_info;
+
+#if !defined(TCP_KEEPIDLE) && defined(TCP_KEEPALIVE)
+#define TCP_KEEPIDLE TCP_KEEPALIVE
+#endif
+
+/**
+ * Indexed by chif_net_option.
+ */
+static const chif_net_option_info chif_net_options[] = {
+  { IPPROTO_TCP, TCP_NODELAY, "TCP_NODELAY" },
+  { SOL_SOCKET, SO_SNDBUF, "SEND_BUFFER" },
+  { SOL_SOCKET, SO_RCVBUF, "RECV_BUFFER" },
+  { SOL_SOCKET, SO_KEEPALIVE, "KEEPALIVE" },
+#if defined(TCP_KEEPIDLE)
+  { IPPROTO_TCP, TCP_KEEPIDLE, "TCP_KEEPIDLE" },
+#else
+  { IPPROTO_TCP, 0, "TCP_KEEPIDLE" },
+#endif
+#if defined(TCP_KEEPINTVL)
+  { IPPROTO_TCP, TCP_KEEPINTVL, "TCP_KEEPINTVL" },
+#else
+  { IPPROTO_TCP, 0, "TCP_KEEPINTVL" },
+#endif
+#if defined(TCP_KEEPCNT)
+  { IPPROTO_TCP, TCP_KEEPCNT, "TCP_KEEPCNT" },
+#else
+  { IPPROTO_TCP, 0, "TCP_KEEPCNT" },
+#endif
+#if defined(TCP_QUICKACK)
+  { IPPROTO_TCP, TCP_QUICKACK, "TCP_QUICKACK" },
+#else
+  { IPPROTO_TCP, 0, "TCP_QUICKACK" },
+#endif
+#if defined(TCP_NOTSENT_LOWAT)
+  { IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT" },
+#else
+  { IPPROTO_TCP, 0, "TCP_NOTSENT_LOWAT" },
+#endif
+#if defined(TCP_USER_TIMEOUT)
+  { IPPROTO_TCP, TCP_USER_TIMEOUT, "TCP_USER_TIMEOUT" },
+#else
+  { IPPROTO_TCP, 0, "TCP_USER_TIMEOUT" },
+#endif
+};
+
+#if defined(__linux__)
+/**
+ * struct sock_txtime of linux/net_tstamp.h, which older C libraries lack.
+ */
+typedef struct
+{
+  clockid_t clockid;
+  uint32_t flags;
+} chif_net_sock_txtime;
+#endif
+
 // ============================================================ //
 // Static Asserts
 // ============================================================ //
 
+CHIF_NET_STATIC_ASSERT(sizeof(chif_net_options) /
+                           sizeof(chif_net_options[0]) ==
+                         CHIF_NET_OPTION_COUNT,
+                       option_table_complete);
+
 CHIF_NET_STATIC_ASSERT((int64_t)CHIF_NET_TRANSPORT_PROTOCOL_TCP ==
                          (int64_t)IPPROTO_TCP,
                        ipproto_tcp_correct_value);
@@ -84,6 +185,12 @@ CHIF_NET_STATIC_ASSERT((int64_t)CHIF_NET_TRANSPORT_PROTOCOL_UDP ==
                          (int64_t)IPPROTO_UDP,
                        ipproto_udp_correct_value);
 
+CHIF_NET_STATIC_ASSERT((int64_t)CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED ==
+                         (int64_t)AF_UNSPEC,
+                       af_unspecified_correct_value);
+CHIF_NET_STATIC_ASSERT((int64_t)CHIF_NET_ADDRESS_FAMILY_UNIX ==
+                         (int64_t)AF_UNIX,
+                       af_unix_correct_value);
 CHIF_NET_STATIC_ASSERT((int64_t)CHIF_NET_ADDRESS_FAMILY_IPV4 ==
                          (int64_t)AF_INET,
                        af_ipv4_correct_value);
@@ -94,6 +201,14 @@ CHIF_NET_STATIC_ASSERT((int64_t)CHIF_NET_ADDRESS_FAMILY_IPV6 ==
 CHIF_NET_STATIC_ASSERT(sizeof(chif_net_ipv6_address) ==
                          sizeof(struct sockaddr_in6),
                        ipv6_address_struct_correct_size);
+#if defined(__linux__)
+CHIF_NET_STATIC_ASSERT(sizeof(chif_net_unix_address) ==
+                         sizeof(struct sockaddr_un),
+                       unix_address_struct_correct_size);
+#endif
+CHIF_NET_STATIC_ASSERT(sizeof(chif_net_address) >=
+                         sizeof(struct sockaddr_in6),
+                       address_struct_fits_ipv6);
 
 CHIF_NET_STATIC_ASSERT((int64_t)CHIF_NET_CHECK_EVENT_WRITE == POLLOUT,
                        check_write_correct_value);
@@ -113,11 +228,13 @@ CHIF_NET_STATIC_ASSERT(sizeof(chif_net_check) == sizeof(struct pollfd),
 // Static functions
 // ============================================================ //
 
+/**
+ * Translate a socket error code, as found in errno, GetLastError or SO_ERROR.
+ */
 static chif_net_result
-_chif_net_get_specific_result_type(void)
+_chif_net_error_to_result(const int error)
 {
 #if defined(CHIF_NET_WINSOCK2)
-  const DWORD error = GetLastError();
   // TODO handle more errors on windows
   switch (error) {
     case WSANOTINITIALISED:
@@ -199,7 +316,7 @@ _chif_net_get_specific_result_type(void)
   }
 
 #elif defined(CHIF_NET_BERKLEY_SOCKET)
-  switch (errno) {
+  switch (error) {
     case ENOTSOCK:
       return CHIF_NET_RESULT_NOT_A_SOCKET;
 
@@ -295,6 +412,19 @@ _chif_net_get_specific_result_type(void)
     default:
       return CHIF_NET_RESULT_UNKNOWN;
   }
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(error);
+  return CHIF_NET_RESULT_UNKNOWN;
+#endif
+}
+
+static chif_net_result
+_chif_net_get_specific_result_type(void)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  return _chif_net_error_to_result((int)GetLastError());
+#elif defined(CHIF_NET_BERKLEY_SOCKET)
+  return _chif_net_error_to_result(errno);
 #else
   return CHIF_NET_RESULT_UNKNOWN;
 #endif
@@ -409,6 +539,90 @@ _chif_net_poll(const chif_net_socket socket,
   return CHIF_NET_RESULT_SUCCESS;
 }
 
+/**
+ * Result of a non-blocking connect, once poll has reported events for it.
+ *
+ * @param return_events The events that poll returned for the socket.
+ */
+static chif_net_result
+_chif_net_connect_result(const chif_net_socket socket,
+                         const short return_events)
+{
+  chif_net_result error = CHIF_NET_RESULT_SUCCESS;
+  const chif_net_result res = chif_net_get_socket_error(socket, &error);
+  if (res) {
+    return res;
+  }
+  if (!error && !(return_events & POLLOUT)) {
+    // hung up without an error
+    error = CHIF_NET_RESULT_CONNECTION_CLOSED;
+  }
+  return error;
+}
+
+/**
+ * @param deadline_ms In chif_net_time_ms time, or UINT64_MAX for none.
+ * @return Time left until the deadline as a poll timeout.
+ */
+static int
+_chif_net_remaining_ms(const uint64_t deadline_ms)
+{
+  if (deadline_ms == UINT64_MAX) {
+    return -1;
+  }
+  const uint64_t now = chif_net_time_ms();
+  if (deadline_ms <= now) {
+    return 0;
+  }
+  const uint64_t remaining = deadline_ms - now;
+  return remaining > INT32_MAX ? INT32_MAX : (int)remaining;
+}
+
+static uint64_t
+_chif_net_deadline_ms(const int timeout_ms)
+{
+  return timeout_ms < 0 ? UINT64_MAX
+                        : chif_net_time_ms() + (uint64_t)timeout_ms;
+}
+
+#if defined(__linux__)
+static uint64_t
+_chif_net_timespec_ns(const struct timespec* time)
+{
+  return (uint64_t)time->tv_sec * 1000000000 + (uint64_t)time->tv_nsec;
+}
+
+/**
+ * Fill in a timestamp from the control messages of recvmsg. TX timestamps
+ * also come with the extended error that tells which write they are for.
+ */
+static void
+_chif_net_timestamp_from_msg(struct msghdr* msg,
+                             chif_net_timestamp* timestamp_out)
+{
+  memset(timestamp_out, 0, sizeof(*timestamp_out));
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg;
+       cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET &&
+        cmsg->cmsg_type == SO_TIMESTAMPING) {
+      struct scm_timestamping timestamping;
+      memcpy(&timestamping, CMSG_DATA(cmsg), sizeof(timestamping));
+      timestamp_out->software_ns = _chif_net_timespec_ns(&timestamping.ts[0]);
+      timestamp_out->hardware_ns = _chif_net_timespec_ns(&timestamping.ts[2]);
+    } else if ((cmsg->cmsg_level == SOL_IP &&
+                cmsg->cmsg_type == IP_RECVERR) ||
+               (cmsg->cmsg_level == SOL_IPV6 &&
+                cmsg->cmsg_type == IPV6_RECVERR)) {
+      struct sock_extended_err error;
+      memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+      if (error.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+        timestamp_out->id = error.ee_data;
+      }
+    }
+  }
+}
+#endif
+
 static socklen_t
 _chif_net_address_size_from_address_family(
   const chif_net_address_family address_family)
@@ -418,158 +632,1003 @@ _chif_net_address_size_from_address_family(
     addrlen = sizeof(struct sockaddr_in);
   } else if (address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
     addrlen = sizeof(struct sockaddr_in6);
+  } else if (address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    addrlen = sizeof(chif_net_unix_address);
   } else {
     return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
   }
   return addrlen;
 }
 
-// ====================================================================== //
-// Implementation
-// ====================================================================== //
-
-chif_net_result
-chif_net_startup(void)
+/**
+ * Length of a unix address for the socket calls. An abstract name ends where
+ * the name does, as the kernel takes the rest of the path to be part of it,
+ * and an unnamed address, with an empty path, is only the address family.
+ */
+static socklen_t
+_chif_net_unix_address_size(const chif_net_address* address)
 {
-#if defined(CHIF_NET_WINSOCK2)
-  WSADATA winsock_data;
-  const int result = WSAStartup(WINSOCK_VERSION, &winsock_data);
-  if (result != 0) {
-    return CHIF_NET_RESULT_FAIL;
+  const chif_net_unix_address* unix_address =
+    (const chif_net_unix_address*)address;
+  if (unix_address->path[0] != '\0') {
+    return sizeof(chif_net_unix_address);
   }
-#endif
-  return CHIF_NET_RESULT_SUCCESS;
+
+  const char* name = unix_address->path + 1;
+  const char* end = memchr(name, '\0', CHIF_NET_UNIX_PATH_LENGTH - 1);
+  const size_t length =
+    end ? (size_t)(end - name) : CHIF_NET_UNIX_PATH_LENGTH - 1;
+  if (length == 0) {
+    return sizeof(uint16_t);
+  }
+  return (socklen_t)(sizeof(uint16_t) + 1 + length);
 }
 
-chif_net_result
-chif_net_shutdown(void)
+/**
+ * Write the path of a unix address, with "@" in front of an abstract name,
+ * and nothing for an unnamed address.
+ */
+static chif_net_result
+_chif_net_unix_address_to_string(const chif_net_address* address,
+                                 char* str_out,
+                                 const size_t strlen,
+                                 size_t* written_out)
 {
-#if defined(CHIF_NET_WINSOCK2)
-  const int32_t result = WSACleanup();
-  if (result == WSAEINPROGRESS) {
-    return CHIF_NET_RESULT_BLOCKING;
-  } else if (result != 0) {
-    return CHIF_NET_RESULT_FAIL;
+  const chif_net_unix_address* unix_address =
+    (const chif_net_unix_address*)address;
+  const char* path = unix_address->path;
+  size_t prefix_length = 0;
+  size_t length;
+  if (path[0] == '\0') {
+    const size_t size = _chif_net_unix_address_size(address);
+    prefix_length = size > sizeof(uint16_t) ? 1 : 0;
+    path += prefix_length;
+    length = size - sizeof(uint16_t) - prefix_length;
+  } else {
+    const char* end = memchr(path, '\0', CHIF_NET_UNIX_PATH_LENGTH);
+    length = end ? (size_t)(end - path) : CHIF_NET_UNIX_PATH_LENGTH;
+  }
+  if (prefix_length + length >= strlen) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
+
+  if (prefix_length) {
+    str_out[0] = '@';
+  }
+  memcpy(str_out + prefix_length, path, length);
+  str_out[prefix_length + length] = '\0';
+  if (written_out) {
+    *written_out = prefix_length + length;
   }
-#endif
   return CHIF_NET_RESULT_SUCCESS;
 }
 
-chif_net_result
-chif_net_open_socket(chif_net_socket* socket_out,
-                     const chif_net_transport_protocol transport_protocol,
-                     const chif_net_address_family address_family)
+/**
+ * Clear a unix address before the kernel fills it in, so that an abstract or
+ * unnamed address has no garbage after it.
+ */
+static void
+_chif_net_unix_address_clear(chif_net_unix_address* address)
 {
-  const int domain = address_family;
-  const int protocol = transport_protocol;
+  memset(address, 0, sizeof(chif_net_unix_address));
+  address->address_family = CHIF_NET_ADDRESS_FAMILY_UNIX;
+}
 
-  int type;
-  switch (transport_protocol) {
-    case CHIF_NET_TRANSPORT_PROTOCOL_TCP: {
-      type = SOCK_STREAM;
-      break;
+/**
+ * Whether the kernel gave back a unix address where an IP address was asked
+ * for. It does not fit a chif_net_address, only a chif_net_unix_address.
+ */
+static int
+_chif_net_got_unix_address(const void* addr, const socklen_t addrlen)
+{
+  uint16_t address_family;
+  if (addrlen < sizeof(address_family)) {
+    return 0;
+  }
+  memcpy(&address_family, addr, sizeof(address_family));
+  return address_family == CHIF_NET_ADDRESS_FAMILY_UNIX;
+}
+
+/**
+ * Strictly parse a dotted-quad IPv4 literal, such as "10.0.0.1".
+ *
+ * Forms that inet_aton also accepts, like "10.1" or "010.0.0.1" (octal), are
+ * rejected here, so the caller can leave them to getaddrinfo.
+ *
+ * @param str Null terminated string.
+ * @param address_out The address in network byte order.
+ * @return 1 if str is a dotted-quad literal, otherwise 0.
+ */
+static int
+_chif_net_parse_ipv4(const char* str, uint8_t* address_out)
+{
+  for (int i = 0; i < 4; ++i) {
+    if (*str < '0' || *str > '9') {
+      return 0;
     }
-    case CHIF_NET_TRANSPORT_PROTOCOL_UDP: {
-      type = SOCK_DGRAM;
-      break;
+    if (str[0] == '0' && str[1] >= '0' && str[1] <= '9') {
+      return 0;
+    }
+    unsigned value = 0;
+    int digits = 0;
+    while (*str >= '0' && *str <= '9') {
+      value = value * 10 + (unsigned)(*str - '0');
+      ++str;
+      if (++digits > 3) {
+        return 0;
+      }
+    }
+    if (value > 255) {
+      return 0;
+    }
+    address_out[i] = (uint8_t)value;
+    if (i < 3) {
+      if (*str != '.') {
+        return 0;
+      }
+      ++str;
     }
-    default:
-      return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
   }
+  return *str == '\0';
+}
 
-  *socket_out = socket(domain, type, protocol);
-
-  if (*socket_out == CHIF_NET_INVALID_SOCKET) {
-    return _chif_net_get_specific_result_type();
+static int
+_chif_net_hex_value(const char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
   }
-
-  return CHIF_NET_RESULT_SUCCESS;
+  return -1;
 }
 
-chif_net_result
-chif_net_close_socket(chif_net_socket* socket_out)
+/**
+ * Parse an IPv6 literal as described in RFC 4291 section 2.2, such as "::1",
+ * "2001:db8::8:800:200c:417a" or "::ffff:10.0.0.1".
+ *
+ * Zone indices ("fe80::1%eth0") are not handled and are left to getaddrinfo.
+ *
+ * @param str Null terminated string.
+ * @param address_out The address in network byte order.
+ * @return 1 if str is an IPv6 literal, otherwise 0.
+ */
+static int
+_chif_net_parse_ipv6(const char* str, uint8_t* address_out)
 {
-  if (*socket_out != CHIF_NET_INVALID_SOCKET) {
-    // Close the socket
-#if defined(CHIF_NET_WINSOCK2)
-    const int result = closesocket(*socket_out);
-#elif defined(CHIF_NET_BERKLEY_SOCKET)
-    const int result = close(*socket_out);
-#else
-    return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
-#endif
+  uint16_t groups[8];
+  int count = 0;
+  int gap = -1;
 
-    // Set socket to invalid to prevent usage of closed socket.
-    *socket_out = CHIF_NET_INVALID_SOCKET;
-
-    if (result == -1) {
-      return _chif_net_get_specific_result_type();
+  if (str[0] == ':') {
+    if (str[1] != ':') {
+      return 0;
     }
+    gap = 0;
+    str += 2;
   }
 
-  return CHIF_NET_RESULT_SUCCESS;
-}
+  while (*str != '\0') {
+    const char* group_start = str;
+    unsigned value = 0;
+    int digits = 0;
+    int hex;
+    while ((hex = _chif_net_hex_value(*str)) >= 0) {
+      value = (value << 4) | (unsigned)hex;
+      ++str;
+      if (++digits > 4) {
+        break;
+      }
+    }
 
-chif_net_result
-chif_net_connect(const chif_net_socket socket, const chif_net_address* address)
-{
-  int result;
-  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
-    struct sockaddr_in addr;
-    memcpy(&addr, address, sizeof(chif_net_ipv4_address));
-    memset(((uint8_t*)&addr) + sizeof(chif_net_ipv4_address),
-           0,
-           sizeof(struct sockaddr_in) - sizeof(chif_net_ipv4_address));
-    result = connect(socket, (const struct sockaddr*)&addr, sizeof(addr));
-  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
-    result = connect(
-      socket, (const struct sockaddr*)address, sizeof(chif_net_ipv6_address));
-  } else {
-    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+    if (*str == '.') {
+      // trailing dotted-quad, takes up the last two groups
+      uint8_t ipv4[4];
+      if (count > 6 || !_chif_net_parse_ipv4(group_start, ipv4)) {
+        return 0;
+      }
+      groups[count++] = (uint16_t)((ipv4[0] << 8) | ipv4[1]);
+      groups[count++] = (uint16_t)((ipv4[2] << 8) | ipv4[3]);
+      break;
+    }
+
+    if (digits == 0 || digits > 4 || count == 8) {
+      return 0;
+    }
+    groups[count++] = (uint16_t)value;
+
+    if (*str == ':') {
+      ++str;
+      if (*str == ':') {
+        if (gap >= 0) {
+          return 0;
+        }
+        gap = count;
+        ++str;
+      } else if (*str == '\0') {
+        return 0;
+      }
+    } else if (*str != '\0') {
+      return 0;
+    }
   }
 
-  if (result == -1) {
-    return _chif_net_get_specific_result_type();
+  if ((gap < 0 && count != 8) || (gap >= 0 && count == 8)) {
+    return 0;
   }
 
-  return CHIF_NET_RESULT_SUCCESS;
+  // expand the "::" gap with zeroes
+  const int zeroes = 8 - count;
+  for (int i = 0, g = 0; i < 8; ++i) {
+    uint16_t group;
+    if (gap >= 0 && i >= gap && i < gap + zeroes) {
+      group = 0;
+    } else {
+      group = groups[g++];
+    }
+    address_out[i * 2] = (uint8_t)(group >> 8);
+    address_out[i * 2 + 1] = (uint8_t)(group & 0xff);
+  }
+  return 1;
 }
 
-chif_net_result
-chif_net_bind(const chif_net_socket socket, const chif_net_address* address)
+/**
+ * Parse a numeric service, such as "80".
+ *
+ * @param service Null terminated string, or NULL for port 0.
+ * @param port_out Port in host byte order.
+ * @return 1 if service is a number on the range [0, 65535], otherwise 0.
+ */
+static int
+_chif_net_parse_port(const char* service, chif_net_port* port_out)
 {
-  int result;
-  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
-    struct sockaddr_in addr;
-    memcpy(&addr, address, sizeof(chif_net_ipv4_address));
-    memset(((uint8_t*)&addr) + sizeof(chif_net_ipv4_address),
-           0,
-           sizeof(struct sockaddr_in) - sizeof(chif_net_ipv4_address));
-    result = bind(socket, (const struct sockaddr*)&addr, sizeof(addr));
-  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
-    result = bind(
-      socket, (const struct sockaddr*)address, sizeof(chif_net_ipv6_address));
-  } else {
-    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  if (service == NULL) {
+    *port_out = 0;
+    return 1;
   }
 
-  if (result != 0) {
-    return _chif_net_get_specific_result_type();
+  uint32_t value = 0;
+  const char* c = service;
+  while (*c >= '0' && *c <= '9') {
+    value = value * 10 + (uint32_t)(*c - '0');
+    if (value > 65535) {
+      return 0;
+    }
+    ++c;
+  }
+  if (c == service || *c != '\0') {
+    return 0;
   }
 
-  return CHIF_NET_RESULT_SUCCESS;
+  *port_out = (chif_net_port)value;
+  return 1;
 }
 
-chif_net_result
-chif_net_listen(const chif_net_socket socket, const int maximum_backlog)
+/**
+ * Fill in the address without getaddrinfo, if name is a numeric literal of
+ * the given address family, or NULL for the wildcard address.
+ *
+ * @return 1 if the address was filled in, 0 if getaddrinfo is needed.
+ */
+static int
+_chif_net_create_numeric_address(
+  chif_net_address* address_out,
+  const char* name,
+  const chif_net_port port,
+  const chif_net_transport_protocol transport_protocol,
+  const chif_net_address_family address_family)
 {
-  const int result = listen(socket, maximum_backlog);
+  if (transport_protocol != CHIF_NET_TRANSPORT_PROTOCOL_TCP &&
+      transport_protocol != CHIF_NET_TRANSPORT_PROTOCOL_UDP) {
+    return 0;
+  }
 
-  if (result != 0) {
-    return _chif_net_get_specific_result_type();
+  if (address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    uint8_t address[4] = { 0, 0, 0, 0 };
+    if (name != NULL && !_chif_net_parse_ipv4(name, address)) {
+      return 0;
+    }
+    chif_net_ipv4_address* ipv4 = (chif_net_ipv4_address*)address_out;
+    ipv4->address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    ipv4->port = htons(port);
+    memcpy(&ipv4->address, address, sizeof(address));
+    return 1;
+  } else if (address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    uint8_t address[16];
+    memset(address, 0, sizeof(address));
+    if (name != NULL && !_chif_net_parse_ipv6(name, address)) {
+      return 0;
+    }
+    chif_net_ipv6_address* ipv6 = (chif_net_ipv6_address*)address_out;
+    ipv6->address_family = CHIF_NET_ADDRESS_FAMILY_IPV6;
+    ipv6->port = htons(port);
+    ipv6->flowinfo = 0;
+    memcpy(ipv6->address, address, sizeof(address));
+    ipv6->scope_id = 0;
+    return 1;
   }
 
-  return CHIF_NET_RESULT_SUCCESS;
+  return 0;
+}
+
+static size_t
+_chif_net_address_size(const chif_net_address* address)
+{
+  return address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4
+           ? sizeof(chif_net_ipv4_address)
+           : sizeof(chif_net_ipv6_address);
+}
+
+/**
+ * Fill in the addresses by calling getaddrinfo, in the order it returns
+ * them, skipping duplicates.
+ */
+static chif_net_result
+_chif_net_getaddrinfo(chif_net_address* addresses_out,
+                      const size_t address_capacity,
+                      size_t* address_count_out,
+                      const char* name,
+                      const char* service,
+                      const chif_net_transport_protocol transport_protocol,
+                      const chif_net_address_family address_family)
+{
+  struct addrinfo hints, *ai;
+  memset(&hints, 0, sizeof(hints));
+
+  hints.ai_family = address_family;
+  hints.ai_protocol = transport_protocol;
+  switch (transport_protocol) {
+    case CHIF_NET_TRANSPORT_PROTOCOL_TCP:
+      hints.ai_socktype = SOCK_STREAM;
+      break;
+    case CHIF_NET_TRANSPORT_PROTOCOL_UDP:
+      // fall through
+    default:
+      hints.ai_socktype = SOCK_DGRAM;
+  }
+
+  if (name == NULL) {
+    hints.ai_flags = AI_PASSIVE; // wildcard IP address
+  }
+
+  struct addrinfo* result_list;
+  const int result = getaddrinfo(name, service, &hints, &result_list);
+  if (result != 0) {
+    // no need to freeaddrinfo() here
+    return _chif_net_ai_error_to_result(result);
+  }
+
+  size_t count = 0;
+  for (ai = result_list; ai != NULL && count < address_capacity;
+       ai = ai->ai_next) {
+    chif_net_address* address = &addresses_out[count];
+    switch (ai->ai_family) {
+      case CHIF_NET_ADDRESS_FAMILY_IPV4: {
+        memcpy(address, ai->ai_addr, sizeof(chif_net_ipv4_address));
+        break;
+      }
+      case CHIF_NET_ADDRESS_FAMILY_IPV6: {
+        memcpy(address, ai->ai_addr, sizeof(struct sockaddr_in6));
+        break;
+      }
+      default:
+        continue;
+    }
+
+    int duplicate = 0;
+    for (size_t i = 0; i < count && !duplicate; ++i) {
+      duplicate = addresses_out[i].address_family == address->address_family &&
+                  memcmp(&addresses_out[i],
+                         address,
+                         _chif_net_address_size(address)) == 0;
+    }
+    if (!duplicate) {
+      ++count;
+    }
+  }
+
+  freeaddrinfo(result_list);
+
+  *address_count_out = count;
+  if (count == 0) {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+/**
+ * Precedence of the address in the RFC 6724 default policy table.
+ */
+static int
+_chif_net_address_precedence(const chif_net_address* address)
+{
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    return 35; // ::ffff:0:0/96
+  }
+
+  const uint8_t* a =
+    (const uint8_t*)((const chif_net_ipv6_address*)address)->address;
+  static const uint8_t zeros[16] = { 0 };
+  if (memcmp(a, zeros, 15) == 0 && a[15] == 1) {
+    return 50; // ::1/128
+  }
+  if (memcmp(a, zeros, 10) == 0 && a[10] == 0xff && a[11] == 0xff) {
+    return 35; // ::ffff:0:0/96
+  }
+  if (a[0] == 0x20 && a[1] == 0x02) {
+    return 30; // 2002::/16
+  }
+  if (a[0] == 0x20 && a[1] == 0x01 && a[2] == 0 && a[3] == 0) {
+    return 5; // 2001::/32
+  }
+  if ((a[0] & 0xfe) == 0xfc) {
+    return 3; // fc00::/7
+  }
+  if (memcmp(a, zeros, 12) == 0 || (a[0] == 0xfe && (a[1] & 0xc0) == 0xc0) ||
+      (a[0] == 0x3f && a[1] == 0xfe)) {
+    return 1; // ::/96, fec0::/10, 3ffe::/16
+  }
+  return 40; // ::/0
+}
+
+/**
+ * Scope of the address, as in RFC 6724 section 3.1.
+ */
+static int
+_chif_net_address_scope(const chif_net_address* address)
+{
+  enum
+  {
+    scope_link_local = 0x2,
+    scope_site_local = 0x5,
+    scope_global = 0xe
+  };
+
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    const uint8_t* a =
+      (const uint8_t*)&((const chif_net_ipv4_address*)address)->address;
+    if (a[0] == 127 || (a[0] == 169 && a[1] == 254)) {
+      return scope_link_local;
+    }
+    return scope_global;
+  }
+
+  const uint8_t* a =
+    (const uint8_t*)((const chif_net_ipv6_address*)address)->address;
+  if (a[0] == 0xff) {
+    return a[1] & 0x0f; // multicast
+  }
+  static const uint8_t loopback[16] = { [15] = 1 };
+  if (memcmp(a, loopback, 16) == 0 || (a[0] == 0xfe && (a[1] & 0xc0) == 0x80)) {
+    return scope_link_local;
+  }
+  if (a[0] == 0xfe && (a[1] & 0xc0) == 0xc0) {
+    return scope_site_local;
+  }
+  return scope_global;
+}
+
+static const char _chif_net_digit_pairs[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536"
+  "37383940414243444546474849505152535455565758596061626364656667686970717273"
+  "7475767778798081828384858687888990919293949596979899";
+
+static const char _chif_net_hex_digits[17] = "0123456789abcdef";
+
+/**
+ * Write the decimal representation of value, without null terminator.
+ *
+ * @return Number of chars written, at most 5.
+ */
+static size_t
+_chif_net_format_u16(char* out, const uint16_t value)
+{
+  char buf[5];
+  char* c = buf + sizeof(buf);
+  unsigned v = value;
+  while (v >= 100) {
+    const unsigned pair = (v % 100) * 2;
+    v /= 100;
+    *--c = _chif_net_digit_pairs[pair + 1];
+    *--c = _chif_net_digit_pairs[pair];
+  }
+  if (v >= 10) {
+    *--c = _chif_net_digit_pairs[v * 2 + 1];
+    *--c = _chif_net_digit_pairs[v * 2];
+  } else {
+    *--c = (char)('0' + v);
+  }
+  const size_t length = (size_t)(buf + sizeof(buf) - c);
+  memcpy(out, c, length);
+  return length;
+}
+
+static size_t
+_chif_net_format_ipv4(char* out, const uint8_t* address)
+{
+  char* c = out;
+  for (int i = 0; i < 4; ++i) {
+    c += _chif_net_format_u16(c, address[i]);
+    *c++ = '.';
+  }
+  return (size_t)(c - out) - 1;
+}
+
+/**
+ * Write the IPv6 address in the RFC 5952 canonical form: lowercase, no
+ * leading zeros, and the longest (first, if tied) run of two or more zero
+ * groups replaced with "::". IPv4-mapped addresses end in a dotted-quad.
+ */
+static size_t
+_chif_net_format_ipv6(char* out, const uint8_t* address)
+{
+  uint16_t groups[8];
+  for (int i = 0; i < 8; ++i) {
+    groups[i] = (uint16_t)((address[i * 2] << 8) | address[i * 2 + 1]);
+  }
+
+  int best_start = -1;
+  int best_length = 1;
+  for (int i = 0; i < 8;) {
+    if (groups[i] != 0) {
+      ++i;
+      continue;
+    }
+    int j = i;
+    while (j < 8 && groups[j] == 0) {
+      ++j;
+    }
+    if (j - i > best_length) {
+      best_start = i;
+      best_length = j - i;
+    }
+    i = j;
+  }
+
+  const int ipv4_mapped = best_start == 0 && best_length == 5 &&
+                          groups[5] == 0xffff;
+  const int group_count = ipv4_mapped ? 6 : 8;
+
+  char* c = out;
+  for (int i = 0; i < group_count; ++i) {
+    if (i == best_start) {
+      *c++ = ':';
+      if (i == 0) {
+        *c++ = ':';
+      }
+      i += best_length - 1;
+      continue;
+    }
+
+    const uint16_t group = groups[i];
+    int shift = 12;
+    while (shift > 0 && ((group >> shift) & 0xf) == 0) {
+      shift -= 4;
+    }
+    for (; shift >= 0; shift -= 4) {
+      *c++ = _chif_net_hex_digits[(group >> shift) & 0xf];
+    }
+    if (i < 7) {
+      *c++ = ':';
+    }
+  }
+
+  if (ipv4_mapped) {
+    c += _chif_net_format_ipv4(c, address + 12);
+  }
+  return (size_t)(c - out);
+}
+
+/**
+ * @param out Must fit CHIF_NET_ADDRESS_STRING_LENGTH chars.
+ * @param with_port Append the port, and put IPv6 addresses in brackets.
+ * @return Number of chars written without null terminator, or 0 if the
+ * address family is not supported.
+ */
+static size_t
+_chif_net_format_address(char* out,
+                         const chif_net_address* address,
+                         const int with_port)
+{
+  char* c = out;
+  chif_net_port port;
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    const chif_net_ipv4_address* ipv4 = (const chif_net_ipv4_address*)address;
+    c += _chif_net_format_ipv4(c, (const uint8_t*)&ipv4->address);
+    port = ipv4->port;
+  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    const chif_net_ipv6_address* ipv6 = (const chif_net_ipv6_address*)address;
+    if (with_port) {
+      *c++ = '[';
+    }
+    c += _chif_net_format_ipv6(c, (const uint8_t*)ipv6->address);
+    if (with_port) {
+      *c++ = ']';
+    }
+    port = ipv6->port;
+  } else {
+    return 0;
+  }
+
+  if (with_port) {
+    *c++ = ':';
+    c += _chif_net_format_u16(c, ntohs(port));
+  }
+  *c = '\0';
+  return (size_t)(c - out);
+}
+
+// ====================================================================== //
+// Implementation
+// ====================================================================== //
+
+chif_net_result
+chif_net_startup(void)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  WSADATA winsock_data;
+  const int result = WSAStartup(WINSOCK_VERSION, &winsock_data);
+  if (result != 0) {
+    return CHIF_NET_RESULT_FAIL;
+  }
+#endif
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_shutdown(void)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  const int32_t result = WSACleanup();
+  if (result == WSAEINPROGRESS) {
+    return CHIF_NET_RESULT_BLOCKING;
+  } else if (result != 0) {
+    return CHIF_NET_RESULT_FAIL;
+  }
+#endif
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_open_socket(chif_net_socket* socket_out,
+                     const chif_net_transport_protocol transport_protocol,
+                     const chif_net_address_family address_family)
+{
+  const int domain = address_family;
+  // unix sockets have no transport protocol, only the socket type
+  const int protocol =
+    address_family == CHIF_NET_ADDRESS_FAMILY_UNIX ? 0 : transport_protocol;
+
+  int type;
+  switch (transport_protocol) {
+    case CHIF_NET_TRANSPORT_PROTOCOL_TCP: {
+      type = SOCK_STREAM;
+      break;
+    }
+    case CHIF_NET_TRANSPORT_PROTOCOL_UDP: {
+      type = SOCK_DGRAM;
+      break;
+    }
+    default:
+      return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+
+  *socket_out = socket(domain, type, protocol);
+
+  if (*socket_out == CHIF_NET_INVALID_SOCKET) {
+    return _chif_net_get_specific_result_type();
+  }
+
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_open_socket_pair(const chif_net_transport_protocol transport_protocol,
+                          chif_net_socket sockets_out[2])
+{
+#if defined(CHIF_NET_BERKLEY_SOCKET)
+  int type;
+  switch (transport_protocol) {
+    case CHIF_NET_TRANSPORT_PROTOCOL_TCP: {
+      type = SOCK_STREAM;
+      break;
+    }
+    case CHIF_NET_TRANSPORT_PROTOCOL_UDP: {
+      type = SOCK_DGRAM;
+      break;
+    }
+    default:
+      return CHIF_NET_RESULT_INVALID_TRANSPORT_PROTOCOL;
+  }
+
+  if (socketpair(AF_UNIX, type, 0, sockets_out) == -1) {
+    return _chif_net_get_specific_result_type();
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(transport_protocol);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(sockets_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_close_socket(chif_net_socket* socket_out)
+{
+  if (*socket_out != CHIF_NET_INVALID_SOCKET) {
+    // Close the socket
+#if defined(CHIF_NET_WINSOCK2)
+    const int result = closesocket(*socket_out);
+#elif defined(CHIF_NET_BERKLEY_SOCKET)
+    const int result = close(*socket_out);
+#else
+    return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+
+    // Set socket to invalid to prevent usage of closed socket.
+    *socket_out = CHIF_NET_INVALID_SOCKET;
+
+    if (result == -1) {
+      return _chif_net_get_specific_result_type();
+    }
+  }
+
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_connect(const chif_net_socket socket, const chif_net_address* address)
+{
+  int result;
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    struct sockaddr_in addr;
+    memcpy(&addr, address, sizeof(chif_net_ipv4_address));
+    memset(((uint8_t*)&addr) + sizeof(chif_net_ipv4_address),
+           0,
+           sizeof(struct sockaddr_in) - sizeof(chif_net_ipv4_address));
+    result = connect(socket, (const struct sockaddr*)&addr, sizeof(addr));
+  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    result = connect(
+      socket, (const struct sockaddr*)address, sizeof(chif_net_ipv6_address));
+  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    result = connect(socket,
+                     (const struct sockaddr*)address,
+                     _chif_net_unix_address_size(address));
+  } else {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+
+  if (result == -1) {
+    return _chif_net_get_specific_result_type();
+  }
+
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_tcp_connect_with_data(const chif_net_socket socket,
+                               const chif_net_address* address,
+                               const uint8_t* buf,
+                               const size_t bufsize,
+                               int* sent_bytes_out)
+{
+#if defined(MSG_FASTOPEN)
+  struct sockaddr_in6 addr;
+  socklen_t addr_size;
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    addr_size = sizeof(struct sockaddr_in);
+    memset(&addr, 0, sizeof(addr));
+    memcpy(&addr, address, sizeof(chif_net_ipv4_address));
+  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    addr_size = sizeof(struct sockaddr_in6);
+    memcpy(&addr, address, sizeof(chif_net_ipv6_address));
+  } else {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+
+  const ssize_t result = sendto(socket,
+                                buf,
+                                bufsize,
+                                MSG_FASTOPEN | MSG_NOSIGNAL,
+                                (const struct sockaddr*)&addr,
+                                addr_size);
+  if (result >= 0) {
+    if (sent_bytes_out) {
+      *sent_bytes_out = (int)result;
+    }
+    return CHIF_NET_RESULT_SUCCESS;
+  }
+  if (errno != EOPNOTSUPP) {
+    return _chif_net_get_specific_result_type();
+  }
+  // fast open is turned off by the sysctl, connect as usual
+#endif
+
+  const chif_net_result res = chif_net_connect(socket, address);
+  if (res) {
+    return res;
+  }
+  return chif_net_write(socket, buf, bufsize, sent_bytes_out);
+}
+
+chif_net_result
+chif_net_connect_start(const chif_net_socket socket,
+                       const chif_net_address* address)
+{
+  chif_net_result res = chif_net_set_blocking(socket, CHIF_NET_FALSE);
+  if (res) {
+    return res;
+  }
+
+  res = chif_net_connect(socket, address);
+  // winsock reports a pending connect as WSAEWOULDBLOCK
+  if (res == CHIF_NET_RESULT_WOULD_BLOCK) {
+    return CHIF_NET_RESULT_IN_PROGRESS;
+  }
+  return res;
+}
+
+chif_net_result
+chif_net_connect_finish(const chif_net_socket socket, const int timeout_ms)
+{
+  chif_net_check check;
+  check.socket = socket;
+  check.request_events = CHIF_NET_CHECK_EVENT_WRITE;
+  check.return_events = 0;
+  const size_t check_count = 1;
+  int ready_count;
+  const chif_net_result res =
+    chif_net_poll(&check, check_count, &ready_count, timeout_ms);
+  if (res) {
+    return res;
+  }
+  if (ready_count == 0) {
+    return CHIF_NET_RESULT_IN_PROGRESS;
+  }
+  return _chif_net_connect_result(socket, check.return_events);
+}
+
+chif_net_result
+chif_net_connect_timeout(const chif_net_socket socket,
+                         const chif_net_address* address,
+                         const int timeout_ms)
+{
+  const uint64_t deadline_ms = _chif_net_deadline_ms(timeout_ms);
+  chif_net_result res = chif_net_connect_start(socket, address);
+  while (res == CHIF_NET_RESULT_IN_PROGRESS) {
+    const int remaining_ms = _chif_net_remaining_ms(deadline_ms);
+    res = chif_net_connect_finish(socket, remaining_ms);
+    if (res == CHIF_NET_RESULT_IN_PROGRESS && remaining_ms == 0) {
+      res = CHIF_NET_RESULT_TIMEDOUT;
+    }
+  }
+
+  const chif_net_result blocking_res =
+    chif_net_set_blocking(socket, CHIF_NET_TRUE);
+  return res ? res : blocking_res;
+}
+
+chif_net_result
+chif_net_connect_many(chif_net_check* checks,
+                      chif_net_result* results_out,
+                      const size_t count,
+                      const chif_net_address* addresses,
+                      const size_t address_count,
+                      const int timeout_ms,
+                      size_t* connected_count_out)
+{
+  if (address_count == 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  // only the pending connects are polled, in a compact set of their own, so a
+  // finished connect or a socket that could not start never wakes the poll
+  const size_t capacity = count ? count : 1;
+  chif_net_check* pending_checks = malloc(capacity * sizeof(chif_net_check));
+  size_t* pending_indices = malloc(capacity * sizeof(size_t));
+  if (!pending_checks || !pending_indices) {
+    free(pending_checks);
+    free(pending_indices);
+    return CHIF_NET_RESULT_NO_MEMORY;
+  }
+
+  const uint64_t deadline_ms = _chif_net_deadline_ms(timeout_ms);
+  size_t pending = 0;
+  size_t connected = 0;
+  for (size_t i = 0; i < count; ++i) {
+    checks[i].request_events = CHIF_NET_CHECK_EVENT_WRITE;
+    checks[i].return_events = 0;
+    results_out[i] =
+      chif_net_connect_start(checks[i].socket, &addresses[i % address_count]);
+    if (results_out[i] == CHIF_NET_RESULT_IN_PROGRESS) {
+      pending_checks[pending] = checks[i];
+      pending_indices[pending] = i;
+      ++pending;
+    } else {
+      connected += results_out[i] == CHIF_NET_RESULT_SUCCESS;
+    }
+  }
+
+  chif_net_result res = CHIF_NET_RESULT_SUCCESS;
+  while (pending > 0) {
+    const int remaining_ms = _chif_net_remaining_ms(deadline_ms);
+    int ready_count;
+    res = chif_net_poll(pending_checks, pending, &ready_count, remaining_ms);
+    if (res || (ready_count == 0 && remaining_ms == 0)) {
+      break;
+    }
+
+    // a finished check is replaced by the last pending one, which is then
+    // looked at in its place
+    size_t p = 0;
+    while (p < pending && ready_count > 0) {
+      if (pending_checks[p].return_events == 0) {
+        ++p;
+        continue;
+      }
+      --ready_count;
+      const size_t i = pending_indices[p];
+      results_out[i] = _chif_net_connect_result(
+        pending_checks[p].socket, pending_checks[p].return_events);
+      connected += results_out[i] == CHIF_NET_RESULT_SUCCESS;
+      --pending;
+      pending_checks[p] = pending_checks[pending];
+      pending_indices[p] = pending_indices[pending];
+    }
+  }
+
+  for (size_t p = 0; p < pending; ++p) {
+    results_out[pending_indices[p]] = CHIF_NET_RESULT_TIMEDOUT;
+  }
+  free(pending_checks);
+  free(pending_indices);
+  if (connected_count_out) {
+    *connected_count_out = connected;
+  }
+  return res;
+}
+
+chif_net_result
+chif_net_bind(const chif_net_socket socket, const chif_net_address* address)
+{
+  int result;
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    struct sockaddr_in addr;
+    memcpy(&addr, address, sizeof(chif_net_ipv4_address));
+    memset(((uint8_t*)&addr) + sizeof(chif_net_ipv4_address),
+           0,
+           sizeof(struct sockaddr_in) - sizeof(chif_net_ipv4_address));
+    result = bind(socket, (const struct sockaddr*)&addr, sizeof(addr));
+  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    result = bind(
+      socket, (const struct sockaddr*)address, sizeof(chif_net_ipv6_address));
+  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    result = bind(socket,
+                  (const struct sockaddr*)address,
+                  _chif_net_unix_address_size(address));
+  } else {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+
+  if (result != 0) {
+    return _chif_net_get_specific_result_type();
+  }
+
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_listen(const chif_net_socket socket, const int maximum_backlog)
+{
+  const int result = listen(socket, maximum_backlog);
+
+  if (result != 0) {
+    return _chif_net_get_specific_result_type();
+  }
+
+  return CHIF_NET_RESULT_SUCCESS;
 }
 
 chif_net_result
@@ -581,19 +1640,35 @@ chif_net_accept(const chif_net_socket listening_socket,
     client_address_out->address_family);
   const socklen_t addrlen_copy = client_addrlen;
 
+  int got_unix_address = 0;
   if (client_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
     struct sockaddr_in addr;
     *client_socket_out =
       accept(listening_socket, (struct sockaddr*)&addr, &client_addrlen);
+    got_unix_address = _chif_net_got_unix_address(&addr, client_addrlen);
     memcpy(client_address_out, &addr, sizeof(chif_net_ipv4_address));
   } else if (client_address_out->address_family ==
              CHIF_NET_ADDRESS_FAMILY_IPV6) {
     *client_socket_out = accept(
       listening_socket, (struct sockaddr*)client_address_out, &client_addrlen);
+    got_unix_address =
+      _chif_net_got_unix_address(client_address_out, client_addrlen);
+  } else if (client_address_out->address_family ==
+             CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    chif_net_unix_address addr;
+    _chif_net_unix_address_clear(&addr);
+    *client_socket_out =
+      accept(listening_socket, (struct sockaddr*)&addr, &client_addrlen);
+    memcpy(client_address_out, &addr, sizeof(chif_net_unix_address));
   } else {
     return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
   }
 
+  // the connection cannot be handed out without its address
+  if (got_unix_address && *client_socket_out != CHIF_NET_INVALID_SOCKET) {
+    chif_net_close_socket(client_socket_out);
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
   if (client_addrlen > addrlen_copy) {
     return CHIF_NET_RESULT_BUFSIZE_INVALID;
   }
@@ -684,6 +1759,7 @@ chif_net_readfrom(const chif_net_socket socket,
 #endif
 
   int result;
+  int got_unix_address = 0;
   if (from_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
     struct sockaddr_in addr;
 #if defined(CHIF_NET_WINSOCK2)
@@ -697,6 +1773,7 @@ chif_net_readfrom(const chif_net_socket socket,
     result = recvfrom(
       socket, buf_out, bufsize, flag, (struct sockaddr*)&addr, &addrlen);
 #endif
+    got_unix_address = _chif_net_got_unix_address(&addr, addrlen);
     memcpy(from_address_out, &addr, sizeof(chif_net_ipv4_address));
   } else if (from_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
 #if defined(CHIF_NET_WINSOCK2)
@@ -714,6 +1791,22 @@ chif_net_readfrom(const chif_net_socket socket,
                       (struct sockaddr*)from_address_out,
                       &addrlen);
 #endif
+    got_unix_address = _chif_net_got_unix_address(from_address_out, addrlen);
+  } else if (from_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    chif_net_unix_address addr;
+    _chif_net_unix_address_clear(&addr);
+#if defined(CHIF_NET_WINSOCK2)
+    result = recvfrom(socket,
+                      (char*)buf_out,
+                      (int)bufsize,
+                      flag,
+                      (struct sockaddr*)&addr,
+                      &addrlen);
+#else
+    result = recvfrom(
+      socket, buf_out, bufsize, flag, (struct sockaddr*)&addr, &addrlen);
+#endif
+    memcpy(from_address_out, &addr, sizeof(chif_net_unix_address));
   } else {
     return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
   }
@@ -721,6 +1814,9 @@ chif_net_readfrom(const chif_net_socket socket,
   if (result == -1) {
     return _chif_net_get_specific_result_type();
   }
+  if (got_unix_address) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
   // TODO result == 0 may indicate connection closed if TCP
   /* else if (!result) { */
   /*   return CHIF_NET_RESULT_CONNECTION_CLOSED; */
@@ -833,6 +1929,22 @@ chif_net_writeto(const chif_net_socket socket,
                     flag,
                     (const struct sockaddr*)to_address,
                     sizeof(struct sockaddr_in6));
+#endif
+  } else if (to_address->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+#if defined(CHIF_NET_WINSOCK2)
+    result = sendto(socket,
+                    (const char*)buf,
+                    (int)bufsize,
+                    flag,
+                    (const struct sockaddr*)to_address,
+                    _chif_net_unix_address_size(to_address));
+#else
+    result = sendto(socket,
+                    buf,
+                    bufsize,
+                    flag,
+                    (const struct sockaddr*)to_address,
+                    _chif_net_unix_address_size(to_address));
 #endif
   } else {
     return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
@@ -849,6 +1961,356 @@ chif_net_writeto(const chif_net_socket socket,
   return CHIF_NET_RESULT_SUCCESS;
 }
 
+chif_net_result
+chif_net_readfrom_timestamp(const chif_net_socket socket,
+                            uint8_t* buf_out,
+                            const size_t bufsize,
+                            int* read_bytes_out,
+                            chif_net_address* from_address_out,
+                            chif_net_timestamp* timestamp_out)
+{
+#if defined(__linux__)
+  if (socket == CHIF_NET_INVALID_SOCKET) {
+    return CHIF_NET_RESULT_NOT_A_SOCKET;
+  }
+
+  // room for an address of any family, copied out as in chif_net_readfrom
+  chif_net_unix_address addr;
+  socklen_t addrlen = 0;
+  if (from_address_out) {
+    if (from_address_out->address_family != CHIF_NET_ADDRESS_FAMILY_IPV4 &&
+        from_address_out->address_family != CHIF_NET_ADDRESS_FAMILY_IPV6 &&
+        from_address_out->address_family != CHIF_NET_ADDRESS_FAMILY_UNIX) {
+      return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+    }
+    _chif_net_unix_address_clear(&addr);
+    addrlen = _chif_net_address_size_from_address_family(
+      from_address_out->address_family);
+  }
+  struct iovec iov;
+  iov.iov_base = buf_out;
+  iov.iov_len = bufsize;
+  union
+  {
+    char buf[CMSG_SPACE(sizeof(struct scm_timestamping))];
+    struct cmsghdr align;
+  } control;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = from_address_out ? &addr : NULL;
+  msg.msg_namelen = addrlen;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  const ssize_t result = recvmsg(socket, &msg, MSG_NOSIGNAL);
+  if (result == -1) {
+    return _chif_net_get_specific_result_type();
+  }
+  if (read_bytes_out) {
+    *read_bytes_out = (int)result;
+  }
+
+  _chif_net_timestamp_from_msg(&msg, timestamp_out);
+  if (result == 0) {
+    // unlike a datagram, a stream only reads 0 bytes once the peer closed
+    int type = 0;
+    socklen_t type_size = sizeof(type);
+    if (!getsockopt(socket, SOL_SOCKET, SO_TYPE, &type, &type_size) &&
+        type == SOCK_STREAM) {
+      return CHIF_NET_RESULT_TCP_CONNECTION_CLOSED;
+    }
+  }
+
+  if (from_address_out) {
+    if (from_address_out->address_family != CHIF_NET_ADDRESS_FAMILY_UNIX &&
+        _chif_net_got_unix_address(&addr, msg.msg_namelen)) {
+      return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+    }
+    if (msg.msg_namelen > addrlen) {
+      return CHIF_NET_RESULT_BUFSIZE_INVALID;
+    }
+    if (from_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+      memcpy(from_address_out, &addr, sizeof(chif_net_unix_address));
+    } else if (msg.msg_namelen > 0) {
+      memcpy(from_address_out,
+             &addr,
+             from_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4
+               ? sizeof(chif_net_ipv4_address)
+               : sizeof(chif_net_ipv6_address));
+    }
+  }
+  if (timestamp_out->software_ns == 0 && timestamp_out->hardware_ns == 0) {
+    return CHIF_NET_RESULT_NO_TIMESTAMP;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(buf_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(bufsize);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(read_bytes_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(from_address_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(timestamp_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_read_tx_timestamp(const chif_net_socket socket,
+                           chif_net_timestamp* timestamp_out)
+{
+#if defined(__linux__)
+  union
+  {
+    char buf[CMSG_SPACE(sizeof(struct scm_timestamping)) +
+             CMSG_SPACE(sizeof(struct sock_extended_err) +
+                        sizeof(struct sockaddr_in6))];
+    struct cmsghdr align;
+  } control;
+
+  // with SOF_TIMESTAMPING_OPT_TSONLY there is no data, only the timestamp
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  if (recvmsg(socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return CHIF_NET_RESULT_WOULD_BLOCK;
+    }
+    return _chif_net_get_specific_result_type();
+  }
+  _chif_net_timestamp_from_msg(&msg, timestamp_out);
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(timestamp_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_writeto_at(const chif_net_socket socket,
+                    const uint8_t* buf,
+                    const size_t bufsize,
+                    int* sent_bytes_out,
+                    const chif_net_address* to_address,
+                    const uint64_t launch_ns)
+{
+#if defined(__linux__)
+  if (socket == CHIF_NET_INVALID_SOCKET) {
+    return CHIF_NET_RESULT_NOT_A_SOCKET;
+  }
+
+  struct sockaddr_in6 addr;
+  socklen_t addr_size;
+  if (to_address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    addr_size = sizeof(struct sockaddr_in);
+    memset(&addr, 0, sizeof(addr));
+    memcpy(&addr, to_address, sizeof(chif_net_ipv4_address));
+  } else if (to_address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    addr_size = sizeof(struct sockaddr_in6);
+    memcpy(&addr, to_address, sizeof(chif_net_ipv6_address));
+  } else {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+
+  struct iovec iov;
+  iov.iov_base = (void*)buf;
+  iov.iov_len = bufsize;
+  union
+  {
+    char buf[CMSG_SPACE(sizeof(uint64_t))];
+    struct cmsghdr align;
+  } control;
+  memset(&control, 0, sizeof(control));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &addr;
+  msg.msg_namelen = addr_size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_TXTIME;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+  memcpy(CMSG_DATA(cmsg), &launch_ns, sizeof(launch_ns));
+
+  const ssize_t result = sendmsg(socket, &msg, MSG_NOSIGNAL);
+  if (result == -1) {
+    return _chif_net_get_specific_result_type();
+  }
+  if (sent_bytes_out) {
+    *sent_bytes_out = (int)result;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(buf);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(bufsize);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(sent_bytes_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(to_address);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(launch_ns);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_send_sockets(const chif_net_socket socket,
+                      const chif_net_socket* sockets,
+                      const size_t socket_count,
+                      const uint8_t* buf,
+                      const size_t bufsize,
+                      int* sent_bytes_out)
+{
+#if defined(CHIF_NET_BERKLEY_SOCKET)
+  if (socket == CHIF_NET_INVALID_SOCKET) {
+    return CHIF_NET_RESULT_NOT_A_SOCKET;
+  }
+  if (socket_count == 0 || socket_count > CHIF_NET_MAX_SOCKETS_PER_MESSAGE) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  uint8_t zero = 0;
+  struct iovec iov;
+  iov.iov_base = bufsize ? (void*)buf : &zero;
+  iov.iov_len = bufsize ? bufsize : 1;
+  union
+  {
+    char buf[CMSG_SPACE(sizeof(int) * CHIF_NET_MAX_SOCKETS_PER_MESSAGE)];
+    struct cmsghdr align;
+  } control;
+  const size_t sockets_size = sizeof(int) * socket_count;
+  memset(&control, 0, CMSG_SPACE(sockets_size));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = CMSG_SPACE(sockets_size);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sockets_size);
+  memcpy(CMSG_DATA(cmsg), sockets, sockets_size);
+
+  const ssize_t result = sendmsg(socket, &msg, MSG_NOSIGNAL);
+  if (result == -1) {
+    return _chif_net_get_specific_result_type();
+  }
+
+  if (sent_bytes_out) {
+    *sent_bytes_out = (int)result;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(sockets);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket_count);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(buf);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(bufsize);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(sent_bytes_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_receive_sockets(const chif_net_socket socket,
+                         chif_net_socket* sockets_out,
+                         const size_t socket_capacity,
+                         size_t* socket_count_out,
+                         uint8_t* buf_out,
+                         const size_t bufsize,
+                         int* read_bytes_out)
+{
+#if defined(CHIF_NET_BERKLEY_SOCKET)
+  if (socket == CHIF_NET_INVALID_SOCKET) {
+    return CHIF_NET_RESULT_NOT_A_SOCKET;
+  }
+  if (socket_capacity == 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  uint8_t zero;
+  struct iovec iov;
+  iov.iov_base = bufsize ? buf_out : &zero;
+  iov.iov_len = bufsize ? bufsize : 1;
+  union
+  {
+    char buf[CMSG_SPACE(sizeof(int) * CHIF_NET_MAX_SOCKETS_PER_MESSAGE)];
+    struct cmsghdr align;
+  } control;
+  // the kernel closes the sockets that do not fit in the control buffer,
+  // which is not padded, so that exactly capacity sockets fit
+  const size_t capacity = socket_capacity < CHIF_NET_MAX_SOCKETS_PER_MESSAGE
+                            ? socket_capacity
+                            : CHIF_NET_MAX_SOCKETS_PER_MESSAGE;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = CMSG_LEN(sizeof(int) * capacity);
+
+  int flags = 0;
+#if defined(MSG_CMSG_CLOEXEC)
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+  const ssize_t result = recvmsg(socket, &msg, flags);
+  if (result == -1) {
+    return _chif_net_get_specific_result_type();
+  }
+
+  // should a platform still pass more sockets than fit, close the rest
+  // rather than leak them
+  size_t count = 0;
+  int truncated = (msg.msg_flags & MSG_CTRUNC) != 0;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    const size_t cmsg_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const size_t copy_count =
+      cmsg_count < capacity - count ? cmsg_count : capacity - count;
+    memcpy(sockets_out + count, CMSG_DATA(cmsg), copy_count * sizeof(int));
+    count += copy_count;
+    for (size_t i = copy_count; i < cmsg_count; ++i) {
+      int extra;
+      memcpy(&extra, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+      close(extra);
+      truncated = 1;
+    }
+  }
+
+  *socket_count_out = count;
+  if (read_bytes_out) {
+    *read_bytes_out = (int)result;
+  }
+  if (truncated) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(sockets_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket_capacity);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket_count_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(buf_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(bufsize);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(read_bytes_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
 chif_net_result
 chif_net_poll(chif_net_check* check,
               const size_t check_count,
@@ -869,6 +2331,50 @@ chif_net_poll(chif_net_check* check,
   return CHIF_NET_RESULT_SUCCESS;
 }
 
+chif_net_result
+chif_net_poll_spin(chif_net_check* check,
+                   const size_t check_count,
+                   int* ready_count_out,
+                   const int spin_us,
+                   const int timeout_ms,
+                   chif_net_spin_stats* stats)
+{
+  chif_net_result res;
+  const uint64_t start_ns = chif_net_time_ns();
+  uint64_t spin_ns =
+    spin_us > 0 && timeout_ms != 0 ? (uint64_t)spin_us * 1000 : 0;
+  if (timeout_ms > 0 && spin_ns > (uint64_t)timeout_ms * 1000000) {
+    spin_ns = (uint64_t)timeout_ms * 1000000;
+  }
+  uint64_t now_ns = start_ns;
+  do {
+    res = chif_net_poll(check, check_count, ready_count_out, 0);
+    now_ns = chif_net_time_ns();
+  } while (!res && *ready_count_out == 0 && now_ns - start_ns < spin_ns);
+
+  if (stats) {
+    ++stats->polls;
+    stats->spin_ns += now_ns - start_ns;
+    stats->spin_hits += !res && *ready_count_out > 0 && spin_ns > 0;
+  }
+  if (res || *ready_count_out > 0 || timeout_ms == 0) {
+    return res;
+  }
+
+  int remaining_ms = -1;
+  if (timeout_ms > 0) {
+    const uint64_t spun_ms = (now_ns - start_ns) / 1000000;
+    if (spun_ms >= (uint64_t)timeout_ms) {
+      return CHIF_NET_RESULT_SUCCESS;
+    }
+    remaining_ms = timeout_ms - (int)spun_ms;
+  }
+  if (stats) {
+    ++stats->blocks;
+  }
+  return chif_net_poll(check, check_count, ready_count_out, remaining_ms);
+}
+
 chif_net_result
 chif_net_can_read(const chif_net_socket socket,
                   int* can_read_out,
@@ -891,80 +2397,94 @@ chif_net_has_error(const chif_net_socket socket, const int timeout_ms)
   int socket_no_error;
   const chif_net_result res =
     _chif_net_poll(socket, &socket_no_error, 0, timeout_ms);
-  return res;
+  if (res != CHIF_NET_RESULT_FAIL) {
+    return res;
+  }
+
+  // poll only tells that there is an error, the socket knows which one
+  chif_net_result error = CHIF_NET_RESULT_SUCCESS;
+  if (chif_net_get_socket_error(socket, &error) || !error) {
+    return res;
+  }
+  return error;
 }
 
 chif_net_result
-chif_net_set_blocking(const chif_net_socket socket,
-                      const chif_net_bool blocking)
+chif_net_get_socket_error(const chif_net_socket socket,
+                          chif_net_result* error_out)
 {
+  int error = 0;
+  socklen_t error_size = sizeof(error);
+  int result;
 #if defined(CHIF_NET_WINSOCK2)
-  u_long blocking_mode = !blocking;
-  int result = ioctlsocket(socket, (long)FIONBIO, &blocking_mode);
-  if (result != 0) {
-    return _chif_net_get_specific_result_type();
-  }
+  result =
+    getsockopt(socket, SOL_SOCKET, SO_ERROR, (char*)&error, &error_size);
 #elif defined(CHIF_NET_BERKLEY_SOCKET)
-  int flags = fcntl(socket, F_GETFL, 0);
-  if (blocking)
-    flags &= ~O_NONBLOCK;
-  else
-    flags |= O_NONBLOCK;
-  fcntl(socket, F_SETFL, flags);
+  result = getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &error_size);
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  *error_out = CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
 #endif
 
+  if (result != 0) {
+    const chif_net_result res = _chif_net_get_specific_result_type();
+    *error_out = res;
+    return res;
+  }
+
+  *error_out =
+    error == 0 ? CHIF_NET_RESULT_SUCCESS : _chif_net_error_to_result(error);
   return CHIF_NET_RESULT_SUCCESS;
 }
 
 chif_net_result
-chif_net_create_address(chif_net_address* address_out,
-                        const char* name,
-                        const char* service,
-                        const chif_net_transport_protocol transport_protocol,
-                        const chif_net_address_family address_family)
+chif_net_set_blocking(const chif_net_socket socket,
+                      const chif_net_bool blocking)
 {
-  struct addrinfo hints, *ai;
-  memset(&hints, 0, sizeof(hints));
-
-  hints.ai_family = address_family;
-  hints.ai_protocol = transport_protocol;
-  switch (transport_protocol) {
-    case CHIF_NET_TRANSPORT_PROTOCOL_TCP:
-      hints.ai_socktype = SOCK_STREAM;
-      break;
-    case CHIF_NET_TRANSPORT_PROTOCOL_UDP:
-      // fall through
-    default:
-      hints.ai_socktype = SOCK_DGRAM;
-  }
-
-  if (name == NULL) {
-    hints.ai_flags = AI_PASSIVE; // wildcard IP address
-  }
-
-  const int result = getaddrinfo(name, service, &hints, &ai);
+#if defined(CHIF_NET_WINSOCK2)
+  u_long blocking_mode = !blocking;
+  int result = ioctlsocket(socket, (long)FIONBIO, &blocking_mode);
   if (result != 0) {
-    // no need to freeaddrinfo() here
-    return _chif_net_ai_error_to_result(result);
+    return _chif_net_get_specific_result_type();
   }
+#elif defined(CHIF_NET_BERKLEY_SOCKET)
+  int flags = fcntl(socket, F_GETFL, 0);
+  if (blocking)
+    flags &= ~O_NONBLOCK;
+  else
+    flags |= O_NONBLOCK;
+  fcntl(socket, F_SETFL, flags);
+#endif
 
-  switch (ai->ai_family) {
-    case CHIF_NET_ADDRESS_FAMILY_IPV4: {
-      memcpy(address_out, ai->ai_addr, sizeof(chif_net_ipv4_address));
-      break;
-    }
-    case CHIF_NET_ADDRESS_FAMILY_IPV6: {
-      memcpy(address_out, ai->ai_addr, sizeof(struct sockaddr_in6));
-      break;
-    }
-    default:
-      freeaddrinfo(ai);
-      return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
-  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
 
-  freeaddrinfo(ai);
+chif_net_result
+chif_net_create_address(chif_net_address* address_out,
+                        const char* name,
+                        const char* service,
+                        const chif_net_transport_protocol transport_protocol,
+                        const chif_net_address_family address_family)
+{
+  // Numeric addresses do not need getaddrinfo, which allocates and may
+  // consult the name service switch even for literals.
+  chif_net_port port;
+  if ((name != NULL || service != NULL) &&
+      _chif_net_parse_port(service, &port) &&
+      _chif_net_create_numeric_address(
+        address_out, name, port, transport_protocol, address_family)) {
+    return CHIF_NET_RESULT_SUCCESS;
+  }
 
-  return CHIF_NET_RESULT_SUCCESS;
+  size_t address_count;
+  return _chif_net_getaddrinfo(address_out,
+                               1,
+                               &address_count,
+                               name,
+                               service,
+                               transport_protocol,
+                               address_family);
 }
 
 chif_net_result
@@ -974,14 +2494,122 @@ chif_net_create_address_i(chif_net_address* address_out,
                           const chif_net_transport_protocol transport_protocol,
                           const chif_net_address_family address_family)
 {
+  if (_chif_net_create_numeric_address(
+        address_out, name, port, transport_protocol, address_family)) {
+    return CHIF_NET_RESULT_SUCCESS;
+  }
+
   enum
   {
     portstrlen = 6
   };
   char portstr[portstrlen];
   snprintf(portstr, portstrlen, "%u", port);
-  return chif_net_create_address(
-    address_out, name, portstr, transport_protocol, address_family);
+  size_t address_count;
+  return _chif_net_getaddrinfo(address_out,
+                               1,
+                               &address_count,
+                               name,
+                               portstr,
+                               transport_protocol,
+                               address_family);
+}
+
+chif_net_result
+chif_net_create_addresses(chif_net_address* addresses_out,
+                          const size_t address_capacity,
+                          size_t* address_count_out,
+                          const char* name,
+                          const char* service,
+                          const chif_net_transport_protocol transport_protocol,
+                          const chif_net_address_family address_family)
+{
+  *address_count_out = 0;
+  if (address_capacity == 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  chif_net_port port;
+  if ((name != NULL || service != NULL) &&
+      _chif_net_parse_port(service, &port)) {
+    if (address_family == CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED) {
+      // a numeric name has only one family, the wildcard has both
+      if (name != NULL && (_chif_net_create_numeric_address(
+                             addresses_out,
+                             name,
+                             port,
+                             transport_protocol,
+                             CHIF_NET_ADDRESS_FAMILY_IPV4) ||
+                           _chif_net_create_numeric_address(
+                             addresses_out,
+                             name,
+                             port,
+                             transport_protocol,
+                             CHIF_NET_ADDRESS_FAMILY_IPV6))) {
+        *address_count_out = 1;
+        return CHIF_NET_RESULT_SUCCESS;
+      }
+    } else if (_chif_net_create_numeric_address(addresses_out,
+                                                name,
+                                                port,
+                                                transport_protocol,
+                                                address_family)) {
+      *address_count_out = 1;
+      return CHIF_NET_RESULT_SUCCESS;
+    }
+  }
+
+  return _chif_net_getaddrinfo(addresses_out,
+                               address_capacity,
+                               address_count_out,
+                               name,
+                               service,
+                               transport_protocol,
+                               address_family);
+}
+
+chif_net_result
+chif_net_create_unix_address(chif_net_unix_address* address_out,
+                             const char* path)
+{
+  // an abstract name is written with a leading null char instead of "@"
+  const int abstract = path[0] == '@';
+  const size_t length = strlen(path);
+  if (length == (size_t)abstract || length >= CHIF_NET_UNIX_PATH_LENGTH) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  memset(address_out, 0, sizeof(chif_net_unix_address));
+  address_out->address_family = CHIF_NET_ADDRESS_FAMILY_UNIX;
+  memcpy(address_out->path + abstract, path + abstract, length - abstract);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+void
+chif_net_sort_addresses(chif_net_address* addresses,
+                        const size_t address_count)
+{
+  // insertion sort, it is stable and there are only a handful of addresses
+  for (size_t i = 1; i < address_count; ++i) {
+    chif_net_address address;
+    memcpy(&address, &addresses[i], sizeof(chif_net_address));
+    const int precedence = _chif_net_address_precedence(&address);
+    const int scope = _chif_net_address_scope(&address);
+
+    size_t j = i;
+    while (j > 0) {
+      const chif_net_address* prev = &addresses[j - 1];
+      const int prev_precedence = _chif_net_address_precedence(prev);
+      if (prev_precedence > precedence ||
+          (prev_precedence == precedence &&
+           _chif_net_address_scope(prev) <= scope)) {
+        break;
+      }
+      memcpy(&addresses[j], prev, sizeof(chif_net_address));
+      --j;
+    }
+    memcpy(&addresses[j], &address, sizeof(chif_net_address));
+  }
 }
 
 chif_net_result
@@ -993,12 +2621,20 @@ chif_net_address_from_socket(const chif_net_socket socket,
   const socklen_t addrlen_copy = addrlen;
 
   int result;
+  int got_unix_address = 0;
   if (address_out->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
     struct sockaddr_in addr;
     result = getsockname(socket, (struct sockaddr*)&addr, &addrlen);
+    got_unix_address = _chif_net_got_unix_address(&addr, addrlen);
     memcpy(address_out, &addr, sizeof(chif_net_ipv4_address));
   } else if (address_out->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
     result = getsockname(socket, (struct sockaddr*)address_out, &addrlen);
+    got_unix_address = _chif_net_got_unix_address(address_out, addrlen);
+  } else if (address_out->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    chif_net_unix_address addr;
+    _chif_net_unix_address_clear(&addr);
+    result = getsockname(socket, (struct sockaddr*)&addr, &addrlen);
+    memcpy(address_out, &addr, sizeof(chif_net_unix_address));
   } else {
     return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
   }
@@ -1006,6 +2642,9 @@ chif_net_address_from_socket(const chif_net_socket socket,
   if (result != 0) {
     return _chif_net_get_specific_result_type();
   }
+  if (got_unix_address) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
 
   if (addrlen > addrlen_copy) {
     return CHIF_NET_RESULT_BUFSIZE_INVALID;
@@ -1023,12 +2662,20 @@ chif_net_peer_address_from_socket(const chif_net_socket socket,
   const socklen_t addrlen_copy = addrlen;
 
   int result;
+  int got_unix_address = 0;
   if (peer_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
     struct sockaddr_in addr;
     result = getpeername(socket, (struct sockaddr*)&addr, &addrlen);
+    got_unix_address = _chif_net_got_unix_address(&addr, addrlen);
     memcpy(peer_address_out, &addr, sizeof(chif_net_ipv4_address));
   } else if (peer_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
     result = getpeername(socket, (struct sockaddr*)peer_address_out, &addrlen);
+    got_unix_address = _chif_net_got_unix_address(peer_address_out, addrlen);
+  } else if (peer_address_out->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    chif_net_unix_address addr;
+    _chif_net_unix_address_clear(&addr);
+    result = getpeername(socket, (struct sockaddr*)&addr, &addrlen);
+    memcpy(peer_address_out, &addr, sizeof(chif_net_unix_address));
   } else {
     return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
   }
@@ -1036,6 +2683,9 @@ chif_net_peer_address_from_socket(const chif_net_socket socket,
   if (result != 0) {
     return _chif_net_get_specific_result_type();
   }
+  if (got_unix_address) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
 
   if (addrlen > addrlen_copy) {
     return CHIF_NET_RESULT_BUFSIZE_INVALID;
@@ -1066,23 +2716,20 @@ chif_net_ip_from_address(const chif_net_address* address,
                          char* str_out,
                          const size_t strlen)
 {
-  const char* ntop_result;
-  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
-    ntop_result = inet_ntop(address->address_family,
-                            &((const chif_net_ipv4_address*)address)->address,
-                            str_out,
-                            strlen);
-  } else /* if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) */ {
-    ntop_result = inet_ntop(address->address_family,
-                            &((const chif_net_ipv6_address*)address)->address,
-                            str_out,
-                            strlen);
-  }
-
-  if (ntop_result == NULL) {
-    return _chif_net_get_specific_result_type();
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    return _chif_net_unix_address_to_string(address, str_out, strlen, NULL);
+  }
+
+  char buf[CHIF_NET_ADDRESS_STRING_LENGTH];
+  const size_t length = _chif_net_format_address(buf, address, 0);
+  if (length == 0) {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+  if (length >= strlen) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
   }
 
+  memcpy(str_out, buf, length + 1);
   return CHIF_NET_RESULT_SUCCESS;
 }
 
@@ -1118,6 +2765,60 @@ chif_net_port_from_address(const chif_net_address* address,
   return CHIF_NET_RESULT_SUCCESS;
 }
 
+chif_net_result
+chif_net_address_to_string(const chif_net_address* address,
+                           char* str_out,
+                           const size_t strlen,
+                           size_t* written_out)
+{
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_UNIX) {
+    return _chif_net_unix_address_to_string(
+      address, str_out, strlen, written_out);
+  }
+
+  if (strlen >= CHIF_NET_ADDRESS_STRING_LENGTH) {
+    const size_t length = _chif_net_format_address(str_out, address, 1);
+    if (length == 0) {
+      return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+    }
+    if (written_out) {
+      *written_out = length;
+    }
+    return CHIF_NET_RESULT_SUCCESS;
+  }
+
+  char buf[CHIF_NET_ADDRESS_STRING_LENGTH];
+  const size_t length = _chif_net_format_address(buf, address, 1);
+  if (length == 0) {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+  if (length >= strlen) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
+
+  memcpy(str_out, buf, length + 1);
+  if (written_out) {
+    *written_out = length;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_addresses_to_string(const chif_net_address* addresses,
+                             const size_t address_count,
+                             char* strs_out,
+                             const size_t stride)
+{
+  for (size_t i = 0; i < address_count; ++i) {
+    const chif_net_result result = chif_net_address_to_string(
+      &addresses[i], strs_out + i * stride, stride, NULL);
+    if (result) {
+      return result;
+    }
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
 chif_net_result
 chif_net_get_bytes_available(const chif_net_socket socket,
                              unsigned long* bytes_available_out)
@@ -1157,6 +2858,48 @@ chif_net_set_reuse_port(const chif_net_socket socket, const chif_net_bool reuse)
 #endif
 }
 
+chif_net_result
+chif_net_set_reuse_port_cpu_steering(const chif_net_socket socket,
+                                     const uint32_t group_size)
+{
+#if defined(__linux__)
+  if (group_size == 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  // the returned index picks the socket, A = cpu % group_size
+  struct sock_filter code[] = {
+    { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },
+    { BPF_ALU | BPF_MOD | BPF_K, 0, 0, group_size },
+    { BPF_RET | BPF_A, 0, 0, 0 },
+  };
+  struct sock_fprog program;
+  program.len = sizeof(code) / sizeof(code[0]);
+  program.filter = code;
+  return _chif_net_setsockopt(
+    socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(group_size);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_get_incoming_cpu(const chif_net_socket socket, int* cpu_out)
+{
+#if defined(__linux__)
+  socklen_t cpu_size = sizeof(*cpu_out);
+  if (getsockopt(socket, SOL_SOCKET, SO_INCOMING_CPU, cpu_out, &cpu_size)) {
+    return _chif_net_get_specific_result_type();
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(cpu_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
 chif_net_result
 chif_net_set_keepalive(const chif_net_socket socket,
                        const chif_net_bool keepalive)
@@ -1246,6 +2989,203 @@ chif_net_tcp_set_syncnt(const chif_net_socket socket, const int count)
 #endif
 }
 
+chif_net_result
+chif_net_tcp_set_fastopen(const chif_net_socket socket, const int queue_length)
+{
+#if defined(TCP_FASTOPEN)
+  if (queue_length < 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  return _chif_net_setsockopt(
+    socket, IPPROTO_TCP, TCP_FASTOPEN, &queue_length, sizeof(queue_length));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(queue_length);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_set_max_pacing_rate(const chif_net_socket socket,
+                             const uint64_t bytes_per_s)
+{
+#if defined(__linux__)
+  // 32 bits works on every kernel, where ~0U is no limit
+  const uint32_t rate =
+    bytes_per_s >= UINT32_MAX ? UINT32_MAX : (uint32_t)bytes_per_s;
+  return _chif_net_setsockopt(
+    socket, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(bytes_per_s);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_set_txtime(const chif_net_socket socket,
+                    const chif_net_txtime_clock clock)
+{
+#if defined(__linux__)
+  chif_net_sock_txtime txtime;
+  txtime.clockid =
+    clock == CHIF_NET_TXTIME_CLOCK_TAI ? CLOCK_TAI : CLOCK_MONOTONIC;
+  txtime.flags = 0;
+  return _chif_net_setsockopt(
+    socket, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(clock);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+uint64_t
+chif_net_txtime_now_ns(const chif_net_txtime_clock clock)
+{
+#if defined(__linux__)
+  struct timespec now;
+  clock_gettime(clock == CHIF_NET_TXTIME_CLOCK_TAI ? CLOCK_TAI
+                                                  : CLOCK_MONOTONIC,
+                &now);
+  return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(clock);
+  return 0;
+#endif
+}
+
+chif_net_result
+chif_net_set_timestamping(const chif_net_socket socket, const int flags)
+{
+#if defined(__linux__)
+  uint32_t timestamping = 0;
+  if (flags & CHIF_NET_TIMESTAMPING_RX) {
+    timestamping |= SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (flags & CHIF_NET_TIMESTAMPING_HARDWARE) {
+      timestamping |=
+        SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    }
+  }
+  if (flags & CHIF_NET_TIMESTAMPING_TX) {
+    // number the writes, and skip looping the data back with the timestamp
+    timestamping |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                    SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (flags & CHIF_NET_TIMESTAMPING_HARDWARE) {
+      timestamping |=
+        SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    }
+  }
+  return _chif_net_setsockopt(
+    socket, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(flags);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_tcp_set_defer_accept(const chif_net_socket socket, const int timeout_s)
+{
+#if defined(CHIF_NET_HAS_TCP_DETAILS)
+  if (timeout_s < 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  return _chif_net_setsockopt(
+    socket, IPPROTO_TCP, TCP_DEFER_ACCEPT, &timeout_s, sizeof(timeout_s));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(timeout_s);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_tcp_set_fastopen_connect(const chif_net_socket socket,
+                                  const chif_net_bool fastopen_connect)
+{
+#if defined(__linux__)
+  return _chif_net_setsockopt(socket,
+                              IPPROTO_TCP,
+                              TCP_FASTOPEN_CONNECT,
+                              &fastopen_connect,
+                              sizeof(fastopen_connect));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(fastopen_connect);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_set_busy_poll(const chif_net_socket socket, const int time_us)
+{
+#if defined(__linux__)
+  if (time_us < 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  return _chif_net_setsockopt(
+    socket, SOL_SOCKET, SO_BUSY_POLL, &time_us, sizeof(time_us));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(time_us);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_set_prefer_busy_poll(const chif_net_socket socket,
+                              const chif_net_bool prefer)
+{
+#if defined(__linux__)
+  return _chif_net_setsockopt(
+    socket, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer));
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(prefer);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_set_option(const chif_net_socket socket,
+                    const chif_net_option option,
+                    const int value)
+{
+  if ((unsigned)option >= CHIF_NET_OPTION_COUNT) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  const chif_net_option_info* info = &chif_net_options[option];
+  if (info->name == 0) {
+    return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+  }
+  return _chif_net_setsockopt(
+    socket, info->level, info->name, &value, sizeof(value));
+}
+
+chif_net_result
+chif_net_get_option(const chif_net_socket socket,
+                    const chif_net_option option,
+                    int* value_out)
+{
+  if ((unsigned)option >= CHIF_NET_OPTION_COUNT) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  const chif_net_option_info* info = &chif_net_options[option];
+  if (info->name == 0) {
+    return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+  }
+  // windows may write a BOOL option as a single byte
+  *value_out = 0;
+  socklen_t value_size = sizeof(*value_out);
+  if (getsockopt(
+        socket, info->level, info->name, (char*)value_out, &value_size)) {
+    return _chif_net_get_specific_result_type();
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
 chif_net_result
 chif_net_set_ttl(const chif_net_socket socket, const int ttl)
 {
@@ -1299,6 +3239,40 @@ chif_net_set_own_iphdr(const chif_net_socket socket, const int provide_own_hdr)
 /* #endif */
 /* } */
 
+uint64_t
+chif_net_time_ms(void)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  return (uint64_t)GetTickCount64();
+#elif defined(CHIF_NET_BERKLEY_SOCKET)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+#else
+  return 0;
+#endif
+}
+
+uint64_t
+chif_net_time_ns(void)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  const uint64_t ticks = (uint64_t)counter.QuadPart;
+  const uint64_t hz = (uint64_t)frequency.QuadPart;
+  return ticks / hz * 1000000000 + ticks % hz * 1000000000 / hz;
+#elif defined(CHIF_NET_BERKLEY_SOCKET)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
 const char*
 chif_net_result_to_string(const chif_net_result result)
 {
@@ -1383,6 +3357,8 @@ chif_net_result_to_string(const chif_net_result result)
       return "INVALID_SOCKTYPE";
     case CHIF_NET_RESULT_TCP_CONNECTION_CLOSED:
       return "CHIF_NET_RESULT_TCP_CONNECTION_CLOSED";
+    case CHIF_NET_RESULT_NO_TIMESTAMP:
+      return "NO_TIMESTAMP";
   }
 
   // should never happen
@@ -1399,6 +3375,12 @@ chif_net_address_family_to_string(const chif_net_address_family address_family)
     case CHIF_NET_ADDRESS_FAMILY_IPV6: {
       return "IPv6";
     }
+    case CHIF_NET_ADDRESS_FAMILY_UNIX: {
+      return "Unix";
+    }
+    case CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED: {
+      return "Unspecified";
+    }
     default: {
       return "INVALID INPUT";
     }
@@ -1421,3 +3403,12 @@ chif_net_transport_protocol_to_string(
     }
   }
 }
+
+const char*
+chif_net_option_to_string(const chif_net_option option)
+{
+  if ((unsigned)option >= CHIF_NET_OPTION_COUNT) {
+    return "INVALID INPUT";
+  }
+  return chif_net_options[option].string;
+}
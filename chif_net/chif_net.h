@@ -89,6 +89,17 @@ extern "C"
 #define CHIF_NET_IPV6_STRING_LENGTH 46 /*INET6_ADDRSTRLEN*/
 // Can hold both ipv4 and ipv6 addresses represented as a string.
 #define CHIF_NET_IPVX_STRING_LENGTH CHIF_NET_IPV6_STRING_LENGTH
+// Can hold any address with port, as formatted by chif_net_address_to_string.
+// "[" + ipv6 + "]:" + port + null terminator.
+#define CHIF_NET_ADDRESS_STRING_LENGTH (CHIF_NET_IPV6_STRING_LENGTH + 8)
+// Size of the path of a unix address, with null terminator, as sun_path.
+#define CHIF_NET_UNIX_PATH_LENGTH 108
+// Can hold a unix address formatted by chif_net_address_to_string, which
+// puts "@" before abstract names.
+#define CHIF_NET_UNIX_STRING_LENGTH (CHIF_NET_UNIX_PATH_LENGTH + 1)
+// Most sockets that chif_net_send_sockets can pass in one message, as the
+// SCM_MAX_FD limit of Linux.
+#define CHIF_NET_MAX_SOCKETS_PER_MESSAGE 253
 
 // Use this to let the OS decide the port.
 #define CHIF_NET_ANY_PORT 0
@@ -158,7 +169,8 @@ typedef int chif_net_socket;
     CHIF_NET_RESLUT_NO_NAME,
     CHIF_NET_RESULT_BUFFER_BAD,
     CHIF_NET_RESULT_INVALID_SOCKTYPE,
-    CHIF_NET_RESULT_TCP_CONNECTION_CLOSED
+    CHIF_NET_RESULT_TCP_CONNECTION_CLOSED,
+    CHIF_NET_RESULT_NO_TIMESTAMP
   } chif_net_result;
 
   typedef enum
@@ -169,6 +181,10 @@ typedef int chif_net_socket;
 
   typedef enum
   {
+    // Either IPv4 or IPv6, only for looking up addresses.
+    CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED = 0 /*AF_UNSPEC*/,
+    // Unix domain sockets, between processes on the same host.
+    CHIF_NET_ADDRESS_FAMILY_UNIX = 1 /*AF_UNIX*/,
     CHIF_NET_ADDRESS_FAMILY_IPV4 = 2 /*AF_INET*/,
 #if defined(CHIF_NET_WINSOCK2)
     CHIF_NET_ADDRESS_FAMILY_IPV6 = 23 /*AF_INET6*/
@@ -177,6 +193,91 @@ typedef int chif_net_socket;
 #endif
   } chif_net_address_family;
 
+  /**
+   * Integer socket options, for chif_net_set_option and chif_net_get_option.
+   * Booleans are 0 or 1, times are in the unit of the option.
+   *
+   * @param CHIF_NET_OPTION_TCP_NODELAY Disable the Nagle algorithm.
+   * @param CHIF_NET_OPTION_SEND_BUFFER Send buffer size in bytes. Linux
+   * reports the double of what was set, to account for bookkeeping.
+   * @param CHIF_NET_OPTION_RECV_BUFFER Receive buffer size in bytes, reported
+   * like CHIF_NET_OPTION_SEND_BUFFER.
+   * @param CHIF_NET_OPTION_KEEPALIVE Send keepalive probes.
+   * @param CHIF_NET_OPTION_TCP_KEEPIDLE Seconds idle before the first probe.
+   * @param CHIF_NET_OPTION_TCP_KEEPINTVL Seconds between probes.
+   * @param CHIF_NET_OPTION_TCP_KEEPCNT Unanswered probes before dropping.
+   * @param CHIF_NET_OPTION_TCP_QUICKACK Acknowledge at once instead of
+   * delaying acks. Not permanent, the kernel may leave quickack mode.
+   * @param CHIF_NET_OPTION_TCP_NOTSENT_LOWAT Unsent bytes in the send buffer
+   * at which the socket stops being writable.
+   * @param CHIF_NET_OPTION_TCP_USER_TIMEOUT Milliseconds sent data may stay
+   * unacknowledged before the connection is dropped.
+   */
+  typedef enum
+  {
+    CHIF_NET_OPTION_TCP_NODELAY,
+    CHIF_NET_OPTION_SEND_BUFFER,
+    CHIF_NET_OPTION_RECV_BUFFER,
+    CHIF_NET_OPTION_KEEPALIVE,
+    CHIF_NET_OPTION_TCP_KEEPIDLE,
+    CHIF_NET_OPTION_TCP_KEEPINTVL,
+    CHIF_NET_OPTION_TCP_KEEPCNT,
+    CHIF_NET_OPTION_TCP_QUICKACK,
+    CHIF_NET_OPTION_TCP_NOTSENT_LOWAT,
+    CHIF_NET_OPTION_TCP_USER_TIMEOUT,
+    CHIF_NET_OPTION_COUNT
+  } chif_net_option;
+
+  /**
+   * What chif_net_set_timestamping has the kernel timestamp, combine with |.
+   *
+   * @param CHIF_NET_TIMESTAMPING_RX Received data, when the network stack got
+   * it, see chif_net_readfrom_timestamp.
+   * @param CHIF_NET_TIMESTAMPING_TX Sent data, when it was handed to the
+   * device, see chif_net_read_tx_timestamp.
+   * @param CHIF_NET_TIMESTAMPING_HARDWARE Also ask for timestamps from the
+   * network card. The card must have been set up for it (SIOCSHWTSTAMP, as
+   * by hwstamp_ctl or ptp4l), which needs CAP_NET_ADMIN.
+   */
+  typedef enum
+  {
+    CHIF_NET_TIMESTAMPING_RX = 1,
+    CHIF_NET_TIMESTAMPING_TX = 2,
+    CHIF_NET_TIMESTAMPING_HARDWARE = 4
+  } chif_net_timestamping_flag;
+
+  /**
+   * A kernel timestamp of sent or received data.
+   *
+   * @param software_ns Nanoseconds since the epoch (CLOCK_REALTIME), or 0 if
+   * there is none.
+   * @param hardware_ns Nanoseconds of the network card clock, or 0 if there
+   * is none.
+   * @param id For TX timestamps, which write it is for. For UDP, the number
+   * of writes before it since timestamping was enabled, and for TCP, the
+   * byte offset of the last byte of the write. 0 for RX timestamps.
+   */
+  typedef struct
+  {
+    uint64_t software_ns;
+    uint64_t hardware_ns;
+    uint32_t id;
+  } chif_net_timestamp;
+
+  /**
+   * Clock of the launch times given to chif_net_writeto_at.
+   *
+   * @param CHIF_NET_TXTIME_CLOCK_MONOTONIC For the fq qdisc, with times from
+   * chif_net_time_ns.
+   * @param CHIF_NET_TXTIME_CLOCK_TAI For the etf qdisc, which needs CLOCK_TAI
+   * times, see chif_net_txtime_now_ns.
+   */
+  typedef enum
+  {
+    CHIF_NET_TXTIME_CLOCK_MONOTONIC,
+    CHIF_NET_TXTIME_CLOCK_TAI
+  } chif_net_txtime_clock;
+
   typedef struct
   {
     uint16_t address_family;
@@ -193,9 +294,24 @@ typedef int chif_net_socket;
     uint32_t scope_id;
   } chif_net_ipv6_address;
 
+  /**
+   * Fill in with chif_net_create_unix_address. The path is null terminated,
+   * except that an abstract name (Linux only) starts with a null char.
+   */
+  typedef struct
+  {
+    uint16_t address_family;
+    char path[CHIF_NET_UNIX_PATH_LENGTH];
+  } chif_net_unix_address;
+
   /**
    * For best performance, explicitly use chif_netipv4_address when you can,
    * and cast it to chif_net_address for the function calls.
+   *
+   * Unix addresses do not fit, use chif_net_unix_address and cast it the same
+   * way, also for the address out parameters of accept and readfrom. Those
+   * return CHIF_NET_RESULT_NOT_ENOUGH_SPACE for a unix socket unless the
+   * address family is set to CHIF_NET_ADDRESS_FAMILY_UNIX.
    */
   typedef struct
   {
@@ -217,6 +333,23 @@ typedef int chif_net_socket;
     short return_events;
   } chif_net_check;
 
+  /**
+   * Counters of chif_net_poll_spin, to tune the spin budget against the CPU
+   * it burns. Zero initialize, every call adds to it.
+   *
+   * @param polls Calls to chif_net_poll_spin.
+   * @param spin_hits Calls that found an event while spinning.
+   * @param blocks Calls that fell back to a blocking wait.
+   * @param spin_ns Time spent spinning, in nanoseconds.
+   */
+  typedef struct
+  {
+    uint64_t polls;
+    uint64_t spin_hits;
+    uint64_t blocks;
+    uint64_t spin_ns;
+  } chif_net_spin_stats;
+
   /**
    * Use in conjunction with chif_net_check.
    *
@@ -271,6 +404,9 @@ typedef int chif_net_socket;
    * Open a socket that uses the specified transport protocol for data
    * transmission.
    *
+   * With CHIF_NET_ADDRESS_FAMILY_UNIX, TCP gives a stream socket and UDP a
+   * datagram socket, which skip the IP stack for processes on the same host.
+   *
    * @param socket_out
    * @param transport_protocol
    * @param address_family
@@ -281,6 +417,18 @@ typedef int chif_net_socket;
     chif_net_transport_protocol transport_protocol,
     chif_net_address_family address_family);
 
+  /**
+   * Open a pair of connected unix sockets, as stream (TCP) or datagram (UDP)
+   * sockets, such as for talking to a forked process.
+   *
+   * @param transport_protocol
+   * @param sockets_out Both sockets, close each of them.
+   * @return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED on Windows.
+   */
+  chif_net_result chif_net_open_socket_pair(
+    chif_net_transport_protocol transport_protocol,
+    chif_net_socket sockets_out[2]);
+
   /**
    * Closes a socket that was previously opened with the open socket function.
    *
@@ -300,9 +448,119 @@ typedef int chif_net_socket;
   chif_net_result chif_net_connect(chif_net_socket socket,
                                    const chif_net_address* address);
 
+  /**
+   * Connect to an address and send the first data with the SYN, using TCP
+   * Fast Open (MSG_FASTOPEN), which saves the round trip of the handshake
+   * before the data can be sent.
+   *
+   * Without a Fast Open cookie from an earlier connection to the server, the
+   * kernel asks for one and sends the data after the handshake, as a plain
+   * connect and write would. Where Fast Open is not available, on the
+   * platform or by the net.ipv4.tcp_fastopen sysctl, it is a plain connect
+   * and write. Either way, only make the first data something the server
+   * can handle twice, as a SYN with data may be repeated by the network.
+   *
+   * @pre Make sure @socket is open (call chif_net_open_socket) and TCP.
+   * @param socket
+   * @param address
+   * @param buf
+   * @param bufsize
+   * @param sent_bytes_out May be NULL. Write the rest, if any, as usual.
+   * @return As chif_net_connect. A non-blocking socket gets
+   * CHIF_NET_RESULT_IN_PROGRESS when the data could not go with the SYN,
+   * write it once the socket is writable.
+   */
+  chif_net_result chif_net_tcp_connect_with_data(
+    chif_net_socket socket,
+    const chif_net_address* address,
+    const uint8_t* buf,
+    size_t bufsize,
+    int* sent_bytes_out);
+
+  /**
+   * Start connecting to an address without blocking. The socket is set to
+   * non-blocking mode and stays that way.
+   *
+   * Wait for the socket to become writable (chif_net_poll with
+   * CHIF_NET_CHECK_EVENT_WRITE) and call chif_net_connect_finish, or call
+   * chif_net_connect_finish directly with a timeout.
+   *
+   * @pre Make sure @socket is open (call chif_net_open_socket).
+   * @param socket
+   * @param address
+   * @return CHIF_NET_RESULT_IN_PROGRESS if the connection is pending,
+   * CHIF_NET_RESULT_SUCCESS if it was established right away, else the error.
+   */
+  chif_net_result chif_net_connect_start(chif_net_socket socket,
+                                         const chif_net_address* address);
+
+  /**
+   * Complete a connect started with chif_net_connect_start.
+   *
+   * @param socket
+   * @param timeout_ms How long to wait for the connection. Use 0 to only
+   * check, and -1 to wait without a limit.
+   * @return CHIF_NET_RESULT_SUCCESS once connected,
+   * CHIF_NET_RESULT_IN_PROGRESS if the connection is still pending after
+   * timeout_ms, else the reason the connect failed, read from the socket
+   * (such as CHIF_NET_RESULT_CONNECTION_REFUSED).
+   */
+  chif_net_result chif_net_connect_finish(chif_net_socket socket,
+                                          int timeout_ms);
+
+  /**
+   * Connect to an address, giving up after a deadline. The socket is left in
+   * blocking mode.
+   *
+   * @pre Make sure @socket is open (call chif_net_open_socket).
+   * @param socket
+   * @param address
+   * @param timeout_ms Maximum time for the whole connect, -1 for no limit.
+   * @return CHIF_NET_RESULT_TIMEDOUT if the deadline passed, in which case the
+   * socket should be closed, else as chif_net_connect.
+   */
+  chif_net_result chif_net_connect_timeout(chif_net_socket socket,
+                                           const chif_net_address* address,
+                                           int timeout_ms);
+
+  /**
+   * Connect many sockets at once from a single thread. All connects are
+   * started without blocking and then completed together with chif_net_poll,
+   * so the total time is about that of the slowest connect, not their sum.
+   *
+   * The sockets are left in non-blocking mode. A socket that did not connect
+   * should be closed by the caller.
+   *
+   * @pre Open the sockets (chif_net_open_socket) and store them in
+   * checks[i].socket. The rest of the check structs are used as scratch.
+   * @param checks The sockets to connect, count of them.
+   * @param results_out The result of each connect, count of them. Either
+   * CHIF_NET_RESULT_SUCCESS, CHIF_NET_RESULT_TIMEDOUT or the connect error.
+   * @param count
+   * @param addresses Socket i connects to addresses[i % address_count], so
+   * pass a single address to connect every socket to the same server.
+   * @param address_count
+   * @param timeout_ms Maximum time for all connects, -1 for no limit.
+   * @param connected_count_out Optional, number of sockets that connected.
+   * @return CHIF_NET_RESULT_SUCCESS if all connects have a result,
+   * CHIF_NET_RESULT_NO_MEMORY if the poll set could not be allocated, else the
+   * error that stopped the polling.
+   */
+  chif_net_result chif_net_connect_many(chif_net_check* checks,
+                                        chif_net_result* results_out,
+                                        size_t count,
+                                        const chif_net_address* addresses,
+                                        size_t address_count,
+                                        int timeout_ms,
+                                        size_t* connected_count_out);
+
   /**
    * Bind a socket to the port on address localhost.
    *
+   * A unix address path is created as a socket file, and binding fails with
+   * CHIF_NET_RESULT_SOCKET_ALREADY_IN_USE while it exists, so unlink the file
+   * after closing the socket. Abstract names go away with the socket.
+   *
    * @param socket
    * @param address
    * @return
@@ -415,6 +673,124 @@ typedef int chif_net_socket;
                                    int* sent_bytes_out,
                                    const chif_net_address* to_address);
 
+  /**
+   * Read from a socket, just as chif_net_readfrom, and get the kernel
+   * timestamp of when the data was received. Unlike timing the call, it does
+   * not include the time the data waited for the application.
+   *
+   * @pre Enable CHIF_NET_TIMESTAMPING_RX with chif_net_set_timestamping.
+   * @param socket
+   * @param buf_out
+   * @param bufsize
+   * @param read_bytes_out May be NULL if you don't want the data.
+   * @param from_address_out May be NULL, such as for a TCP socket, else with
+   * the address family set as for chif_net_readfrom.
+   * @param timestamp_out Zero if the data has no timestamp. For TCP, the
+   * timestamp of the last segment that was read.
+   * @return As chif_net_readfrom, CHIF_NET_RESULT_NO_TIMESTAMP if the data
+   * was read but the kernel gave it no timestamp,
+   * CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED if not on linux. Data can lack a
+   * timestamp if it arrived before timestamping was enabled, or just after
+   * the first socket of the host enabled it, since the kernel turns receive
+   * timestamps on in the background.
+   */
+  chif_net_result chif_net_readfrom_timestamp(
+    chif_net_socket socket,
+    uint8_t* buf_out,
+    size_t bufsize,
+    int* read_bytes_out,
+    chif_net_address* from_address_out,
+    chif_net_timestamp* timestamp_out);
+
+  /**
+   * Get the next TX timestamp from the error queue of the socket, without
+   * blocking. Pending TX timestamps make chif_net_poll report
+   * CHIF_NET_CHECK_EVENT_ERROR for the socket.
+   *
+   * @pre Enable CHIF_NET_TIMESTAMPING_TX with chif_net_set_timestamping.
+   * @param socket
+   * @param timestamp_out
+   * @return CHIF_NET_RESULT_WOULD_BLOCK if there is no timestamp yet,
+   * CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED if not on linux.
+   */
+  chif_net_result chif_net_read_tx_timestamp(chif_net_socket socket,
+                                             chif_net_timestamp* timestamp_out);
+
+  /**
+   * Write to a socket, just as chif_net_writeto, but have the kernel hold
+   * the datagram back until launch_ns (SCM_TXTIME), instead of pacing it in
+   * user space. The qdisc of the interface does the waiting: fq for
+   * CHIF_NET_TXTIME_CLOCK_MONOTONIC, etf for CHIF_NET_TXTIME_CLOCK_TAI.
+   * Without such a qdisc, the datagram is sent at once.
+   *
+   * @pre Enable launch times with chif_net_set_txtime.
+   * @param socket
+   * @param buf
+   * @param bufsize
+   * @param sent_bytes_out May be NULL if you don't want the data.
+   * @param to_address
+   * @param launch_ns When to send, in nanoseconds of the clock given to
+   * chif_net_set_txtime.
+   * @return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED if not on linux.
+   */
+  chif_net_result chif_net_writeto_at(chif_net_socket socket,
+                                      const uint8_t* buf,
+                                      size_t bufsize,
+                                      int* sent_bytes_out,
+                                      const chif_net_address* to_address,
+                                      uint64_t launch_ns);
+
+  /**
+   * Pass sockets to the process at the other end of a unix socket
+   * (SCM_RIGHTS), such as an acceptor handing connections to workers. The
+   * receiver gets its own sockets for the same connections, so close them
+   * in this process once sent.
+   *
+   * The sockets go with the data, which must be at least one byte, so a
+   * single zero byte is sent when bufsize is 0.
+   *
+   * @pre socket is a connected unix socket.
+   * @param socket
+   * @param sockets
+   * @param socket_count On the range [1, CHIF_NET_MAX_SOCKETS_PER_MESSAGE].
+   * @param buf May be NULL if bufsize is 0.
+   * @param bufsize
+   * @param sent_bytes_out May be NULL. Counts the zero byte, if sent.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if socket_count is out of
+   * range, CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED on Windows.
+   */
+  chif_net_result chif_net_send_sockets(chif_net_socket socket,
+                                        const chif_net_socket* sockets,
+                                        size_t socket_count,
+                                        const uint8_t* buf,
+                                        size_t bufsize,
+                                        int* sent_bytes_out);
+
+  /**
+   * Receive sockets sent with chif_net_send_sockets, together with the data
+   * of the same message. On Linux they are closed on exec.
+   *
+   * @param socket
+   * @param sockets_out
+   * @param socket_capacity How many sockets fit in sockets_out, at least 1.
+   * @param socket_count_out How many sockets were received, 0 if the data
+   * had none.
+   * @param buf_out May be NULL if bufsize is 0, then one byte is read, as
+   * sent by chif_net_send_sockets without data.
+   * @param bufsize
+   * @param read_bytes_out May be NULL. 0 if the connection is closed.
+   * @return CHIF_NET_RESULT_NOT_ENOUGH_SPACE if more sockets were sent than
+   * fit, the ones that did not are closed but the rest are in sockets_out,
+   * CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED on Windows.
+   */
+  chif_net_result chif_net_receive_sockets(chif_net_socket socket,
+                                           chif_net_socket* sockets_out,
+                                           size_t socket_capacity,
+                                           size_t* socket_count_out,
+                                           uint8_t* buf_out,
+                                           size_t bufsize,
+                                           int* read_bytes_out);
+
   /**
    * Check a/multiple socket(s) for events such as
    *
@@ -436,6 +812,32 @@ typedef int chif_net_socket;
                                 int* ready_count_out,
                                 int timeout_ms);
 
+  /**
+   * Like chif_net_poll, but first spin for up to spin_us microseconds,
+   * checking the sockets without blocking, and only then block for what is
+   * left of timeout_ms. An event that arrives while spinning is seen without
+   * the cost of sleeping and being woken up, at the price of a busy CPU.
+   *
+   * Combine with chif_net_set_busy_poll to also have the kernel poll the
+   * device queue while checking.
+   *
+   * @param check
+   * @param check_count
+   * @param ready_count_out
+   * @param spin_us Spin budget in microseconds, 0 to not spin. Cut to
+   * timeout_ms when that is shorter.
+   * @param timeout_ms Total time to wait, including the spinning, or -1 to
+   * block until an event.
+   * @param stats May be NULL, else the counters are added to.
+   * @return
+   */
+  chif_net_result chif_net_poll_spin(chif_net_check* check,
+                                     size_t check_count,
+                                     int* ready_count_out,
+                                     int spin_us,
+                                     int timeout_ms,
+                                     chif_net_spin_stats* stats);
+
   /**
    * Is there any data waiting to be read?
    *
@@ -469,15 +871,30 @@ typedef int chif_net_socket;
 
   /**
    * Check if the socket has any errors. This includes detecting a (cleanly)
-   * closed TCP connection.
+   * closed TCP connection. A pending error is read from the socket and
+   * cleared, see chif_net_get_socket_error.
    *
    * @param socket
    * @param timeout_ms How long should we wait before accepting a negative
    * response?
-   * @return If no error, CHIF_NET_RESULT_SUCCESS will be returned.
+   * @return If no error, CHIF_NET_RESULT_SUCCESS will be returned, else the
+   * error, such as CHIF_NET_RESULT_CONNECTION_REFUSED for a failed connect.
    */
   chif_net_result chif_net_has_error(chif_net_socket socket, int timeout_ms);
 
+  /**
+   * Read and clear the pending error of the socket (SO_ERROR). After a
+   * non-blocking connect has become writable, this tells if it succeeded.
+   *
+   * @param socket
+   * @param error_out CHIF_NET_RESULT_SUCCESS if there is no pending error,
+   * else the error, such as CHIF_NET_RESULT_CONNECTION_REFUSED. Always
+   * written, with the returned result if reading the error failed.
+   * @return Result of reading the error.
+   */
+  chif_net_result chif_net_get_socket_error(chif_net_socket socket,
+                                            chif_net_result* error_out);
+
   /**
    * Sets the blocking mode of a socket to either blocking or non-blocking
    * depending on the specified flag.
@@ -494,6 +911,10 @@ typedef int chif_net_socket;
    * Fill in address from information. If needed, will automagically find the
    * address by doing DNS lookup, etc.
    *
+   * Numeric names ("10.0.0.1", "::1" or CHIF_NET_ANY_ADDRESS) together with a
+   * numeric service are parsed directly, without calling getaddrinfo and
+   * without allocating.
+   *
    * @pre Ensure you allocate the appropriate amount of memory for
    * address_out. Size of the different address structure may differ.
    * @pre Both name and service cannot be CHIF_NET_ANY_ADDRESS and
@@ -516,6 +937,8 @@ typedef int chif_net_socket;
    * Fill in address from information. If needed, will automagically find the
    * address by doing DNS lookup, etc.
    *
+   * Like chif_net_create_address, numeric names are parsed directly.
+   *
    * @pre Ensure you allocate the appropriate amount of memory for
    * address_out. Size of the different address structure may differ.
    * @pre Both name and service cannot be CHIF_NET_ANY_ADDRESS and
@@ -534,6 +957,66 @@ typedef int chif_net_socket;
     chif_net_transport_protocol transport_protocol,
     chif_net_address_family address_family);
 
+  /**
+   * Like chif_net_create_address, but fill in every address the name resolves
+   * to, not only the first one. Use it to spread load over, or quickly fail
+   * over between, the addresses of a name.
+   *
+   * The addresses are in the order of RFC 6724 destination address selection,
+   * as done by getaddrinfo on Linux, Windows and Mac, which also takes the
+   * available source addresses into account. Duplicates are removed.
+   *
+   * Numeric names are parsed directly, as with chif_net_create_address.
+   *
+   * @param addresses_out
+   * @param address_capacity How many addresses fit in addresses_out. If the
+   * name has more addresses, only the first address_capacity are returned.
+   * @param address_count_out How many addresses were filled in.
+   * @param name
+   * @param service
+   * @param transport_protocol
+   * @param address_family CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED for both IPv4
+   * and IPv6 addresses.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if address_capacity is 0.
+   */
+  chif_net_result chif_net_create_addresses(
+    chif_net_address* addresses_out,
+    size_t address_capacity,
+    size_t* address_count_out,
+    const char* name,
+    const char* service,
+    chif_net_transport_protocol transport_protocol,
+    chif_net_address_family address_family);
+
+  /**
+   * Fill in a unix address, cast it to chif_net_address for the function
+   * calls.
+   *
+   * @param address_out
+   * @param path Path of the socket file, or on Linux "@name" for the abstract
+   * name "name", which has no file.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if path does not fit in
+   * CHIF_NET_UNIX_PATH_LENGTH with its null terminator, or is empty.
+   */
+  chif_net_result chif_net_create_unix_address(
+    chif_net_unix_address* address_out,
+    const char* path);
+
+  /**
+   * Sort addresses by the RFC 6724 rules that do not depend on the source
+   * address: higher precedence in the default policy table first (rule 6),
+   * then smaller scope first (rule 8). The sort is stable, equal addresses
+   * keep their order (rule 10).
+   *
+   * Use it for addresses that did not come from getaddrinfo, such as the A
+   * and AAAA answers of chif_net_resolver.
+   *
+   * @param addresses
+   * @param address_count
+   */
+  void chif_net_sort_addresses(chif_net_address* addresses,
+                               size_t address_count);
+
   /**
    * Get the address of a socket.
    *
@@ -579,6 +1062,7 @@ typedef int chif_net_socket;
    * From an address, get the IP address of it as a string.
    * ipv4 -> "XXX.XXX.XXX.XXX"
    * ipv6 -> "XX:XX:XX:XX:XX:XX"
+   * unix -> the path, as with chif_net_address_to_string
    *
    * @param socket
    * @param str_out
@@ -611,6 +1095,45 @@ typedef int chif_net_socket;
   chif_net_result chif_net_port_from_address(const chif_net_address* address,
                                              chif_net_port* port_out);
 
+  /**
+   * Format an address, with port, as a string. IPv6 addresses are written
+   * in the RFC 5952 canonical form and put in brackets.
+   * ipv4 -> "XXX.XXX.XXX.XXX:PORT"
+   * ipv6 -> "[XX:XX::XX]:PORT"
+   * unix -> "/path/to/socket", "@abstract_name" or "" for an unnamed socket
+   *
+   * Does not allocate, and is cheap enough to be called for every request
+   * when logging.
+   *
+   * @param address
+   * @param str_out
+   * @param strlen Use CHIF_NET_ADDRESS_STRING_LENGTH to fit any IP address,
+   * and CHIF_NET_UNIX_STRING_LENGTH for unix addresses.
+   * @param written_out Length of the string, not counting the null
+   * terminator. May be NULL.
+   * @return CHIF_NET_RESULT_NOT_ENOUGH_SPACE if strlen is too small.
+   */
+  chif_net_result chif_net_address_to_string(const chif_net_address* address,
+                                             char* str_out,
+                                             size_t strlen,
+                                             size_t* written_out);
+
+  /**
+   * Format many addresses, as with chif_net_address_to_string. The string of
+   * address i is written at strs_out + i * stride.
+   *
+   * @param addresses
+   * @param address_count
+   * @param strs_out Must hold address_count * stride chars.
+   * @param stride Use CHIF_NET_ADDRESS_STRING_LENGTH to fit any address.
+   * @return The result of the first address that failed, if any.
+   */
+  chif_net_result chif_net_addresses_to_string(
+    const chif_net_address* addresses,
+    size_t address_count,
+    char* strs_out,
+    size_t stride);
+
   /**
    * Get number of bytes available for read on given socket.
    *
@@ -643,6 +1166,40 @@ typedef int chif_net_socket;
   chif_net_result chif_net_set_reuse_port(chif_net_socket socket,
                                           chif_net_bool reuse);
 
+  /**
+   * Steer new connections, or datagrams, of a reuseport group to the socket
+   * of the CPU that received them (SO_ATTACH_REUSEPORT_CBPF). Socket i of the
+   * group, counted in the order the sockets joined it by listen for TCP or
+   * bind for UDP, gets the traffic of CPU i, i + group_size, and so on. Run
+   * the reactor of socket i on one of those CPUs, and a connection is handled
+   * on the core that took its interrupts, without cross-core cache traffic.
+   *
+   * Attaching to any socket of the group applies to the whole group. When a
+   * socket leaves the group, the kernel moves the last socket into its slot,
+   * so the indices no longer match the CPUs and attaching again does not fix
+   * that. Close the whole group and build it again in CPU order then.
+   * Only on linux.
+   *
+   * @param socket A socket with chif_net_set_reuse_port, bound or listening.
+   * @param group_size Number of sockets in the group, usually the number of
+   * CPUs that handle the network queues.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if group_size is 0.
+   */
+  chif_net_result chif_net_set_reuse_port_cpu_steering(chif_net_socket socket,
+                                                       uint32_t group_size);
+
+  /**
+   * Get the CPU that last received data for the socket (SO_INCOMING_CPU).
+   * For a socket returned by chif_net_accept, it is the CPU that handled the
+   * connection handshake. Only on linux.
+   *
+   * @param socket
+   * @param cpu_out The CPU, or -1 if the socket has not received anything.
+   * @return
+   */
+  chif_net_result chif_net_get_incoming_cpu(chif_net_socket socket,
+                                            int* cpu_out);
+
   /**
    * Set the connection to keep it alive, if supported by the protocol.
    * Useless for connectionless protocols such as UDP.
@@ -734,6 +1291,144 @@ typedef int chif_net_socket;
    */
   chif_net_result chif_net_tcp_set_syncnt(chif_net_socket socket, int count);
 
+  /**
+   * Cap the rate the socket sends at (SO_MAX_PACING_RATE). The fq qdisc, or
+   * TCP internal pacing, spreads the packets evenly at that rate instead of
+   * sending them in bursts. Only on linux.
+   *
+   * @param socket
+   * @param bytes_per_s Maximum rate in bytes per second. UINT32_MAX or more
+   * means no limit.
+   * @return
+   */
+  chif_net_result chif_net_set_max_pacing_rate(chif_net_socket socket,
+                                               uint64_t bytes_per_s);
+
+  /**
+   * Enable launch times for chif_net_writeto_at (SO_TXTIME). They can not be
+   * disabled again, only given another clock. Only on linux 4.19 and newer.
+   *
+   * @param socket
+   * @param clock Clock of the launch times.
+   * @return
+   */
+  chif_net_result chif_net_set_txtime(chif_net_socket socket,
+                                      chif_net_txtime_clock clock);
+
+  /**
+   * The current time of a launch time clock, in nanoseconds.
+   *
+   * @param clock
+   * @return 0 if the platform does not have the clock.
+   */
+  uint64_t chif_net_txtime_now_ns(chif_net_txtime_clock clock);
+
+  /**
+   * Have the kernel timestamp the data of the socket (SO_TIMESTAMPING). Only
+   * on linux.
+   *
+   * @param socket
+   * @param flags chif_net_timestamping_flag values, 0 to disable.
+   * @return
+   */
+  chif_net_result chif_net_set_timestamping(chif_net_socket socket, int flags);
+
+  /**
+   * Accept TCP Fast Open on a listening socket (TCP_FASTOPEN), so clients
+   * with a cookie can send data with the SYN, and it is handed to accept
+   * before the handshake completes. Only takes effect on linux when the
+   * net.ipv4.tcp_fastopen sysctl has the server bit (2) set.
+   *
+   * @param socket The socket, before or after chif_net_listen.
+   * @param queue_length Maximum number of pending Fast Open requests, a
+   * limit against SYN floods with data. 0 to disable.
+   * @return
+   */
+  chif_net_result chif_net_tcp_set_fastopen(chif_net_socket socket,
+                                            int queue_length);
+
+  /**
+   * Only wake the listener for connections that have sent data
+   * (TCP_DEFER_ACCEPT). The kernel holds a new connection back until its
+   * first data arrives, so chif_net_accept, and polling the listener for
+   * CHIF_NET_CHECK_EVENT_READ, only see connections with readable data, and
+   * the first read does not have to wait.
+   *
+   * A connection that sends nothing is still handed out, without data, some
+   * time after timeout_s, so the accept loop must not assume data. Only for
+   * protocols where the client talks first. Only on linux.
+   *
+   * @param socket The listening socket, before or after chif_net_listen.
+   * @param timeout_s Seconds to wait for the first data, 0 to disable.
+   * @return
+   */
+  chif_net_result chif_net_tcp_set_defer_accept(chif_net_socket socket,
+                                                int timeout_s);
+
+  /**
+   * Make chif_net_connect return at once and send the data of the first
+   * write with the SYN (TCP_FASTOPEN_CONNECT), for code that cannot use
+   * chif_net_tcp_connect_with_data. Only on linux 4.11 and newer.
+   *
+   * @param socket
+   * @param fastopen_connect
+   * @return
+   */
+  chif_net_result chif_net_tcp_set_fastopen_connect(
+    chif_net_socket socket,
+    chif_net_bool fastopen_connect);
+
+  /**
+   * Have reads and polls on the socket busy poll the device queue for up to
+   * time_us microseconds when there is no data (SO_BUSY_POLL), instead of
+   * waiting for an interrupt. Only on linux, and raising it above the
+   * net.core.busy_read sysctl needs CAP_NET_ADMIN.
+   *
+   * @param socket
+   * @param time_us Busy poll time in microseconds, 0 to disable.
+   * @return
+   */
+  chif_net_result chif_net_set_busy_poll(chif_net_socket socket, int time_us);
+
+  /**
+   * Prefer busy polling over interrupt driven processing of the device queue
+   * (SO_PREFER_BUSY_POLL), for sockets that are busy polled all the time. Only
+   * on linux 5.11 and newer.
+   *
+   * @param socket
+   * @param prefer
+   * @return
+   */
+  chif_net_result chif_net_set_prefer_busy_poll(chif_net_socket socket,
+                                                chif_net_bool prefer);
+
+  /**
+   * Set an integer socket option.
+   *
+   * @param socket
+   * @param option
+   * @param value
+   * @return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED if the platform does not
+   * have the option.
+   */
+  chif_net_result chif_net_set_option(chif_net_socket socket,
+                                      chif_net_option option,
+                                      int value);
+
+  /**
+   * Get an integer socket option, as the kernel has it, which may differ from
+   * what was set. The kernel clamps buffer sizes to its limits, for one.
+   *
+   * @param socket
+   * @param option
+   * @param value_out
+   * @return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED if the platform does not
+   * have the option.
+   */
+  chif_net_result chif_net_get_option(chif_net_socket socket,
+                                      chif_net_option option,
+                                      int* value_out);
+
   /**
    * Set the time to live (ttl) parameter in the IP header. This value will
    * determine how many routers the packet can hop through.
@@ -773,6 +1468,26 @@ typedef int chif_net_socket;
   /*                                     uint16_t id, */
   /*                                     uint16_t seq); */
 
+  /**
+   * Milliseconds from a monotonic clock, with an unspecified starting point.
+   * Use it to compute timeouts and deadlines, it does not jump when the wall
+   * clock is changed.
+   *
+   * @return
+   */
+  uint64_t chif_net_time_ms(void);
+
+  /**
+   * Nanoseconds from a monotonic clock, for short intervals such as the gap
+   * between two paced datagrams. Its starting point may differ from the one
+   * of chif_net_time_ms, on windows it is the performance counter, so do not
+   * mix the two. On linux it is CLOCK_MONOTONIC, the clock of
+   * CHIF_NET_TXTIME_CLOCK_MONOTONIC.
+   *
+   * @return
+   */
+  uint64_t chif_net_time_ns(void);
+
   /**
    * Convert the enumerated result to a string, good for printing the result.
    * @param result
@@ -794,6 +1509,12 @@ typedef int chif_net_socket;
   const char* chif_net_transport_protocol_to_string(
     chif_net_transport_protocol transport_protocol);
 
+  /**
+   * @param option
+   * @return
+   */
+  const char* chif_net_option_to_string(chif_net_option option);
+
 #if defined(__cplusplus)
 }
 #endif
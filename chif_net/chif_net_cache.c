@@ -0,0 +1,525 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_cache.h"
+
+#if defined(CHIF_NET_WINSOCK2)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+
+#include <string.h>
+
+// ============================================================ //
+// Static Asserts
+// ============================================================ //
+
+CHIF_NET_STATIC_ASSERT((CHIF_NET_CACHE_SHARDS &
+                        (CHIF_NET_CACHE_SHARDS - 1)) == 0,
+                       cache_shards_power_of_two);
+
+#if defined(CHIF_NET_WINSOCK2)
+CHIF_NET_STATIC_ASSERT(sizeof(chif_net_cache_lock) == sizeof(SRWLOCK),
+                       cache_lock_correct_size);
+#endif
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+static chif_net_result
+_chif_net_cache_lock_init(chif_net_cache_lock* lock)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  InitializeSRWLock((PSRWLOCK)lock);
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  return pthread_rwlock_init(lock, NULL) == 0 ? CHIF_NET_RESULT_SUCCESS
+                                               : CHIF_NET_RESULT_FAIL;
+#endif
+}
+
+static void
+_chif_net_cache_lock_destroy(chif_net_cache_lock* lock)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(lock);
+#else
+  pthread_rwlock_destroy(lock);
+#endif
+}
+
+static void
+_chif_net_cache_read_lock(chif_net_cache_lock* lock)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  AcquireSRWLockShared((PSRWLOCK)lock);
+#else
+  pthread_rwlock_rdlock(lock);
+#endif
+}
+
+static void
+_chif_net_cache_read_unlock(chif_net_cache_lock* lock)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  ReleaseSRWLockShared((PSRWLOCK)lock);
+#else
+  pthread_rwlock_unlock(lock);
+#endif
+}
+
+static void
+_chif_net_cache_write_lock(chif_net_cache_lock* lock)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  AcquireSRWLockExclusive((PSRWLOCK)lock);
+#else
+  pthread_rwlock_wrlock(lock);
+#endif
+}
+
+static void
+_chif_net_cache_write_unlock(chif_net_cache_lock* lock)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  ReleaseSRWLockExclusive((PSRWLOCK)lock);
+#else
+  pthread_rwlock_unlock(lock);
+#endif
+}
+
+static char
+_chif_net_cache_lower(const char c)
+{
+  return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static int
+_chif_net_cache_equal_nocase(const char* a, const char* b)
+{
+  while (*a && _chif_net_cache_lower(*a) == _chif_net_cache_lower(*b)) {
+    ++a;
+    ++b;
+  }
+  return *a == *b;
+}
+
+/**
+ * FNV-1a over the key, the name is hashed lowercase since DNS names are
+ * case-insensitive.
+ */
+static uint64_t
+_chif_net_cache_hash(const char* name,
+                     const char* service,
+                     const chif_net_transport_protocol transport_protocol,
+                     const chif_net_address_family address_family)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  const uint64_t prime = 0x100000001b3ull;
+  for (const char* c = name; *c; ++c) {
+    hash = (hash ^ (uint8_t)_chif_net_cache_lower(*c)) * prime;
+  }
+  hash = (hash ^ 0xff) * prime;
+  if (service) {
+    for (const char* c = service; *c; ++c) {
+      hash = (hash ^ (uint8_t)*c) * prime;
+    }
+  }
+  hash = (hash ^ (uint8_t)transport_protocol) * prime;
+  hash = (hash ^ (uint8_t)address_family) * prime;
+  // zero marks an unused slot
+  return hash ? hash : 1;
+}
+
+static int
+_chif_net_cache_cacheable(const char* name, const char* service)
+{
+  return name && strlen(name) <= CHIF_NET_CACHE_MAX_NAME_LENGTH &&
+         (!service || strlen(service) <= CHIF_NET_CACHE_MAX_SERVICE_LENGTH);
+}
+
+static chif_net_cache_shard*
+_chif_net_cache_shard(chif_net_cache* cache, const uint64_t hash)
+{
+  return &cache->shards[(hash >> 32) & (CHIF_NET_CACHE_SHARDS - 1)];
+}
+
+static chif_net_cache_entry*
+_chif_net_cache_find(chif_net_cache_shard* shard,
+                     const uint64_t hash,
+                     const char* name,
+                     const char* service,
+                     const chif_net_transport_protocol transport_protocol,
+                     const chif_net_address_family address_family)
+{
+  for (size_t i = 0; i < CHIF_NET_CACHE_SHARD_ENTRIES; ++i) {
+    if (shard->hashes[i] != hash) {
+      continue;
+    }
+    chif_net_cache_entry* entry = &shard->entries[i];
+    if (entry->transport_protocol == transport_protocol &&
+        entry->address_family == address_family &&
+        _chif_net_cache_equal_nocase(entry->name, name) &&
+        strcmp(entry->service, service ? service : "") == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+static size_t
+_chif_net_cache_address_size(const chif_net_address_family address_family)
+{
+  return address_family == CHIF_NET_ADDRESS_FAMILY_IPV4
+           ? sizeof(chif_net_ipv4_address)
+           : sizeof(chif_net_ipv6_address);
+}
+
+static chif_net_result
+_chif_net_cache_copy(const chif_net_cache_entry* entry,
+                     chif_net_address* address_out)
+{
+  if (entry->result == CHIF_NET_RESULT_SUCCESS) {
+    memcpy(address_out,
+           &entry->address,
+           _chif_net_cache_address_size(
+             (chif_net_address_family)entry->address.address_family));
+  }
+  return entry->result;
+}
+
+static void
+_chif_net_cache_store(chif_net_cache* cache,
+                      const uint64_t hash,
+                      const char* name,
+                      const char* service,
+                      const chif_net_transport_protocol transport_protocol,
+                      const chif_net_address_family address_family,
+                      const chif_net_result result,
+                      const chif_net_address* address,
+                      uint32_t ttl_s)
+{
+  if (ttl_s > cache->max_ttl_s) {
+    ttl_s = cache->max_ttl_s;
+  }
+  const uint64_t expires_ms = chif_net_time_ms() + (uint64_t)ttl_s * 1000;
+
+  chif_net_cache_shard* shard = _chif_net_cache_shard(cache, hash);
+  _chif_net_cache_write_lock(&shard->lock);
+
+  chif_net_cache_entry* entry = _chif_net_cache_find(
+    shard, hash, name, service, transport_protocol, address_family);
+  size_t index;
+  if (entry) {
+    index = (size_t)(entry - shard->entries);
+  } else {
+    // replace an unused entry, or else the one closest to expiring
+    index = 0;
+    for (size_t i = 0; i < CHIF_NET_CACHE_SHARD_ENTRIES; ++i) {
+      const chif_net_cache_entry* candidate = &shard->entries[i];
+      if (!candidate->used) {
+        index = i;
+        break;
+      }
+      if (!candidate->refreshing &&
+          (shard->entries[index].refreshing ||
+           candidate->expires_ms < shard->entries[index].expires_ms)) {
+        index = i;
+      }
+    }
+    entry = &shard->entries[index];
+    strcpy(entry->name, name);
+    strcpy(entry->service, service ? service : "");
+    entry->transport_protocol = transport_protocol;
+    entry->address_family = address_family;
+  }
+
+  shard->hashes[index] = hash;
+  entry->used = 1;
+  entry->refresh_due = 0;
+  entry->refreshing = 0;
+  entry->expires_ms = expires_ms;
+  entry->result = result;
+  if (result == CHIF_NET_RESULT_SUCCESS) {
+    memcpy(&entry->address,
+           address,
+           _chif_net_cache_address_size(
+             (chif_net_address_family)address->address_family));
+  }
+
+  _chif_net_cache_write_unlock(&shard->lock);
+}
+
+static chif_net_result
+_chif_net_cache_default_resolve(
+  void* user_data,
+  chif_net_address* address_out,
+  const char* name,
+  const char* service,
+  const chif_net_transport_protocol transport_protocol,
+  const chif_net_address_family address_family,
+  uint32_t* ttl_s_out)
+{
+  const chif_net_cache* cache = (const chif_net_cache*)user_data;
+  const chif_net_result result = chif_net_create_address(
+    address_out, name, service, transport_protocol, address_family);
+  *ttl_s_out = result == CHIF_NET_RESLUT_NO_NAME ? cache->negative_ttl_s
+                                                  : cache->default_ttl_s;
+  return result;
+}
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+chif_net_result
+chif_net_cache_init(chif_net_cache* cache)
+{
+  memset(cache, 0, sizeof(chif_net_cache));
+  cache->resolve = _chif_net_cache_default_resolve;
+  cache->resolve_user_data = cache;
+  cache->default_ttl_s = CHIF_NET_CACHE_DEFAULT_TTL_S;
+  cache->negative_ttl_s = CHIF_NET_CACHE_DEFAULT_NEGATIVE_TTL_S;
+  cache->max_ttl_s = CHIF_NET_CACHE_DEFAULT_MAX_TTL_S;
+  cache->stale_s = CHIF_NET_CACHE_DEFAULT_STALE_S;
+
+  for (size_t i = 0; i < CHIF_NET_CACHE_SHARDS; ++i) {
+    chif_net_cache_lock* lock = &cache->shards[i].lock;
+    const chif_net_result res = _chif_net_cache_lock_init(lock);
+    if (res) {
+      while (i-- > 0) {
+        _chif_net_cache_lock_destroy(&cache->shards[i].lock);
+      }
+      return res;
+    }
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_cache_destroy(chif_net_cache* cache)
+{
+  for (size_t i = 0; i < CHIF_NET_CACHE_SHARDS; ++i) {
+    _chif_net_cache_lock_destroy(&cache->shards[i].lock);
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_cache_create_address(
+  chif_net_cache* cache,
+  chif_net_address* address_out,
+  const char* name,
+  const char* service,
+  const chif_net_transport_protocol transport_protocol,
+  const chif_net_address_family address_family)
+{
+  uint32_t ttl_s;
+  if (!_chif_net_cache_cacheable(name, service)) {
+    return cache->resolve(cache->resolve_user_data,
+                          address_out,
+                          name,
+                          service,
+                          transport_protocol,
+                          address_family,
+                          &ttl_s);
+  }
+
+  const uint64_t hash =
+    _chif_net_cache_hash(name, service, transport_protocol, address_family);
+  chif_net_cache_shard* shard = _chif_net_cache_shard(cache, hash);
+  const uint64_t now = chif_net_time_ms();
+  const uint64_t stale_ms = (uint64_t)cache->stale_s * 1000;
+
+  _chif_net_cache_read_lock(&shard->lock);
+  const chif_net_cache_entry* found = _chif_net_cache_find(
+    shard, hash, name, service, transport_protocol, address_family);
+  if (found && (now < found->expires_ms ||
+                ((found->refresh_due || found->refreshing) &&
+                 now < found->expires_ms + stale_ms))) {
+    const chif_net_result result = _chif_net_cache_copy(found, address_out);
+    _chif_net_cache_read_unlock(&shard->lock);
+    return result;
+  }
+  _chif_net_cache_read_unlock(&shard->lock);
+
+  // expired but still in the stale window, the first caller to get here
+  // marks it for chif_net_cache_refresh, and every caller is served stale
+  if (found) {
+    _chif_net_cache_write_lock(&shard->lock);
+    chif_net_cache_entry* entry = _chif_net_cache_find(
+      shard, hash, name, service, transport_protocol, address_family);
+    if (entry && now < entry->expires_ms + stale_ms) {
+      if (now >= entry->expires_ms && !entry->refreshing) {
+        entry->refresh_due = 1;
+      }
+      const chif_net_result result = _chif_net_cache_copy(entry, address_out);
+      _chif_net_cache_write_unlock(&shard->lock);
+      return result;
+    }
+    _chif_net_cache_write_unlock(&shard->lock);
+  }
+
+  const chif_net_result result = cache->resolve(cache->resolve_user_data,
+                                                address_out,
+                                                name,
+                                                service,
+                                                transport_protocol,
+                                                address_family,
+                                                &ttl_s);
+  if (result == CHIF_NET_RESULT_SUCCESS || result == CHIF_NET_RESLUT_NO_NAME) {
+    _chif_net_cache_store(cache,
+                          hash,
+                          name,
+                          service,
+                          transport_protocol,
+                          address_family,
+                          result,
+                          address_out,
+                          ttl_s);
+  }
+  return result;
+}
+
+chif_net_result
+chif_net_cache_insert(chif_net_cache* cache,
+                      const char* name,
+                      const char* service,
+                      const chif_net_transport_protocol transport_protocol,
+                      const chif_net_address_family address_family,
+                      const chif_net_result result,
+                      const chif_net_address* address,
+                      const uint32_t ttl_s)
+{
+  if (!_chif_net_cache_cacheable(name, service) ||
+      (result != CHIF_NET_RESULT_SUCCESS &&
+       result != CHIF_NET_RESLUT_NO_NAME) ||
+      (result == CHIF_NET_RESULT_SUCCESS && !address)) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  const uint64_t hash =
+    _chif_net_cache_hash(name, service, transport_protocol, address_family);
+  _chif_net_cache_store(cache,
+                        hash,
+                        name,
+                        service,
+                        transport_protocol,
+                        address_family,
+                        result,
+                        address,
+                        ttl_s);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_cache_refresh(chif_net_cache* cache,
+                       const size_t max_count,
+                       size_t* refreshed_count_out)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < CHIF_NET_CACHE_SHARDS && count < max_count; ++i) {
+    chif_net_cache_shard* shard = &cache->shards[i];
+    for (size_t j = 0; j < CHIF_NET_CACHE_SHARD_ENTRIES && count < max_count;
+         ++j) {
+      // claim the entry and copy its key, so the lock is not held while it
+      // is resolved
+      _chif_net_cache_write_lock(&shard->lock);
+      chif_net_cache_entry* entry = &shard->entries[j];
+      if (!entry->used || !entry->refresh_due) {
+        _chif_net_cache_write_unlock(&shard->lock);
+        continue;
+      }
+      entry->refresh_due = 0;
+      entry->refreshing = 1;
+      const uint64_t hash = shard->hashes[j];
+      const chif_net_transport_protocol transport_protocol =
+        entry->transport_protocol;
+      const chif_net_address_family address_family = entry->address_family;
+      char name[CHIF_NET_CACHE_MAX_NAME_LENGTH + 1];
+      char service[CHIF_NET_CACHE_MAX_SERVICE_LENGTH + 1];
+      strcpy(name, entry->name);
+      strcpy(service, entry->service);
+      _chif_net_cache_write_unlock(&shard->lock);
+
+      chif_net_address address;
+      uint32_t ttl_s;
+      const chif_net_result result = cache->resolve(cache->resolve_user_data,
+                                                    &address,
+                                                    name,
+                                                    service,
+                                                    transport_protocol,
+                                                    address_family,
+                                                    &ttl_s);
+      ++count;
+      if (result == CHIF_NET_RESULT_SUCCESS ||
+          result == CHIF_NET_RESLUT_NO_NAME) {
+        _chif_net_cache_store(cache,
+                              hash,
+                              name,
+                              service,
+                              transport_protocol,
+                              address_family,
+                              result,
+                              &address,
+                              ttl_s);
+        continue;
+      }
+
+      // keep serving the stale entry, the next lookup marks it again
+      _chif_net_cache_write_lock(&shard->lock);
+      entry = _chif_net_cache_find(
+        shard, hash, name, service, transport_protocol, address_family);
+      if (entry) {
+        entry->refreshing = 0;
+      }
+      _chif_net_cache_write_unlock(&shard->lock);
+    }
+  }
+
+  if (refreshed_count_out) {
+    *refreshed_count_out = count;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_cache_clear(chif_net_cache* cache)
+{
+  for (size_t i = 0; i < CHIF_NET_CACHE_SHARDS; ++i) {
+    chif_net_cache_shard* shard = &cache->shards[i];
+    _chif_net_cache_write_lock(&shard->lock);
+    memset(shard->hashes, 0, sizeof(shard->hashes));
+    memset(shard->entries, 0, sizeof(shard->entries));
+    _chif_net_cache_write_unlock(&shard->lock);
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CHIF_NET_CACHE_H_
+#define CHIF_NET_CACHE_H_
+
+/**
+ * Thread-safe cache in front of chif_net_create_address.
+ *
+ * Entries are keyed by (name, service, transport protocol, address family)
+ * and live for the TTL of the answer. Missing names are cached as well, so a
+ * typo does not turn into a lookup per call. Once an entry has expired it is
+ * still served for stale_s seconds, without waiting on a lookup, and marked
+ * for a refresh. chif_net_cache_refresh resolves the marked entries again,
+ * call it from a background thread or the idle time of an event loop. An
+ * entry that is not refreshed in time is resolved by the next lookup, as a
+ * miss.
+ *
+ * The cache is split in CHIF_NET_CACHE_SHARDS shards, each behind its own
+ * read-write lock. Hits only take the read lock, so lookups from many threads
+ * do not wait on each other.
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+
+#if defined(CHIF_NET_BERKLEY_SOCKET)
+#include <pthread.h>
+#endif
+
+// Must be a power of two.
+#define CHIF_NET_CACHE_SHARDS 16
+
+// Entries per shard, the least valuable entry is replaced when it is full.
+#define CHIF_NET_CACHE_SHARD_ENTRIES 64
+
+// Names and services longer than this are not cached, only resolved.
+#define CHIF_NET_CACHE_MAX_NAME_LENGTH 253
+#define CHIF_NET_CACHE_MAX_SERVICE_LENGTH 31
+
+#define CHIF_NET_CACHE_DEFAULT_TTL_S 30
+#define CHIF_NET_CACHE_DEFAULT_NEGATIVE_TTL_S 5
+#define CHIF_NET_CACHE_DEFAULT_MAX_TTL_S 3600
+#define CHIF_NET_CACHE_DEFAULT_STALE_S 30
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+#if defined(CHIF_NET_WINSOCK2)
+  typedef void* chif_net_cache_lock; /*SRWLOCK*/
+#else
+typedef pthread_rwlock_t chif_net_cache_lock;
+#endif
+
+  /**
+   * Resolves a name when it is missing from the cache, or has expired.
+   *
+   * @param ttl_s_out How many seconds the result may be cached. Only results
+   * of CHIF_NET_RESULT_SUCCESS and CHIF_NET_RESLUT_NO_NAME are cached.
+   * @return As chif_net_create_address.
+   */
+  typedef chif_net_result (*chif_net_cache_resolve_fn)(
+    void* user_data,
+    chif_net_address* address_out,
+    const char* name,
+    const char* service,
+    chif_net_transport_protocol transport_protocol,
+    chif_net_address_family address_family,
+    uint32_t* ttl_s_out);
+
+  /**
+   * @param refresh_due Expired, served stale and waiting for
+   * chif_net_cache_refresh.
+   * @param refreshing Being resolved again by chif_net_cache_refresh.
+   */
+  typedef struct
+  {
+    int used;
+    int refresh_due;
+    int refreshing;
+    uint64_t expires_ms;
+    chif_net_result result;
+    chif_net_transport_protocol transport_protocol;
+    chif_net_address_family address_family;
+    chif_net_address address;
+    char name[CHIF_NET_CACHE_MAX_NAME_LENGTH + 1];
+    char service[CHIF_NET_CACHE_MAX_SERVICE_LENGTH + 1];
+  } chif_net_cache_entry;
+
+  /**
+   * The hashes are kept apart from the entries, a lookup only has to scan a
+   * few cache lines to find its entry.
+   */
+  typedef struct
+  {
+    chif_net_cache_lock lock;
+    uint64_t hashes[CHIF_NET_CACHE_SHARD_ENTRIES];
+    chif_net_cache_entry entries[CHIF_NET_CACHE_SHARD_ENTRIES];
+  } chif_net_cache_shard;
+
+  /**
+   * Allocate it wherever you like, then call chif_net_cache_init. It is
+   * large, prefer the heap over the stack.
+   *
+   * The settings below may be changed after chif_net_cache_init, but not
+   * while the cache is in use.
+   *
+   * @param resolve Called on a miss. Defaults to chif_net_create_address,
+   * which cannot tell the record TTL, so default_ttl_s and negative_ttl_s
+   * are used instead.
+   * @param resolve_user_data Passed to resolve.
+   * @param default_ttl_s
+   * @param negative_ttl_s
+   * @param max_ttl_s Longer TTLs are cut down to this.
+   * @param stale_s How long an expired entry is served, while it waits to be
+   * refreshed.
+   */
+  typedef struct
+  {
+    chif_net_cache_resolve_fn resolve;
+    void* resolve_user_data;
+    uint32_t default_ttl_s;
+    uint32_t negative_ttl_s;
+    uint32_t max_ttl_s;
+    uint32_t stale_s;
+    chif_net_cache_shard shards[CHIF_NET_CACHE_SHARDS];
+  } chif_net_cache;
+
+  // ====================================================================== //
+  // Definition
+  // ====================================================================== //
+
+  /**
+   * @param cache
+   * @return
+   */
+  chif_net_result chif_net_cache_init(chif_net_cache* cache);
+
+  /**
+   * No other thread may use the cache while, or after, it is destroyed.
+   *
+   * @param cache
+   * @return
+   */
+  chif_net_result chif_net_cache_destroy(chif_net_cache* cache);
+
+  /**
+   * Same as chif_net_create_address, but answered from the cache when
+   * possible. Safe to call from any number of threads.
+   *
+   * A name of CHIF_NET_ANY_ADDRESS is never cached. Only a miss, or an entry
+   * past its stale window, waits on cache->resolve.
+   *
+   * @return The result of the resolve, cached or not.
+   */
+  chif_net_result chif_net_cache_create_address(
+    chif_net_cache* cache,
+    chif_net_address* address_out,
+    const char* name,
+    const char* service,
+    chif_net_transport_protocol transport_protocol,
+    chif_net_address_family address_family);
+
+  /**
+   * Put a result in the cache, such as an answer from chif_net_resolver
+   * together with its TTL.
+   *
+   * @param cache
+   * @param name
+   * @param service
+   * @param transport_protocol
+   * @param address_family
+   * @param result CHIF_NET_RESULT_SUCCESS or CHIF_NET_RESLUT_NO_NAME.
+   * @param address The address for a result of CHIF_NET_RESULT_SUCCESS.
+   * @param ttl_s
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if the entry cannot be cached.
+   */
+  chif_net_result chif_net_cache_insert(
+    chif_net_cache* cache,
+    const char* name,
+    const char* service,
+    chif_net_transport_protocol transport_protocol,
+    chif_net_address_family address_family,
+    chif_net_result result,
+    const chif_net_address* address,
+    uint32_t ttl_s);
+
+  /**
+   * Resolve the expired entries that have been served stale again, with
+   * cache->resolve, outside of the cache locks. Lookups meanwhile keep
+   * getting the stale entry. A failed refresh keeps the stale entry, and it
+   * is retried after the next lookup of it.
+   *
+   * @param cache
+   * @param max_count Most entries to resolve in this call.
+   * @param refreshed_count_out May be NULL. How many entries were resolved.
+   * @return
+   */
+  chif_net_result chif_net_cache_refresh(chif_net_cache* cache,
+                                         size_t max_count,
+                                         size_t* refreshed_count_out);
+
+  /**
+   * Remove every entry.
+   *
+   * @param cache
+   * @return
+   */
+  chif_net_result chif_net_cache_clear(chif_net_cache* cache);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_CACHE_H_
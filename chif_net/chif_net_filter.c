@@ -0,0 +1,605 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_filter.h"
+
+#if defined(CHIF_NET_WINSOCK2)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================ //
+// Constants
+// ============================================================ //
+
+#define CHIF_NET_FILTER_CHUNK 0x80000000u
+#define CHIF_NET_FILTER_CHUNK_ENTRIES 256
+
+#define CHIF_NET_FILTER_IPV4_ROOT 0
+#define CHIF_NET_FILTER_IPV4_ROOT_ENTRIES 65536
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+static const uint8_t _chif_net_filter_ipv4_mapped_prefix[12] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff
+};
+
+/**
+ * The address of an IPv4 or IPv6 address as bytes in network order, with
+ * IPv4-mapped IPv6 addresses turned into IPv4.
+ *
+ * @return Number of bytes, 4 or 16, or 0 for other address families.
+ */
+static int
+_chif_net_filter_address_bytes(const chif_net_address* address,
+                               const uint8_t** bytes_out)
+{
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    *bytes_out =
+      (const uint8_t*)&((const chif_net_ipv4_address*)address)->address;
+    return 4;
+  }
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    *bytes_out =
+      (const uint8_t*)((const chif_net_ipv6_address*)address)->address;
+    if (memcmp(*bytes_out,
+               _chif_net_filter_ipv4_mapped_prefix,
+               sizeof(_chif_net_filter_ipv4_mapped_prefix)) == 0) {
+      *bytes_out += sizeof(_chif_net_filter_ipv4_mapped_prefix);
+      return 4;
+    }
+    return 16;
+  }
+  *bytes_out = NULL;
+  return 0;
+}
+
+/**
+ * Where a rule goes: IPv4-mapped IPv6 rules of at least 96 bits become IPv4
+ * rules, shorter ones also cover other IPv6 addresses and stay IPv6.
+ *
+ * @return 0 if the rule is invalid.
+ */
+static int
+_chif_net_filter_rule_target(const chif_net_filter_rule* rule,
+                             const uint8_t** bytes_out,
+                             int* byte_count_out,
+                             int* prefix_length_out)
+{
+  *byte_count_out = _chif_net_filter_address_bytes(&rule->address, bytes_out);
+  *prefix_length_out = rule->prefix_length;
+  if (rule->address.address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    if (*byte_count_out == 4) {
+      if (rule->prefix_length < 96) {
+        *bytes_out -= sizeof(_chif_net_filter_ipv4_mapped_prefix);
+        *byte_count_out = 16;
+      } else {
+        *prefix_length_out -= 96;
+      }
+    }
+    return rule->prefix_length <= 128;
+  }
+  return *byte_count_out == 4 && rule->prefix_length <= 32;
+}
+
+/**
+ * Append a chunk with every entry set to value.
+ *
+ * @param index_out Index of the first entry of the chunk.
+ */
+static chif_net_result
+_chif_net_filter_add_chunk(chif_net_filter* filter,
+                           const uint32_t value,
+                           size_t* index_out)
+{
+  const size_t needed = filter->node_count + CHIF_NET_FILTER_CHUNK_ENTRIES;
+  if (needed >= CHIF_NET_FILTER_CHUNK) {
+    return CHIF_NET_RESULT_NO_MEMORY;
+  }
+  if (needed > filter->node_capacity) {
+    size_t capacity = filter->node_capacity * 2;
+    if (capacity < needed) {
+      capacity = needed;
+    }
+    uint32_t* nodes = realloc(filter->nodes, capacity * sizeof(uint32_t));
+    if (!nodes) {
+      return CHIF_NET_RESULT_NO_MEMORY;
+    }
+    filter->nodes = nodes;
+    filter->node_capacity = capacity;
+  }
+
+  *index_out = filter->node_count;
+  for (size_t i = 0; i < CHIF_NET_FILTER_CHUNK_ENTRIES; ++i) {
+    filter->nodes[filter->node_count + i] = value;
+  }
+  filter->node_count = needed;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+/**
+ * Expand an IPv4 prefix into the slots it covers. Rules are added shortest
+ * prefix first, so the slots never hold a chunk yet, and a new chunk starts
+ * out with the value of the shorter prefix it is carved out of.
+ */
+static chif_net_result
+_chif_net_filter_insert_ipv4(chif_net_filter* filter,
+                             const uint8_t* bytes,
+                             const int prefix_length,
+                             const uint32_t value)
+{
+  size_t chunk = CHIF_NET_FILTER_IPV4_ROOT;
+  int bit = 0;
+  int stride = 16;
+  size_t index = (size_t)bytes[0] << 8 | bytes[1];
+
+  while (prefix_length > bit + stride) {
+    uint32_t entry = filter->nodes[chunk + index];
+    if (!(entry & CHIF_NET_FILTER_CHUNK)) {
+      size_t child;
+      const chif_net_result res =
+        _chif_net_filter_add_chunk(filter, entry, &child);
+      if (res) {
+        return res;
+      }
+      entry = CHIF_NET_FILTER_CHUNK | (uint32_t)child;
+      filter->nodes[chunk + index] = entry;
+    }
+    chunk = entry & ~CHIF_NET_FILTER_CHUNK;
+    bit += stride;
+    stride = 8;
+    index = bytes[bit / 8];
+  }
+
+  const size_t span = (size_t)1 << (bit + stride - prefix_length);
+  const size_t first = index & ~(span - 1);
+  for (size_t i = 0; i < span; ++i) {
+    filter->nodes[chunk + first + i] = value;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+/**
+ * The leading bits of a big-endian half of an IPv6 address.
+ */
+static uint64_t
+_chif_net_filter_mask(const int bits)
+{
+  if (bits <= 0) {
+    return 0;
+  }
+  return bits >= 64 ? ~(uint64_t)0 : ~(uint64_t)0 << (64 - bits);
+}
+
+static void
+_chif_net_filter_ipv6_halves(const uint8_t* bytes,
+                             uint64_t* high_out,
+                             uint64_t* low_out)
+{
+  uint64_t high = 0;
+  uint64_t low = 0;
+  for (int i = 0; i < 8; ++i) {
+    high = high << 8 | bytes[i];
+    low = low << 8 | bytes[8 + i];
+  }
+  *high_out = high;
+  *low_out = low;
+}
+
+static size_t
+_chif_net_filter_hash(const uint64_t high, const uint64_t low)
+{
+  uint64_t hash = (high ^ low * 0x9e3779b97f4a7c15ull) * 0xbf58476d1ce4e5b9ull;
+  hash ^= hash >> 31;
+  return (size_t)hash;
+}
+
+/**
+ * The slot of an IPv6 prefix in its table, which is either the slot that
+ * holds it or the empty slot where it goes. The tables are at most half
+ * full, so there always is one.
+ */
+static chif_net_filter_prefix*
+_chif_net_filter_find_prefix(const chif_net_filter* filter,
+                             const chif_net_filter_table* table,
+                             const uint64_t high,
+                             const uint64_t low)
+{
+  chif_net_filter_prefix* prefixes = filter->prefixes + table->first;
+  size_t i = _chif_net_filter_hash(high, low) & table->mask;
+  while (prefixes[i].value &&
+         (prefixes[i].high != high || prefixes[i].low != low)) {
+    i = (i + 1) & table->mask;
+  }
+  return &prefixes[i];
+}
+
+/**
+ * An IPv6 prefix goes into the table of its length, where a later rule for
+ * the same prefix replaces the earlier one.
+ */
+static void
+_chif_net_filter_insert_ipv6(chif_net_filter* filter,
+                             const chif_net_filter_table* table,
+                             const uint8_t* bytes,
+                             const uint32_t value)
+{
+  uint64_t high;
+  uint64_t low;
+  _chif_net_filter_ipv6_halves(bytes, &high, &low);
+  high &= _chif_net_filter_mask(table->prefix_length);
+  low &= _chif_net_filter_mask(table->prefix_length - 64);
+  chif_net_filter_prefix* prefix =
+    _chif_net_filter_find_prefix(filter, table, high, low);
+  prefix->high = high;
+  prefix->low = low;
+  prefix->value = value;
+}
+
+/**
+ * Size a table for each IPv6 prefix length in use, longest first.
+ *
+ * @param counts Number of rules of each prefix length.
+ * @param table_of_length_out Index of the table for each prefix length.
+ */
+static chif_net_result
+_chif_net_filter_init_tables(chif_net_filter* filter,
+                             const size_t* counts,
+                             size_t* table_of_length_out)
+{
+  for (int length = 0; length <= 128; ++length) {
+    filter->table_count += counts[length] > 0;
+  }
+  filter->tables =
+    malloc((filter->table_count ? filter->table_count : 1) *
+           sizeof(chif_net_filter_table));
+  if (!filter->tables) {
+    return CHIF_NET_RESULT_NO_MEMORY;
+  }
+
+  size_t table = 0;
+  for (int length = 128; length >= 0; --length) {
+    if (counts[length] == 0) {
+      continue;
+    }
+    size_t slot_count = 2;
+    while (slot_count < counts[length] * 2) {
+      slot_count *= 2;
+    }
+    filter->tables[table].first = filter->prefix_count;
+    filter->tables[table].mask = slot_count - 1;
+    filter->tables[table].prefix_length = length;
+    table_of_length_out[length] = table++;
+    filter->prefix_count += slot_count;
+  }
+  filter->prefixes = calloc(filter->prefix_count ? filter->prefix_count : 1,
+                            sizeof(chif_net_filter_prefix));
+  return filter->prefixes ? CHIF_NET_RESULT_SUCCESS
+                          : CHIF_NET_RESULT_NO_MEMORY;
+}
+
+static uint32_t
+_chif_net_filter_match_ipv6(const chif_net_filter* filter,
+                            const uint8_t* bytes)
+{
+  uint64_t high;
+  uint64_t low;
+  _chif_net_filter_ipv6_halves(bytes, &high, &low);
+  for (size_t t = 0; t < filter->table_count; ++t) {
+    const chif_net_filter_table* table = &filter->tables[t];
+    const chif_net_filter_prefix* prefix = _chif_net_filter_find_prefix(
+      filter,
+      table,
+      high & _chif_net_filter_mask(table->prefix_length),
+      low & _chif_net_filter_mask(table->prefix_length - 64));
+    if (prefix->value) {
+      return prefix->value;
+    }
+  }
+  return 0;
+}
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+chif_net_result
+chif_net_filter_rule_from_string(chif_net_filter_rule* rule_out,
+                                 const char* cidr,
+                                 const chif_net_filter_action action)
+{
+  char ip[CHIF_NET_IPV6_STRING_LENGTH];
+  size_t ip_length = 0;
+  int is_ipv6 = 0;
+  int dot_count = 0;
+  for (; cidr[ip_length] && cidr[ip_length] != '/'; ++ip_length) {
+    const char c = cidr[ip_length];
+    const int valid = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+                      (c >= 'A' && c <= 'F') || c == '.' || c == ':';
+    if (!valid || ip_length + 1 >= sizeof(ip)) {
+      return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+    }
+    is_ipv6 |= c == ':';
+    dot_count += c == '.';
+    ip[ip_length] = c;
+  }
+  ip[ip_length] = '\0';
+  // getaddrinfo would also take the short forms, such as "10.1" for 10.0.0.1
+  if (!is_ipv6 && dot_count != 3) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  const int max_length = is_ipv6 ? 128 : 32;
+  int prefix_length = max_length;
+  if (cidr[ip_length] == '/') {
+    const char* digits = &cidr[ip_length + 1];
+    prefix_length = 0;
+    int digit_count = 0;
+    for (; *digits >= '0' && *digits <= '9' && digit_count < 4;
+         ++digits, ++digit_count) {
+      prefix_length = prefix_length * 10 + (*digits - '0');
+    }
+    if (digit_count == 0 || *digits != '\0') {
+      return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+    }
+  }
+  if (prefix_length > max_length) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  const chif_net_result res = chif_net_create_address_i(
+    &rule_out->address,
+    ip,
+    0,
+    CHIF_NET_TRANSPORT_PROTOCOL_UDP,
+    is_ipv6 ? CHIF_NET_ADDRESS_FAMILY_IPV6 : CHIF_NET_ADDRESS_FAMILY_IPV4);
+  if (res) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  rule_out->prefix_length = (uint8_t)prefix_length;
+  rule_out->action = action;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_filter_init(chif_net_filter* filter,
+                     const chif_net_filter_rule* rules,
+                     const size_t rule_count,
+                     const chif_net_filter_action default_action)
+{
+  // order the rules by prefix length with a counting sort, which keeps rules
+  // with the same prefix length in order, so the last one wins
+  size_t starts[128 + 2] = { 0 };
+  size_t ipv6_counts[128 + 1] = { 0 };
+  for (size_t i = 0; i < rule_count; ++i) {
+    const uint8_t* bytes = NULL;
+    int byte_count = 0;
+    int prefix_length = 0;
+    if (!_chif_net_filter_rule_target(
+          &rules[i], &bytes, &byte_count, &prefix_length)) {
+      return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+    }
+    ++starts[prefix_length + 1];
+    ipv6_counts[prefix_length] += byte_count == 16;
+  }
+  for (size_t i = 1; i < sizeof(starts) / sizeof(starts[0]); ++i) {
+    starts[i] += starts[i - 1];
+  }
+
+  memset(filter, 0, sizeof(*filter));
+  filter->default_action = default_action;
+  size_t table_of_length[128 + 1];
+  uint32_t* order = malloc((rule_count ? rule_count : 1) * sizeof(uint32_t));
+  filter->node_capacity = CHIF_NET_FILTER_IPV4_ROOT_ENTRIES;
+  filter->nodes = calloc(filter->node_capacity, sizeof(uint32_t));
+  chif_net_result res =
+    order && filter->nodes
+      ? _chif_net_filter_init_tables(filter, ipv6_counts, table_of_length)
+      : CHIF_NET_RESULT_NO_MEMORY;
+  if (res) {
+    free(order);
+    chif_net_filter_destroy(filter);
+    return res;
+  }
+  filter->node_count = CHIF_NET_FILTER_IPV4_ROOT_ENTRIES;
+  for (size_t i = 0; i < rule_count && !res; ++i) {
+    const uint8_t* bytes = NULL;
+    int byte_count = 0;
+    int prefix_length = 0;
+    if (!_chif_net_filter_rule_target(
+          &rules[i], &bytes, &byte_count, &prefix_length)) {
+      res = CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+    } else {
+      order[starts[prefix_length]++] = (uint32_t)i;
+    }
+  }
+
+  for (size_t i = 0; i < rule_count && !res; ++i) {
+    const chif_net_filter_rule* rule = &rules[order[i]];
+    const uint8_t* bytes = NULL;
+    int byte_count = 0;
+    int prefix_length = 0;
+    if (!_chif_net_filter_rule_target(
+          rule, &bytes, &byte_count, &prefix_length)) {
+      res = CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+    } else if (byte_count == 4) {
+      res = _chif_net_filter_insert_ipv4(
+        filter, bytes, prefix_length, (uint32_t)rule->action + 1);
+    } else {
+      const size_t table = table_of_length[prefix_length];
+      _chif_net_filter_insert_ipv6(
+        filter, &filter->tables[table], bytes, (uint32_t)rule->action + 1);
+    }
+  }
+
+  free(order);
+  if (res) {
+    chif_net_filter_destroy(filter);
+    return res;
+  }
+
+  // the filter is never changed, so give back what the growth left over
+  uint32_t* nodes =
+    realloc(filter->nodes, filter->node_count * sizeof(uint32_t));
+  if (nodes) {
+    filter->nodes = nodes;
+    filter->node_capacity = filter->node_count;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_filter_destroy(chif_net_filter* filter)
+{
+  free(filter->nodes);
+  free(filter->prefixes);
+  free(filter->tables);
+  filter->nodes = NULL;
+  filter->node_count = 0;
+  filter->node_capacity = 0;
+  filter->prefixes = NULL;
+  filter->prefix_count = 0;
+  filter->tables = NULL;
+  filter->table_count = 0;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+size_t
+chif_net_filter_memory_size(const chif_net_filter* filter)
+{
+  return filter->node_capacity * sizeof(uint32_t) +
+         filter->prefix_count * sizeof(chif_net_filter_prefix) +
+         filter->table_count * sizeof(chif_net_filter_table);
+}
+
+chif_net_filter_action
+chif_net_filter_match(const chif_net_filter* filter,
+                      const chif_net_address* address)
+{
+  const uint8_t* bytes;
+  const int byte_count = _chif_net_filter_address_bytes(address, &bytes);
+  const uint32_t* nodes = filter->nodes;
+  uint32_t entry;
+  if (byte_count == 4) {
+    const size_t index = (size_t)bytes[0] << 8 | bytes[1];
+    entry = nodes[CHIF_NET_FILTER_IPV4_ROOT + index];
+    if (entry & CHIF_NET_FILTER_CHUNK) {
+      entry = nodes[(entry & ~CHIF_NET_FILTER_CHUNK) + bytes[2]];
+      if (entry & CHIF_NET_FILTER_CHUNK) {
+        entry = nodes[(entry & ~CHIF_NET_FILTER_CHUNK) + bytes[3]];
+      }
+    }
+  } else if (byte_count == 16) {
+    entry = _chif_net_filter_match_ipv6(filter, bytes);
+  } else {
+    entry = 0;
+  }
+
+  return entry ? (chif_net_filter_action)(entry - 1) : filter->default_action;
+}
+
+void
+chif_net_filter_handle_init(chif_net_filter_handle* handle,
+                            chif_net_filter* filter)
+{
+  handle->filter = filter;
+}
+
+chif_net_filter*
+chif_net_filter_swap(chif_net_filter_handle* handle, chif_net_filter* filter)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  return (chif_net_filter*)InterlockedExchangePointer(
+    (PVOID volatile*)&handle->filter, filter);
+#else
+  return __atomic_exchange_n(&handle->filter, filter, __ATOMIC_ACQ_REL);
+#endif
+}
+
+const chif_net_filter*
+chif_net_filter_current(const chif_net_filter_handle* handle)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  // volatile reads have acquire semantics with msvc
+  return handle->filter;
+#else
+  return __atomic_load_n(&handle->filter, __ATOMIC_ACQUIRE);
+#endif
+}
+
+chif_net_result
+chif_net_filter_accept(const chif_net_filter_handle* handle,
+                       const chif_net_socket listening_socket,
+                       chif_net_address* client_address_out,
+                       chif_net_socket* client_socket_out)
+{
+  for (;;) {
+    const chif_net_result res = chif_net_accept(
+      listening_socket, client_address_out, client_socket_out);
+    if (res) {
+      return res;
+    }
+
+    const chif_net_filter* filter = chif_net_filter_current(handle);
+    if (!filter || chif_net_filter_match(filter, client_address_out) ==
+                     CHIF_NET_FILTER_ACTION_ALLOW) {
+      return CHIF_NET_RESULT_SUCCESS;
+    }
+    chif_net_close_socket(client_socket_out);
+  }
+}
+
+chif_net_result
+chif_net_filter_readfrom(const chif_net_filter_handle* handle,
+                         const chif_net_socket socket,
+                         uint8_t* buf_out,
+                         const size_t bufsize,
+                         int* read_bytes_out,
+                         chif_net_address* from_address_out)
+{
+  for (;;) {
+    const chif_net_result res = chif_net_readfrom(
+      socket, buf_out, bufsize, read_bytes_out, from_address_out);
+    if (res) {
+      return res;
+    }
+
+    const chif_net_filter* filter = chif_net_filter_current(handle);
+    if (!filter || chif_net_filter_match(filter, from_address_out) ==
+                     CHIF_NET_FILTER_ACTION_ALLOW) {
+      return CHIF_NET_RESULT_SUCCESS;
+    }
+  }
+}
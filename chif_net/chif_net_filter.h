@@ -0,0 +1,251 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHIF_NET_FILTER_H_
+#define CHIF_NET_FILTER_H_
+
+/**
+ * Longest-prefix-match filter over IP addresses, to drop traffic from large
+ * deny lists before doing any work on it.
+ *
+ * The rules are compiled so that a lookup never looks at the rules:
+ *
+ *   IPv4 -> DIR-16-8-8, a 2^16 entry table indexed by the top 16 bits, then
+ *           256 entry chunks for longer prefixes, with the prefixes expanded
+ *           into every slot they cover, at most three reads.
+ *   IPv6 -> one hash table of prefixes per prefix length in use, probed
+ *           longest first, one probe per distinct length. The tables are
+ *           at most half full, at most 96 bytes per rule, where expanding
+ *           a /64 into 256 entry chunks would take up to 7 KiB.
+ *
+ * IPv4-mapped IPv6 addresses (from a dual-stack socket) are matched against
+ * the IPv4 rules.
+ *
+ * A compiled filter is never changed. To update it, compile a new one and
+ * publish it with chif_net_filter_swap, readers pick it up on their next
+ * lookup.
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+  typedef enum
+  {
+    CHIF_NET_FILTER_ACTION_ALLOW = 0,
+    CHIF_NET_FILTER_ACTION_DENY = 1
+  } chif_net_filter_action;
+
+  /**
+   * @param address IPv4 or IPv6 address, the port is ignored, as are the bits
+   * after the prefix.
+   * @param prefix_length Number of leading bits that must match, at most 32
+   * for IPv4 and 128 for IPv6.
+   * @param action
+   */
+  typedef struct
+  {
+    chif_net_address address;
+    uint8_t prefix_length;
+    chif_net_filter_action action;
+  } chif_net_filter_rule;
+
+  /**
+   * An IPv6 prefix, as two big-endian halves with the bits after the prefix
+   * cleared.
+   *
+   * @param value The action plus one, zero for an empty slot.
+   */
+  typedef struct
+  {
+    uint64_t high;
+    uint64_t low;
+    uint32_t value;
+  } chif_net_filter_prefix;
+
+  /**
+   * The IPv6 prefixes of one length, in an open addressing hash table.
+   *
+   * @param first Index of the first slot in prefixes.
+   * @param mask Slot count minus one, the count is a power of two.
+   * @param prefix_length
+   */
+  typedef struct
+  {
+    size_t first;
+    size_t mask;
+    int prefix_length;
+  } chif_net_filter_table;
+
+  /**
+   * Allocate it wherever you like, then call chif_net_filter_init.
+   *
+   * @param nodes IPv4 table entries. Zero is no match, a set top bit is the
+   * index of the next chunk, anything else is the action plus one.
+   * @param prefixes Slots of the IPv6 tables.
+   * @param tables The IPv6 tables, longest prefix length first.
+   */
+  typedef struct
+  {
+    uint32_t* nodes;
+    size_t node_count;
+    size_t node_capacity;
+    chif_net_filter_prefix* prefixes;
+    size_t prefix_count;
+    chif_net_filter_table* tables;
+    size_t table_count;
+    chif_net_filter_action default_action;
+  } chif_net_filter;
+
+  /**
+   * The filter in use, swapped atomically.
+   */
+  typedef struct
+  {
+    chif_net_filter* volatile filter;
+  } chif_net_filter_handle;
+
+  // ====================================================================== //
+  // Definition
+  // ====================================================================== //
+
+  /**
+   * Parse a rule such as "10.0.0.0/8", "2001:db8::/32" or a single address.
+   * Only numeric addresses are accepted, a deny list never causes a DNS
+   * lookup.
+   *
+   * @param rule_out
+   * @param cidr
+   * @param action
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if the rule is malformed.
+   */
+  chif_net_result chif_net_filter_rule_from_string(
+    chif_net_filter_rule* rule_out,
+    const char* cidr,
+    chif_net_filter_action action);
+
+  /**
+   * Compile rules into a filter. The longest matching prefix decides, so an
+   * allowed /24 inside a denied /8 is allowed. Of rules with the same prefix
+   * the last one wins.
+   *
+   * @param filter
+   * @param rules
+   * @param rule_count
+   * @param default_action For addresses that match no rule.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM for an invalid rule, or
+   * CHIF_NET_RESULT_NO_MEMORY.
+   */
+  chif_net_result chif_net_filter_init(chif_net_filter* filter,
+                                       const chif_net_filter_rule* rules,
+                                       size_t rule_count,
+                                       chif_net_filter_action default_action);
+
+  /**
+   * @param filter
+   * @return
+   */
+  chif_net_result chif_net_filter_destroy(chif_net_filter* filter);
+
+  /**
+   * @param filter
+   * @return Bytes of memory the compiled filter takes.
+   */
+  size_t chif_net_filter_memory_size(const chif_net_filter* filter);
+
+  /**
+   * @param filter
+   * @param address
+   * @return The action of the longest matching rule. Addresses that are
+   * neither IPv4 nor IPv6 get the default action.
+   */
+  chif_net_filter_action chif_net_filter_match(const chif_net_filter* filter,
+                                               const chif_net_address* address);
+
+  /**
+   * @param handle
+   * @param filter Initial filter, NULL to allow everything.
+   */
+  void chif_net_filter_handle_init(chif_net_filter_handle* handle,
+                                   chif_net_filter* filter);
+
+  /**
+   * Publish a new filter.
+   *
+   * @param handle
+   * @param filter The new filter, NULL to allow everything.
+   * @return The previous filter. Threads may still be reading it, destroy it
+   * only once every reader has finished the lookup it was doing, for example
+   * after each worker has gone once around its event loop.
+   */
+  chif_net_filter* chif_net_filter_swap(chif_net_filter_handle* handle,
+                                        chif_net_filter* filter);
+
+  /**
+   * @return The published filter, or NULL.
+   */
+  const chif_net_filter* chif_net_filter_current(
+    const chif_net_filter_handle* handle);
+
+  /**
+   * chif_net_accept that closes connections from denied addresses right away
+   * and accepts the next one, so only allowed connections are returned.
+   *
+   * @return As chif_net_accept. On a non-blocking socket, the error once no
+   * more connections are pending.
+   */
+  chif_net_result chif_net_filter_accept(const chif_net_filter_handle* handle,
+                                         chif_net_socket listening_socket,
+                                         chif_net_address* client_address_out,
+                                         chif_net_socket* client_socket_out);
+
+  /**
+   * chif_net_readfrom that drops datagrams from denied addresses and reads
+   * the next one, so only allowed datagrams are returned.
+   *
+   * @return As chif_net_readfrom.
+   */
+  chif_net_result chif_net_filter_readfrom(const chif_net_filter_handle* handle,
+                                           chif_net_socket socket,
+                                           uint8_t* buf_out,
+                                           size_t bufsize,
+                                           int* read_bytes_out,
+                                           chif_net_address* from_address_out);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_FILTER_H_
@@ -0,0 +1,352 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_happy_eyeballs.h"
+
+#include <string.h>
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+/**
+ * Copy the addresses, alternating between address families. RFC 8305
+ * section 4, with a First Address Family Count of one.
+ */
+static void
+_chif_net_happy_eyeballs_interleave(chif_net_happy_eyeballs* happy_eyeballs,
+                                    const chif_net_address* addresses,
+                                    size_t address_count)
+{
+  if (address_count > CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES) {
+    address_count = CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES;
+  }
+
+  const uint16_t first_family = addresses[0].address_family;
+  size_t first = 0;
+  size_t other = 0;
+  int take_first = 1;
+  for (size_t i = 0; i < address_count; ++i) {
+    while (first < address_count &&
+           addresses[first].address_family != first_family) {
+      ++first;
+    }
+    while (other < address_count &&
+           addresses[other].address_family == first_family) {
+      ++other;
+    }
+
+    size_t pick;
+    if ((take_first && first < address_count) || other == address_count) {
+      pick = first++;
+    } else {
+      pick = other++;
+    }
+    take_first = !take_first;
+    memcpy(&happy_eyeballs->addresses[i],
+           &addresses[pick],
+           sizeof(chif_net_address));
+  }
+  happy_eyeballs->address_count = address_count;
+}
+
+static void
+_chif_net_happy_eyeballs_close(chif_net_happy_eyeballs* happy_eyeballs,
+                               const size_t index)
+{
+  chif_net_close_socket(&happy_eyeballs->sockets[index]);
+  --happy_eyeballs->in_flight;
+}
+
+/**
+ * Start the attempt to connect to the next address.
+ */
+static void
+_chif_net_happy_eyeballs_start_next(chif_net_happy_eyeballs* happy_eyeballs,
+                                    const uint64_t now)
+{
+  const size_t index = happy_eyeballs->next_address++;
+  happy_eyeballs->next_attempt_ms =
+    now + (uint64_t)happy_eyeballs->attempt_delay_ms;
+
+  const chif_net_address* address = &happy_eyeballs->addresses[index];
+  chif_net_socket* socket = &happy_eyeballs->sockets[index];
+  chif_net_result res =
+    chif_net_open_socket(socket,
+                         CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                         (chif_net_address_family)address->address_family);
+  if (res) {
+    happy_eyeballs->last_error = res;
+    return;
+  }
+  ++happy_eyeballs->in_flight;
+
+  res = chif_net_connect_start(*socket, address);
+  if (res && res != CHIF_NET_RESULT_IN_PROGRESS) {
+    happy_eyeballs->last_error = res;
+    _chif_net_happy_eyeballs_close(happy_eyeballs, index);
+  }
+}
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+chif_net_result
+chif_net_happy_eyeballs_start(chif_net_happy_eyeballs* happy_eyeballs,
+                              const chif_net_address* addresses,
+                              const size_t address_count,
+                              const int attempt_delay_ms,
+                              const int timeout_ms)
+{
+  if (address_count == 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  _chif_net_happy_eyeballs_interleave(happy_eyeballs, addresses, address_count);
+  for (size_t i = 0; i < CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES; ++i) {
+    happy_eyeballs->sockets[i] = CHIF_NET_INVALID_SOCKET;
+  }
+  happy_eyeballs->next_address = 0;
+  happy_eyeballs->in_flight = 0;
+  happy_eyeballs->attempt_delay_ms = attempt_delay_ms;
+  happy_eyeballs->last_error = CHIF_NET_RESULT_SUCCESS;
+
+  const uint64_t now = chif_net_time_ms();
+  happy_eyeballs->deadline_ms =
+    timeout_ms < 0 ? UINT64_MAX : now + (uint64_t)timeout_ms;
+  _chif_net_happy_eyeballs_start_next(happy_eyeballs, now);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_happy_eyeballs_fill_checks(
+  const chif_net_happy_eyeballs* happy_eyeballs,
+  chif_net_check* checks,
+  const size_t check_capacity,
+  size_t* check_count_out)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < happy_eyeballs->next_address; ++i) {
+    if (happy_eyeballs->sockets[i] == CHIF_NET_INVALID_SOCKET) {
+      continue;
+    }
+    if (count == check_capacity) {
+      return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+    }
+    checks[count].socket = happy_eyeballs->sockets[i];
+    checks[count].request_events = CHIF_NET_CHECK_EVENT_WRITE;
+    checks[count].return_events = 0;
+    ++count;
+  }
+  *check_count_out = count;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_happy_eyeballs_process(chif_net_happy_eyeballs* happy_eyeballs,
+                                chif_net_socket* socket_out,
+                                chif_net_address* address_out)
+{
+  chif_net_check checks[CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES];
+  size_t indices[CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES];
+  size_t check_count = 0;
+  for (size_t i = 0; i < happy_eyeballs->next_address; ++i) {
+    if (happy_eyeballs->sockets[i] != CHIF_NET_INVALID_SOCKET) {
+      checks[check_count].socket = happy_eyeballs->sockets[i];
+      checks[check_count].request_events = CHIF_NET_CHECK_EVENT_WRITE;
+      checks[check_count].return_events = 0;
+      indices[check_count++] = i;
+    }
+  }
+
+  int ready_count = 0;
+  if (check_count > 0) {
+    const chif_net_result res =
+      chif_net_poll(checks, check_count, &ready_count, 0);
+    if (res) {
+      return res;
+    }
+  }
+
+  const uint64_t now = chif_net_time_ms();
+  for (size_t c = 0; c < check_count && ready_count > 0; ++c) {
+    if (checks[c].return_events == 0) {
+      continue;
+    }
+    --ready_count;
+
+    // writable means connected, unless there is a pending error
+    const size_t index = indices[c];
+    chif_net_result error;
+    chif_net_result res =
+      chif_net_get_socket_error(happy_eyeballs->sockets[index], &error);
+    if (!res && !error &&
+        !(checks[c].return_events & CHIF_NET_CHECK_EVENT_WRITE)) {
+      error = CHIF_NET_RESULT_CONNECTION_CLOSED;
+    }
+    if (res || error) {
+      happy_eyeballs->last_error = res ? res : error;
+      _chif_net_happy_eyeballs_close(happy_eyeballs, index);
+      // a failed attempt does not have to wait for the delay
+      happy_eyeballs->next_attempt_ms = now;
+      continue;
+    }
+
+    *socket_out = happy_eyeballs->sockets[index];
+    happy_eyeballs->sockets[index] = CHIF_NET_INVALID_SOCKET;
+    --happy_eyeballs->in_flight;
+    if (address_out) {
+      memcpy(address_out,
+             &happy_eyeballs->addresses[index],
+             sizeof(chif_net_address));
+    }
+    chif_net_happy_eyeballs_cancel(happy_eyeballs);
+    return CHIF_NET_RESULT_SUCCESS;
+  }
+
+  if (now >= happy_eyeballs->deadline_ms) {
+    chif_net_happy_eyeballs_cancel(happy_eyeballs);
+    return CHIF_NET_RESULT_TIMEDOUT;
+  }
+
+  while (happy_eyeballs->next_address < happy_eyeballs->address_count &&
+         (now >= happy_eyeballs->next_attempt_ms ||
+          happy_eyeballs->in_flight == 0)) {
+    _chif_net_happy_eyeballs_start_next(happy_eyeballs, now);
+  }
+
+  if (happy_eyeballs->in_flight == 0) {
+    return happy_eyeballs->last_error ? happy_eyeballs->last_error
+                                      : CHIF_NET_RESULT_FAIL;
+  }
+  return CHIF_NET_RESULT_IN_PROGRESS;
+}
+
+int
+chif_net_happy_eyeballs_next_timeout_ms(
+  const chif_net_happy_eyeballs* happy_eyeballs)
+{
+  uint64_t deadline = happy_eyeballs->deadline_ms;
+  if (happy_eyeballs->next_address < happy_eyeballs->address_count &&
+      happy_eyeballs->next_attempt_ms < deadline) {
+    deadline = happy_eyeballs->next_attempt_ms;
+  }
+  if (deadline == UINT64_MAX) {
+    return -1;
+  }
+
+  const uint64_t now = chif_net_time_ms();
+  if (deadline <= now) {
+    return 0;
+  }
+  const uint64_t remaining = deadline - now;
+  return remaining > INT32_MAX ? INT32_MAX : (int)remaining;
+}
+
+chif_net_result
+chif_net_happy_eyeballs_cancel(chif_net_happy_eyeballs* happy_eyeballs)
+{
+  for (size_t i = 0; i < happy_eyeballs->next_address; ++i) {
+    if (happy_eyeballs->sockets[i] != CHIF_NET_INVALID_SOCKET) {
+      _chif_net_happy_eyeballs_close(happy_eyeballs, i);
+    }
+  }
+  // nothing more to start
+  happy_eyeballs->next_address = happy_eyeballs->address_count;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_happy_eyeballs_connect(chif_net_socket* socket_out,
+                                chif_net_address* address_out,
+                                const char* name,
+                                const char* service,
+                                const int timeout_ms)
+{
+  chif_net_address addresses[CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES];
+  size_t address_count;
+  chif_net_result res =
+    chif_net_create_addresses(addresses,
+                              CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES,
+                              &address_count,
+                              name,
+                              service,
+                              CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                              CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED);
+  if (res) {
+    return res;
+  }
+
+  chif_net_happy_eyeballs happy_eyeballs;
+  res = chif_net_happy_eyeballs_start(&happy_eyeballs,
+                                      addresses,
+                                      address_count,
+                                      CHIF_NET_HAPPY_EYEBALLS_DEFAULT_DELAY_MS,
+                                      timeout_ms);
+  if (res) {
+    return res;
+  }
+
+  for (;;) {
+    res =
+      chif_net_happy_eyeballs_process(&happy_eyeballs, socket_out, address_out);
+    if (res != CHIF_NET_RESULT_IN_PROGRESS) {
+      break;
+    }
+
+    chif_net_check checks[CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES];
+    size_t check_count;
+    res = chif_net_happy_eyeballs_fill_checks(
+      &happy_eyeballs,
+      checks,
+      CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES,
+      &check_count);
+    if (res) {
+      chif_net_happy_eyeballs_cancel(&happy_eyeballs);
+      return res;
+    }
+    const int poll_timeout_ms =
+      chif_net_happy_eyeballs_next_timeout_ms(&happy_eyeballs);
+    int ready_count;
+    res = chif_net_poll(checks, check_count, &ready_count, poll_timeout_ms);
+    if (res) {
+      chif_net_happy_eyeballs_cancel(&happy_eyeballs);
+      return res;
+    }
+  }
+
+  if (res) {
+    return res;
+  }
+  res = chif_net_set_blocking(*socket_out, CHIF_NET_TRUE);
+  if (res) {
+    chif_net_close_socket(socket_out);
+  }
+  return res;
+}
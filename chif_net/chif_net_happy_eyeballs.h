@@ -0,0 +1,181 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CHIF_NET_HAPPY_EYEBALLS_H_
+#define CHIF_NET_HAPPY_EYEBALLS_H_
+
+/**
+ * Happy Eyeballs (RFC 8305), connect to the first of many addresses that
+ * answers.
+ *
+ * Connection attempts are started one at a time, attempt_delay_ms apart, and
+ * alternate between IPv6 and IPv4 addresses. An attempt that fails starts the
+ * next one right away. The first attempt to connect wins and the others are
+ * closed, so a broken path costs one attempt delay instead of a full connect
+ * timeout.
+ *
+ * It is driven from the caller's event loop like chif_net_resolver:
+ *
+ *   chif_net_happy_eyeballs_fill_checks -> add the checks to chif_net_poll
+ *   chif_net_happy_eyeballs_next_timeout_ms -> cap the poll timeout
+ *   chif_net_happy_eyeballs_process -> after the poll, until it is done
+ *
+ * chif_net_happy_eyeballs_connect wraps it all in a blocking call.
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+
+// Most addresses raced, the rest are ignored.
+#define CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES 16
+
+// Recommended Connection Attempt Delay from RFC 8305.
+#define CHIF_NET_HAPPY_EYEBALLS_DEFAULT_DELAY_MS 250
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+  /**
+   * State of one race, allocate it wherever you like.
+   */
+  typedef struct
+  {
+    chif_net_address addresses[CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES];
+    chif_net_socket sockets[CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES];
+    size_t address_count;
+    size_t next_address;
+    size_t in_flight;
+    int attempt_delay_ms;
+    uint64_t next_attempt_ms;
+    uint64_t deadline_ms;
+    chif_net_result last_error;
+  } chif_net_happy_eyeballs;
+
+  // ====================================================================== //
+  // Definition
+  // ====================================================================== //
+
+  /**
+   * Start racing TCP connections to the addresses. The first attempt is
+   * started before returning.
+   *
+   * @param happy_eyeballs
+   * @param addresses In order of preference, such as from
+   * chif_net_create_addresses. They are reordered to alternate between
+   * address families, starting with the family of the first address.
+   * @param address_count
+   * @param attempt_delay_ms Time between starting two attempts, use
+   * CHIF_NET_HAPPY_EYEBALLS_DEFAULT_DELAY_MS.
+   * @param timeout_ms Give up after this long, or -1 to wait for every
+   * attempt to fail on its own.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if there are no addresses.
+   */
+  chif_net_result chif_net_happy_eyeballs_start(
+    chif_net_happy_eyeballs* happy_eyeballs,
+    const chif_net_address* addresses,
+    size_t address_count,
+    int attempt_delay_ms,
+    int timeout_ms);
+
+  /**
+   * Fill out a check for every attempt in flight, for you to pass to
+   * chif_net_poll.
+   *
+   * @param happy_eyeballs
+   * @param checks
+   * @param check_capacity Use CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES to always
+   * fit.
+   * @param check_count_out
+   * @return CHIF_NET_RESULT_NOT_ENOUGH_SPACE if check_capacity is too small.
+   */
+  chif_net_result chif_net_happy_eyeballs_fill_checks(
+    const chif_net_happy_eyeballs* happy_eyeballs,
+    chif_net_check* checks,
+    size_t check_capacity,
+    size_t* check_count_out);
+
+  /**
+   * Collect finished attempts and start new ones. Never blocks.
+   *
+   * @param happy_eyeballs
+   * @param socket_out On success, the connected socket. It is yours to close,
+   * and is left in non-blocking mode.
+   * @param address_out On success, the address it connected to. May be NULL.
+   * @return CHIF_NET_RESULT_IN_PROGRESS while racing. Else the race is over,
+   * with CHIF_NET_RESULT_SUCCESS, CHIF_NET_RESULT_TIMEDOUT, or the error of
+   * the last attempt to fail.
+   */
+  chif_net_result chif_net_happy_eyeballs_process(
+    chif_net_happy_eyeballs* happy_eyeballs,
+    chif_net_socket* socket_out,
+    chif_net_address* address_out);
+
+  /**
+   * @param happy_eyeballs
+   * @return Milliseconds until the next attempt should start or the race
+   * times out, or -1 if neither. Fits the timeout_ms of chif_net_poll.
+   */
+  int chif_net_happy_eyeballs_next_timeout_ms(
+    const chif_net_happy_eyeballs* happy_eyeballs);
+
+  /**
+   * Close every attempt in flight.
+   *
+   * @param happy_eyeballs
+   * @return
+   */
+  chif_net_result chif_net_happy_eyeballs_cancel(
+    chif_net_happy_eyeballs* happy_eyeballs);
+
+  /**
+   * Resolve name for both IPv6 and IPv4, then race the addresses. Blocks
+   * until connected, or until every address failed.
+   *
+   * @param socket_out The connected socket, in blocking mode.
+   * @param address_out The address it connected to. May be NULL.
+   * @param name
+   * @param service
+   * @param timeout_ms Give up after this long, or -1 for no limit. Does not
+   * include the time to resolve the name.
+   * @return
+   */
+  chif_net_result chif_net_happy_eyeballs_connect(chif_net_socket* socket_out,
+                                                  chif_net_address* address_out,
+                                                  const char* name,
+                                                  const char* service,
+                                                  int timeout_ms);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_HAPPY_EYEBALLS_H_
@@ -0,0 +1,321 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_limiter.h"
+
+#include <string.h>
+
+// ============================================================ //
+// Static Asserts
+// ============================================================ //
+
+CHIF_NET_STATIC_ASSERT((CHIF_NET_LIMITER_COLUMNS &
+                        (CHIF_NET_LIMITER_COLUMNS - 1)) == 0,
+                       limiter_columns_power_of_two);
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+// Buckets hold thousandths of a token, so a rate per second refills the same
+// number of them per millisecond.
+#define CHIF_NET_LIMITER_SCALE 1000u
+
+#define CHIF_NET_LIMITER_MAX_SETTING 1000000u
+
+// Odd multipliers, one per row, so every row places a source differently.
+static const uint32_t _chif_net_limiter_row_seeds[] = {
+  0x9e3779b1u, 0x85ebca77u, 0xc2b2ae3du, 0x27d4eb2fu,
+  0x165667b1u, 0xd3a2646du, 0xfd7046c5u, 0xb55a4f09u
+};
+
+CHIF_NET_STATIC_ASSERT(CHIF_NET_LIMITER_ROWS <=
+                         sizeof(_chif_net_limiter_row_seeds) /
+                           sizeof(_chif_net_limiter_row_seeds[0]),
+                       limiter_rows_have_seeds);
+
+static const uint8_t _chif_net_limiter_ipv4_mapped_prefix[12] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff
+};
+
+/**
+ * The key of the source, without the port and, for IPv6, without the bits
+ * after the prefix.
+ */
+static chif_net_result
+_chif_net_limiter_source_key(const chif_net_limiter* limiter,
+                             const chif_net_address* address,
+                             chif_net_address_key* key_out)
+{
+  const chif_net_result res =
+    chif_net_address_key_from_address(address, key_out);
+  if (res) {
+    return res;
+  }
+  key_out->port = 0;
+
+  uint8_t* bytes = (uint8_t*)key_out->address;
+  if (memcmp(bytes,
+             _chif_net_limiter_ipv4_mapped_prefix,
+             sizeof(_chif_net_limiter_ipv4_mapped_prefix)) == 0) {
+    return CHIF_NET_RESULT_SUCCESS;
+  }
+  const int prefix_length = limiter->ipv6_prefix_length;
+  for (int i = 0; i < 16; ++i) {
+    const int bits = prefix_length - i * 8;
+    if (bits <= 0) {
+      bytes[i] = 0;
+    } else if (bits < 8) {
+      bytes[i] &= (uint8_t)(0xff << (8 - bits));
+    }
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_limiter_bucket*
+_chif_net_limiter_bucket(chif_net_limiter* limiter,
+                         const int row,
+                         const uint32_t hash)
+{
+  const uint32_t mixed = hash * _chif_net_limiter_row_seeds[row];
+  // the high bits of the product are the best mixed
+  const size_t column =
+    (size_t)(((uint64_t)mixed * CHIF_NET_LIMITER_COLUMNS) >> 32);
+  return &limiter->buckets[row][column];
+}
+
+static uint32_t
+_chif_net_limiter_refill(const chif_net_limiter* limiter,
+                         chif_net_limiter_bucket* bucket,
+                         const uint32_t now_ms)
+{
+  const uint32_t elapsed_ms = now_ms - bucket->updated_ms;
+  const uint64_t burst = (uint64_t)limiter->burst * CHIF_NET_LIMITER_SCALE;
+  uint64_t tokens =
+    bucket->tokens + (uint64_t)elapsed_ms * limiter->rate_per_s;
+  if (tokens > burst) {
+    tokens = burst;
+  }
+  bucket->tokens = (uint32_t)tokens;
+  bucket->updated_ms = now_ms;
+  return bucket->tokens;
+}
+
+/**
+ * Space-saving: a source that is not tracked replaces the lightest tracked
+ * one, and inherits its count as the error.
+ *
+ * @param heavy Whether a source that is not tracked may enter.
+ */
+static void
+_chif_net_limiter_observe(chif_net_limiter* limiter,
+                          const chif_net_address_key* key,
+                          const uint32_t hash,
+                          const uint32_t weight,
+                          const int denied,
+                          const int heavy)
+{
+  for (size_t i = 0; i < limiter->top_count; ++i) {
+    if (limiter->top_hashes[i] == hash &&
+        chif_net_address_key_equal(&limiter->top[i].key, key)) {
+      limiter->top[i].count += weight;
+      limiter->top[i].denied += (uint64_t)denied;
+      return;
+    }
+  }
+
+  if (!heavy) {
+    return;
+  }
+
+  size_t slot;
+  uint64_t error = 0;
+  if (limiter->top_count < CHIF_NET_LIMITER_TOP_ENTRIES) {
+    slot = limiter->top_count++;
+  } else {
+    slot = 0;
+    for (size_t i = 1; i < CHIF_NET_LIMITER_TOP_ENTRIES; ++i) {
+      if (limiter->top[i].count < limiter->top[slot].count) {
+        slot = i;
+      }
+    }
+    error = limiter->top[slot].count;
+  }
+
+  limiter->top_hashes[slot] = hash;
+  limiter->top[slot].key = *key;
+  limiter->top[slot].count = error + weight;
+  limiter->top[slot].error = error;
+  limiter->top[slot].denied = (uint64_t)denied;
+}
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+chif_net_result
+chif_net_limiter_init(chif_net_limiter* limiter,
+                      const uint32_t rate_per_s,
+                      const uint32_t burst)
+{
+  if (burst == 0 || burst > CHIF_NET_LIMITER_MAX_SETTING ||
+      rate_per_s > CHIF_NET_LIMITER_MAX_SETTING) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  limiter->rate_per_s = rate_per_s;
+  limiter->burst = burst;
+  limiter->ipv6_prefix_length = CHIF_NET_LIMITER_DEFAULT_IPV6_PREFIX_LENGTH;
+  chif_net_limiter_reset_top(limiter);
+
+  const uint32_t now_ms = (uint32_t)chif_net_time_ms();
+  for (int row = 0; row < CHIF_NET_LIMITER_ROWS; ++row) {
+    for (size_t column = 0; column < CHIF_NET_LIMITER_COLUMNS; ++column) {
+      limiter->buckets[row][column].tokens = burst * CHIF_NET_LIMITER_SCALE;
+      limiter->buckets[row][column].updated_ms = now_ms;
+    }
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_bool
+chif_net_limiter_allow(chif_net_limiter* limiter,
+                       const chif_net_address* address,
+                       const uint32_t cost,
+                       const uint64_t now_ms)
+{
+  chif_net_address_key key;
+  if (_chif_net_limiter_source_key(limiter, address, &key)) {
+    return CHIF_NET_TRUE;
+  }
+  const uint32_t hash = chif_net_address_key_hash(&key);
+
+  // every bucket of the source is shared with other sources, so each one has
+  // at most the tokens of the source, and the fullest is the best estimate
+  chif_net_limiter_bucket* buckets[CHIF_NET_LIMITER_ROWS];
+  uint32_t tokens = 0;
+  for (int row = 0; row < CHIF_NET_LIMITER_ROWS; ++row) {
+    buckets[row] = _chif_net_limiter_bucket(limiter, row, hash);
+    const uint32_t row_tokens =
+      _chif_net_limiter_refill(limiter, buckets[row], (uint32_t)now_ms);
+    if (row_tokens > tokens) {
+      tokens = row_tokens;
+    }
+  }
+
+  const uint64_t needed = (uint64_t)cost * CHIF_NET_LIMITER_SCALE;
+  const int allowed = tokens >= needed;
+  if (allowed) {
+    tokens -= (uint32_t)needed;
+    for (int row = 0; row < CHIF_NET_LIMITER_ROWS; ++row) {
+      buckets[row]->tokens = buckets[row]->tokens > needed
+                               ? buckets[row]->tokens - (uint32_t)needed
+                               : 0;
+    }
+  }
+
+  // only sources that have used half their burst may enter the top, so a
+  // flood of one-off sources does not churn it
+  const int heavy =
+    tokens < (uint64_t)limiter->burst * (CHIF_NET_LIMITER_SCALE / 2);
+  _chif_net_limiter_observe(limiter, &key, hash, cost, !allowed, heavy);
+  return allowed ? CHIF_NET_TRUE : CHIF_NET_FALSE;
+}
+
+size_t
+chif_net_limiter_top(const chif_net_limiter* limiter,
+                     chif_net_limiter_hitter* hitters_out,
+                     const size_t capacity)
+{
+  // insertion sort into the output, there are only a few entries
+  size_t count = 0;
+  for (size_t i = 0; i < limiter->top_count; ++i) {
+    const chif_net_limiter_hitter* hitter = &limiter->top[i];
+    size_t position = count;
+    while (position > 0 && hitters_out[position - 1].count < hitter->count) {
+      if (position < capacity) {
+        hitters_out[position] = hitters_out[position - 1];
+      }
+      --position;
+    }
+    if (position < capacity) {
+      hitters_out[position] = *hitter;
+    }
+    if (count < capacity) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void
+chif_net_limiter_reset_top(chif_net_limiter* limiter)
+{
+  limiter->top_count = 0;
+}
+
+chif_net_result
+chif_net_limiter_accept(chif_net_limiter* limiter,
+                        const chif_net_socket listening_socket,
+                        chif_net_address* client_address_out,
+                        chif_net_socket* client_socket_out)
+{
+  for (;;) {
+    const chif_net_result res = chif_net_accept(
+      listening_socket, client_address_out, client_socket_out);
+    if (res) {
+      return res;
+    }
+    if (chif_net_limiter_allow(
+          limiter, client_address_out, 1, chif_net_time_ms())) {
+      return CHIF_NET_RESULT_SUCCESS;
+    }
+    chif_net_close_socket(client_socket_out);
+  }
+}
+
+chif_net_result
+chif_net_limiter_readfrom(chif_net_limiter* limiter,
+                          const chif_net_socket socket,
+                          uint8_t* buf_out,
+                          const size_t bufsize,
+                          int* read_bytes_out,
+                          chif_net_address* from_address_out)
+{
+  for (;;) {
+    const chif_net_result res = chif_net_readfrom(
+      socket, buf_out, bufsize, read_bytes_out, from_address_out);
+    if (res) {
+      return res;
+    }
+    if (chif_net_limiter_allow(
+          limiter, from_address_out, 1, chif_net_time_ms())) {
+      return CHIF_NET_RESULT_SUCCESS;
+    }
+  }
+}
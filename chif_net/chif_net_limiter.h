@@ -0,0 +1,195 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHIF_NET_LIMITER_H_
+#define CHIF_NET_LIMITER_H_
+
+/**
+ * Per source address rate limiting in fixed memory.
+ *
+ * Every source gets a token bucket, without storing one per source: the
+ * buckets live in a count-min sketch of CHIF_NET_LIMITER_ROWS rows, a source
+ * hashes to one bucket per row and takes its tokens from all of them, and it
+ * may send while any one of its buckets has tokens. Only sources that share
+ * a bucket in every row are limited together, so an innocent source is
+ * rarely limited with a flooding one, while a flooding source is never let
+ * through, however many spoofed sources there are.
+ *
+ * The heaviest sources are tracked with the space-saving algorithm in
+ * CHIF_NET_LIMITER_TOP_ENTRIES entries, see chif_net_limiter_top. A source
+ * is only considered once it has used half its burst, so a flood of one-off
+ * sources does not push out the real heavy hitters.
+ *
+ * Sources are compared by address, not port, and IPv6 sources by their
+ * leading ipv6_prefix_length bits, as one host usually has a whole /64.
+ *
+ * A limiter is not thread-safe, use one per thread.
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+#include "chif_net_session.h"
+
+// Must be a power of two.
+#define CHIF_NET_LIMITER_COLUMNS 4096
+#define CHIF_NET_LIMITER_ROWS 4
+
+#define CHIF_NET_LIMITER_TOP_ENTRIES 32
+
+#define CHIF_NET_LIMITER_DEFAULT_IPV6_PREFIX_LENGTH 64
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+  /**
+   * @param tokens In thousandths of a token.
+   * @param updated_ms When tokens was last refilled, in chif_net_time_ms time
+   * truncated to 32 bits.
+   */
+  typedef struct
+  {
+    uint32_t tokens;
+    uint32_t updated_ms;
+  } chif_net_limiter_bucket;
+
+  /**
+   * @param key The source, with the port cleared.
+   * @param count How many tokens it asked for since it entered the top. The
+   * true count is between count - error and count.
+   * @param error
+   * @param denied How many times it was limited since it entered the top.
+   */
+  typedef struct
+  {
+    chif_net_address_key key;
+    uint64_t count;
+    uint64_t error;
+    uint64_t denied;
+  } chif_net_limiter_hitter;
+
+  /**
+   * Allocate it wherever you like, then call chif_net_limiter_init. It is
+   * large, prefer the heap over the stack.
+   *
+   * ipv6_prefix_length may be changed after chif_net_limiter_init.
+   */
+  typedef struct
+  {
+    uint32_t rate_per_s;
+    uint32_t burst;
+    uint8_t ipv6_prefix_length;
+    size_t top_count;
+    uint32_t top_hashes[CHIF_NET_LIMITER_TOP_ENTRIES];
+    chif_net_limiter_hitter top[CHIF_NET_LIMITER_TOP_ENTRIES];
+    chif_net_limiter_bucket buckets[CHIF_NET_LIMITER_ROWS]
+                                   [CHIF_NET_LIMITER_COLUMNS];
+  } chif_net_limiter;
+
+  // ====================================================================== //
+  // Definition
+  // ====================================================================== //
+
+  /**
+   * @param limiter
+   * @param rate_per_s Tokens a source gets per second.
+   * @param burst Tokens a source can save up, and starts out with.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if burst is 0, or either is
+   * above a million.
+   */
+  chif_net_result chif_net_limiter_init(chif_net_limiter* limiter,
+                                        uint32_t rate_per_s,
+                                        uint32_t burst);
+
+  /**
+   * Take tokens from the bucket of a source.
+   *
+   * @param limiter
+   * @param address The source, IPv4 or IPv6.
+   * @param cost Tokens to take, such as 1 per packet or connection.
+   * @param now_ms From chif_net_time_ms.
+   * @return CHIF_NET_TRUE if the source had the tokens.
+   */
+  chif_net_bool chif_net_limiter_allow(chif_net_limiter* limiter,
+                                       const chif_net_address* address,
+                                       uint32_t cost,
+                                       uint64_t now_ms);
+
+  /**
+   * The heaviest sources, heaviest first.
+   *
+   * @param limiter
+   * @param hitters_out
+   * @param capacity
+   * @return Number of hitters written.
+   */
+  size_t chif_net_limiter_top(const chif_net_limiter* limiter,
+                              chif_net_limiter_hitter* hitters_out,
+                              size_t capacity);
+
+  /**
+   * Forget the heaviest sources, to start a new measuring window. The buckets
+   * are kept.
+   *
+   * @param limiter
+   */
+  void chif_net_limiter_reset_top(chif_net_limiter* limiter);
+
+  /**
+   * chif_net_accept that closes connections from sources over their rate
+   * right away and accepts the next one, at a cost of one token each.
+   *
+   * @return As chif_net_accept.
+   */
+  chif_net_result chif_net_limiter_accept(chif_net_limiter* limiter,
+                                          chif_net_socket listening_socket,
+                                          chif_net_address* client_address_out,
+                                          chif_net_socket* client_socket_out);
+
+  /**
+   * chif_net_readfrom that drops datagrams from sources over their rate and
+   * reads the next one, at a cost of one token each.
+   *
+   * @return As chif_net_readfrom.
+   */
+  chif_net_result chif_net_limiter_readfrom(chif_net_limiter* limiter,
+                                            chif_net_socket socket,
+                                            uint8_t* buf_out,
+                                            size_t bufsize,
+                                            int* read_bytes_out,
+                                            chif_net_address* from_address_out);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_LIMITER_H_
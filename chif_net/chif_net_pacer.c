@@ -0,0 +1,116 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_pacer.h"
+
+#if defined(CHIF_NET_WINSOCK2)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+static uint64_t
+_chif_net_pacer_duration_ns(const chif_net_pacer* pacer, const uint64_t bytes)
+{
+  return bytes * 1000000000 / pacer->rate_bytes_per_s;
+}
+
+static void
+_chif_net_pacer_sleep_ns(const uint64_t duration_ns)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  // Sleep has millisecond resolution at best, the rest is spun
+  Sleep((DWORD)(duration_ns / 1000000));
+#else
+  struct timespec duration;
+  duration.tv_sec = (time_t)(duration_ns / 1000000000);
+  duration.tv_nsec = (long)(duration_ns % 1000000000);
+  nanosleep(&duration, NULL);
+#endif
+}
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+chif_net_result
+chif_net_pacer_init(chif_net_pacer* pacer,
+                    const uint64_t rate_bytes_per_s,
+                    const uint64_t burst_bytes)
+{
+  if (rate_bytes_per_s == 0 || burst_bytes == 0 ||
+      burst_bytes > UINT64_MAX / 1000000000) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  pacer->rate_bytes_per_s = rate_bytes_per_s;
+  pacer->burst_ns = _chif_net_pacer_duration_ns(pacer, burst_bytes);
+  pacer->next_ns = 0;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+uint64_t
+chif_net_pacer_schedule(chif_net_pacer* pacer,
+                        const size_t bytes,
+                        const uint64_t now_ns)
+{
+  // time not used while idle is credit, up to the burst
+  const uint64_t earliest = now_ns > pacer->burst_ns ? now_ns - pacer->burst_ns
+                                                     : 0;
+  if (pacer->next_ns < earliest) {
+    pacer->next_ns = earliest;
+  }
+  pacer->next_ns += _chif_net_pacer_duration_ns(pacer, (uint64_t)bytes);
+  return pacer->next_ns > now_ns ? pacer->next_ns : now_ns;
+}
+
+chif_net_result
+chif_net_pacer_writeto(chif_net_pacer* pacer,
+                       const chif_net_socket socket,
+                       const uint8_t* buf,
+                       const size_t bufsize,
+                       int* sent_bytes_out,
+                       const chif_net_address* to_address)
+{
+  uint64_t now_ns = chif_net_time_ns();
+  const uint64_t departure_ns =
+    chif_net_pacer_schedule(pacer, bufsize, now_ns);
+  if (departure_ns - now_ns > CHIF_NET_PACER_SPIN_NS) {
+    _chif_net_pacer_sleep_ns(departure_ns - now_ns - CHIF_NET_PACER_SPIN_NS);
+  }
+  while (now_ns < departure_ns) {
+    now_ns = chif_net_time_ns();
+  }
+  return chif_net_writeto(socket, buf, bufsize, sent_bytes_out, to_address);
+}
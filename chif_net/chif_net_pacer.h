@@ -0,0 +1,130 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHIF_NET_PACER_H_
+#define CHIF_NET_PACER_H_
+
+/**
+ * Spread datagrams evenly at a target rate, instead of sending them in bursts
+ * that overflow switch buffers and the queues of the receiver.
+ *
+ * The pacer is a token bucket kept as a single timestamp: every datagram
+ * gets a departure time, bytes / rate after the one before it, and up to
+ * burst_bytes may leave back to back after the sender has been idle. The
+ * departure time can be handed to the kernel with chif_net_writeto_at,
+ * where the fq or etf qdisc does the waiting, or waited for in user space
+ * with chif_net_pacer_writeto.
+ *
+ * When the kernel can pace the whole socket, chif_net_set_max_pacing_rate is
+ * cheaper still, the pacer is for when it cannot, or per destination rates.
+ *
+ * A pacer is not thread-safe, use one per sending thread.
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+
+// Waits shorter than this are spun, a sleep would overshoot them.
+#define CHIF_NET_PACER_SPIN_NS 100000
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+  /**
+   * @param rate_bytes_per_s
+   * @param burst_ns Time to send burst_bytes at the rate.
+   * @param next_ns Departure time of the last datagram, in chif_net_time_ns
+   * time.
+   */
+  typedef struct
+  {
+    uint64_t rate_bytes_per_s;
+    uint64_t burst_ns;
+    uint64_t next_ns;
+  } chif_net_pacer;
+
+  // ====================================================================== //
+  // Functions
+  // ====================================================================== //
+
+  /**
+   * @param pacer
+   * @param rate_bytes_per_s
+   * @param burst_bytes How many bytes may leave back to back after being
+   * idle, at least the largest datagram. A few datagrams keep the number of
+   * waits, and so the timer overhead, down at high rates.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if rate_bytes_per_s or
+   * burst_bytes is 0.
+   */
+  chif_net_result chif_net_pacer_init(chif_net_pacer* pacer,
+                                      uint64_t rate_bytes_per_s,
+                                      uint64_t burst_bytes);
+
+  /**
+   * Give a datagram its departure time, and account for it.
+   *
+   * @param pacer
+   * @param bytes Size of the datagram.
+   * @param now_ns Current time, from chif_net_time_ns, or from
+   * chif_net_txtime_now_ns for the etf qdisc.
+   * @return When to send the datagram, now_ns if it may leave at once.
+   */
+  uint64_t chif_net_pacer_schedule(chif_net_pacer* pacer,
+                                   size_t bytes,
+                                   uint64_t now_ns);
+
+  /**
+   * Wait until the departure time of the datagram, then write it, as
+   * chif_net_writeto. Long waits sleep, and the last
+   * CHIF_NET_PACER_SPIN_NS are spun, so datagrams leave on time.
+   *
+   * @param pacer
+   * @param socket
+   * @param buf
+   * @param bufsize
+   * @param sent_bytes_out May be NULL if you don't want the data.
+   * @param to_address
+   * @return As chif_net_writeto.
+   */
+  chif_net_result chif_net_pacer_writeto(chif_net_pacer* pacer,
+                                         chif_net_socket socket,
+                                         const uint8_t* buf,
+                                         size_t bufsize,
+                                         int* sent_bytes_out,
+                                         const chif_net_address* to_address);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_PACER_H_
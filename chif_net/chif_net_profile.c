@@ -0,0 +1,186 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_profile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// ============================================================ //
+// Profiles
+// ============================================================ //
+
+static const chif_net_profile_setting _chif_net_profile_low_latency[] = {
+  { CHIF_NET_OPTION_TCP_NODELAY, 1 },
+  { CHIF_NET_OPTION_TCP_QUICKACK, 1 },
+  { CHIF_NET_OPTION_TCP_NOTSENT_LOWAT, 16384 },
+  { CHIF_NET_OPTION_KEEPALIVE, 1 },
+  { CHIF_NET_OPTION_TCP_KEEPIDLE, 30 },
+  { CHIF_NET_OPTION_TCP_KEEPINTVL, 5 },
+  { CHIF_NET_OPTION_TCP_KEEPCNT, 3 },
+  { CHIF_NET_OPTION_TCP_USER_TIMEOUT, 45000 },
+};
+
+static const chif_net_profile_setting _chif_net_profile_bulk[] = {
+  { CHIF_NET_OPTION_TCP_NODELAY, 0 },
+  { CHIF_NET_OPTION_KEEPALIVE, 1 },
+  { CHIF_NET_OPTION_TCP_KEEPIDLE, 120 },
+  { CHIF_NET_OPTION_TCP_KEEPINTVL, 30 },
+  { CHIF_NET_OPTION_TCP_KEEPCNT, 4 },
+};
+
+static const chif_net_profile_setting _chif_net_profile_idle[] = {
+  { CHIF_NET_OPTION_SEND_BUFFER, 4096 },
+  { CHIF_NET_OPTION_RECV_BUFFER, 4096 },
+  { CHIF_NET_OPTION_TCP_NOTSENT_LOWAT, 4096 },
+  { CHIF_NET_OPTION_KEEPALIVE, 1 },
+  { CHIF_NET_OPTION_TCP_KEEPIDLE, 300 },
+  { CHIF_NET_OPTION_TCP_KEEPINTVL, 60 },
+  { CHIF_NET_OPTION_TCP_KEEPCNT, 5 },
+};
+
+#define CHIF_NET_PROFILE(name, settings)                                       \
+  {                                                                            \
+    name, settings, sizeof(settings) / sizeof(settings[0])                     \
+  }
+
+const chif_net_profile chif_net_profile_low_latency =
+  CHIF_NET_PROFILE("low_latency", _chif_net_profile_low_latency);
+const chif_net_profile chif_net_profile_bulk =
+  CHIF_NET_PROFILE("bulk", _chif_net_profile_bulk);
+const chif_net_profile chif_net_profile_idle =
+  CHIF_NET_PROFILE("idle", _chif_net_profile_idle);
+
+static const chif_net_profile* const _chif_net_profiles[] = {
+  &chif_net_profile_low_latency,
+  &chif_net_profile_bulk,
+  &chif_net_profile_idle,
+};
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+/**
+ * The kernel may give more buffer than asked for, linux even reports the
+ * double, which is still what was asked for.
+ */
+static chif_net_bool
+_chif_net_profile_granted(const chif_net_option option,
+                          const int requested,
+                          const int effective)
+{
+  switch (option) {
+    case CHIF_NET_OPTION_SEND_BUFFER:
+    case CHIF_NET_OPTION_RECV_BUFFER:
+      return effective >= requested;
+    default:
+      return effective == requested;
+  }
+}
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+const chif_net_profile*
+chif_net_profile_find(const char* name)
+{
+  if (!name) {
+    return NULL;
+  }
+  const size_t count =
+    sizeof(_chif_net_profiles) / sizeof(_chif_net_profiles[0]);
+  for (size_t i = 0; i < count; ++i) {
+    if (strcmp(_chif_net_profiles[i]->name, name) == 0) {
+      return _chif_net_profiles[i];
+    }
+  }
+  return NULL;
+}
+
+chif_net_result
+chif_net_profile_apply(const chif_net_socket socket,
+                       const chif_net_profile* profile,
+                       chif_net_profile_report* reports_out,
+                       size_t* not_granted_count_out)
+{
+  chif_net_result first_failure = CHIF_NET_RESULT_SUCCESS;
+  size_t not_granted_count = 0;
+  for (size_t i = 0; i < profile->setting_count; ++i) {
+    const chif_net_profile_setting* setting = &profile->settings[i];
+    int effective = setting->value;
+    chif_net_result result =
+      chif_net_set_option(socket, setting->option, setting->value);
+    if (!result) {
+      result = chif_net_get_option(socket, setting->option, &effective);
+    }
+    const chif_net_bool granted =
+      !result &&
+      _chif_net_profile_granted(setting->option, setting->value, effective);
+
+    not_granted_count += !granted;
+    if (result && result != CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED &&
+        !first_failure) {
+      first_failure = result;
+    }
+    if (reports_out) {
+      reports_out[i].option = setting->option;
+      reports_out[i].requested = setting->value;
+      reports_out[i].effective = effective;
+      reports_out[i].result = result;
+      reports_out[i].granted = granted;
+    }
+  }
+
+  if (not_granted_count_out) {
+    *not_granted_count_out = not_granted_count;
+  }
+  return first_failure;
+}
+
+chif_net_result
+chif_net_profile_report_to_string(const chif_net_profile_report* report,
+                                  char* str_out,
+                                  const size_t strlen)
+{
+  const char* outcome = report->result
+                          ? chif_net_result_to_string(report->result)
+                          : report->granted ? "granted" : "not granted";
+  const int length = snprintf(str_out,
+                              strlen,
+                              "%s requested %d effective %d %s",
+                              chif_net_option_to_string(report->option),
+                              report->requested,
+                              report->effective,
+                              outcome);
+  if (length < 0 || (size_t)length >= strlen) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
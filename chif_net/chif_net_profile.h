@@ -0,0 +1,164 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHIF_NET_PROFILE_H_
+#define CHIF_NET_PROFILE_H_
+
+/**
+ * Named sets of socket options that belong together, applied in one call.
+ *
+ * A profile is a table of chif_net_option values, so a new profile is only a
+ * new table, and a new option is only a new chif_net_option. After applying
+ * a profile, every option is read back, and the report tells what the kernel
+ * actually granted, as it silently clamps some values to its limits.
+ *
+ * Apply a profile before connect or listen, options such as the buffer sizes
+ * and TCP_NOTSENT_LOWAT are best set before the connection is established,
+ * and sockets returned by accept inherit most of them from the listener.
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+
+#define CHIF_NET_PROFILE_REPORT_STRING_LENGTH 128
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+  typedef struct
+  {
+    chif_net_option option;
+    int value;
+  } chif_net_profile_setting;
+
+  typedef struct
+  {
+    const char* name;
+    const chif_net_profile_setting* settings;
+    size_t setting_count;
+  } chif_net_profile;
+
+  /**
+   * @param option
+   * @param requested The value of the profile.
+   * @param effective The value read back after setting it, or the requested
+   * value if it could not be read.
+   * @param result Result of setting, then reading, the option.
+   * @param granted If the effective value is the requested one. Buffer sizes
+   * count as granted when at least the requested size was given.
+   */
+  typedef struct
+  {
+    chif_net_option option;
+    int requested;
+    int effective;
+    chif_net_result result;
+    chif_net_bool granted;
+  } chif_net_profile_report;
+
+  // ====================================================================== //
+  // Profiles
+  // ====================================================================== //
+
+  /**
+   * Request-response traffic where every message should leave at once:
+   * no Nagle, quick acks, little unsent data queued in the kernel, and dead
+   * peers detected within a minute.
+   */
+  extern const chif_net_profile chif_net_profile_low_latency;
+
+  /**
+   * Large transfers: Nagle on, so segments are full, and buffers left to the
+   * autotuning of the kernel, which setting a buffer size turns off on linux.
+   */
+  extern const chif_net_profile chif_net_profile_bulk;
+
+  /**
+   * Many connections that are idle most of the time: small buffers, so the
+   * idle connections cost little memory, and slow keepalive, to notice dead
+   * peers without waking every connection often.
+   */
+  extern const chif_net_profile chif_net_profile_idle;
+
+  // ====================================================================== //
+  // Functions
+  // ====================================================================== //
+
+  /**
+   * Find one of the profiles above by name, "low_latency", "bulk" or "idle",
+   * to pick the profile from a config file.
+   *
+   * @param name
+   * @return NULL if there is no profile with the name.
+   */
+  const chif_net_profile* chif_net_profile_find(const char* name);
+
+  /**
+   * Apply every setting of the profile. A setting that fails does not stop
+   * the rest from being applied.
+   *
+   * @param socket
+   * @param profile
+   * @param reports_out May be NULL, else profile->setting_count reports, in
+   * the order of the settings.
+   * @param not_granted_count_out May be NULL, else the number of settings
+   * that failed or were not granted.
+   * @return The result of the first setting that failed, or
+   * CHIF_NET_RESULT_SUCCESS. A setting the platform does not have is not a
+   * failure, it is only reported.
+   */
+  chif_net_result chif_net_profile_apply(chif_net_socket socket,
+                                         const chif_net_profile* profile,
+                                         chif_net_profile_report* reports_out,
+                                         size_t* not_granted_count_out);
+
+  /**
+   * Format a report as one line, such as
+   * "SEND_BUFFER requested 4096 effective 8192 granted", or ending with
+   * "not granted" or the failed result, for logging what a profile got.
+   *
+   * @param report
+   * @param str_out
+   * @param strlen At least CHIF_NET_PROFILE_REPORT_STRING_LENGTH.
+   * @return CHIF_NET_RESULT_NOT_ENOUGH_SPACE if strlen is too small.
+   */
+  chif_net_result chif_net_profile_report_to_string(
+    const chif_net_profile_report* report,
+    char* str_out,
+    size_t strlen);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_PROFILE_H_
@@ -0,0 +1,805 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_resolver.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// ============================================================ //
+// Constants
+// ============================================================ //
+
+#define DNS_HEADER_SIZE 12
+#define DNS_TYPE_A 1
+#define DNS_TYPE_SOA 6
+#define DNS_TYPE_AAAA 28
+#define DNS_CLASS_IN 1
+#define DNS_FLAG_QR 0x8000
+#define DNS_FLAG_TC 0x0200
+#define DNS_FLAG_RD 0x0100
+#define DNS_RCODE_MASK 0x000f
+#define DNS_RCODE_NXDOMAIN 3
+
+// Answers without EDNS are at most 512 bytes, leave room for servers that
+// ignore that.
+#define DNS_UDP_BUFFER_SIZE 1232
+
+#define RESOLV_CONF_PATH "/etc/resolv.conf"
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+static uint16_t
+_chif_net_resolver_read_u16(const uint8_t* p)
+{
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t
+_chif_net_resolver_read_u32(const uint8_t* p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void
+_chif_net_resolver_write_u16(uint8_t* p, const uint16_t value)
+{
+  p[0] = (uint8_t)(value >> 8);
+  p[1] = (uint8_t)(value & 0xff);
+}
+
+static int
+_chif_net_resolver_would_block(const chif_net_result result)
+{
+  // EAGAIN is reported as CHIF_NET_RESULT_NO_FREE_PORT on berkley sockets
+  return result == CHIF_NET_RESULT_WOULD_BLOCK ||
+         result == CHIF_NET_RESULT_NO_FREE_PORT ||
+         result == CHIF_NET_RESULT_IN_PROGRESS;
+}
+
+/**
+ * Query ids are the only thing stopping an off-path attacker from spoofing
+ * answers, together with the random source port picked by the OS. This is
+ * not a cryptographic generator, but ids are at least not sequential.
+ */
+static uint16_t
+_chif_net_resolver_next_id(chif_net_resolver* resolver)
+{
+  for (;;) {
+    uint32_t x = resolver->id_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    resolver->id_state = x;
+    const uint16_t id = (uint16_t)(x >> 8);
+
+    int taken = 0;
+    for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+      if (resolver->queries[i].state != CHIF_NET_RESOLVER_QUERY_FREE &&
+          resolver->queries[i].id == id) {
+        taken = 1;
+        break;
+      }
+    }
+    if (!taken) {
+      return id;
+    }
+  }
+}
+
+/**
+ * Write the query, prefixed with its length for TCP.
+ *
+ * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if the name is not a valid
+ * host name.
+ */
+static chif_net_result
+_chif_net_resolver_encode_query(chif_net_resolver_query* query,
+                                const char* name)
+{
+  size_t name_length = strlen(name);
+  if (name_length > 0 && name[name_length - 1] == '.') {
+    --name_length;
+  }
+  if (name_length == 0 || name_length > CHIF_NET_RESOLVER_MAX_NAME_LENGTH) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  uint8_t* p = query->query + 2;
+  _chif_net_resolver_write_u16(p, query->id);
+  _chif_net_resolver_write_u16(p + 2, DNS_FLAG_RD);
+  _chif_net_resolver_write_u16(p + 4, 1);
+  memset(p + 6, 0, 6);
+  p += DNS_HEADER_SIZE;
+
+  size_t label_start = 0;
+  for (size_t i = 0; i <= name_length; ++i) {
+    if (i < name_length && name[i] != '.') {
+      continue;
+    }
+    const size_t label_length = i - label_start;
+    if (label_length == 0 || label_length > 63) {
+      return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+    }
+    *p++ = (uint8_t)label_length;
+    memcpy(p, name + label_start, label_length);
+    p += label_length;
+    label_start = i + 1;
+  }
+  *p++ = 0;
+
+  const uint16_t type =
+    query->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4 ? DNS_TYPE_A
+                                                          : DNS_TYPE_AAAA;
+  _chif_net_resolver_write_u16(p, type);
+  _chif_net_resolver_write_u16(p + 2, DNS_CLASS_IN);
+  p += 4;
+
+  query->query_size = (size_t)(p - query->query);
+  _chif_net_resolver_write_u16(query->query, (uint16_t)(query->query_size - 2));
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+/**
+ * @return Offset after the name, or 0 if the name runs past the message.
+ */
+static size_t
+_chif_net_resolver_skip_name(const uint8_t* msg,
+                             const size_t size,
+                             size_t offset)
+{
+  while (offset < size) {
+    const uint8_t length = msg[offset];
+    if ((length & 0xc0) == 0xc0) {
+      return offset + 2 <= size ? offset + 2 : 0;
+    }
+    if (length > 63) {
+      return 0;
+    }
+    offset += 1 + (size_t)length;
+    if (length == 0) {
+      return offset;
+    }
+  }
+  return 0;
+}
+
+static int
+_chif_net_resolver_equal_nocase(const uint8_t* a,
+                                const uint8_t* b,
+                                const size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t ca = a[i];
+    uint8_t cb = b[i];
+    if (ca >= 'A' && ca <= 'Z') {
+      ca = (uint8_t)(ca - 'A' + 'a');
+    }
+    if (cb >= 'A' && cb <= 'Z') {
+      cb = (uint8_t)(cb - 'A' + 'a');
+    }
+    if (ca != cb) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void
+_chif_net_resolver_set_ttl(uint32_t* ttl_out, int* has_ttl, uint32_t ttl)
+{
+  if (!*has_ttl || ttl < *ttl_out) {
+    *ttl_out = ttl;
+    *has_ttl = 1;
+  }
+}
+
+/**
+ * Parse an answer to the query.
+ *
+ * @param truncated_out Set if the answer did not fit in a datagram.
+ * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if the message is malformed
+ * or does not answer the query, it should then be ignored.
+ */
+static chif_net_result
+_chif_net_resolver_parse(const chif_net_resolver_query* query,
+                         const uint8_t* msg,
+                         const size_t size,
+                         chif_net_address* addresses_out,
+                         size_t* address_count_out,
+                         uint32_t* ttl_out,
+                         int* truncated_out)
+{
+  *address_count_out = 0;
+  *ttl_out = 0;
+  *truncated_out = 0;
+
+  const uint8_t* question = query->query + 2 + DNS_HEADER_SIZE;
+  const size_t question_size = query->query_size - 2 - DNS_HEADER_SIZE;
+  if (size < DNS_HEADER_SIZE + question_size ||
+      _chif_net_resolver_read_u16(msg) != query->id ||
+      _chif_net_resolver_read_u16(msg + 4) != 1 ||
+      !_chif_net_resolver_equal_nocase(
+        msg + DNS_HEADER_SIZE, question, question_size)) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  const uint16_t flags = _chif_net_resolver_read_u16(msg + 2);
+  if (!(flags & DNS_FLAG_QR)) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+  if (flags & DNS_FLAG_TC) {
+    *truncated_out = 1;
+    return CHIF_NET_RESULT_SUCCESS;
+  }
+  const uint16_t rcode = flags & DNS_RCODE_MASK;
+  if (rcode != 0 && rcode != DNS_RCODE_NXDOMAIN) {
+    return CHIF_NET_RESULT_NAME_SERVER_FAIL;
+  }
+
+  const uint16_t type =
+    query->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4 ? DNS_TYPE_A
+                                                          : DNS_TYPE_AAAA;
+  const uint16_t rdata_size = type == DNS_TYPE_A ? 4 : 16;
+  const size_t record_count = (size_t)_chif_net_resolver_read_u16(msg + 6) +
+                              _chif_net_resolver_read_u16(msg + 8);
+  const size_t answer_count = _chif_net_resolver_read_u16(msg + 6);
+
+  int has_ttl = 0;
+  int has_negative_ttl = 0;
+  uint32_t negative_ttl = 0;
+  size_t offset = DNS_HEADER_SIZE + question_size;
+  for (size_t i = 0; i < record_count; ++i) {
+    offset = _chif_net_resolver_skip_name(msg, size, offset);
+    if (offset == 0 || offset + 10 > size) {
+      return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+    }
+    const uint8_t* record = msg + offset;
+    const uint16_t record_type = _chif_net_resolver_read_u16(record);
+    const uint16_t record_class = _chif_net_resolver_read_u16(record + 2);
+    uint32_t ttl = _chif_net_resolver_read_u32(record + 4);
+    const uint16_t size_of_rdata = _chif_net_resolver_read_u16(record + 8);
+    offset += 10;
+    if (offset + size_of_rdata > size) {
+      return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+    }
+    const uint8_t* rdata = msg + offset;
+    offset += size_of_rdata;
+
+    if (record_class != DNS_CLASS_IN) {
+      continue;
+    }
+
+    if (i < answer_count) {
+      // CNAME records on the way to the address also limit the ttl
+      _chif_net_resolver_set_ttl(ttl_out, &has_ttl, ttl);
+      if (record_type != type || size_of_rdata != rdata_size ||
+          *address_count_out == CHIF_NET_RESOLVER_MAX_ADDRESSES) {
+        continue;
+      }
+
+      chif_net_address* address = &addresses_out[*address_count_out];
+      memset(address, 0, sizeof(chif_net_address));
+      if (type == DNS_TYPE_A) {
+        chif_net_ipv4_address* ipv4 = (chif_net_ipv4_address*)address;
+        ipv4->address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+        _chif_net_resolver_write_u16((uint8_t*)&ipv4->port, query->port);
+        memcpy(&ipv4->address, rdata, 4);
+      } else {
+        chif_net_ipv6_address* ipv6 = (chif_net_ipv6_address*)address;
+        ipv6->address_family = CHIF_NET_ADDRESS_FAMILY_IPV6;
+        _chif_net_resolver_write_u16((uint8_t*)&ipv6->port, query->port);
+        memcpy(ipv6->address, rdata, 16);
+      }
+      ++*address_count_out;
+    } else if (record_type == DNS_TYPE_SOA && size_of_rdata >= 20) {
+      // RFC 2308, a missing name is cached for the smaller of the SOA ttl
+      // and the SOA minimum field
+      const uint32_t minimum =
+        _chif_net_resolver_read_u32(rdata + size_of_rdata - 4);
+      if (minimum < ttl) {
+        ttl = minimum;
+      }
+      _chif_net_resolver_set_ttl(&negative_ttl, &has_negative_ttl, ttl);
+    }
+  }
+
+  if (rcode == DNS_RCODE_NXDOMAIN || *address_count_out == 0) {
+    *address_count_out = 0;
+    *ttl_out = negative_ttl;
+    return CHIF_NET_RESLUT_NO_NAME;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static void
+_chif_net_resolver_complete(chif_net_resolver* resolver,
+                            chif_net_resolver_query* query,
+                            const chif_net_result result,
+                            const chif_net_address* addresses,
+                            const size_t address_count,
+                            const uint32_t ttl)
+{
+  const chif_net_resolver_callback callback = query->callback;
+  void* user_data = query->user_data;
+  if (query->tcp_socket != CHIF_NET_INVALID_SOCKET) {
+    chif_net_close_socket(&query->tcp_socket);
+  }
+  query->state = CHIF_NET_RESOLVER_QUERY_FREE;
+  --resolver->active_count;
+
+  // the slot is free, the callback may start a new query
+  callback(user_data, result, addresses, address_count, ttl);
+}
+
+static void
+_chif_net_resolver_fail(chif_net_resolver* resolver,
+                        chif_net_resolver_query* query,
+                        const chif_net_result result)
+{
+  _chif_net_resolver_complete(resolver, query, result, NULL, 0, 0);
+}
+
+/**
+ * Complete the query with the answer, or switch to TCP if it was truncated.
+ *
+ * @return If the answer was used.
+ */
+static int
+_chif_net_resolver_handle_answer(chif_net_resolver* resolver,
+                                 chif_net_resolver_query* query,
+                                 const uint8_t* msg,
+                                 const size_t size)
+{
+  chif_net_address addresses[CHIF_NET_RESOLVER_MAX_ADDRESSES];
+  size_t address_count;
+  uint32_t ttl;
+  int truncated;
+  const chif_net_result result = _chif_net_resolver_parse(
+    query, msg, size, addresses, &address_count, &ttl, &truncated);
+  if (result == CHIF_NET_RESULT_INVALID_INPUT_PARAM) {
+    return 0;
+  }
+
+  if (truncated) {
+    if (query->state != CHIF_NET_RESOLVER_QUERY_UDP) {
+      _chif_net_resolver_fail(
+        resolver, query, CHIF_NET_RESULT_NAME_SERVER_FAIL);
+      return 1;
+    }
+
+    chif_net_result res = chif_net_open_socket(
+      &query->tcp_socket,
+      CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+      (chif_net_address_family)resolver->server.address_family);
+    if (!res) {
+      res = chif_net_set_blocking(query->tcp_socket, CHIF_NET_FALSE);
+    }
+    if (!res) {
+      res = chif_net_connect(query->tcp_socket, &resolver->server);
+    }
+    if (res && !_chif_net_resolver_would_block(res)) {
+      _chif_net_resolver_fail(resolver, query, res);
+      return 1;
+    }
+    query->state = CHIF_NET_RESOLVER_QUERY_TCP_WRITE;
+    query->tcp_size = 0;
+    query->deadline_ms = chif_net_time_ms() + (uint64_t)resolver->timeout_ms;
+    return 1;
+  }
+
+  _chif_net_resolver_complete(
+    resolver, query, result, addresses, address_count, ttl);
+  return 1;
+}
+
+static chif_net_resolver_query*
+_chif_net_resolver_find_udp(chif_net_resolver* resolver, const uint16_t id)
+{
+  for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+    chif_net_resolver_query* query = &resolver->queries[i];
+    if (query->state == CHIF_NET_RESOLVER_QUERY_UDP && query->id == id) {
+      return query;
+    }
+  }
+  return NULL;
+}
+
+static void
+_chif_net_resolver_process_udp(chif_net_resolver* resolver)
+{
+  uint8_t buf[DNS_UDP_BUFFER_SIZE];
+  for (;;) {
+    int read_bytes = 0;
+    const chif_net_result res =
+      chif_net_read(resolver->udp_socket, buf, sizeof(buf), &read_bytes);
+    if (res == CHIF_NET_RESULT_CONNECTION_REFUSED ||
+        res == CHIF_NET_RESULT_TCP_CONNECTION_CLOSED) {
+      // port unreachable from a previous send, or an empty datagram
+      continue;
+    }
+    if (res) {
+      return;
+    }
+    if (read_bytes < DNS_HEADER_SIZE) {
+      continue;
+    }
+
+    chif_net_resolver_query* query =
+      _chif_net_resolver_find_udp(resolver, _chif_net_resolver_read_u16(buf));
+    if (query) {
+      _chif_net_resolver_handle_answer(
+        resolver, query, buf, (size_t)read_bytes);
+    }
+  }
+}
+
+static void
+_chif_net_resolver_process_tcp(chif_net_resolver* resolver,
+                               chif_net_resolver_query* query)
+{
+  if (query->state == CHIF_NET_RESOLVER_QUERY_TCP_WRITE) {
+    int can_write = 0;
+    chif_net_result res = chif_net_can_write(query->tcp_socket, &can_write, 0);
+    if (res) {
+      _chif_net_resolver_fail(resolver, query, res);
+      return;
+    }
+    if (!can_write) {
+      return;
+    }
+
+    int sent_bytes = 0;
+    res = chif_net_write(query->tcp_socket,
+                         query->query + query->tcp_size,
+                         query->query_size - query->tcp_size,
+                         &sent_bytes);
+    if (_chif_net_resolver_would_block(res)) {
+      return;
+    }
+    if (res) {
+      _chif_net_resolver_fail(resolver, query, res);
+      return;
+    }
+    query->tcp_size += (size_t)sent_bytes;
+    if (query->tcp_size < query->query_size) {
+      return;
+    }
+    query->state = CHIF_NET_RESOLVER_QUERY_TCP_READ;
+    query->tcp_size = 0;
+  }
+
+  for (;;) {
+    size_t want = 2;
+    if (query->tcp_size >= 2) {
+      want += _chif_net_resolver_read_u16(query->tcp_buf);
+      if (want > CHIF_NET_RESOLVER_TCP_BUFFER_SIZE) {
+        _chif_net_resolver_fail(
+          resolver, query, CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+        return;
+      }
+      if (query->tcp_size == want) {
+        if (!_chif_net_resolver_handle_answer(
+              resolver, query, query->tcp_buf + 2, want - 2)) {
+          _chif_net_resolver_fail(
+            resolver, query, CHIF_NET_RESULT_NAME_SERVER_FAIL);
+        }
+        return;
+      }
+    }
+
+    int read_bytes = 0;
+    const chif_net_result res = chif_net_read(query->tcp_socket,
+                                              query->tcp_buf + query->tcp_size,
+                                              want - query->tcp_size,
+                                              &read_bytes);
+    if (_chif_net_resolver_would_block(res)) {
+      return;
+    }
+    if (res) {
+      _chif_net_resolver_fail(resolver, query, res);
+      return;
+    }
+    query->tcp_size += (size_t)read_bytes;
+  }
+}
+
+static chif_net_result
+_chif_net_resolver_send_udp(chif_net_resolver* resolver,
+                            chif_net_resolver_query* query)
+{
+  const chif_net_result res = chif_net_write(
+    resolver->udp_socket, query->query + 2, query->query_size - 2, NULL);
+  // a full send buffer is handled like a lost datagram
+  if (res && !_chif_net_resolver_would_block(res)) {
+    return res;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static void
+_chif_net_resolver_process_timeouts(chif_net_resolver* resolver)
+{
+  const uint64_t now = chif_net_time_ms();
+  for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+    chif_net_resolver_query* query = &resolver->queries[i];
+    if (query->state == CHIF_NET_RESOLVER_QUERY_FREE ||
+        query->deadline_ms > now) {
+      continue;
+    }
+
+    if (query->state != CHIF_NET_RESOLVER_QUERY_UDP ||
+        query->attempts_left == 0) {
+      _chif_net_resolver_fail(resolver, query, CHIF_NET_RESULT_TIMEDOUT);
+      continue;
+    }
+
+    const chif_net_result res = _chif_net_resolver_send_udp(resolver, query);
+    if (res) {
+      _chif_net_resolver_fail(resolver, query, res);
+      continue;
+    }
+    const int attempt = resolver->attempts - query->attempts_left;
+    --query->attempts_left;
+    query->deadline_ms = now + ((uint64_t)resolver->timeout_ms << attempt);
+  }
+}
+
+/**
+ * Use the first nameserver line in resolv.conf.
+ */
+static chif_net_result
+_chif_net_resolver_server_from_resolv_conf(chif_net_address* server_out)
+{
+#if defined(CHIF_NET_WINSOCK2)
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(server_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#else
+  FILE* file = fopen(RESOLV_CONF_PATH, "r");
+  if (!file) {
+    return CHIF_NET_RESULT_NAME_SERVER_FAIL;
+  }
+
+  chif_net_result result = CHIF_NET_RESULT_NAME_SERVER_FAIL;
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    char ip[CHIF_NET_IPVX_STRING_LENGTH];
+    if (sscanf(line, " nameserver %45s", ip) != 1) {
+      continue;
+    }
+    const chif_net_address_family address_family =
+      strchr(ip, ':') ? CHIF_NET_ADDRESS_FAMILY_IPV6
+                      : CHIF_NET_ADDRESS_FAMILY_IPV4;
+    if (chif_net_create_address_i(server_out,
+                                  ip,
+                                  53,
+                                  CHIF_NET_TRANSPORT_PROTOCOL_UDP,
+                                  address_family) == CHIF_NET_RESULT_SUCCESS) {
+      result = CHIF_NET_RESULT_SUCCESS;
+      break;
+    }
+  }
+
+  fclose(file);
+  return result;
+#endif
+}
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+chif_net_result
+chif_net_resolver_init(chif_net_resolver* resolver,
+                       const chif_net_address* server)
+{
+  memset(resolver, 0, sizeof(chif_net_resolver));
+  resolver->udp_socket = CHIF_NET_INVALID_SOCKET;
+  resolver->timeout_ms = CHIF_NET_RESOLVER_DEFAULT_TIMEOUT_MS;
+  resolver->attempts = CHIF_NET_RESOLVER_DEFAULT_ATTEMPTS;
+  for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+    resolver->queries[i].tcp_socket = CHIF_NET_INVALID_SOCKET;
+  }
+
+  if (server) {
+    memcpy(&resolver->server, server, sizeof(chif_net_address));
+  } else {
+    const chif_net_result res =
+      _chif_net_resolver_server_from_resolv_conf(&resolver->server);
+    if (res) {
+      return res;
+    }
+  }
+
+  resolver->id_state = (uint32_t)chif_net_time_ms() ^
+                       (uint32_t)(uintptr_t)resolver ^ 0x9e3779b9u;
+  if (resolver->id_state == 0) {
+    resolver->id_state = 1;
+  }
+
+  chif_net_result res = chif_net_open_socket(
+    &resolver->udp_socket,
+    CHIF_NET_TRANSPORT_PROTOCOL_UDP,
+    (chif_net_address_family)resolver->server.address_family);
+  if (res) {
+    return res;
+  }
+  res = chif_net_set_blocking(resolver->udp_socket, CHIF_NET_FALSE);
+  if (!res) {
+    // only accept datagrams from the server
+    res = chif_net_connect(resolver->udp_socket, &resolver->server);
+  }
+  if (res) {
+    chif_net_close_socket(&resolver->udp_socket);
+  }
+  return res;
+}
+
+chif_net_result
+chif_net_resolver_destroy(chif_net_resolver* resolver)
+{
+  for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+    chif_net_resolver_query* query = &resolver->queries[i];
+    if (query->state != CHIF_NET_RESOLVER_QUERY_FREE) {
+      _chif_net_resolver_fail(
+        resolver, query, CHIF_NET_RESULT_BLOCKING_CANCELED);
+    }
+  }
+  return chif_net_close_socket(&resolver->udp_socket);
+}
+
+chif_net_result
+chif_net_resolver_resolve(chif_net_resolver* resolver,
+                          const char* name,
+                          const chif_net_port port,
+                          const chif_net_address_family address_family,
+                          const chif_net_resolver_callback callback,
+                          void* user_data)
+{
+  if (address_family != CHIF_NET_ADDRESS_FAMILY_IPV4 &&
+      address_family != CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+  if (!name || !callback) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  chif_net_resolver_query* query = NULL;
+  for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+    if (resolver->queries[i].state == CHIF_NET_RESOLVER_QUERY_FREE) {
+      query = &resolver->queries[i];
+      break;
+    }
+  }
+  if (!query) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
+
+  query->id = _chif_net_resolver_next_id(resolver);
+  query->address_family = address_family;
+  query->port = port;
+  chif_net_result res = _chif_net_resolver_encode_query(query, name);
+  if (res) {
+    return res;
+  }
+  res = _chif_net_resolver_send_udp(resolver, query);
+  if (res) {
+    return res;
+  }
+
+  query->state = CHIF_NET_RESOLVER_QUERY_UDP;
+  query->attempts_left = resolver->attempts - 1;
+  query->deadline_ms = chif_net_time_ms() + (uint64_t)resolver->timeout_ms;
+  query->callback = callback;
+  query->user_data = user_data;
+  query->tcp_socket = CHIF_NET_INVALID_SOCKET;
+  query->tcp_size = 0;
+  ++resolver->active_count;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_resolver_fill_checks(const chif_net_resolver* resolver,
+                              chif_net_check* checks,
+                              const size_t check_capacity,
+                              size_t* check_count_out)
+{
+  size_t count = 0;
+  if (count == check_capacity) {
+    return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+  }
+  checks[count].socket = resolver->udp_socket;
+  checks[count].request_events = CHIF_NET_CHECK_EVENT_READ;
+  checks[count].return_events = 0;
+  ++count;
+
+  for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+    const chif_net_resolver_query* query = &resolver->queries[i];
+    if (query->state != CHIF_NET_RESOLVER_QUERY_TCP_WRITE &&
+        query->state != CHIF_NET_RESOLVER_QUERY_TCP_READ) {
+      continue;
+    }
+    if (count == check_capacity) {
+      return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+    }
+    checks[count].socket = query->tcp_socket;
+    checks[count].request_events =
+      query->state == CHIF_NET_RESOLVER_QUERY_TCP_WRITE
+        ? CHIF_NET_CHECK_EVENT_WRITE
+        : CHIF_NET_CHECK_EVENT_READ;
+    checks[count].return_events = 0;
+    ++count;
+  }
+
+  *check_count_out = count;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_resolver_process(chif_net_resolver* resolver)
+{
+  _chif_net_resolver_process_udp(resolver);
+
+  for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+    chif_net_resolver_query* query = &resolver->queries[i];
+    if (query->state == CHIF_NET_RESOLVER_QUERY_TCP_WRITE ||
+        query->state == CHIF_NET_RESOLVER_QUERY_TCP_READ) {
+      _chif_net_resolver_process_tcp(resolver, query);
+    }
+  }
+
+  _chif_net_resolver_process_timeouts(resolver);
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+int
+chif_net_resolver_next_timeout_ms(const chif_net_resolver* resolver)
+{
+  if (resolver->active_count == 0) {
+    return -1;
+  }
+
+  uint64_t deadline = UINT64_MAX;
+  for (size_t i = 0; i < CHIF_NET_RESOLVER_MAX_QUERIES; ++i) {
+    const chif_net_resolver_query* query = &resolver->queries[i];
+    if (query->state != CHIF_NET_RESOLVER_QUERY_FREE &&
+        query->deadline_ms < deadline) {
+      deadline = query->deadline_ms;
+    }
+  }
+
+  const uint64_t now = chif_net_time_ms();
+  if (deadline <= now) {
+    return 0;
+  }
+  const uint64_t remaining = deadline - now;
+  return remaining > INT32_MAX ? INT32_MAX : (int)remaining;
+}
@@ -0,0 +1,229 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CHIF_NET_RESOLVER_H_
+#define CHIF_NET_RESOLVER_H_
+
+/**
+ * Non-blocking DNS stub resolver, built on the chif_net sockets.
+ *
+ * Queries are sent over UDP to a single name server, pipelined up to
+ * CHIF_NET_RESOLVER_MAX_QUERIES at a time, and retried over TCP when the
+ * answer is truncated. Nothing blocks and nothing is allocated, the resolver
+ * is driven from the caller's event loop:
+ *
+ *   chif_net_resolver_fill_checks -> add the checks to chif_net_poll
+ *   chif_net_resolver_next_timeout_ms -> cap the poll timeout
+ *   chif_net_resolver_process -> after the poll, fires the callbacks
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+
+// How many queries can be in flight at the same time.
+#define CHIF_NET_RESOLVER_MAX_QUERIES 32
+
+// Most addresses delivered to a callback, extra records are ignored.
+#define CHIF_NET_RESOLVER_MAX_ADDRESSES 16
+
+// Longest name that can be resolved, not counting a trailing dot.
+#define CHIF_NET_RESOLVER_MAX_NAME_LENGTH 253
+
+// Size of a query on the wire, with the TCP length prefix.
+#define CHIF_NET_RESOLVER_MAX_QUERY_SIZE                                       \
+  (2 + 12 + CHIF_NET_RESOLVER_MAX_NAME_LENGTH + 2 + 4)
+
+// Largest answer that can be read over TCP, with the TCP length prefix.
+#define CHIF_NET_RESOLVER_TCP_BUFFER_SIZE 4096
+
+// Enough checks for the UDP socket and every TCP fallback.
+#define CHIF_NET_RESOLVER_MAX_CHECKS (1 + CHIF_NET_RESOLVER_MAX_QUERIES)
+
+#define CHIF_NET_RESOLVER_DEFAULT_TIMEOUT_MS 1000
+#define CHIF_NET_RESOLVER_DEFAULT_ATTEMPTS 3
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+  /**
+   * Called when a query has completed.
+   *
+   * @param user_data As given to chif_net_resolver_resolve.
+   * @param result CHIF_NET_RESULT_SUCCESS if any address was found,
+   * CHIF_NET_RESLUT_NO_NAME if the name does not exist or has no address of
+   * the requested family, CHIF_NET_RESULT_TIMEDOUT if the name server did not
+   * answer in time. CHIF_NET_RESULT_BLOCKING_CANCELED when the resolver is
+   * destroyed with the query in flight.
+   * @param addresses The addresses, with the port set. Only valid during the
+   * call.
+   * @param address_count
+   * @param ttl_s How many seconds the answer may be cached. For a missing
+   * name, how long that may be cached, or 0 if the server did not say.
+   */
+  typedef void (*chif_net_resolver_callback)(void* user_data,
+                                             chif_net_result result,
+                                             const chif_net_address* addresses,
+                                             size_t address_count,
+                                             uint32_t ttl_s);
+
+  typedef enum
+  {
+    CHIF_NET_RESOLVER_QUERY_FREE = 0,
+    CHIF_NET_RESOLVER_QUERY_UDP,
+    CHIF_NET_RESOLVER_QUERY_TCP_WRITE,
+    CHIF_NET_RESOLVER_QUERY_TCP_READ
+  } chif_net_resolver_query_state;
+
+  /**
+   * Internal state of an in-flight query.
+   */
+  typedef struct
+  {
+    chif_net_resolver_query_state state;
+    uint16_t id;
+    chif_net_address_family address_family;
+    chif_net_port port;
+    int attempts_left;
+    uint64_t deadline_ms;
+    chif_net_resolver_callback callback;
+    void* user_data;
+    chif_net_socket tcp_socket;
+    size_t tcp_size;
+    size_t query_size;
+    uint8_t query[CHIF_NET_RESOLVER_MAX_QUERY_SIZE];
+    uint8_t tcp_buf[CHIF_NET_RESOLVER_TCP_BUFFER_SIZE];
+  } chif_net_resolver_query;
+
+  /**
+   * Allocate it wherever you like, then call chif_net_resolver_init. It is
+   * large, prefer the heap over the stack.
+   *
+   * @param timeout_ms How long to wait for an answer before retrying. Every
+   * retry waits twice as long as the previous one.
+   * @param attempts How many times a query is sent over UDP before giving up.
+   */
+  typedef struct
+  {
+    chif_net_address server;
+    chif_net_socket udp_socket;
+    int timeout_ms;
+    int attempts;
+    uint32_t id_state;
+    size_t active_count;
+    chif_net_resolver_query queries[CHIF_NET_RESOLVER_MAX_QUERIES];
+  } chif_net_resolver;
+
+  // ====================================================================== //
+  // Definition
+  // ====================================================================== //
+
+  /**
+   * Open the resolver's UDP socket, timeout_ms and attempts are set to their
+   * defaults.
+   *
+   * @param resolver
+   * @param server Address and port of the name server. If NULL, the first
+   * nameserver in /etc/resolv.conf is used, on port 53.
+   * @return CHIF_NET_RESULT_NAME_SERVER_FAIL if no name server could be found.
+   */
+  chif_net_result chif_net_resolver_init(chif_net_resolver* resolver,
+                                         const chif_net_address* server);
+
+  /**
+   * Close all sockets. Queries still in flight are completed with
+   * CHIF_NET_RESULT_BLOCKING_CANCELED.
+   *
+   * @param resolver
+   * @return
+   */
+  chif_net_result chif_net_resolver_destroy(chif_net_resolver* resolver);
+
+  /**
+   * Start resolving a name. The query is sent right away, the callback is
+   * called from a later chif_net_resolver_process, never from within this
+   * function.
+   *
+   * @param resolver
+   * @param name Host name, such as "example.com".
+   * @param port Set on the resolved addresses.
+   * @param address_family IPv4 asks for A records, IPv6 for AAAA records.
+   * @param callback
+   * @param user_data Passed to the callback.
+   * @return CHIF_NET_RESULT_NOT_ENOUGH_SPACE if
+   * CHIF_NET_RESOLVER_MAX_QUERIES are already in flight.
+   */
+  chif_net_result chif_net_resolver_resolve(
+    chif_net_resolver* resolver,
+    const char* name,
+    chif_net_port port,
+    chif_net_address_family address_family,
+    chif_net_resolver_callback callback,
+    void* user_data);
+
+  /**
+   * Fill out the checks the resolver needs, for you to pass to chif_net_poll
+   * together with your own.
+   *
+   * @param resolver
+   * @param checks
+   * @param check_capacity Use CHIF_NET_RESOLVER_MAX_CHECKS to always fit.
+   * @param check_count_out How many checks were filled out.
+   * @return CHIF_NET_RESULT_NOT_ENOUGH_SPACE if check_capacity is too small.
+   */
+  chif_net_result chif_net_resolver_fill_checks(
+    const chif_net_resolver* resolver,
+    chif_net_check* checks,
+    size_t check_capacity,
+    size_t* check_count_out);
+
+  /**
+   * Read answers, make progress on TCP fallbacks and retry or fail queries
+   * that have timed out. Completed queries have their callback called.
+   * Never blocks, call it after every poll.
+   *
+   * @param resolver
+   * @return
+   */
+  chif_net_result chif_net_resolver_process(chif_net_resolver* resolver);
+
+  /**
+   * @param resolver
+   * @return Milliseconds until the next query times out, or -1 if no query is
+   * in flight. Fits the timeout_ms of chif_net_poll.
+   */
+  int chif_net_resolver_next_timeout_ms(const chif_net_resolver* resolver);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_RESOLVER_H_
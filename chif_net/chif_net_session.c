@@ -0,0 +1,285 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_session.h"
+
+#include <string.h>
+
+// ============================================================ //
+// Static Asserts
+// ============================================================ //
+
+CHIF_NET_STATIC_ASSERT(sizeof(chif_net_address_key) == 20,
+                       address_key_correct_size);
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+// ::ffff:0:0/96, in network byte order
+static const uint8_t _chif_net_ipv4_mapped_prefix[12] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff
+};
+
+static size_t
+_chif_net_session_slot(const chif_net_session_table* table,
+                       const uint32_t hash)
+{
+  return (size_t)hash & table->mask;
+}
+
+/**
+ * @return Slot of the key, or of the empty slot that ends its probe sequence.
+ */
+static size_t
+_chif_net_session_probe(const chif_net_session_table* table,
+                        const chif_net_address_key* key,
+                        const uint32_t hash)
+{
+  size_t slot = _chif_net_session_slot(table, hash);
+  for (;;) {
+    const chif_net_session* session = &table->sessions[slot];
+    if (session->hash == 0 ||
+        (session->hash == hash &&
+         chif_net_address_key_equal(&session->key, key))) {
+      return slot;
+    }
+    slot = (slot + 1) & table->mask;
+  }
+}
+
+/**
+ * Backward shift deletion. The sessions after the removed one are moved back
+ * to fill the hole, as long as that does not move them in front of their home
+ * slot, so no probe sequence is broken.
+ */
+static void
+_chif_net_session_remove_slot(chif_net_session_table* table, size_t slot)
+{
+  size_t next = slot;
+  for (;;) {
+    next = (next + 1) & table->mask;
+    chif_net_session* session = &table->sessions[next];
+    if (session->hash == 0) {
+      break;
+    }
+
+    const size_t home = _chif_net_session_slot(table, session->hash);
+    const size_t home_distance = (next - home) & table->mask;
+    const size_t hole_distance = (next - slot) & table->mask;
+    if (home_distance >= hole_distance) {
+      table->sessions[slot] = *session;
+      slot = next;
+    }
+  }
+
+  table->sessions[slot].hash = 0;
+  table->sessions[slot].user_data = NULL;
+  --table->count;
+}
+
+static uint32_t
+_chif_net_session_hash(const chif_net_address_key* key)
+{
+  // zero marks an empty slot
+  const uint32_t hash = chif_net_address_key_hash(key);
+  return hash != 0 ? hash : 1;
+}
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+chif_net_result
+chif_net_address_key_from_address(const chif_net_address* address,
+                                  chif_net_address_key* key_out)
+{
+  if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV4) {
+    const chif_net_ipv4_address* ipv4 = (const chif_net_ipv4_address*)address;
+    memcpy(key_out->address,
+           _chif_net_ipv4_mapped_prefix,
+           sizeof(_chif_net_ipv4_mapped_prefix));
+    key_out->address[3] = ipv4->address;
+    key_out->port = ipv4->port;
+  } else if (address->address_family == CHIF_NET_ADDRESS_FAMILY_IPV6) {
+    const chif_net_ipv6_address* ipv6 = (const chif_net_ipv6_address*)address;
+    memcpy(key_out->address, ipv6->address, sizeof(key_out->address));
+    key_out->port = ipv6->port;
+  } else {
+    return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY;
+  }
+  key_out->reserved = 0;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_address_from_key(const chif_net_address_key* key,
+                          chif_net_address* address_out)
+{
+  memset(address_out, 0, sizeof(chif_net_address));
+  if (memcmp(key->address,
+             _chif_net_ipv4_mapped_prefix,
+             sizeof(_chif_net_ipv4_mapped_prefix)) == 0) {
+    chif_net_ipv4_address* ipv4 = (chif_net_ipv4_address*)address_out;
+    ipv4->address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    ipv4->port = key->port;
+    ipv4->address = key->address[3];
+  } else {
+    chif_net_ipv6_address* ipv6 = (chif_net_ipv6_address*)address_out;
+    ipv6->address_family = CHIF_NET_ADDRESS_FAMILY_IPV6;
+    ipv6->port = key->port;
+    memcpy(ipv6->address, key->address, sizeof(ipv6->address));
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+uint32_t
+chif_net_address_key_hash(const chif_net_address_key* key)
+{
+  // fold the key into 64 bits, then finish with xorshift-multiply rounds so
+  // every input bit reaches the low bits, IPv4 keys only differ in high
+  uint64_t low;
+  uint64_t high;
+  memcpy(&low, &key->address[0], sizeof(low));
+  memcpy(&high, &key->address[2], sizeof(high));
+  uint64_t hash = ((low ^ key->port) * 0x9e3779b97f4a7c15ull) ^ high;
+  hash = (hash ^ (hash >> 32)) * 0xd6e8feb86659fd93ull;
+  hash = (hash ^ (hash >> 32)) * 0xd6e8feb86659fd93ull;
+  hash ^= hash >> 32;
+  return (uint32_t)hash;
+}
+
+chif_net_bool
+chif_net_address_key_equal(const chif_net_address_key* a,
+                           const chif_net_address_key* b)
+{
+  return a->address[3] == b->address[3] && a->port == b->port &&
+         a->address[2] == b->address[2] && a->address[1] == b->address[1] &&
+         a->address[0] == b->address[0];
+}
+
+chif_net_result
+chif_net_session_table_init(chif_net_session_table* table,
+                            chif_net_session* sessions,
+                            const size_t capacity,
+                            const uint32_t idle_timeout_ms)
+{
+  if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  memset(sessions, 0, capacity * sizeof(chif_net_session));
+  table->sessions = sessions;
+  table->mask = capacity - 1;
+  table->count = 0;
+  table->max_count = capacity - capacity / 8;
+  table->idle_timeout_ms = idle_timeout_ms;
+  table->expire_cursor = 0;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_session*
+chif_net_session_table_find(chif_net_session_table* table,
+                            const chif_net_address_key* key,
+                            const uint64_t now_ms)
+{
+  const size_t slot =
+    _chif_net_session_probe(table, key, _chif_net_session_hash(key));
+  chif_net_session* session = &table->sessions[slot];
+  if (session->hash == 0 || session->expires_ms <= now_ms) {
+    return NULL;
+  }
+
+  session->expires_ms = now_ms + table->idle_timeout_ms;
+  return session;
+}
+
+chif_net_result
+chif_net_session_table_insert(chif_net_session_table* table,
+                              const chif_net_address_key* key,
+                              const uint64_t now_ms,
+                              chif_net_session** session_out)
+{
+  const uint32_t hash = _chif_net_session_hash(key);
+  const size_t slot = _chif_net_session_probe(table, key, hash);
+  chif_net_session* session = &table->sessions[slot];
+  if (session->hash == 0) {
+    if (table->count == table->max_count) {
+      return CHIF_NET_RESULT_NOT_ENOUGH_SPACE;
+    }
+    session->key = *key;
+    session->hash = hash;
+    session->user_data = NULL;
+    ++table->count;
+  }
+
+  session->expires_ms = now_ms + table->idle_timeout_ms;
+  *session_out = session;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+chif_net_result
+chif_net_session_table_remove(chif_net_session_table* table,
+                              chif_net_session* session)
+{
+  if (session < table->sessions || session > &table->sessions[table->mask] ||
+      session->hash == 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  _chif_net_session_remove_slot(table, (size_t)(session - table->sessions));
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+size_t
+chif_net_session_table_expire(chif_net_session_table* table,
+                              const uint64_t now_ms,
+                              const size_t slot_budget,
+                              chif_net_session_expire_fn on_expire,
+                              void* user_data)
+{
+  size_t expired = 0;
+  size_t visited = 0;
+  while (visited < slot_budget && table->count > 0) {
+    const size_t slot = table->expire_cursor;
+    chif_net_session* session = &table->sessions[slot];
+    if (session->hash != 0 && session->expires_ms <= now_ms) {
+      if (on_expire) {
+        on_expire(user_data, session);
+      }
+      // a later session may have shifted into this slot, look again
+      _chif_net_session_remove_slot(table, slot);
+      ++expired;
+      continue;
+    }
+
+    table->expire_cursor = (slot + 1) & table->mask;
+    ++visited;
+  }
+  return expired;
+}
@@ -0,0 +1,215 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHIF_NET_SESSION_H_
+#define CHIF_NET_SESSION_H_
+
+/**
+ * Session tracking for servers that talk to many peers over one socket, such
+ * as a UDP server mapping the address from every chif_net_readfrom to the
+ * state of that peer.
+ *
+ * chif_net_address_key is a compact, canonical form of an address. IPv4
+ * addresses are stored as IPv4-mapped IPv6 addresses (::ffff:a.b.c.d), so a
+ * peer seen on a dual-stack socket and on an IPv4 socket gets the same key.
+ * The IPv6 flow info and scope id are not part of the key.
+ *
+ * chif_net_session_table is an open-addressing hash table with linear
+ * probing over storage owned by the caller. Lookups touch one or two cache
+ * lines, removals shift the following entries back instead of leaving
+ * tombstones, and sessions expire after being idle for a set time.
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+  /**
+   * Compare with chif_net_address_key_equal, or memcmp, as the reserved field
+   * is always zero.
+   *
+   * @param address IPv6 address in network byte order.
+   * @param port In network byte order.
+   */
+  typedef struct
+  {
+    uint32_t address[4];
+    uint16_t port;
+    uint16_t reserved;
+  } chif_net_address_key;
+
+  /**
+   * @param key
+   * @param hash Zero for an empty slot.
+   * @param expires_ms In chif_net_time_ms time.
+   * @param user_data Owned by the caller, NULL for a new session.
+   */
+  typedef struct
+  {
+    chif_net_address_key key;
+    uint32_t hash;
+    uint64_t expires_ms;
+    void* user_data;
+  } chif_net_session;
+
+  /**
+   * Called for every session removed by chif_net_session_table_expire, so the
+   * user data can be released.
+   */
+  typedef void (*chif_net_session_expire_fn)(void* user_data,
+                                             chif_net_session* session);
+
+  /**
+   * Allocate it wherever you like, then call chif_net_session_table_init.
+   */
+  typedef struct
+  {
+    chif_net_session* sessions;
+    size_t mask;
+    size_t count;
+    size_t max_count;
+    uint32_t idle_timeout_ms;
+    size_t expire_cursor;
+  } chif_net_session_table;
+
+  // ====================================================================== //
+  // Definition
+  // ====================================================================== //
+
+  /**
+   * @param address IPv4 or IPv6 address.
+   * @param key_out
+   * @return CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY for other addresses.
+   */
+  chif_net_result chif_net_address_key_from_address(
+    const chif_net_address* address,
+    chif_net_address_key* key_out);
+
+  /**
+   * The inverse of chif_net_address_key_from_address. IPv4-mapped keys give
+   * an IPv4 address.
+   *
+   * @param key
+   * @param address_out
+   * @return
+   */
+  chif_net_result chif_net_address_from_key(const chif_net_address_key* key,
+                                            chif_net_address* address_out);
+
+  /**
+   * @return A well mixed hash, use any of its bits.
+   */
+  uint32_t chif_net_address_key_hash(const chif_net_address_key* key);
+
+  chif_net_bool chif_net_address_key_equal(const chif_net_address_key* a,
+                                           const chif_net_address_key* b);
+
+  /**
+   * @param table
+   * @param sessions Storage for the table, it must outlive the table.
+   * @param capacity Number of sessions in storage, a power of two. At most
+   * seven eighths of it is used, to keep the probe sequences short.
+   * @param idle_timeout_ms How long a session lives after it was last found.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if capacity is not a power of
+   * two.
+   */
+  chif_net_result chif_net_session_table_init(chif_net_session_table* table,
+                                              chif_net_session* sessions,
+                                              size_t capacity,
+                                              uint32_t idle_timeout_ms);
+
+  /**
+   * Find the session of a key, and keep it alive for another idle timeout.
+   *
+   * @param table
+   * @param key
+   * @param now_ms From chif_net_time_ms, it can be read once per batch of
+   * packets.
+   * @return The session, or NULL if there is none or it has expired. It stays
+   * valid until the next removal from the table.
+   */
+  chif_net_session* chif_net_session_table_find(chif_net_session_table* table,
+                                                const chif_net_address_key* key,
+                                                uint64_t now_ms);
+
+  /**
+   * Find the session of a key, or add a new one with user_data set to NULL.
+   * An expired session that has not been removed by
+   * chif_net_session_table_expire yet is brought back, with its user_data.
+   *
+   * @param table
+   * @param key
+   * @param now_ms
+   * @param session_out Valid until the next removal from the table.
+   * @return CHIF_NET_RESULT_NOT_ENOUGH_SPACE if the table is full.
+   */
+  chif_net_result chif_net_session_table_insert(
+    chif_net_session_table* table,
+    const chif_net_address_key* key,
+    uint64_t now_ms,
+    chif_net_session** session_out);
+
+  /**
+   * @param table
+   * @param session As returned by find or insert.
+   * @return
+   */
+  chif_net_result chif_net_session_table_remove(chif_net_session_table* table,
+                                                chif_net_session* session);
+
+  /**
+   * Remove sessions that have been idle for longer than the idle timeout.
+   *
+   * The table is swept incrementally, call it regularly with a small budget
+   * to spread the work out, or with the capacity to sweep the whole table.
+   *
+   * @param table
+   * @param now_ms
+   * @param slot_budget How many slots to look at.
+   * @param on_expire Optional, called before a session is removed.
+   * @param user_data Passed to on_expire.
+   * @return Number of removed sessions.
+   */
+  size_t chif_net_session_table_expire(chif_net_session_table* table,
+                                       uint64_t now_ms,
+                                       size_t slot_budget,
+                                       chif_net_session_expire_fn on_expire,
+                                       void* user_data);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_SESSION_H_
@@ -0,0 +1,606 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// for memfd_create and the file seals
+#define _GNU_SOURCE
+#endif
+
+// ============================================================ //
+// Headers
+// ============================================================ //
+
+#include "chif_net_shm.h"
+
+#include <string.h>
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ============================================================ //
+// Types
+// ============================================================ //
+
+/**
+ * Start of the shared memory, followed by the two rings.
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ring_size;
+  uint8_t padding[48];
+} chif_net_shm_header;
+
+/**
+ * Positions are free running byte counts, the producer only writes tail and
+ * the consumer only writes head, each on its own cache line. The waiting
+ * fields are set by an end that is about to sleep, to what it waits for, and
+ * cleared by the end that wakes it: 1 for a reader, that waits for a
+ * message, and the free bytes it needs for a writer. Followed by ring_size
+ * bytes of messages.
+ */
+typedef struct
+{
+  uint64_t tail;
+  uint8_t tail_padding[56];
+  uint64_t head;
+  uint8_t head_padding[56];
+  uint32_t reader_waiting;
+  uint32_t writer_waiting;
+  uint8_t waiting_padding[56];
+} chif_net_shm_ring;
+
+// ============================================================ //
+// Static Asserts
+// ============================================================ //
+
+CHIF_NET_STATIC_ASSERT(sizeof(chif_net_shm_header) == 64,
+                       shm_header_correct_size);
+CHIF_NET_STATIC_ASSERT(sizeof(chif_net_shm_ring) == 192,
+                       shm_ring_correct_size);
+
+// ============================================================ //
+// Static Functions
+// ============================================================ //
+
+#if defined(__linux__)
+
+enum
+{
+  _chif_net_shm_magic = 0x73666863, // "chfs"
+  _chif_net_shm_version = 1,
+  _chif_net_shm_min_ring_size = 4096,
+  // so that message sizes fit in an int
+  _chif_net_shm_max_ring_size = 1 << 30,
+  // every message starts with its size, and is padded to this
+  _chif_net_shm_record_header_size = 8,
+  // the size of the memory is fixed once the creator has sent it
+  _chif_net_shm_seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL
+};
+
+static chif_net_result
+_chif_net_shm_result_from_errno(void)
+{
+  switch (errno) {
+    case ENOMEM:
+      return CHIF_NET_RESULT_NO_MEMORY;
+    case EMFILE:
+      return CHIF_NET_RESULT_NO_FREE_FILE_DESCRIPTORS;
+    case ENFILE:
+      return CHIF_NET_RESULT_NO_FREE_FILES;
+    default:
+      return CHIF_NET_RESULT_FAIL;
+  }
+}
+
+static size_t
+_chif_net_shm_memory_size(const uint64_t ring_size)
+{
+  return sizeof(chif_net_shm_header) +
+         2 * (sizeof(chif_net_shm_ring) + (size_t)ring_size);
+}
+
+static uint64_t
+_chif_net_shm_record_size(const uint64_t message_size)
+{
+  const uint64_t align = _chif_net_shm_record_header_size;
+  return _chif_net_shm_record_header_size + (message_size + align - 1) /
+                                              align * align;
+}
+
+static uint8_t*
+_chif_net_shm_data(void* ring)
+{
+  return (uint8_t*)ring + sizeof(chif_net_shm_ring);
+}
+
+static void
+_chif_net_shm_reset(chif_net_shm_channel* channel)
+{
+  memset(channel, 0, sizeof(chif_net_shm_channel));
+  channel->notify_socket = CHIF_NET_INVALID_SOCKET;
+  channel->peer_notify_socket = CHIF_NET_INVALID_SOCKET;
+}
+
+/**
+ * Map the memory, the creator writes to the first ring and reads from the
+ * second, and the peer the other way around.
+ */
+static chif_net_result
+_chif_net_shm_map(chif_net_shm_channel* channel,
+                  const int memory_fd,
+                  const uint64_t ring_size,
+                  const int creator)
+{
+  const size_t memory_size = _chif_net_shm_memory_size(ring_size);
+  void* memory = mmap(
+    NULL, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+  if (memory == MAP_FAILED) {
+    return _chif_net_shm_result_from_errno();
+  }
+
+  channel->memory = (uint8_t*)memory;
+  channel->memory_size = memory_size;
+  channel->ring_size = ring_size;
+  uint8_t* first = channel->memory + sizeof(chif_net_shm_header);
+  uint8_t* second = first + sizeof(chif_net_shm_ring) + ring_size;
+  channel->tx = creator ? first : second;
+  channel->rx = creator ? second : first;
+
+  chif_net_shm_ring* tx = (chif_net_shm_ring*)channel->tx;
+  chif_net_shm_ring* rx = (chif_net_shm_ring*)channel->rx;
+  channel->tx_tail = __atomic_load_n(&tx->tail, __ATOMIC_ACQUIRE);
+  channel->tx_head = __atomic_load_n(&tx->head, __ATOMIC_ACQUIRE);
+  channel->rx_head = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE);
+  channel->rx_tail = __atomic_load_n(&rx->tail, __ATOMIC_ACQUIRE);
+  channel->tx_wanted = ring_size / 2;
+  return CHIF_NET_RESULT_SUCCESS;
+}
+
+static chif_net_result
+_chif_net_shm_create(chif_net_shm_channel* channel,
+                     const int memory_fd,
+                     const chif_net_socket socket,
+                     const uint64_t ring_size)
+{
+  const size_t memory_size = _chif_net_shm_memory_size(ring_size);
+  if (ftruncate(memory_fd, (off_t)memory_size) == -1 ||
+      fcntl(memory_fd, F_ADD_SEALS, _chif_net_shm_seals) == -1) {
+    return _chif_net_shm_result_from_errno();
+  }
+  chif_net_result res = _chif_net_shm_map(channel, memory_fd, ring_size, 1);
+  if (res) {
+    return res;
+  }
+
+  // the rings start out zeroed by ftruncate
+  chif_net_shm_header* header = (chif_net_shm_header*)channel->memory;
+  header->magic = _chif_net_shm_magic;
+  header->version = _chif_net_shm_version;
+  header->ring_size = ring_size;
+
+  channel->notify_socket = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (channel->notify_socket == -1) {
+    return _chif_net_shm_result_from_errno();
+  }
+  channel->peer_notify_socket = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (channel->peer_notify_socket == -1) {
+    return _chif_net_shm_result_from_errno();
+  }
+
+  // in the order of the peer, its own eventfd first
+  const chif_net_socket sockets[3] = { memory_fd,
+                                       channel->peer_notify_socket,
+                                       channel->notify_socket };
+  return chif_net_send_sockets(
+    socket, sockets, 3, (const uint8_t*)header, sizeof(*header), NULL);
+}
+
+static chif_net_result
+_chif_net_shm_accept(chif_net_shm_channel* channel,
+                     const int memory_fd,
+                     const chif_net_shm_header* sent_header)
+{
+  // the peer may not be trusted, check the memory before using it, and that
+  // it can not be resized under the mapping, which would fault on access
+  struct stat memory_stat;
+  const int seals = fcntl(memory_fd, F_GET_SEALS);
+  if (seals == -1 || (seals & _chif_net_shm_seals) != _chif_net_shm_seals ||
+      sent_header->magic != _chif_net_shm_magic ||
+      sent_header->version != _chif_net_shm_version ||
+      sent_header->ring_size < _chif_net_shm_min_ring_size ||
+      sent_header->ring_size > _chif_net_shm_max_ring_size ||
+      (sent_header->ring_size & (sent_header->ring_size - 1)) != 0 ||
+      fstat(memory_fd, &memory_stat) == -1 ||
+      (uint64_t)memory_stat.st_size !=
+        _chif_net_shm_memory_size(sent_header->ring_size)) {
+    return CHIF_NET_RESULT_FAIL;
+  }
+  return _chif_net_shm_map(channel, memory_fd, sent_header->ring_size, 0);
+}
+
+/**
+ * Wake up the peer if it is waiting for no more than available, messages for
+ * a reader or free bytes for a writer. The fence pairs with the one in
+ * chif_net_shm_fill_check: either the peer sees the new position before it
+ * sleeps, or this sees what it waits for.
+ */
+static void
+_chif_net_shm_wake(uint32_t* waiting,
+                   const uint64_t available,
+                   const chif_net_socket notify_socket)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  const uint32_t wanted = __atomic_load_n(waiting, __ATOMIC_RELAXED);
+  if (wanted && wanted <= available &&
+      __atomic_exchange_n(waiting, 0, __ATOMIC_ACQ_REL)) {
+    const uint64_t one = 1;
+    const ssize_t result = write(notify_socket, &one, sizeof(one));
+    CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(result);
+  }
+}
+
+static int
+_chif_net_shm_readable(chif_net_shm_channel* channel)
+{
+  if (channel->rx_head == channel->rx_tail) {
+    chif_net_shm_ring* rx = (chif_net_shm_ring*)channel->rx;
+    channel->rx_tail = __atomic_load_n(&rx->tail, __ATOMIC_ACQUIRE);
+  }
+  return channel->rx_head != channel->rx_tail;
+}
+
+/**
+ * Writable with tx_wanted bytes free, room for the write that last blocked
+ * and at least half the ring, so that a writer is not woken up for every
+ * message read.
+ */
+static int
+_chif_net_shm_writable(chif_net_shm_channel* channel)
+{
+  const uint64_t ring_size = channel->ring_size;
+  if (ring_size - (channel->tx_tail - channel->tx_head) < channel->tx_wanted) {
+    chif_net_shm_ring* tx = (chif_net_shm_ring*)channel->tx;
+    channel->tx_head = __atomic_load_n(&tx->head, __ATOMIC_ACQUIRE);
+  }
+  return ring_size - (channel->tx_tail - channel->tx_head) >=
+         channel->tx_wanted;
+}
+
+static short
+_chif_net_shm_ready_events(chif_net_shm_channel* channel,
+                           const short request_events)
+{
+  short events = 0;
+  if ((request_events & CHIF_NET_CHECK_EVENT_READ) &&
+      _chif_net_shm_readable(channel)) {
+    events |= CHIF_NET_CHECK_EVENT_READ;
+  }
+  if ((request_events & CHIF_NET_CHECK_EVENT_WRITE) &&
+      _chif_net_shm_writable(channel)) {
+    events |= CHIF_NET_CHECK_EVENT_WRITE;
+  }
+  return events;
+}
+
+#endif // __linux__
+
+// ============================================================ //
+// Implementation
+// ============================================================ //
+
+chif_net_result
+chif_net_shm_create(chif_net_shm_channel* channel_out,
+                    const chif_net_socket socket,
+                    const size_t ring_size)
+{
+#if defined(__linux__)
+  if (ring_size < _chif_net_shm_min_ring_size ||
+      ring_size > _chif_net_shm_max_ring_size ||
+      (ring_size & (ring_size - 1)) != 0) {
+    return CHIF_NET_RESULT_INVALID_INPUT_PARAM;
+  }
+
+  _chif_net_shm_reset(channel_out);
+  const int memory_fd =
+    memfd_create("chif_net_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memory_fd == -1) {
+    return _chif_net_shm_result_from_errno();
+  }
+  const chif_net_result res =
+    _chif_net_shm_create(channel_out, memory_fd, socket, ring_size);
+  // the mapping and the peer keep the memory alive
+  close(memory_fd);
+  if (res) {
+    chif_net_shm_close(channel_out);
+  }
+  return res;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(channel_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(ring_size);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_shm_accept(chif_net_shm_channel* channel_out,
+                    const chif_net_socket socket)
+{
+#if defined(__linux__)
+  _chif_net_shm_reset(channel_out);
+  chif_net_socket sockets[3];
+  size_t socket_count = 0;
+  chif_net_shm_header header;
+  int bytes;
+  chif_net_result res = chif_net_receive_sockets(socket,
+                                                 sockets,
+                                                 3,
+                                                 &socket_count,
+                                                 (uint8_t*)&header,
+                                                 sizeof(header),
+                                                 &bytes);
+  if (res && res != CHIF_NET_RESULT_NOT_ENOUGH_SPACE) {
+    return res;
+  }
+
+  if (!res && socket_count == 3 && bytes == (int)sizeof(header)) {
+    channel_out->notify_socket = sockets[1];
+    channel_out->peer_notify_socket = sockets[2];
+    res = _chif_net_shm_accept(channel_out, sockets[0], &header);
+    close(sockets[0]);
+    if (res) {
+      chif_net_shm_close(channel_out);
+    }
+    return res;
+  }
+
+  for (size_t i = 0; i < socket_count; ++i) {
+    close(sockets[i]);
+  }
+  return CHIF_NET_RESULT_FAIL;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(channel_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(socket);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+void
+chif_net_shm_close(chif_net_shm_channel* channel)
+{
+#if defined(__linux__)
+  if (channel->memory) {
+    munmap(channel->memory, channel->memory_size);
+  }
+  chif_net_close_socket(&channel->notify_socket);
+  chif_net_close_socket(&channel->peer_notify_socket);
+  channel->memory = NULL;
+  channel->tx = NULL;
+  channel->rx = NULL;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(channel);
+#endif
+}
+
+chif_net_result
+chif_net_shm_write(chif_net_shm_channel* channel,
+                   const uint8_t* buf,
+                   const size_t bufsize,
+                   int* sent_bytes_out)
+{
+#if defined(__linux__)
+  const uint64_t ring_size = channel->ring_size;
+  if (bufsize > ring_size - _chif_net_shm_record_header_size) {
+    return CHIF_NET_RESULT_TOO_LONG_MSG_NOT_SENT;
+  }
+
+  chif_net_shm_ring* tx = (chif_net_shm_ring*)channel->tx;
+  const uint64_t record_size = _chif_net_shm_record_size(bufsize);
+  if (channel->tx_tail + record_size - channel->tx_head > ring_size) {
+    channel->tx_head = __atomic_load_n(&tx->head, __ATOMIC_ACQUIRE);
+    if (channel->tx_tail + record_size - channel->tx_head > ring_size) {
+      // waiting to write wakes up once this message fits
+      if (record_size > channel->tx_wanted) {
+        channel->tx_wanted = record_size;
+      }
+      return CHIF_NET_RESULT_WOULD_BLOCK;
+    }
+  }
+  channel->tx_wanted = ring_size / 2;
+
+  // records are aligned, so the size never wraps, but the message may
+  uint8_t* data = _chif_net_shm_data(tx);
+  const uint64_t mask = ring_size - 1;
+  const uint64_t position = channel->tx_tail & mask;
+  const uint64_t size = bufsize;
+  memcpy(data + position, &size, sizeof(size));
+  const uint64_t message_position =
+    (position + _chif_net_shm_record_header_size) & mask;
+  const size_t first = (size_t)(ring_size - message_position) < bufsize
+                         ? (size_t)(ring_size - message_position)
+                         : bufsize;
+  memcpy(data + message_position, buf, first);
+  memcpy(data, buf + first, bufsize - first);
+
+  channel->tx_tail += record_size;
+  __atomic_store_n(&tx->tail, channel->tx_tail, __ATOMIC_RELEASE);
+  _chif_net_shm_wake(&tx->reader_waiting, 1, channel->peer_notify_socket);
+
+  if (sent_bytes_out) {
+    *sent_bytes_out = (int)bufsize;
+  }
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(channel);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(buf);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(bufsize);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(sent_bytes_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+chif_net_result
+chif_net_shm_read(chif_net_shm_channel* channel,
+                  uint8_t* buf_out,
+                  const size_t bufsize,
+                  int* read_bytes_out)
+{
+#if defined(__linux__)
+  if (!_chif_net_shm_readable(channel)) {
+    return CHIF_NET_RESULT_WOULD_BLOCK;
+  }
+
+  // the size is read once, and checked, as the peer may not be trusted
+  chif_net_shm_ring* rx = (chif_net_shm_ring*)channel->rx;
+  uint8_t* data = _chif_net_shm_data(rx);
+  const uint64_t ring_size = channel->ring_size;
+  const uint64_t mask = ring_size - 1;
+  const uint64_t position = channel->rx_head & mask;
+  uint64_t size;
+  memcpy(&size, data + position, sizeof(size));
+  if (size > ring_size - _chif_net_shm_record_header_size ||
+      channel->rx_tail - channel->rx_head > ring_size ||
+      _chif_net_shm_record_size(size) > channel->rx_tail - channel->rx_head) {
+    return CHIF_NET_RESULT_FAIL;
+  }
+  if (read_bytes_out) {
+    *read_bytes_out = (int)size;
+  }
+  if (size > bufsize) {
+    return CHIF_NET_RESULT_BUFSIZE_INVALID;
+  }
+
+  const uint64_t message_position =
+    (position + _chif_net_shm_record_header_size) & mask;
+  const size_t first = ring_size - message_position < size
+                         ? (size_t)(ring_size - message_position)
+                         : (size_t)size;
+  memcpy(buf_out, data + message_position, first);
+  memcpy(buf_out + first, data, (size_t)size - first);
+
+  channel->rx_head += _chif_net_shm_record_size(size);
+  __atomic_store_n(&rx->head, channel->rx_head, __ATOMIC_RELEASE);
+  _chif_net_shm_wake(&rx->writer_waiting,
+                     ring_size - (channel->rx_tail - channel->rx_head),
+                     channel->peer_notify_socket);
+  return CHIF_NET_RESULT_SUCCESS;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(channel);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(buf_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(bufsize);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(read_bytes_out);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
+
+short
+chif_net_shm_fill_check(chif_net_shm_channel* channel,
+                        const short request_events,
+                        chif_net_check* check_out)
+{
+#if defined(__linux__)
+  short events = _chif_net_shm_ready_events(channel, request_events);
+  if (events) {
+    return events;
+  }
+
+  // clear wake ups from earlier waits, so that only the peer wakes this one
+  uint64_t count;
+  const ssize_t result = read(channel->notify_socket, &count, sizeof(count));
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(result);
+
+  chif_net_shm_ring* tx = (chif_net_shm_ring*)channel->tx;
+  chif_net_shm_ring* rx = (chif_net_shm_ring*)channel->rx;
+  if (request_events & CHIF_NET_CHECK_EVENT_READ) {
+    __atomic_store_n(&rx->reader_waiting, 1, __ATOMIC_RELAXED);
+  }
+  if (request_events & CHIF_NET_CHECK_EVENT_WRITE) {
+    __atomic_store_n(
+      &tx->writer_waiting, (uint32_t)channel->tx_wanted, __ATOMIC_RELAXED);
+  }
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  events = _chif_net_shm_ready_events(channel, request_events);
+  if (events) {
+    // the flags are left set, which at worst gives one needless wake up
+    return events;
+  }
+
+  check_out->socket = channel->notify_socket;
+  check_out->request_events = CHIF_NET_CHECK_EVENT_READ;
+  check_out->return_events = 0;
+  return 0;
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(channel);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(request_events);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(check_out);
+  return 0;
+#endif
+}
+
+chif_net_result
+chif_net_shm_poll(chif_net_shm_channel* channel,
+                  const short request_events,
+                  short* return_events_out,
+                  const int timeout_ms)
+{
+#if defined(__linux__)
+  const uint64_t start_ms = chif_net_time_ms();
+  for (;;) {
+    chif_net_check check;
+    *return_events_out =
+      chif_net_shm_fill_check(channel, request_events, &check);
+    if (*return_events_out) {
+      return CHIF_NET_RESULT_SUCCESS;
+    }
+
+    int wait_ms = timeout_ms;
+    if (timeout_ms >= 0) {
+      const uint64_t elapsed_ms = chif_net_time_ms() - start_ms;
+      if (elapsed_ms >= (uint64_t)timeout_ms) {
+        return CHIF_NET_RESULT_SUCCESS;
+      }
+      wait_ms = timeout_ms - (int)elapsed_ms;
+    }
+    int ready_count;
+    const chif_net_result res = chif_net_poll(&check, 1, &ready_count, wait_ms);
+    if (res) {
+      return res;
+    }
+    // woken up, or a late wake up of an earlier wait, check again
+  }
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(channel);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(request_events);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(return_events_out);
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(timeout_ms);
+  return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+#endif
+}
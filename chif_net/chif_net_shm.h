@@ -0,0 +1,210 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CHIF_NET_SHM_H_
+#define CHIF_NET_SHM_H_
+
+/**
+ * Shared memory channel between two processes on the same host, for when
+ * even unix sockets, with a system call and a kernel copy per message, cost
+ * too much.
+ *
+ * A channel is a memfd with two single-producer single-consumer rings of
+ * messages, one in each direction. Messages are written to and read from the
+ * mapped memory directly, and a system call is only made to wake up a peer
+ * that went to sleep waiting, through its eventfd. Set up a channel over a
+ * connected unix stream socket, where one side calls chif_net_shm_create and
+ * the other chif_net_shm_accept:
+ *
+ *   chif_net_shm_write -> message is seen by the peer's chif_net_shm_read
+ *   chif_net_shm_fill_check -> add the check to chif_net_poll, or
+ *   chif_net_shm_poll -> wait for the one channel
+ *
+ * Keep the unix socket open to notice the peer going away, the channel
+ * itself does not.
+ *
+ * Each end of a channel must be used by one thread at a time. Linux only,
+ * elsewhere the functions return CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED.
+ */
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// ====================================================================== //
+// Headers & Constants
+// ====================================================================== //
+
+#include "chif_net.h"
+
+// Default size of each ring, in bytes.
+#define CHIF_NET_SHM_DEFAULT_RING_SIZE (1 << 20)
+
+  // ====================================================================== //
+  // Types
+  // ====================================================================== //
+
+  /**
+   * One end of a channel, fill in with chif_net_shm_create or
+   * chif_net_shm_accept.
+   *
+   * @param memory The mapped memfd.
+   * @param memory_size
+   * @param tx Header of the ring this end writes to.
+   * @param rx Header of the ring this end reads from.
+   * @param ring_size Bytes of message data each ring holds.
+   * @param tx_tail Write position, only written by this end.
+   * @param tx_head Read position of the peer, as last seen.
+   * @param rx_head Read position, only written by this end.
+   * @param rx_tail Write position of the peer, as last seen.
+   * @param tx_wanted Free bytes that make the channel writable, enough for
+   * the write that last got CHIF_NET_RESULT_WOULD_BLOCK.
+   * @param notify_socket eventfd the peer wakes this end with.
+   * @param peer_notify_socket eventfd this end wakes the peer with.
+   */
+  typedef struct
+  {
+    uint8_t* memory;
+    size_t memory_size;
+    void* tx;
+    void* rx;
+    uint64_t ring_size;
+    uint64_t tx_tail;
+    uint64_t tx_head;
+    uint64_t rx_head;
+    uint64_t rx_tail;
+    uint64_t tx_wanted;
+    chif_net_socket notify_socket;
+    chif_net_socket peer_notify_socket;
+  } chif_net_shm_channel;
+
+  // ====================================================================== //
+  // Functions
+  // ====================================================================== //
+
+  /**
+   * Create a channel and hand it to the peer over socket, which calls
+   * chif_net_shm_accept.
+   *
+   * @param channel_out
+   * @param socket Connected unix stream socket.
+   * @param ring_size Bytes in each ring, a power of two from 4096 up to
+   * 1 GiB. The largest message is 8 bytes less. Use
+   * CHIF_NET_SHM_DEFAULT_RING_SIZE if unsure.
+   * @return CHIF_NET_RESULT_INVALID_INPUT_PARAM if ring_size is not valid.
+   */
+  chif_net_result chif_net_shm_create(chif_net_shm_channel* channel_out,
+                                      chif_net_socket socket,
+                                      size_t ring_size);
+
+  /**
+   * Accept a channel created by the peer with chif_net_shm_create. Blocks
+   * until the peer has sent it, unless socket is non-blocking. The memory
+   * must be sealed against resizing, as chif_net_shm_create does, so that
+   * the peer can not make the mapping fault later.
+   *
+   * @param channel_out
+   * @param socket Connected unix stream socket.
+   * @return CHIF_NET_RESULT_FAIL if the peer did not send a valid channel.
+   */
+  chif_net_result chif_net_shm_accept(chif_net_shm_channel* channel_out,
+                                      chif_net_socket socket);
+
+  /**
+   * Unmap the channel and close its eventfds. Messages the peer has not read
+   * stay readable for it.
+   *
+   * @param channel
+   */
+  void chif_net_shm_close(chif_net_shm_channel* channel);
+
+  /**
+   * Write a message to the peer, whole or not at all.
+   *
+   * @param channel
+   * @param buf
+   * @param bufsize
+   * @param sent_bytes_out May be NULL, bufsize on success.
+   * @return CHIF_NET_RESULT_WOULD_BLOCK if the ring is too full,
+   * CHIF_NET_RESULT_TOO_LONG_MSG_NOT_SENT if the message never fits.
+   */
+  chif_net_result chif_net_shm_write(chif_net_shm_channel* channel,
+                                     const uint8_t* buf,
+                                     size_t bufsize,
+                                     int* sent_bytes_out);
+
+  /**
+   * Read the next message from the peer.
+   *
+   * @param channel
+   * @param buf_out
+   * @param bufsize
+   * @param read_bytes_out Size of the message.
+   * @return CHIF_NET_RESULT_WOULD_BLOCK if there is no message,
+   * CHIF_NET_RESULT_BUFSIZE_INVALID if the message does not fit in buf_out,
+   * it is kept for the next read then.
+   */
+  chif_net_result chif_net_shm_read(chif_net_shm_channel* channel,
+                                    uint8_t* buf_out,
+                                    size_t bufsize,
+                                    int* read_bytes_out);
+
+  /**
+   * Get ready to wait for the channel with chif_net_poll, together with
+   * sockets. Unless events are already there, fill out check, so that
+   * polling it wakes up on them, and have the peer signal it.
+   *
+   * @param channel
+   * @param request_events CHIF_NET_CHECK_EVENT_READ for a message to read,
+   * CHIF_NET_CHECK_EVENT_WRITE for room to write. Writable means that the
+   * write that last got CHIF_NET_RESULT_WOULD_BLOCK fits now, and that at
+   * least half the ring is free, so the peer does not wake this end for
+   * every message it reads.
+   * @param check_out
+   * @return The request_events that are already there, do not wait then.
+   * Otherwise 0, poll check_out and call again once it has an event.
+   */
+  short chif_net_shm_fill_check(chif_net_shm_channel* channel,
+                                short request_events,
+                                chif_net_check* check_out);
+
+  /**
+   * Wait for events on the channel, as chif_net_poll for a socket.
+   *
+   * @param channel
+   * @param request_events As for chif_net_shm_fill_check.
+   * @param return_events_out The events there are, 0 if timed out.
+   * @param timeout_ms -1 to wait forever.
+   * @return
+   */
+  chif_net_result chif_net_shm_poll(chif_net_shm_channel* channel,
+                                    short request_events,
+                                    short* return_events_out,
+                                    int timeout_ms);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // CHIF_NET_SHM_H_
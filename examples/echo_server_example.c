@@ -116,6 +116,10 @@ run_server(int argc, char** argv)
   if (proto == CHIF_NET_TRANSPORT_PROTOCOL_TCP) {
     printf("listen for connection\n");
     OK_OR_CRASH(chif_net_listen(sock, CHIF_NET_DEFAULT_BACKLOG));
+    // the client talks first, only wake up once it has
+    if (chif_net_tcp_set_defer_accept(sock, 10)) {
+      printf("deferred accept not supported, accepting right away\n");
+    }
 
     printf("waiting to accept client\n");
     cliaddr.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
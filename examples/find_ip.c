@@ -110,6 +110,25 @@ find_hostname_address(const char* site)
   const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
   ok_or_die(chif_net_open_socket(&sock, proto, af));
 
+  {
+    printf("all of %s 's addresses\n", site);
+    chif_net_address addrs[16];
+    size_t count;
+    ok_or_die(chif_net_create_addresses(addrs,
+                                        16,
+                                        &count,
+                                        site,
+                                        "http",
+                                        proto,
+                                        CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED));
+    for (size_t i = 0; i < count; ++i) {
+      char str[CHIF_NET_ADDRESS_STRING_LENGTH];
+      ok_or_die(chif_net_address_to_string(
+        &addrs[i], str, CHIF_NET_ADDRESS_STRING_LENGTH, NULL));
+      printf("\t%s\n", str);
+    }
+  }
+
   {
     printf("looking up %s 's ip\n", site);
     chif_net_address addr;
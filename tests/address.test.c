@@ -0,0 +1,281 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <string.h>
+
+static void
+check_address(AlfTestState* state,
+              const char* name,
+              const char* service,
+              const chif_net_address_family af,
+              const char* expected_ip,
+              const chif_net_port expected_port)
+{
+  chif_net_address addr;
+  OK_OR_RET(chif_net_create_address(
+    &addr, name, service, CHIF_NET_TRANSPORT_PROTOCOL_TCP, af));
+  ALF_CHECK_TRUE(state, addr.address_family == af);
+
+  char ip[CHIF_NET_IPVX_STRING_LENGTH];
+  OK_OR_RET(chif_net_ip_from_address(&addr, ip, CHIF_NET_IPVX_STRING_LENGTH));
+  ALF_CHECK_STREQ(state, ip, expected_ip);
+
+  chif_net_port port;
+  OK_OR_RET(chif_net_port_from_address(&addr, &port));
+  ALF_CHECK_TRUE(state, port == expected_port);
+}
+
+void
+address_numeric(AlfTestState* state)
+{
+  const chif_net_address_family ipv4 = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_address_family ipv6 = CHIF_NET_ADDRESS_FAMILY_IPV6;
+
+  check_address(state, "10.0.0.1", "8080", ipv4, "10.0.0.1", 8080);
+  check_address(state, "255.255.255.255", "0", ipv4, "255.255.255.255", 0);
+  check_address(state, NULL, "80", ipv4, "0.0.0.0", 80);
+  check_address(state, "127.0.0.1", NULL, ipv4, "127.0.0.1", 0);
+
+  check_address(state, "::1", "65535", ipv6, "::1", 65535);
+  check_address(state, "::", "1", ipv6, "::", 1);
+  check_address(state, NULL, "443", ipv6, "::", 443);
+  check_address(state,
+                "2001:DB8::8:800:200C:417A",
+                "1",
+                ipv6,
+                "2001:db8::8:800:200c:417a",
+                1);
+  check_address(state, "1:2:3:4:5:6:7:8", "1", ipv6, "1:2:3:4:5:6:7:8", 1);
+  check_address(state, "1::", "1", ipv6, "1::", 1);
+  check_address(state, "::ffff:10.0.0.1", "1", ipv6, "::ffff:10.0.0.1", 1);
+
+  // not numeric, handled by getaddrinfo
+  check_address(state, "localhost", "80", ipv4, "127.0.0.1", 80);
+  check_address(state, "127.0.0.1", "http", ipv4, "127.0.0.1", 80);
+
+  { // same as above, but with the port as an integer
+    chif_net_address addr;
+    OK_OR_RET(chif_net_create_address_i(
+      &addr, "192.168.1.2", 1234, CHIF_NET_TRANSPORT_PROTOCOL_UDP, ipv4));
+    char ip[CHIF_NET_IPVX_STRING_LENGTH];
+    OK_OR_RET(
+      chif_net_ip_from_address(&addr, ip, CHIF_NET_IPVX_STRING_LENGTH));
+    ALF_CHECK_STREQ(state, ip, "192.168.1.2");
+    chif_net_port port;
+    OK_OR_RET(chif_net_port_from_address(&addr, &port));
+    ALF_CHECK_TRUE(state, port == 1234);
+
+    OK_OR_RET(chif_net_create_address_i(
+      &addr, "fe80::1", 4321, CHIF_NET_TRANSPORT_PROTOCOL_UDP, ipv6));
+    OK_OR_RET(
+      chif_net_ip_from_address(&addr, ip, CHIF_NET_IPVX_STRING_LENGTH));
+    ALF_CHECK_STREQ(state, ip, "fe80::1");
+    OK_OR_RET(chif_net_port_from_address(&addr, &port));
+    ALF_CHECK_TRUE(state, port == 4321);
+    const chif_net_ipv6_address* addr6 = (const chif_net_ipv6_address*)&addr;
+    ALF_CHECK_TRUE(state, addr6->flowinfo == 0);
+    ALF_CHECK_TRUE(state, addr6->scope_id == 0);
+  }
+
+  { // invalid literals must still fail
+    const char* invalid_ipv6[] = {
+      "1:2:3:4:5:6:7:8:9", "1:::2", "1::2::3", "12345::",
+      ":1",                "1:",    "::1.2.3", "1.2.3.4"
+    };
+    for (size_t i = 0; i < sizeof(invalid_ipv6) / sizeof(invalid_ipv6[0]);
+         ++i) {
+      chif_net_address addr;
+      ALF_CHECK_TRUE(state,
+                     chif_net_create_address(&addr,
+                                             invalid_ipv6[i],
+                                             "80",
+                                             CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                             ipv6) != CHIF_NET_RESULT_SUCCESS);
+    }
+
+    chif_net_address addr;
+    ALF_CHECK_TRUE(state,
+                   chif_net_create_address(&addr,
+                                           "256.0.0.1",
+                                           "80",
+                                           CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                           ipv4) != CHIF_NET_RESULT_SUCCESS);
+  }
+}
+
+static void
+check_format(AlfTestState* state,
+             const char* name,
+             const chif_net_address_family af,
+             const char* expected)
+{
+  chif_net_address addr;
+  OK_OR_RET(chif_net_create_address_i(
+    &addr, name, 8080, CHIF_NET_TRANSPORT_PROTOCOL_TCP, af));
+
+  char str[CHIF_NET_ADDRESS_STRING_LENGTH];
+  size_t written;
+  OK_OR_RET(chif_net_address_to_string(
+    &addr, str, CHIF_NET_ADDRESS_STRING_LENGTH, &written));
+  ALF_CHECK_STREQ(state, str, expected);
+  ALF_CHECK_TRUE(state, written == strlen(expected));
+}
+
+void
+address_format(AlfTestState* state)
+{
+  const chif_net_address_family ipv4 = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_address_family ipv6 = CHIF_NET_ADDRESS_FAMILY_IPV6;
+
+  check_format(state, "0.0.0.0", ipv4, "0.0.0.0:8080");
+  check_format(state, "10.20.100.255", ipv4, "10.20.100.255:8080");
+
+  check_format(state, "::", ipv6, "[::]:8080");
+  check_format(state, "::1", ipv6, "[::1]:8080");
+  check_format(state, "1::", ipv6, "[1::]:8080");
+  check_format(state, "2001:0DB8::0001", ipv6, "[2001:db8::1]:8080");
+  // a single zero group is not compressed
+  check_format(state, "1:0:2:3:4:5:6:7", ipv6, "[1:0:2:3:4:5:6:7]:8080");
+  // longest run wins, the first one on ties
+  check_format(state, "1:0:0:2:0:0:0:3", ipv6, "[1:0:0:2::3]:8080");
+  check_format(state, "1:0:0:2:3:0:0:4", ipv6, "[1::2:3:0:0:4]:8080");
+  check_format(state, "::ffff:1.2.3.4", ipv6, "[::ffff:1.2.3.4]:8080");
+
+  { // port edges and sizes
+    chif_net_address addr;
+    OK_OR_RET(chif_net_create_address_i(
+      &addr, "1.2.3.4", 65535, CHIF_NET_TRANSPORT_PROTOCOL_UDP, ipv4));
+    char str[CHIF_NET_ADDRESS_STRING_LENGTH];
+    OK_OR_RET(chif_net_address_to_string(&addr, str, 14, NULL));
+    ALF_CHECK_STREQ(state, str, "1.2.3.4:65535");
+    ALF_CHECK_TRUE(state,
+                   chif_net_address_to_string(&addr, str, 13, NULL) ==
+                     CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+    ALF_CHECK_TRUE(state,
+                   chif_net_ip_from_address(&addr, str, 7) ==
+                     CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+
+    OK_OR_RET(chif_net_create_address_i(
+      &addr, "1.2.3.4", 0, CHIF_NET_TRANSPORT_PROTOCOL_UDP, ipv4));
+    OK_OR_RET(chif_net_address_to_string(
+      &addr, str, CHIF_NET_ADDRESS_STRING_LENGTH, NULL));
+    ALF_CHECK_STREQ(state, str, "1.2.3.4:0");
+  }
+
+  { // batch
+    chif_net_address addrs[2];
+    OK_OR_RET(chif_net_create_address_i(
+      &addrs[0], "127.0.0.1", 1, CHIF_NET_TRANSPORT_PROTOCOL_TCP, ipv4));
+    OK_OR_RET(chif_net_create_address_i(
+      &addrs[1], "fe80::1", 22, CHIF_NET_TRANSPORT_PROTOCOL_TCP, ipv6));
+    char strs[2][CHIF_NET_ADDRESS_STRING_LENGTH];
+    OK_OR_RET(chif_net_addresses_to_string(
+      addrs, 2, &strs[0][0], CHIF_NET_ADDRESS_STRING_LENGTH));
+    ALF_CHECK_STREQ(state, strs[0], "127.0.0.1:1");
+    ALF_CHECK_STREQ(state, strs[1], "[fe80::1]:22");
+  }
+}
+
+void
+address_all(AlfTestState* state)
+{
+  chif_net_address addrs[8];
+  size_t count;
+  char ip[CHIF_NET_IPVX_STRING_LENGTH];
+
+  { // numeric names
+    OK_OR_RET(chif_net_create_addresses(addrs,
+                                        8,
+                                        &count,
+                                        "10.0.0.1",
+                                        "80",
+                                        CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                        CHIF_NET_ADDRESS_FAMILY_IPV4));
+    ALF_CHECK_TRUE(state, count == 1);
+    OK_OR_RET(chif_net_create_addresses(addrs,
+                                        8,
+                                        &count,
+                                        "::1",
+                                        "80",
+                                        CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                        CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED));
+    ALF_CHECK_TRUE(state, count == 1);
+    ALF_CHECK_TRUE(state,
+                   addrs[0].address_family == CHIF_NET_ADDRESS_FAMILY_IPV6);
+  }
+
+  { // through getaddrinfo
+    OK_OR_RET(chif_net_create_addresses(addrs,
+                                        8,
+                                        &count,
+                                        "localhost",
+                                        "http",
+                                        CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                        CHIF_NET_ADDRESS_FAMILY_IPV4));
+    ALF_CHECK_TRUE(state, count >= 1);
+    for (size_t i = 0; i < count; ++i) {
+      OK_OR_RET(chif_net_ip_from_address(&addrs[i], ip, sizeof(ip)));
+      ALF_CHECK_TRUE(state, strncmp(ip, "127.", 4) == 0);
+      chif_net_port port;
+      OK_OR_RET(chif_net_port_from_address(&addrs[i], &port));
+      ALF_CHECK_TRUE(state, port == 80);
+    }
+
+    ALF_CHECK_TRUE(state,
+                   chif_net_create_addresses(addrs,
+                                             0,
+                                             &count,
+                                             "localhost",
+                                             "80",
+                                             CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                             CHIF_NET_ADDRESS_FAMILY_IPV4) ==
+                     CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  }
+
+  { // RFC 6724 precedence, then scope
+    const char* unsorted[] = { "2001::5", "10.0.0.1", "::1",      "2a00::1",
+                               "fe80::1", "2002::1",  "127.0.0.1" };
+    const char* sorted[] = { "::1",      "fe80::1", "2a00::1", "127.0.0.1",
+                             "10.0.0.1", "2002::1", "2001::5" };
+    const size_t n = sizeof(unsorted) / sizeof(unsorted[0]);
+    for (size_t i = 0; i < n; ++i) {
+      OK_OR_RET(
+        chif_net_create_addresses(&addrs[i],
+                                  1,
+                                  &count,
+                                  unsorted[i],
+                                  "80",
+                                  CHIF_NET_TRANSPORT_PROTOCOL_UDP,
+                                  CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED));
+    }
+    chif_net_sort_addresses(addrs, n);
+    for (size_t i = 0; i < n; ++i) {
+      OK_OR_RET(chif_net_ip_from_address(&addrs[i], ip, sizeof(ip)));
+      ALF_CHECK_STREQ(state, ip, sorted[i]);
+    }
+  }
+}
@@ -0,0 +1,320 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <alf_thread.h>
+#include <chif_net.h>
+#include <chif_net_cache.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+  chif_net_cache* cache;
+  int calls;
+  chif_net_result result;
+  const char* ip;
+  uint32_t ttl_s;
+  const char* nested_name;
+  chif_net_result nested_result;
+  char nested_ip[CHIF_NET_IPV4_STRING_LENGTH];
+} fake_resolver;
+
+static chif_net_result
+fake_resolve(void* user_data,
+             chif_net_address* address_out,
+             const char* name,
+             const char* service,
+             chif_net_transport_protocol transport_protocol,
+             chif_net_address_family address_family,
+             uint32_t* ttl_s_out)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(name);
+  fake_resolver* fake = (fake_resolver*)user_data;
+  ++fake->calls;
+  *ttl_s_out = fake->ttl_s;
+
+  if (fake->nested_name) {
+    // a lookup made while the entry is being refreshed
+    chif_net_address nested;
+    fake->nested_result = chif_net_cache_create_address(fake->cache,
+                                                        &nested,
+                                                        fake->nested_name,
+                                                        service,
+                                                        transport_protocol,
+                                                        address_family);
+    chif_net_ip_from_address(&nested, fake->nested_ip, sizeof(fake->nested_ip));
+  }
+
+  if (fake->result) {
+    return fake->result;
+  }
+  return chif_net_create_address(
+    address_out, fake->ip, service, transport_protocol, address_family);
+}
+
+static chif_net_result
+lookup(chif_net_cache* cache, const char* name, char* ip_out)
+{
+  chif_net_address address;
+  const chif_net_result res =
+    chif_net_cache_create_address(cache,
+                                  &address,
+                                  name,
+                                  "80",
+                                  CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                  CHIF_NET_ADDRESS_FAMILY_IPV4);
+  if (res) {
+    return res;
+  }
+  return chif_net_ip_from_address(
+    &address, ip_out, CHIF_NET_IPV4_STRING_LENGTH);
+}
+
+static chif_net_result
+insert(chif_net_cache* cache, const char* name, const char* ip, uint32_t ttl)
+{
+  chif_net_address address;
+  const chif_net_result res =
+    chif_net_create_address(&address,
+                            ip,
+                            "80",
+                            CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                            CHIF_NET_ADDRESS_FAMILY_IPV4);
+  if (res) {
+    return res;
+  }
+  return chif_net_cache_insert(cache,
+                               name,
+                               "80",
+                               CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                               CHIF_NET_ADDRESS_FAMILY_IPV4,
+                               CHIF_NET_RESULT_SUCCESS,
+                               &address,
+                               ttl);
+}
+
+void
+cache_ttl(AlfTestState* state)
+{
+  chif_net_cache* cache = malloc(sizeof(chif_net_cache));
+  OK_OR_RET(chif_net_cache_init(cache));
+  fake_resolver fake = { .cache = cache, .ip = "10.0.0.1", .ttl_s = 60 };
+  cache->resolve = fake_resolve;
+  cache->resolve_user_data = &fake;
+  char ip[CHIF_NET_IPV4_STRING_LENGTH];
+
+  { // hits, names are case-insensitive
+    OK_OR_RET(lookup(cache, "Host.example", ip));
+    ALF_CHECK_STREQ(state, ip, "10.0.0.1");
+    fake.ip = "10.0.0.9";
+    OK_OR_RET(lookup(cache, "host.EXAMPLE", ip));
+    ALF_CHECK_STREQ(state, ip, "10.0.0.1");
+    ALF_CHECK_TRUE(state, fake.calls == 1);
+
+    chif_net_address address;
+    OK_OR_RET(chif_net_cache_create_address(cache,
+                                            &address,
+                                            "host.example",
+                                            "81",
+                                            CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                            CHIF_NET_ADDRESS_FAMILY_IPV4));
+    ALF_CHECK_TRUE(state, fake.calls == 2);
+  }
+
+  { // missing names are cached too
+    fake.result = CHIF_NET_RESLUT_NO_NAME;
+    ALF_CHECK_TRUE(state,
+                   lookup(cache, "missing", ip) == CHIF_NET_RESLUT_NO_NAME);
+    ALF_CHECK_TRUE(state,
+                   lookup(cache, "missing", ip) == CHIF_NET_RESLUT_NO_NAME);
+    ALF_CHECK_TRUE(state, fake.calls == 3);
+  }
+
+  { // failures are not
+    fake.result = CHIF_NET_RESULT_NAME_SERVER_FAIL;
+    ALF_CHECK_TRUE(state,
+                   lookup(cache, "down", ip) ==
+                     CHIF_NET_RESULT_NAME_SERVER_FAIL);
+    ALF_CHECK_TRUE(state,
+                   lookup(cache, "down", ip) ==
+                     CHIF_NET_RESULT_NAME_SERVER_FAIL);
+    ALF_CHECK_TRUE(state, fake.calls == 5);
+  }
+
+  { // expired, the stale entry is served without a lookup until refreshed
+    OK_OR_RET(insert(cache, "stale", "10.0.0.2", 0));
+    fake.result = CHIF_NET_RESULT_SUCCESS;
+    fake.ip = "10.0.0.3";
+    OK_OR_RET(lookup(cache, "stale", ip));
+    ALF_CHECK_STREQ(state, ip, "10.0.0.2");
+    OK_OR_RET(lookup(cache, "stale", ip));
+    ALF_CHECK_STREQ(state, ip, "10.0.0.2");
+    ALF_CHECK_TRUE(state, fake.calls == 5);
+
+    // lookups made while the entry is being refreshed are served stale too
+    fake.nested_name = "stale";
+    size_t refreshed;
+    OK_OR_RET(chif_net_cache_refresh(cache, 16, &refreshed));
+    ALF_CHECK_TRUE(state, refreshed == 1);
+    ALF_CHECK_TRUE(state, fake.nested_result == CHIF_NET_RESULT_SUCCESS);
+    ALF_CHECK_STREQ(state, fake.nested_ip, "10.0.0.2");
+    ALF_CHECK_TRUE(state, fake.calls == 6);
+    fake.nested_name = NULL;
+
+    OK_OR_RET(lookup(cache, "stale", ip));
+    ALF_CHECK_STREQ(state, ip, "10.0.0.3");
+    OK_OR_RET(chif_net_cache_refresh(cache, 16, &refreshed));
+    ALF_CHECK_TRUE(state, refreshed == 0);
+    ALF_CHECK_TRUE(state, fake.calls == 6);
+  }
+
+  { // a failed refresh keeps the stale entry
+    OK_OR_RET(insert(cache, "flaky", "10.0.0.4", 0));
+    fake.result = CHIF_NET_RESULT_NAME_SERVER_FAIL;
+    OK_OR_RET(lookup(cache, "flaky", ip));
+    size_t refreshed;
+    OK_OR_RET(chif_net_cache_refresh(cache, 16, &refreshed));
+    ALF_CHECK_TRUE(state, refreshed == 1);
+    OK_OR_RET(lookup(cache, "flaky", ip));
+    ALF_CHECK_STREQ(state, ip, "10.0.0.4");
+
+    // and is tried again once it has been looked up
+    fake.result = CHIF_NET_RESULT_SUCCESS;
+    fake.ip = "10.0.0.7";
+    OK_OR_RET(chif_net_cache_refresh(cache, 16, &refreshed));
+    ALF_CHECK_TRUE(state, refreshed == 1);
+    OK_OR_RET(lookup(cache, "flaky", ip));
+    ALF_CHECK_STREQ(state, ip, "10.0.0.7");
+  }
+
+  { // past the stale window
+    cache->stale_s = 0;
+    OK_OR_RET(insert(cache, "old", "10.0.0.5", 0));
+    fake.result = CHIF_NET_RESULT_SUCCESS;
+    fake.ip = "10.0.0.6";
+    OK_OR_RET(lookup(cache, "old", ip));
+    ALF_CHECK_STREQ(state, ip, "10.0.0.6");
+  }
+
+  { // the any address is never cached
+    const int calls = fake.calls;
+    OK_OR_RET(lookup(cache, CHIF_NET_ANY_ADDRESS, ip));
+    OK_OR_RET(lookup(cache, CHIF_NET_ANY_ADDRESS, ip));
+    ALF_CHECK_TRUE(state, fake.calls == calls + 2);
+  }
+
+  OK_OR_RET(chif_net_cache_clear(cache));
+  fake.calls = 0;
+  OK_OR_RET(lookup(cache, "host.example", ip));
+  ALF_CHECK_TRUE(state, fake.calls == 1);
+
+  OK_OR_RET(chif_net_cache_destroy(cache));
+  free(cache);
+}
+
+// ============================================================ //
+// Threads
+// ============================================================ //
+
+enum
+{
+  cache_thread_count = 4,
+  cache_name_count = 8,
+  cache_lookups = 20000
+};
+
+typedef struct
+{
+  chif_net_cache* cache;
+  uint32_t seed;
+  int errors;
+} cache_thread_data;
+
+/**
+ * Resolves "host<n>" to 10.0.0.<n>, safe to call from any thread.
+ */
+static chif_net_result
+name_resolve(void* user_data,
+             chif_net_address* address_out,
+             const char* name,
+             const char* service,
+             chif_net_transport_protocol transport_protocol,
+             chif_net_address_family address_family,
+             uint32_t* ttl_s_out)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(user_data);
+  char ip[CHIF_NET_IPV4_STRING_LENGTH];
+  snprintf(ip, sizeof(ip), "10.0.0.%s", name + 4);
+  *ttl_s_out = 60;
+  return chif_net_create_address(
+    address_out, ip, service, transport_protocol, address_family);
+}
+
+static uint32_t
+cache_thread(void* argument)
+{
+  cache_thread_data* data = (cache_thread_data*)argument;
+  uint32_t x = data->seed;
+  for (int i = 0; i < cache_lookups; ++i) {
+    x = x * 1664525u + 1013904223u;
+    const int n = (int)((x >> 16) % cache_name_count);
+    char name[16];
+    char expected[CHIF_NET_IPV4_STRING_LENGTH];
+    snprintf(name, sizeof(name), "host%d", n);
+    snprintf(expected, sizeof(expected), "10.0.0.%d", n);
+
+    char ip[CHIF_NET_IPV4_STRING_LENGTH];
+    if (lookup(data->cache, name, ip) || strcmp(ip, expected) != 0) {
+      ++data->errors;
+    }
+    if (i % 1000 == 0) {
+      insert(data->cache, name, expected, (uint32_t)(x & 1));
+    }
+  }
+  return 0;
+}
+
+void
+cache_threads(AlfTestState* state)
+{
+  chif_net_cache* cache = malloc(sizeof(chif_net_cache));
+  OK_OR_RET(chif_net_cache_init(cache));
+  cache->resolve = name_resolve;
+
+  cache_thread_data data[cache_thread_count];
+  AlfThread* threads[cache_thread_count];
+  for (int i = 0; i < cache_thread_count; ++i) {
+    data[i] = (cache_thread_data){ .cache = cache, .seed = (uint32_t)i + 1 };
+    threads[i] = alfCreateThread(cache_thread, &data[i]);
+  }
+  for (int i = 0; i < cache_thread_count; ++i) {
+    alfJoinThread(threads[i]);
+    ALF_CHECK_TRUE(state, data[i].errors == 0);
+  }
+
+  OK_OR_RET(chif_net_cache_destroy(cache));
+  free(cache);
+}
@@ -0,0 +1,401 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <chif_net_filter.h>
+#include <stdlib.h>
+#include <string.h>
+
+static chif_net_filter_action
+match(const chif_net_filter* filter, const char* ip)
+{
+  chif_net_address address;
+  const chif_net_address_family af = strchr(ip, ':')
+                                       ? CHIF_NET_ADDRESS_FAMILY_IPV6
+                                       : CHIF_NET_ADDRESS_FAMILY_IPV4;
+  if (chif_net_create_address_i(
+        &address, ip, 0, CHIF_NET_TRANSPORT_PROTOCOL_UDP, af)) {
+    return (chif_net_filter_action)-1;
+  }
+  return chif_net_filter_match(filter, &address);
+}
+
+static chif_net_result
+open_udp(chif_net_socket* socket_out,
+         const char* ip,
+         chif_net_address* address_out)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  chif_net_result res =
+    chif_net_open_socket(socket_out, CHIF_NET_TRANSPORT_PROTOCOL_UDP, af);
+  if (!res) {
+    res = chif_net_create_address_i(address_out,
+                                    ip,
+                                    CHIF_NET_ANY_PORT,
+                                    CHIF_NET_TRANSPORT_PROTOCOL_UDP,
+                                    af);
+  }
+  if (!res) {
+    res = chif_net_bind(*socket_out, address_out);
+  }
+  if (!res) {
+    res = chif_net_address_from_socket(*socket_out, address_out);
+  }
+  return res;
+}
+
+void
+filter_match(AlfTestState* state)
+{
+  const chif_net_filter_action allow = CHIF_NET_FILTER_ACTION_ALLOW;
+  const chif_net_filter_action deny = CHIF_NET_FILTER_ACTION_DENY;
+  const char* cidrs[] = { "10.1.2.0/24",      "10.0.0.0/8",
+                          "10.1.2.128/25",    "10.1.2.200",
+                          "192.168.0.0/12",   "2001:db8::/32",
+                          "2001:db8:1::/48",  "2001:db8:1:2::1/127",
+                          "::ffff:8.8.8.0/120" };
+  const chif_net_filter_action actions[] = { allow, deny,  deny,
+                                             allow, deny,  deny,
+                                             allow, deny,  deny };
+  enum
+  {
+    rule_count = sizeof(cidrs) / sizeof(cidrs[0])
+  };
+  chif_net_filter_rule rules[rule_count];
+  for (size_t i = 0; i < rule_count; ++i) {
+    OK_OR_RET(
+      chif_net_filter_rule_from_string(&rules[i], cidrs[i], actions[i]));
+  }
+
+  chif_net_filter filter;
+  OK_OR_RET(chif_net_filter_init(&filter, rules, rule_count, allow));
+  ALF_CHECK_TRUE(state, match(&filter, "10.200.0.1") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "10.1.2.1") == allow);
+  ALF_CHECK_TRUE(state, match(&filter, "10.1.2.127") == allow);
+  ALF_CHECK_TRUE(state, match(&filter, "10.1.2.128") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "10.1.2.200") == allow);
+  ALF_CHECK_TRUE(state, match(&filter, "10.1.2.201") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "11.0.0.1") == allow);
+  // the host bits of a rule are ignored, 192.168.0.0/12 is 192.160.0.0/12
+  ALF_CHECK_TRUE(state, match(&filter, "192.175.255.255") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "192.176.0.0") == allow);
+  ALF_CHECK_TRUE(state, match(&filter, "8.8.8.8") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "8.8.9.8") == allow);
+
+  ALF_CHECK_TRUE(state, match(&filter, "2001:db8:ffff::1") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "2001:db8:1:3::1") == allow);
+  ALF_CHECK_TRUE(state, match(&filter, "2001:db8:1:2::") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "2001:db8:1:2::1") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "2001:db8:1:2::2") == allow);
+  ALF_CHECK_TRUE(state, match(&filter, "2001:db9::1") == allow);
+  // a dual-stack socket sees IPv4 peers as IPv4-mapped addresses
+  ALF_CHECK_TRUE(state, match(&filter, "::ffff:10.9.9.9") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "::ffff:10.1.2.9") == allow);
+  chif_net_filter_destroy(&filter);
+
+  // deny everything, except one network
+  OK_OR_RET(chif_net_filter_rule_from_string(&rules[0], "0.0.0.0/0", deny));
+  OK_OR_RET(
+    chif_net_filter_rule_from_string(&rules[1], "127.0.0.0/8", allow));
+  OK_OR_RET(chif_net_filter_init(&filter, rules, 2, allow));
+  ALF_CHECK_TRUE(state, match(&filter, "1.2.3.4") == deny);
+  ALF_CHECK_TRUE(state, match(&filter, "127.0.0.1") == allow);
+  ALF_CHECK_TRUE(state, match(&filter, "::1") == allow);
+  chif_net_filter_destroy(&filter);
+
+  const char* invalid[] = { "10.0.0.0/33", "::/129",     "10.0.0.0/",
+                            "10.0.0.0/8x", "localhost",  "10.0.0",
+                            "",            "1.2.3.4/-1", "1:2:3:4:5:6:7:8:9" };
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+    ALF_CHECK_TRUE(state,
+                   chif_net_filter_rule_from_string(
+                     &rules[0], invalid[i], deny) ==
+                     CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  }
+  rules[0].prefix_length = 40;
+  rules[0].address.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  ALF_CHECK_TRUE(state,
+                 chif_net_filter_init(&filter, rules, 1, allow) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  rules[0].prefix_length = 8;
+  rules[0].address.address_family = CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED;
+  ALF_CHECK_TRUE(state,
+                 chif_net_filter_init(&filter, rules, 1, allow) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+}
+
+void
+filter_large(AlfTestState* state)
+{
+  // compare against a linear scan, with many overlapping prefixes
+  enum
+  {
+    rule_count = 100000,
+    probe_count = 1000
+  };
+  chif_net_filter_rule* rules = malloc(rule_count * sizeof(*rules));
+  uint32_t* prefixes = malloc(rule_count * sizeof(uint32_t));
+  if (!rules || !prefixes) {
+    ALF_CHECK_TRUE(state, 0);
+    return;
+  }
+
+  srand(1234);
+  for (size_t i = 0; i < rule_count; ++i) {
+    const int lengths[] = { 8, 12, 16, 20, 24, 24, 24, 28, 32 };
+    const int prefix_length = lengths[rand() % 9];
+    // keep the addresses in a small range, so prefixes overlap
+    uint32_t address = 0x0a000000u | ((uint32_t)rand() << 4 & 0x00fffff0u);
+    address &= prefix_length ? ~0u << (32 - prefix_length) : 0;
+    prefixes[i] = address;
+
+    chif_net_ipv4_address* ipv4 = (chif_net_ipv4_address*)&rules[i].address;
+    ipv4->address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    ipv4->port = 0;
+    const uint8_t bytes[4] = { (uint8_t)(address >> 24),
+                               (uint8_t)(address >> 16),
+                               (uint8_t)(address >> 8),
+                               (uint8_t)address };
+    memcpy(&ipv4->address, bytes, sizeof(bytes));
+    rules[i].prefix_length = (uint8_t)prefix_length;
+    rules[i].action = (chif_net_filter_action)(rand() % 2);
+  }
+
+  chif_net_filter filter;
+  OK_OR_RET(chif_net_filter_init(
+    &filter, rules, rule_count, CHIF_NET_FILTER_ACTION_ALLOW));
+
+  int mismatches = 0;
+  for (int p = 0; p < probe_count; ++p) {
+    const uint32_t address =
+      0x0a000000u | ((uint32_t)rand() << 4 & 0x00ffffffu) | (p & 0xf);
+    int best_length = -1;
+    chif_net_filter_action expected = CHIF_NET_FILTER_ACTION_ALLOW;
+    for (size_t i = 0; i < rule_count; ++i) {
+      const int length = rules[i].prefix_length;
+      const uint32_t mask = length ? ~0u << (32 - length) : 0;
+      // the later rule wins a tie
+      if ((address & mask) == prefixes[i] && length >= best_length) {
+        best_length = length;
+        expected = rules[i].action;
+      }
+    }
+
+    chif_net_ipv4_address probe;
+    probe.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    const uint8_t bytes[4] = { (uint8_t)(address >> 24),
+                               (uint8_t)(address >> 16),
+                               (uint8_t)(address >> 8),
+                               (uint8_t)address };
+    memcpy(&probe.address, bytes, sizeof(bytes));
+    mismatches +=
+      chif_net_filter_match(&filter, (chif_net_address*)&probe) != expected;
+  }
+  ALF_CHECK_TRUE(state, mismatches == 0);
+
+  chif_net_filter_destroy(&filter);
+  free(prefixes);
+  free(rules);
+}
+
+void
+filter_large_ipv6(AlfTestState* state)
+{
+  // compare against a linear scan, with prefixes of every length nested in
+  // a small range
+  enum
+  {
+    rule_count = 20000,
+    probe_count = 1000
+  };
+  chif_net_filter_rule* rules = malloc(rule_count * sizeof(*rules));
+  if (!rules) {
+    ALF_CHECK_TRUE(state, 0);
+    return;
+  }
+
+  srand(4321);
+  for (size_t i = 0; i < rule_count; ++i) {
+    const int prefix_length = 32 + rand() % 97;
+    chif_net_ipv6_address* ipv6 = (chif_net_ipv6_address*)&rules[i].address;
+    memset(ipv6, 0, sizeof(*ipv6));
+    ipv6->address_family = CHIF_NET_ADDRESS_FAMILY_IPV6;
+    uint8_t* bytes = (uint8_t*)ipv6->address;
+    bytes[0] = 0x20;
+    bytes[1] = 0x01;
+    // few values per byte, so prefixes overlap
+    for (int b = 2; b < 16; ++b) {
+      bytes[b] = (uint8_t)(rand() % 3);
+    }
+    for (int b = 0; b < 16; ++b) {
+      const int keep = prefix_length - b * 8;
+      bytes[b] &= keep >= 8 ? 0xff : keep <= 0 ? 0 : 0xff << (8 - keep);
+    }
+    rules[i].prefix_length = (uint8_t)prefix_length;
+    rules[i].action = (chif_net_filter_action)(rand() % 2);
+  }
+
+  chif_net_filter filter;
+  OK_OR_RET(chif_net_filter_init(
+    &filter, rules, rule_count, CHIF_NET_FILTER_ACTION_ALLOW));
+  // the IPv4 root table, and at most four slots per rule
+  ALF_CHECK_TRUE(state,
+                 chif_net_filter_memory_size(&filter) <=
+                   65536 * sizeof(uint32_t) +
+                     rule_count * 4 * sizeof(chif_net_filter_prefix) +
+                     129 * sizeof(chif_net_filter_table));
+
+  int mismatches = 0;
+  for (int p = 0; p < probe_count; ++p) {
+    chif_net_ipv6_address probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.address_family = CHIF_NET_ADDRESS_FAMILY_IPV6;
+    uint8_t* probe_bytes = (uint8_t*)probe.address;
+    probe_bytes[0] = 0x20;
+    probe_bytes[1] = 0x01;
+    for (int b = 2; b < 16; ++b) {
+      probe_bytes[b] = (uint8_t)(rand() % 3);
+    }
+
+    int best_length = -1;
+    chif_net_filter_action expected = CHIF_NET_FILTER_ACTION_ALLOW;
+    for (size_t i = 0; i < rule_count; ++i) {
+      const int length = rules[i].prefix_length;
+      const uint8_t* bytes =
+        (const uint8_t*)((chif_net_ipv6_address*)&rules[i].address)->address;
+      int matches = 1;
+      for (int b = 0; b < 16 && matches; ++b) {
+        const int keep = length - b * 8;
+        const uint8_t mask =
+          keep >= 8 ? 0xff : keep <= 0 ? 0 : (uint8_t)(0xff << (8 - keep));
+        matches = (probe_bytes[b] & mask) == bytes[b];
+      }
+      // the later rule wins a tie
+      if (matches && length >= best_length) {
+        best_length = length;
+        expected = rules[i].action;
+      }
+    }
+    mismatches +=
+      chif_net_filter_match(&filter, (chif_net_address*)&probe) != expected;
+  }
+  ALF_CHECK_TRUE(state, mismatches == 0);
+
+  chif_net_filter_destroy(&filter);
+  free(rules);
+}
+
+void
+filter_hooks(AlfTestState* state)
+{
+  chif_net_filter_rule rule;
+  OK_OR_RET(chif_net_filter_rule_from_string(
+    &rule, "127.0.0.2", CHIF_NET_FILTER_ACTION_DENY));
+  chif_net_filter* filter = malloc(sizeof(chif_net_filter));
+  OK_OR_RET(
+    chif_net_filter_init(filter, &rule, 1, CHIF_NET_FILTER_ACTION_ALLOW));
+  chif_net_filter_handle handle;
+  chif_net_filter_handle_init(&handle, NULL);
+  ALF_CHECK_TRUE(state, chif_net_filter_swap(&handle, filter) == NULL);
+  ALF_CHECK_TRUE(state, chif_net_filter_current(&handle) == filter);
+
+  { // datagrams from the denied address are dropped
+    chif_net_socket server;
+    chif_net_socket denied;
+    chif_net_socket allowed;
+    chif_net_address server_address;
+    chif_net_address address;
+    OK_OR_RET(open_udp(&server, "127.0.0.1", &server_address));
+    OK_OR_RET(open_udp(&denied, "127.0.0.2", &address));
+    OK_OR_RET(open_udp(&allowed, "127.0.0.1", &address));
+
+    uint8_t buf[8] = "denied";
+    int bytes;
+    OK_OR_RET(chif_net_writeto(denied, buf, 7, &bytes, &server_address));
+    memcpy(buf, "allowed", 8);
+    OK_OR_RET(chif_net_writeto(allowed, buf, 8, &bytes, &server_address));
+
+    memset(buf, 0, sizeof(buf));
+    address.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    OK_OR_RET(chif_net_filter_readfrom(
+      &handle, server, buf, sizeof(buf), &bytes, &address));
+    ALF_CHECK_TRUE(state, bytes == 8);
+    ALF_CHECK_STREQ(state, (char*)buf, "allowed");
+
+    chif_net_close_socket(&allowed);
+    chif_net_close_socket(&denied);
+    chif_net_close_socket(&server);
+  }
+
+  { // connections from the denied address are closed at accept
+    const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+    chif_net_socket listener;
+    chif_net_address listen_address;
+    OK_OR_RET(chif_net_open_socket(&listener, proto, af));
+    OK_OR_RET(chif_net_create_address_i(
+      &listen_address, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+    OK_OR_RET(chif_net_bind(listener, &listen_address));
+    OK_OR_RET(chif_net_address_from_socket(listener, &listen_address));
+    OK_OR_RET(chif_net_listen(listener, 8));
+
+    chif_net_socket clients[2];
+    const char* client_ips[] = { "127.0.0.2", "127.0.0.1" };
+    for (int i = 0; i < 2; ++i) {
+      chif_net_address address;
+      OK_OR_RET(chif_net_open_socket(&clients[i], proto, af));
+      OK_OR_RET(chif_net_create_address_i(
+        &address, client_ips[i], CHIF_NET_ANY_PORT, proto, af));
+      OK_OR_RET(chif_net_bind(clients[i], &address));
+      OK_OR_RET(chif_net_connect(clients[i], &listen_address));
+    }
+
+    chif_net_address client_address;
+    client_address.address_family = af;
+    chif_net_socket accepted;
+    OK_OR_RET(
+      chif_net_filter_accept(&handle, listener, &client_address, &accepted));
+    char ip[CHIF_NET_IPV4_STRING_LENGTH];
+    OK_OR_RET(chif_net_ip_from_address(&client_address, ip, sizeof(ip)));
+    ALF_CHECK_STREQ(state, ip, "127.0.0.1");
+
+    // the denied client sees its connection closed
+    uint8_t buf[1];
+    int bytes = -1;
+    const chif_net_result read_res =
+      chif_net_read(clients[0], buf, sizeof(buf), &bytes);
+    ALF_CHECK_TRUE(state, read_res || bytes == 0);
+
+    chif_net_close_socket(&accepted);
+    chif_net_close_socket(&clients[0]);
+    chif_net_close_socket(&clients[1]);
+    chif_net_close_socket(&listener);
+  }
+
+  ALF_CHECK_TRUE(state, chif_net_filter_swap(&handle, NULL) == filter);
+  chif_net_filter_destroy(filter);
+  free(filter);
+}
@@ -0,0 +1,266 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <chif_net_happy_eyeballs.h>
+
+// ============================================================ //
+// Servers that accept, refuse, or never answer
+// ============================================================ //
+
+typedef struct
+{
+  chif_net_socket socket;
+  chif_net_socket filler;
+  chif_net_address address;
+} test_server;
+
+/**
+ * @param listen_mode 0 to refuse connections, 1 to accept them, and 2 to
+ * fill the accept queue so connection attempts hang.
+ */
+static chif_net_result
+server_open(test_server* server,
+            const char* ip,
+            chif_net_address_family af,
+            int listen_mode)
+{
+  server->filler = CHIF_NET_INVALID_SOCKET;
+  chif_net_result res = chif_net_open_socket(
+    &server->socket, CHIF_NET_TRANSPORT_PROTOCOL_TCP, af);
+  if (res) {
+    return res;
+  }
+  res = chif_net_create_address_i(&server->address,
+                                  ip,
+                                  CHIF_NET_ANY_PORT,
+                                  CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                  af);
+  if (res) {
+    return res;
+  }
+  res = chif_net_bind(server->socket, &server->address);
+  if (res) {
+    return res;
+  }
+  res = chif_net_address_from_socket(server->socket, &server->address);
+  if (res || listen_mode == 0) {
+    return res;
+  }
+
+  res = chif_net_listen(server->socket, listen_mode == 1 ? 16 : 0);
+  if (res || listen_mode == 1) {
+    return res;
+  }
+  res = chif_net_open_socket(
+    &server->filler, CHIF_NET_TRANSPORT_PROTOCOL_TCP, af);
+  if (res) {
+    return res;
+  }
+  return chif_net_connect(server->filler, &server->address);
+}
+
+static void
+server_close(test_server* server)
+{
+  chif_net_close_socket(&server->filler);
+  chif_net_close_socket(&server->socket);
+}
+
+static chif_net_result
+race(chif_net_happy_eyeballs* happy_eyeballs,
+     chif_net_socket* socket_out,
+     chif_net_address* address_out)
+{
+  for (;;) {
+    chif_net_result res =
+      chif_net_happy_eyeballs_process(happy_eyeballs, socket_out, address_out);
+    if (res != CHIF_NET_RESULT_IN_PROGRESS) {
+      return res;
+    }
+    enum
+    {
+      capacity = CHIF_NET_HAPPY_EYEBALLS_MAX_ADDRESSES
+    };
+    chif_net_check checks[capacity];
+    size_t check_count;
+    res = chif_net_happy_eyeballs_fill_checks(
+      happy_eyeballs, checks, capacity, &check_count);
+    if (res) {
+      return res;
+    }
+    const int timeout_ms =
+      chif_net_happy_eyeballs_next_timeout_ms(happy_eyeballs);
+    int ready_count;
+    res = chif_net_poll(checks, check_count, &ready_count, timeout_ms);
+    if (res) {
+      return res;
+    }
+  }
+}
+
+static int
+same_port(const chif_net_address* a, const chif_net_address* b)
+{
+  chif_net_port port_a = 0;
+  chif_net_port port_b = 1;
+  chif_net_port_from_address(a, &port_a);
+  chif_net_port_from_address(b, &port_b);
+  return port_a == port_b;
+}
+
+// ============================================================ //
+// Tests
+// ============================================================ //
+
+void
+happy_eyeballs_fallback(AlfTestState* state)
+{
+  const chif_net_address_family ipv4 = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  test_server refusing;
+  test_server hanging;
+  test_server accepting;
+  OK_OR_RET(server_open(&refusing, "127.0.0.1", ipv4, 0));
+  OK_OR_RET(server_open(&hanging, "127.0.0.1", ipv4, 2));
+  OK_OR_RET(server_open(&accepting, "127.0.0.1", ipv4, 1));
+
+  { // a refused attempt moves on without waiting for the delay
+    const chif_net_address addresses[] = { refusing.address,
+                                           accepting.address };
+    chif_net_happy_eyeballs happy_eyeballs;
+    const uint64_t start = chif_net_time_ms();
+    OK_OR_RET(chif_net_happy_eyeballs_start(
+      &happy_eyeballs, addresses, 2, 5000, 5000));
+    chif_net_socket socket;
+    chif_net_address address;
+    OK_OR_RET(race(&happy_eyeballs, &socket, &address));
+    ALF_CHECK_TRUE(state, chif_net_time_ms() - start < 2500);
+    ALF_CHECK_TRUE(state, same_port(&address, &accepting.address));
+    chif_net_close_socket(&socket);
+  }
+
+  { // a hanging attempt is raced by the next one after the delay
+    const chif_net_address addresses[] = { hanging.address,
+                                           accepting.address };
+    chif_net_happy_eyeballs happy_eyeballs;
+    const uint64_t start = chif_net_time_ms();
+    OK_OR_RET(
+      chif_net_happy_eyeballs_start(&happy_eyeballs, addresses, 2, 50, 5000));
+    chif_net_socket socket;
+    chif_net_address address;
+    OK_OR_RET(race(&happy_eyeballs, &socket, &address));
+    const uint64_t elapsed = chif_net_time_ms() - start;
+    ALF_CHECK_TRUE(state, elapsed >= 50 && elapsed < 2500);
+    ALF_CHECK_TRUE(state, same_port(&address, &accepting.address));
+    ALF_CHECK_TRUE(state, happy_eyeballs.in_flight == 0);
+    chif_net_close_socket(&socket);
+  }
+
+  server_close(&refusing);
+  server_close(&hanging);
+  server_close(&accepting);
+}
+
+void
+happy_eyeballs_errors(AlfTestState* state)
+{
+  const chif_net_address_family ipv4 = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  test_server refusing;
+  test_server hanging;
+  OK_OR_RET(server_open(&refusing, "127.0.0.1", ipv4, 0));
+  OK_OR_RET(server_open(&hanging, "127.0.0.1", ipv4, 2));
+  chif_net_happy_eyeballs happy_eyeballs;
+  chif_net_socket socket;
+
+  const chif_net_address refused[] = { refusing.address, refusing.address };
+  OK_OR_RET(
+    chif_net_happy_eyeballs_start(&happy_eyeballs, refused, 2, 50, 5000));
+  ALF_CHECK_TRUE(state,
+                 race(&happy_eyeballs, &socket, NULL) ==
+                   CHIF_NET_RESULT_CONNECTION_REFUSED);
+
+  OK_OR_RET(chif_net_happy_eyeballs_start(
+    &happy_eyeballs, &hanging.address, 1, 50, 100));
+  ALF_CHECK_TRUE(state,
+                 race(&happy_eyeballs, &socket, NULL) ==
+                   CHIF_NET_RESULT_TIMEDOUT);
+  ALF_CHECK_TRUE(state, happy_eyeballs.in_flight == 0);
+
+  ALF_CHECK_TRUE(state,
+                 chif_net_happy_eyeballs_start(
+                   &happy_eyeballs, refused, 0, 50, 100) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+
+  server_close(&refusing);
+  server_close(&hanging);
+}
+
+void
+happy_eyeballs_interleave(AlfTestState* state)
+{
+  const chif_net_address_family ipv4 = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_address_family ipv6 = CHIF_NET_ADDRESS_FAMILY_IPV6;
+  chif_net_address addresses[5];
+  OK_OR_RET(chif_net_create_address_i(
+    &addresses[0], "::1", 1, CHIF_NET_TRANSPORT_PROTOCOL_TCP, ipv6));
+  OK_OR_RET(chif_net_create_address_i(
+    &addresses[1], "::1", 2, CHIF_NET_TRANSPORT_PROTOCOL_TCP, ipv6));
+  OK_OR_RET(chif_net_create_address_i(
+    &addresses[2], "::1", 3, CHIF_NET_TRANSPORT_PROTOCOL_TCP, ipv6));
+  OK_OR_RET(chif_net_create_address_i(
+    &addresses[3], "127.0.0.1", 4, CHIF_NET_TRANSPORT_PROTOCOL_TCP, ipv4));
+  OK_OR_RET(chif_net_create_address_i(
+    &addresses[4], "127.0.0.1", 5, CHIF_NET_TRANSPORT_PROTOCOL_TCP, ipv4));
+
+  chif_net_happy_eyeballs happy_eyeballs;
+  OK_OR_RET(
+    chif_net_happy_eyeballs_start(&happy_eyeballs, addresses, 5, 1000, 1000));
+  const chif_net_port expected[] = { 1, 4, 2, 5, 3 };
+  for (size_t i = 0; i < 5; ++i) {
+    chif_net_port port;
+    OK_OR_RET(
+      chif_net_port_from_address(&happy_eyeballs.addresses[i], &port));
+    ALF_CHECK_TRUE(state, port == expected[i]);
+  }
+  OK_OR_RET(chif_net_happy_eyeballs_cancel(&happy_eyeballs));
+
+  { // the blocking wrapper
+    test_server accepting;
+    OK_OR_RET(server_open(&accepting, "127.0.0.1", ipv4, 1));
+    chif_net_port port;
+    OK_OR_RET(chif_net_port_from_address(&accepting.address, &port));
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+
+    chif_net_socket socket;
+    chif_net_address address;
+    OK_OR_RET(chif_net_happy_eyeballs_connect(
+      &socket, &address, "localhost", service, 2000));
+    ALF_CHECK_TRUE(state, same_port(&address, &accepting.address));
+    chif_net_close_socket(&socket);
+    server_close(&accepting);
+  }
+}
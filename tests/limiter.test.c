@@ -0,0 +1,195 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <chif_net_limiter.h>
+#include <stdlib.h>
+#include <string.h>
+
+static chif_net_address
+make_address(const char* ip, const int port)
+{
+  chif_net_address address;
+  const chif_net_address_family af = strchr(ip, ':')
+                                       ? CHIF_NET_ADDRESS_FAMILY_IPV6
+                                       : CHIF_NET_ADDRESS_FAMILY_IPV4;
+  memset(&address, 0, sizeof(address));
+  chif_net_create_address_i(
+    &address, ip, (chif_net_port)port, CHIF_NET_TRANSPORT_PROTOCOL_UDP, af);
+  return address;
+}
+
+static int
+allow_count(chif_net_limiter* limiter,
+            const chif_net_address* address,
+            const int tries,
+            const uint64_t now_ms)
+{
+  int allowed = 0;
+  for (int i = 0; i < tries; ++i) {
+    allowed += chif_net_limiter_allow(limiter, address, 1, now_ms);
+  }
+  return allowed;
+}
+
+void
+limiter_rate(AlfTestState* state)
+{
+  chif_net_limiter* limiter = malloc(sizeof(chif_net_limiter));
+  ALF_CHECK_TRUE(state,
+                 chif_net_limiter_init(limiter, 10, 0) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  OK_OR_RET(chif_net_limiter_init(limiter, 10, 5));
+
+  const chif_net_address first = make_address("10.0.0.1", 1000);
+  const chif_net_address first_other_port = make_address("10.0.0.1", 2000);
+  const chif_net_address second = make_address("10.0.0.2", 1000);
+  uint64_t now = chif_net_time_ms();
+
+  // the burst, shared by every port of the address
+  ALF_CHECK_TRUE(state, allow_count(limiter, &first, 3, now) == 3);
+  ALF_CHECK_TRUE(state, allow_count(limiter, &first_other_port, 3, now) == 2);
+  ALF_CHECK_TRUE(state, allow_count(limiter, &second, 5, now) == 5);
+
+  // 10 per second is one per 100 ms
+  now += 100;
+  ALF_CHECK_TRUE(state, allow_count(limiter, &first, 3, now) == 1);
+  now += 250;
+  ALF_CHECK_TRUE(state, allow_count(limiter, &first, 3, now) == 2);
+  // a larger cost needs more tokens
+  now += 300;
+  ALF_CHECK_TRUE(state, !chif_net_limiter_allow(limiter, &first, 4, now));
+  ALF_CHECK_TRUE(state, chif_net_limiter_allow(limiter, &first, 3, now));
+
+  // idle sources fill up to the burst, not beyond it
+  now += 60000;
+  ALF_CHECK_TRUE(state, allow_count(limiter, &first, 10, now) == 5);
+
+  // IPv6 sources are limited per /64
+  const chif_net_address host = make_address("2001:db8:0:1::1", 1000);
+  const chif_net_address same_network = make_address("2001:db8:0:1::2", 1000);
+  const chif_net_address other_network = make_address("2001:db8:0:2::1", 1000);
+  ALF_CHECK_TRUE(state, allow_count(limiter, &host, 3, now) == 3);
+  ALF_CHECK_TRUE(state, allow_count(limiter, &same_network, 3, now) == 2);
+  ALF_CHECK_TRUE(state, allow_count(limiter, &other_network, 5, now) == 5);
+
+  free(limiter);
+}
+
+void
+limiter_flood(AlfTestState* state)
+{
+  chif_net_limiter* limiter = malloc(sizeof(chif_net_limiter));
+  OK_OR_RET(chif_net_limiter_init(limiter, 100, 20));
+  const chif_net_address heavy = make_address("192.0.2.1", 53);
+  const chif_net_address medium = make_address("2001:db8::53", 53);
+  const uint64_t now = chif_net_time_ms();
+
+  // many sources sending a packet each, like a spoofed flood, mixed with
+  // two heavy sources
+  enum
+  {
+    source_count = 2000
+  };
+  int light_allowed = 0;
+  int heavy_allowed = 0;
+  for (uint32_t i = 0; i < source_count; ++i) {
+    chif_net_ipv4_address light;
+    light.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    light.port = 0;
+    light.address = 0x0a000000u + i * 7919u;
+    light_allowed +=
+      chif_net_limiter_allow(limiter, (chif_net_address*)&light, 1, now);
+    heavy_allowed += allow_count(limiter, &heavy, 5, now);
+    if (i % 4 == 0) {
+      allow_count(limiter, &medium, 1, now);
+    }
+  }
+  ALF_CHECK_TRUE(state, heavy_allowed == 20);
+  ALF_CHECK_TRUE(state, light_allowed >= source_count * 99 / 100);
+
+  // the light sources never used enough of their burst to be tracked
+  chif_net_limiter_hitter top[4];
+  ALF_CHECK_TRUE(state, chif_net_limiter_top(limiter, top, 4) == 2);
+  chif_net_address address;
+  OK_OR_RET(chif_net_address_from_key(&top[0].key, &address));
+  char str[CHIF_NET_ADDRESS_STRING_LENGTH];
+  OK_OR_RET(chif_net_address_to_string(&address, str, sizeof(str), NULL));
+  ALF_CHECK_STREQ(state, str, "192.0.2.1:0");
+  ALF_CHECK_TRUE(state, top[0].count >= source_count * 5 - 20);
+  ALF_CHECK_TRUE(state, top[0].denied == source_count * 5 - 20);
+  OK_OR_RET(chif_net_address_from_key(&top[1].key, &address));
+  OK_OR_RET(chif_net_address_to_string(&address, str, sizeof(str), NULL));
+  ALF_CHECK_STREQ(state, str, "[2001:db8::]:0");
+  ALF_CHECK_TRUE(state, top[1].count <= source_count / 4);
+
+  chif_net_limiter_reset_top(limiter);
+  ALF_CHECK_TRUE(state, chif_net_limiter_top(limiter, top, 4) == 0);
+  free(limiter);
+}
+
+void
+limiter_hooks(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_UDP;
+  chif_net_limiter* limiter = malloc(sizeof(chif_net_limiter));
+  OK_OR_RET(chif_net_limiter_init(limiter, 0, 1));
+
+  chif_net_socket sockets[3];
+  chif_net_address addresses[3];
+  const char* ips[] = { "127.0.0.1", "127.0.0.2", "127.0.0.3" };
+  for (int i = 0; i < 3; ++i) {
+    OK_OR_RET(chif_net_open_socket(&sockets[i], proto, af));
+    OK_OR_RET(chif_net_create_address_i(
+      &addresses[i], ips[i], CHIF_NET_ANY_PORT, proto, af));
+    OK_OR_RET(chif_net_bind(sockets[i], &addresses[i]));
+    OK_OR_RET(chif_net_address_from_socket(sockets[i], &addresses[i]));
+  }
+
+  // the second datagram from 127.0.0.2 is over the limit
+  uint8_t buf[2] = { 0, 0 };
+  int bytes;
+  for (uint8_t i = 0; i < 3; ++i) {
+    buf[0] = i;
+    OK_OR_RET(chif_net_writeto(
+      sockets[i == 2 ? 2 : 1], buf, 1, &bytes, &addresses[0]));
+  }
+
+  chif_net_address from;
+  from.address_family = af;
+  OK_OR_RET(chif_net_limiter_readfrom(
+    limiter, sockets[0], buf, sizeof(buf), &bytes, &from));
+  ALF_CHECK_TRUE(state, bytes == 1 && buf[0] == 0);
+  OK_OR_RET(chif_net_limiter_readfrom(
+    limiter, sockets[0], buf, sizeof(buf), &bytes, &from));
+  ALF_CHECK_TRUE(state, bytes == 1 && buf[0] == 2);
+
+  for (int i = 0; i < 3; ++i) {
+    chif_net_close_socket(&sockets[i]);
+  }
+  free(limiter);
+}
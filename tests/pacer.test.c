@@ -0,0 +1,161 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <chif_net_pacer.h>
+
+void
+pacer_schedule(AlfTestState* state)
+{
+  chif_net_pacer pacer;
+  ALF_CHECK_TRUE(state,
+                 chif_net_pacer_init(&pacer, 0, 1000) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  ALF_CHECK_TRUE(state,
+                 chif_net_pacer_init(&pacer, 1000, 0) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+
+  // 1000 bytes per ms, with a burst of three datagrams
+  OK_OR_RET(chif_net_pacer_init(&pacer, 1000000, 3000));
+  const uint64_t ms = 1000000;
+  const uint64_t now = 1000 * ms;
+  ALF_CHECK_TRUE(state, chif_net_pacer_schedule(&pacer, 1000, now) == now);
+  ALF_CHECK_TRUE(state, chif_net_pacer_schedule(&pacer, 1000, now) == now);
+  ALF_CHECK_TRUE(state, chif_net_pacer_schedule(&pacer, 1000, now) == now);
+  ALF_CHECK_TRUE(state,
+                 chif_net_pacer_schedule(&pacer, 1000, now) == now + ms);
+  ALF_CHECK_TRUE(state,
+                 chif_net_pacer_schedule(&pacer, 500, now) == now + 3 * ms / 2);
+
+  // sending at the rate keeps the datagrams one interval apart
+  ALF_CHECK_TRUE(
+    state,
+    chif_net_pacer_schedule(&pacer, 1000, now + 2 * ms) == now + 5 * ms / 2);
+
+  // idle time builds up credit, but no more than the burst
+  const uint64_t later = now + 100 * ms;
+  for (int i = 0; i < 3; ++i) {
+    ALF_CHECK_TRUE(state,
+                   chif_net_pacer_schedule(&pacer, 1000, later) == later);
+  }
+  ALF_CHECK_TRUE(state,
+                 chif_net_pacer_schedule(&pacer, 1000, later) == later + ms);
+}
+
+void
+pacer_writeto(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_UDP;
+  chif_net_socket receiver;
+  OK_OR_RET(chif_net_open_socket(&receiver, proto, af));
+  chif_net_address address;
+  OK_OR_RET(chif_net_create_address_i(
+    &address, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+  OK_OR_RET(chif_net_bind(receiver, &address));
+  OK_OR_RET(chif_net_address_from_socket(receiver, &address));
+  chif_net_socket sender;
+  OK_OR_RET(chif_net_open_socket(&sender, proto, af));
+
+  enum
+  {
+    datagram_count = 11,
+    datagram_size = 1000
+  };
+  uint8_t buf[datagram_size] = { 0 };
+
+  // one datagram per 5 ms
+  chif_net_pacer pacer;
+  OK_OR_RET(chif_net_pacer_init(&pacer, 200000, datagram_size));
+  const uint64_t start = chif_net_time_ns();
+  for (int i = 0; i < datagram_count; ++i) {
+    int bytes;
+    OK_OR_RET(chif_net_pacer_writeto(
+      &pacer, sender, buf, datagram_size, &bytes, &address));
+    ALF_CHECK_TRUE(state, bytes == datagram_size);
+  }
+  const uint64_t elapsed_ms = (chif_net_time_ns() - start) / 1000000;
+  ALF_CHECK_TRUE(state, elapsed_ms >= 49);
+  ALF_CHECK_TRUE(state, elapsed_ms < 500);
+
+  for (int i = 0; i < datagram_count; ++i) {
+    int can_read;
+    OK_OR_RET(chif_net_can_read(receiver, &can_read, 1000));
+    ALF_CHECK_TRUE(state, can_read);
+    int bytes;
+    OK_OR_RET(chif_net_read(receiver, buf, datagram_size, &bytes));
+  }
+
+  chif_net_close_socket(&sender);
+  chif_net_close_socket(&receiver);
+}
+
+void
+pacer_txtime(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_UDP;
+  chif_net_socket receiver;
+  OK_OR_RET(chif_net_open_socket(&receiver, proto, af));
+  chif_net_address address;
+  OK_OR_RET(chif_net_create_address_i(
+    &address, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+  OK_OR_RET(chif_net_bind(receiver, &address));
+  OK_OR_RET(chif_net_address_from_socket(receiver, &address));
+  chif_net_socket sender;
+  OK_OR_RET(chif_net_open_socket(&sender, proto, af));
+
+  const chif_net_result pacing =
+    chif_net_set_max_pacing_rate(sender, 1000000);
+  if (pacing == CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED) {
+    chif_net_close_socket(&sender);
+    chif_net_close_socket(&receiver);
+    return;
+  }
+  OK_OR_RET(pacing);
+  OK_OR_RET(chif_net_set_max_pacing_rate(sender, UINT64_MAX));
+  OK_OR_RET(chif_net_set_txtime(sender, CHIF_NET_TXTIME_CLOCK_MONOTONIC));
+  ALF_CHECK_TRUE(state,
+                 chif_net_txtime_now_ns(CHIF_NET_TXTIME_CLOCK_TAI) >
+                   chif_net_txtime_now_ns(CHIF_NET_TXTIME_CLOCK_MONOTONIC));
+
+  // loopback has no fq or etf qdisc, the datagram is sent at once
+  const uint8_t buf[4] = { 1, 2, 3, 4 };
+  int bytes;
+  chif_net_pacer pacer;
+  OK_OR_RET(chif_net_pacer_init(&pacer, 1000000, sizeof(buf)));
+  const uint64_t launch_ns =
+    chif_net_pacer_schedule(&pacer, sizeof(buf), chif_net_time_ns());
+  OK_OR_RET(chif_net_writeto_at(
+    sender, buf, sizeof(buf), &bytes, &address, launch_ns));
+  ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+  int can_read;
+  OK_OR_RET(chif_net_can_read(receiver, &can_read, 1000));
+  ALF_CHECK_TRUE(state, can_read);
+
+  chif_net_close_socket(&sender);
+  chif_net_close_socket(&receiver);
+}
@@ -225,3 +225,78 @@ poll_test(AlfTestState* state)
   /* char portstr[portstrlen]; */
   /* snprintf(portstr, portstrlen, "%d%c", args->port, '\0'); */
 }
+
+void
+poll_spin(AlfTestState* state)
+{
+  chif_net_socket socka;
+  OK_OR_RET(chif_net_open_socket(
+    &socka, CHIF_NET_TRANSPORT_PROTOCOL_UDP, CHIF_NET_ADDRESS_FAMILY_IPV4));
+  chif_net_socket sockb;
+  OK_OR_RET(chif_net_open_socket(
+    &sockb, CHIF_NET_TRANSPORT_PROTOCOL_UDP, CHIF_NET_ADDRESS_FAMILY_IPV4));
+
+  chif_net_address addr;
+  OK_OR_RET(chif_net_create_address_i(&addr,
+                                      "127.0.0.1",
+                                      CHIF_NET_ANY_PORT,
+                                      CHIF_NET_TRANSPORT_PROTOCOL_UDP,
+                                      CHIF_NET_ADDRESS_FAMILY_IPV4));
+  OK_OR_RET(chif_net_bind(socka, &addr));
+  addr.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  OK_OR_RET(chif_net_address_from_socket(socka, &addr));
+
+  // may be refused without CAP_NET_ADMIN, the spin works anyway
+  chif_net_set_busy_poll(socka, 50);
+
+  chif_net_check check;
+  check.socket = socka;
+  check.request_events = CHIF_NET_CHECK_EVENT_READ;
+  check.return_events = 0;
+  chif_net_spin_stats stats = { 0, 0, 0, 0 };
+  int ready_count;
+
+  { // nothing arrives, spins the whole budget, then blocks until timeout
+    const uint64_t start = chif_net_time_ms();
+    OK_OR_RET(
+      chif_net_poll_spin(&check, 1, &ready_count, 2000, 20, &stats));
+    ALF_CHECK_TRUE(state, ready_count == 0);
+    ALF_CHECK_TRUE(state, chif_net_time_ms() - start >= 19);
+    ALF_CHECK_TRUE(state, stats.polls == 1);
+    ALF_CHECK_TRUE(state, stats.spin_hits == 0);
+    ALF_CHECK_TRUE(state, stats.blocks == 1);
+    ALF_CHECK_TRUE(state, stats.spin_ns >= 2000000);
+  }
+
+  { // a spin budget past the timeout only spins until the timeout
+    const uint64_t start = chif_net_time_ms();
+    OK_OR_RET(
+      chif_net_poll_spin(&check, 1, &ready_count, 500000, 20, &stats));
+    const uint64_t elapsed_ms = chif_net_time_ms() - start;
+    ALF_CHECK_TRUE(state, ready_count == 0);
+    ALF_CHECK_TRUE(state, elapsed_ms >= 19 && elapsed_ms < 250);
+    ALF_CHECK_TRUE(state, stats.polls == 2);
+    ALF_CHECK_TRUE(state, stats.blocks == 1);
+  }
+
+  { // a waiting datagram is found while spinning
+    const uint8_t buf[4] = { 1, 2, 3, 4 };
+    int bytes;
+    OK_OR_RET(chif_net_writeto(sockb, buf, sizeof(buf), &bytes, &addr));
+    OK_OR_RET(
+      chif_net_poll_spin(&check, 1, &ready_count, 100000, 1000, &stats));
+    ALF_CHECK_TRUE(state, ready_count == 1);
+    ALF_CHECK_TRUE(state, check.return_events & CHIF_NET_CHECK_EVENT_READ);
+    ALF_CHECK_TRUE(state, stats.polls == 3);
+    ALF_CHECK_TRUE(state, stats.spin_hits == 1);
+    ALF_CHECK_TRUE(state, stats.blocks == 1);
+  }
+
+  { // without a spin budget it is a plain poll
+    OK_OR_RET(chif_net_poll_spin(&check, 1, &ready_count, 0, 0, NULL));
+    ALF_CHECK_TRUE(state, ready_count == 1);
+  }
+
+  OK_OR_RET(chif_net_close_socket(&socka));
+  OK_OR_RET(chif_net_close_socket(&sockb));
+}
@@ -0,0 +1,112 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <chif_net_profile.h>
+#include <string.h>
+
+void
+profile_option(AlfTestState* state)
+{
+  chif_net_socket socket;
+  OK_OR_RET(chif_net_open_socket(
+    &socket, CHIF_NET_TRANSPORT_PROTOCOL_TCP, CHIF_NET_ADDRESS_FAMILY_IPV4));
+
+  int value;
+  OK_OR_RET(chif_net_set_option(socket, CHIF_NET_OPTION_TCP_NODELAY, 1));
+  OK_OR_RET(chif_net_get_option(socket, CHIF_NET_OPTION_TCP_NODELAY, &value));
+  ALF_CHECK_TRUE(state, value == 1);
+  OK_OR_RET(chif_net_set_option(socket, CHIF_NET_OPTION_TCP_NODELAY, 0));
+  OK_OR_RET(chif_net_get_option(socket, CHIF_NET_OPTION_TCP_NODELAY, &value));
+  ALF_CHECK_TRUE(state, value == 0);
+
+  OK_OR_RET(chif_net_set_option(socket, CHIF_NET_OPTION_RECV_BUFFER, 8192));
+  OK_OR_RET(chif_net_get_option(socket, CHIF_NET_OPTION_RECV_BUFFER, &value));
+  ALF_CHECK_TRUE(state, value >= 8192);
+
+  ALF_CHECK_TRUE(state,
+                 chif_net_set_option(socket, CHIF_NET_OPTION_COUNT, 1) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  ALF_CHECK_STREQ(
+    state, chif_net_option_to_string(CHIF_NET_OPTION_KEEPALIVE), "KEEPALIVE");
+
+  OK_OR_RET(chif_net_close_socket(&socket));
+}
+
+void
+profile_apply(AlfTestState* state)
+{
+  ALF_CHECK_TRUE(state,
+                 chif_net_profile_find("bulk") == &chif_net_profile_bulk);
+  ALF_CHECK_TRUE(state, chif_net_profile_find("fast") == NULL);
+
+  const chif_net_profile* profiles[] = { &chif_net_profile_low_latency,
+                                         &chif_net_profile_bulk,
+                                         &chif_net_profile_idle };
+  for (size_t p = 0; p < sizeof(profiles) / sizeof(profiles[0]); ++p) {
+    chif_net_socket socket;
+    OK_OR_RET(chif_net_open_socket(&socket,
+                                   CHIF_NET_TRANSPORT_PROTOCOL_TCP,
+                                   CHIF_NET_ADDRESS_FAMILY_IPV4));
+
+    chif_net_profile_report reports[16];
+    ALF_CHECK_TRUE(state, profiles[p]->setting_count <= 16);
+    size_t not_granted_count;
+    OK_OR_RET(chif_net_profile_apply(
+      socket, profiles[p], reports, &not_granted_count));
+#if defined(__linux__)
+    // linux has every option of the profiles
+    ALF_CHECK_TRUE(state, not_granted_count == 0);
+#endif
+    for (size_t i = 0; i < profiles[p]->setting_count; ++i) {
+      ALF_CHECK_TRUE(state,
+                     reports[i].option == profiles[p]->settings[i].option);
+      ALF_CHECK_TRUE(state,
+                     reports[i].requested == profiles[p]->settings[i].value);
+      ALF_CHECK_TRUE(state, reports[i].granted || reports[i].result);
+    }
+
+    OK_OR_RET(chif_net_close_socket(&socket));
+  }
+
+  chif_net_profile_report report;
+  report.option = CHIF_NET_OPTION_SEND_BUFFER;
+  report.requested = 4096;
+  report.effective = 8192;
+  report.result = CHIF_NET_RESULT_SUCCESS;
+  report.granted = CHIF_NET_TRUE;
+  char str[CHIF_NET_PROFILE_REPORT_STRING_LENGTH];
+  OK_OR_RET(chif_net_profile_report_to_string(&report, str, sizeof(str)));
+  ALF_CHECK_STREQ(
+    state, str, "SEND_BUFFER requested 4096 effective 8192 granted");
+  report.granted = CHIF_NET_FALSE;
+  OK_OR_RET(chif_net_profile_report_to_string(&report, str, sizeof(str)));
+  ALF_CHECK_STREQ(
+    state, str, "SEND_BUFFER requested 4096 effective 8192 not granted");
+  ALF_CHECK_TRUE(state,
+                 chif_net_profile_report_to_string(&report, str, 8) ==
+                   CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+}
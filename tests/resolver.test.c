@@ -0,0 +1,466 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <chif_net_resolver.h>
+#include <string.h>
+
+// ============================================================ //
+// A stub name server, driven from the test itself
+// ============================================================ //
+
+typedef struct
+{
+  chif_net_socket udp;
+  chif_net_socket tcp;
+  chif_net_address address;
+} stub_server;
+
+typedef struct
+{
+  int done;
+  chif_net_result result;
+  chif_net_address addresses[CHIF_NET_RESOLVER_MAX_ADDRESSES];
+  size_t address_count;
+  uint32_t ttl;
+} answer;
+
+static void
+on_answer(void* user_data,
+          chif_net_result result,
+          const chif_net_address* addresses,
+          size_t address_count,
+          uint32_t ttl)
+{
+  answer* a = (answer*)user_data;
+  a->done = 1;
+  a->result = result;
+  a->address_count = address_count;
+  a->ttl = ttl;
+  memcpy(a->addresses, addresses, address_count * sizeof(chif_net_address));
+}
+
+static chif_net_result
+stub_open(stub_server* stub)
+{
+  chif_net_result res = chif_net_open_socket(
+    &stub->udp, CHIF_NET_TRANSPORT_PROTOCOL_UDP, CHIF_NET_ADDRESS_FAMILY_IPV4);
+  if (res) {
+    return res;
+  }
+  chif_net_create_address_i(&stub->address,
+                            "127.0.0.1",
+                            CHIF_NET_ANY_PORT,
+                            CHIF_NET_TRANSPORT_PROTOCOL_UDP,
+                            CHIF_NET_ADDRESS_FAMILY_IPV4);
+  res = chif_net_bind(stub->udp, &stub->address);
+  if (res) {
+    return res;
+  }
+  res = chif_net_address_from_socket(stub->udp, &stub->address);
+  if (res) {
+    return res;
+  }
+
+  res = chif_net_open_socket(
+    &stub->tcp, CHIF_NET_TRANSPORT_PROTOCOL_TCP, CHIF_NET_ADDRESS_FAMILY_IPV4);
+  if (res) {
+    return res;
+  }
+  chif_net_set_reuse_addr(stub->tcp, CHIF_NET_TRUE);
+  res = chif_net_bind(stub->tcp, &stub->address);
+  if (res) {
+    return res;
+  }
+  return chif_net_listen(stub->tcp, CHIF_NET_DEFAULT_BACKLOG);
+}
+
+static void
+stub_close(stub_server* stub)
+{
+  chif_net_close_socket(&stub->udp);
+  chif_net_close_socket(&stub->tcp);
+}
+
+static chif_net_result
+stub_read_query(stub_server* stub,
+                uint8_t* buf,
+                size_t bufsize,
+                int* size_out,
+                chif_net_address* from_out)
+{
+  int can_read = 0;
+  const chif_net_result res = chif_net_can_read(stub->udp, &can_read, 1000);
+  if (res) {
+    return res;
+  }
+  if (!can_read) {
+    return CHIF_NET_RESULT_TIMEDOUT;
+  }
+  from_out->address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  return chif_net_readfrom(stub->udp, buf, bufsize, size_out, from_out);
+}
+
+static uint16_t
+query_type(const uint8_t* query, int size)
+{
+  return (uint16_t)((query[size - 4] << 8) | query[size - 3]);
+}
+
+/**
+ * Start an answer by echoing the query, with the given flags and counts.
+ */
+static size_t
+answer_begin(uint8_t* out,
+             const uint8_t* query,
+             int query_size,
+             uint16_t flags,
+             uint16_t answer_count,
+             uint16_t authority_count)
+{
+  memcpy(out, query, (size_t)query_size);
+  flags |= 0x8180;
+  out[2] = (uint8_t)(flags >> 8);
+  out[3] = (uint8_t)flags;
+  out[6] = (uint8_t)(answer_count >> 8);
+  out[7] = (uint8_t)answer_count;
+  out[8] = (uint8_t)(authority_count >> 8);
+  out[9] = (uint8_t)authority_count;
+  return (size_t)query_size;
+}
+
+/**
+ * Append a record, owned by the queried name.
+ */
+static size_t
+answer_record(uint8_t* out,
+              size_t offset,
+              uint16_t type,
+              uint32_t ttl,
+              const uint8_t* rdata,
+              uint16_t rdata_size)
+{
+  uint8_t* p = out + offset;
+  const uint8_t header[12] = { 0xc0,
+                               0x0c,
+                               (uint8_t)(type >> 8),
+                               (uint8_t)type,
+                               0,
+                               1,
+                               (uint8_t)(ttl >> 24),
+                               (uint8_t)(ttl >> 16),
+                               (uint8_t)(ttl >> 8),
+                               (uint8_t)ttl,
+                               (uint8_t)(rdata_size >> 8),
+                               (uint8_t)rdata_size };
+  memcpy(p, header, sizeof(header));
+  memcpy(p + sizeof(header), rdata, rdata_size);
+  return offset + sizeof(header) + rdata_size;
+}
+
+static chif_net_result
+run_until_done(chif_net_resolver* resolver, const answer* a)
+{
+  const uint64_t end = chif_net_time_ms() + 2000;
+  while (!a->done && chif_net_time_ms() < end) {
+    chif_net_check checks[CHIF_NET_RESOLVER_MAX_CHECKS];
+    size_t check_count;
+    chif_net_result res = chif_net_resolver_fill_checks(
+      resolver, checks, CHIF_NET_RESOLVER_MAX_CHECKS, &check_count);
+    if (res) {
+      return res;
+    }
+    int timeout_ms = chif_net_resolver_next_timeout_ms(resolver);
+    if (timeout_ms < 0 || timeout_ms > 10) {
+      timeout_ms = 10;
+    }
+    int ready_count;
+    res = chif_net_poll(checks, check_count, &ready_count, timeout_ms);
+    if (res) {
+      return res;
+    }
+    res = chif_net_resolver_process(resolver);
+    if (res) {
+      return res;
+    }
+  }
+  return a->done ? CHIF_NET_RESULT_SUCCESS : CHIF_NET_RESULT_TIMEDOUT;
+}
+
+static void
+check_ip(AlfTestState* state,
+         const chif_net_address* address,
+         const char* expected_ip,
+         chif_net_port expected_port)
+{
+  char ip[CHIF_NET_IPVX_STRING_LENGTH];
+  OK_OR_RET(chif_net_ip_from_address(address, ip, sizeof(ip)));
+  ALF_CHECK_STREQ(state, ip, expected_ip);
+  chif_net_port port;
+  OK_OR_RET(chif_net_port_from_address(address, &port));
+  ALF_CHECK_TRUE(state, port == expected_port);
+}
+
+static chif_net_resolver resolver;
+
+// ============================================================ //
+// Tests
+// ============================================================ //
+
+void
+resolver_udp(AlfTestState* state)
+{
+  stub_server stub;
+  OK_OR_RET(stub_open(&stub));
+  OK_OR_RET(chif_net_resolver_init(&resolver, &stub.address));
+
+  answer a4 = { 0 };
+  answer a6 = { 0 };
+  OK_OR_RET(chif_net_resolver_resolve(&resolver,
+                                      "example.com",
+                                      80,
+                                      CHIF_NET_ADDRESS_FAMILY_IPV4,
+                                      on_answer,
+                                      &a4));
+  OK_OR_RET(chif_net_resolver_resolve(&resolver,
+                                      "Example.org.",
+                                      443,
+                                      CHIF_NET_ADDRESS_FAMILY_IPV6,
+                                      on_answer,
+                                      &a6));
+
+  // both queries are in flight, answer them in reverse order
+  uint8_t query4[512];
+  uint8_t query6[512];
+  int size4;
+  int size6;
+  chif_net_address from;
+  OK_OR_RET(stub_read_query(&stub, query4, sizeof(query4), &size4, &from));
+  OK_OR_RET(stub_read_query(&stub, query6, sizeof(query6), &size6, &from));
+  if (query_type(query4, size4) != 1) {
+    uint8_t tmp[512];
+    memcpy(tmp, query4, sizeof(tmp));
+    memcpy(query4, query6, sizeof(tmp));
+    memcpy(query6, tmp, sizeof(tmp));
+    const int tmp_size = size4;
+    size4 = size6;
+    size6 = tmp_size;
+  }
+  ALF_CHECK_TRUE(state, query_type(query4, size4) == 1);
+  ALF_CHECK_TRUE(state, query_type(query6, size6) == 28);
+
+  uint8_t out[512];
+  { // an answer with the wrong id is ignored
+    size_t size = answer_begin(out, query6, size6, 0, 0, 0);
+    out[1] ^= 1;
+    OK_OR_RET(chif_net_writeto(stub.udp, out, size, NULL, &from));
+  }
+
+  { // a CNAME with a shorter ttl than the address
+    size_t size = answer_begin(out, query6, size6, 0, 2, 0);
+    const uint8_t cname[] = { 0xc0, 0x0c };
+    const uint8_t ipv6[16] = { 0x20, 0x01, 0x0d, 0xb8, [15] = 1 };
+    size = answer_record(out, size, 5, 30, cname, sizeof(cname));
+    size = answer_record(out, size, 28, 300, ipv6, sizeof(ipv6));
+    OK_OR_RET(chif_net_writeto(stub.udp, out, size, NULL, &from));
+  }
+  OK_OR_RET(run_until_done(&resolver, &a6));
+  ALF_CHECK_TRUE(state, !a4.done);
+  ALF_CHECK_TRUE(state, a6.result == CHIF_NET_RESULT_SUCCESS);
+  ALF_CHECK_TRUE(state, a6.address_count == 1);
+  ALF_CHECK_TRUE(state, a6.ttl == 30);
+  check_ip(state, &a6.addresses[0], "2001:db8::1", 443);
+
+  {
+    size_t size = answer_begin(out, query4, size4, 0, 2, 0);
+    const uint8_t ip_a[4] = { 10, 0, 0, 1 };
+    const uint8_t ip_b[4] = { 10, 0, 0, 2 };
+    size = answer_record(out, size, 1, 60, ip_a, sizeof(ip_a));
+    size = answer_record(out, size, 1, 90, ip_b, sizeof(ip_b));
+    OK_OR_RET(chif_net_writeto(stub.udp, out, size, NULL, &from));
+  }
+  OK_OR_RET(run_until_done(&resolver, &a4));
+  ALF_CHECK_TRUE(state, a4.result == CHIF_NET_RESULT_SUCCESS);
+  ALF_CHECK_TRUE(state, a4.address_count == 2);
+  ALF_CHECK_TRUE(state, a4.ttl == 60);
+  check_ip(state, &a4.addresses[0], "10.0.0.1", 80);
+  check_ip(state, &a4.addresses[1], "10.0.0.2", 80);
+  ALF_CHECK_TRUE(state, chif_net_resolver_next_timeout_ms(&resolver) == -1);
+
+  OK_OR_RET(chif_net_resolver_destroy(&resolver));
+  stub_close(&stub);
+}
+
+void
+resolver_tcp_fallback(AlfTestState* state)
+{
+  stub_server stub;
+  OK_OR_RET(stub_open(&stub));
+  OK_OR_RET(chif_net_resolver_init(&resolver, &stub.address));
+
+  answer a = { 0 };
+  OK_OR_RET(chif_net_resolver_resolve(&resolver,
+                                      "big.example.com",
+                                      53,
+                                      CHIF_NET_ADDRESS_FAMILY_IPV4,
+                                      on_answer,
+                                      &a));
+
+  uint8_t query[512];
+  int query_size;
+  chif_net_address from;
+  OK_OR_RET(stub_read_query(&stub, query, sizeof(query), &query_size, &from));
+
+  uint8_t out[512];
+  size_t size = answer_begin(out + 2, query, query_size, 0x0200, 0, 0);
+  OK_OR_RET(chif_net_writeto(stub.udp, out + 2, size, NULL, &from));
+
+  // reads the truncated answer and connects
+  OK_OR_RET(chif_net_resolver_process(&resolver));
+  ALF_CHECK_TRUE(state, !a.done);
+
+  chif_net_socket client;
+  chif_net_address client_address;
+  client_address.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  OK_OR_RET(chif_net_accept(stub.tcp, &client_address, &client));
+
+  // sends the query over tcp
+  int can_read = 0;
+  for (int i = 0; i < 100 && !can_read; ++i) {
+    OK_OR_RET(chif_net_resolver_process(&resolver));
+    OK_OR_RET(chif_net_can_read(client, &can_read, 10));
+  }
+  uint8_t tcp_query[512];
+  int read_bytes;
+  OK_OR_RET(chif_net_read(client, tcp_query, sizeof(tcp_query), &read_bytes));
+  ALF_CHECK_TRUE(state, read_bytes == query_size + 2);
+  ALF_CHECK_TRUE(state, tcp_query[0] == 0 && tcp_query[1] == query_size);
+
+  size = answer_begin(out + 2, query, query_size, 0, 3, 0);
+  for (uint8_t i = 1; i <= 3; ++i) {
+    const uint8_t ip[4] = { 192, 168, 0, i };
+    size = answer_record(out + 2, size, 1, 600, ip, sizeof(ip));
+  }
+  out[0] = (uint8_t)(size >> 8);
+  out[1] = (uint8_t)size;
+  // split in two writes, the resolver must put it together
+  OK_OR_RET(chif_net_write(client, out, 7, NULL));
+  OK_OR_RET(chif_net_resolver_process(&resolver));
+  OK_OR_RET(chif_net_write(client, out + 7, size + 2 - 7, NULL));
+
+  OK_OR_RET(run_until_done(&resolver, &a));
+  ALF_CHECK_TRUE(state, a.result == CHIF_NET_RESULT_SUCCESS);
+  ALF_CHECK_TRUE(state, a.address_count == 3);
+  ALF_CHECK_TRUE(state, a.ttl == 600);
+  check_ip(state, &a.addresses[2], "192.168.0.3", 53);
+
+  chif_net_close_socket(&client);
+  OK_OR_RET(chif_net_resolver_destroy(&resolver));
+  stub_close(&stub);
+}
+
+void
+resolver_errors(AlfTestState* state)
+{
+  stub_server stub;
+  OK_OR_RET(stub_open(&stub));
+  OK_OR_RET(chif_net_resolver_init(&resolver, &stub.address));
+  resolver.timeout_ms = 20;
+  resolver.attempts = 2;
+
+  answer a = { 0 };
+  ALF_CHECK_TRUE(state,
+                 chif_net_resolver_resolve(&resolver,
+                                           "a..b",
+                                           80,
+                                           CHIF_NET_ADDRESS_FAMILY_IPV4,
+                                           on_answer,
+                                           &a) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+
+  { // missing name, cached for the SOA minimum
+    OK_OR_RET(chif_net_resolver_resolve(&resolver,
+                                        "missing.example.com",
+                                        80,
+                                        CHIF_NET_ADDRESS_FAMILY_IPV4,
+                                        on_answer,
+                                        &a));
+    uint8_t query[512];
+    int query_size;
+    chif_net_address from;
+    OK_OR_RET(
+      stub_read_query(&stub, query, sizeof(query), &query_size, &from));
+
+    uint8_t out[512];
+    size_t size = answer_begin(out, query, query_size, 3, 0, 1);
+    const uint8_t soa[22] = { 0, 0, [21] = 120 };
+    size = answer_record(out, size, 6, 3600, soa, sizeof(soa));
+    OK_OR_RET(chif_net_writeto(stub.udp, out, size, NULL, &from));
+
+    OK_OR_RET(run_until_done(&resolver, &a));
+    ALF_CHECK_TRUE(state, a.result == CHIF_NET_RESLUT_NO_NAME);
+    ALF_CHECK_TRUE(state, a.address_count == 0);
+    ALF_CHECK_TRUE(state, a.ttl == 120);
+  }
+
+  { // no answer, the query is sent once per attempt
+    memset(&a, 0, sizeof(a));
+    OK_OR_RET(chif_net_resolver_resolve(&resolver,
+                                        "slow.example.com",
+                                        80,
+                                        CHIF_NET_ADDRESS_FAMILY_IPV6,
+                                        on_answer,
+                                        &a));
+    OK_OR_RET(run_until_done(&resolver, &a));
+    ALF_CHECK_TRUE(state, a.result == CHIF_NET_RESULT_TIMEDOUT);
+
+    uint8_t query[512];
+    int query_size;
+    chif_net_address from;
+    OK_OR_RET(
+      stub_read_query(&stub, query, sizeof(query), &query_size, &from));
+    OK_OR_RET(
+      stub_read_query(&stub, query, sizeof(query), &query_size, &from));
+    int can_read = 1;
+    OK_OR_RET(chif_net_can_read(stub.udp, &can_read, 0));
+    ALF_CHECK_TRUE(state, !can_read);
+  }
+
+  { // destroyed while in flight
+    memset(&a, 0, sizeof(a));
+    OK_OR_RET(chif_net_resolver_resolve(&resolver,
+                                        "example.com",
+                                        80,
+                                        CHIF_NET_ADDRESS_FAMILY_IPV4,
+                                        on_answer,
+                                        &a));
+    OK_OR_RET(chif_net_resolver_destroy(&resolver));
+    ALF_CHECK_TRUE(state, a.done);
+    ALF_CHECK_TRUE(state, a.result == CHIF_NET_RESULT_BLOCKING_CANCELED);
+  }
+
+  stub_close(&stub);
+}
@@ -0,0 +1,208 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <chif_net_session.h>
+#include <string.h>
+
+static void
+count_expired(void* user_data, chif_net_session* session)
+{
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(session);
+  ++*(int*)user_data;
+}
+
+void
+session_key(AlfTestState* state)
+{
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_UDP;
+  chif_net_address ipv4;
+  chif_net_address mapped;
+  chif_net_address ipv6;
+  OK_OR_RET(chif_net_create_address(
+    &ipv4, "10.1.2.3", "5000", proto, CHIF_NET_ADDRESS_FAMILY_IPV4));
+  OK_OR_RET(chif_net_create_address(&mapped,
+                                    "::ffff:10.1.2.3",
+                                    "5000",
+                                    proto,
+                                    CHIF_NET_ADDRESS_FAMILY_IPV6));
+  OK_OR_RET(chif_net_create_address(
+    &ipv6, "2001:db8::1", "5000", proto, CHIF_NET_ADDRESS_FAMILY_IPV6));
+
+  chif_net_address_key ipv4_key;
+  chif_net_address_key mapped_key;
+  chif_net_address_key ipv6_key;
+  OK_OR_RET(chif_net_address_key_from_address(&ipv4, &ipv4_key));
+  OK_OR_RET(chif_net_address_key_from_address(&mapped, &mapped_key));
+  OK_OR_RET(chif_net_address_key_from_address(&ipv6, &ipv6_key));
+
+  // the same peer gets the same key on an IPv4 and a dual-stack socket
+  ALF_CHECK_TRUE(state, chif_net_address_key_equal(&ipv4_key, &mapped_key));
+  ALF_CHECK_TRUE(state, memcmp(&ipv4_key, &mapped_key, sizeof(ipv4_key)) == 0);
+  ALF_CHECK_TRUE(state,
+                 chif_net_address_key_hash(&ipv4_key) ==
+                   chif_net_address_key_hash(&mapped_key));
+  ALF_CHECK_TRUE(state, !chif_net_address_key_equal(&ipv4_key, &ipv6_key));
+
+  chif_net_address_key other_port = ipv4_key;
+  other_port.port ^= 1;
+  ALF_CHECK_TRUE(state, !chif_net_address_key_equal(&ipv4_key, &other_port));
+  ALF_CHECK_TRUE(state,
+                 chif_net_address_key_hash(&ipv4_key) !=
+                   chif_net_address_key_hash(&other_port));
+
+  // IPv4 peers that only differ in the last address byte still spread over
+  // the low bits of the hash, which index the table
+  uint8_t seen[256] = { 0 };
+  int distinct = 0;
+  for (int i = 0; i < 256; ++i) {
+    chif_net_address_key peer = ipv4_key;
+    ((uint8_t*)&peer.address[3])[3] = (uint8_t)i;
+    const uint8_t bucket = (uint8_t)chif_net_address_key_hash(&peer);
+    distinct += !seen[bucket];
+    seen[bucket] = 1;
+  }
+  ALF_CHECK_TRUE(state, distinct >= 128);
+
+  char str[CHIF_NET_ADDRESS_STRING_LENGTH];
+  chif_net_address address;
+  OK_OR_RET(chif_net_address_from_key(&mapped_key, &address));
+  ALF_CHECK_TRUE(state,
+                 address.address_family == CHIF_NET_ADDRESS_FAMILY_IPV4);
+  OK_OR_RET(chif_net_address_to_string(&address, str, sizeof(str), NULL));
+  ALF_CHECK_STREQ(state, str, "10.1.2.3:5000");
+  OK_OR_RET(chif_net_address_from_key(&ipv6_key, &address));
+  OK_OR_RET(chif_net_address_to_string(&address, str, sizeof(str), NULL));
+  ALF_CHECK_STREQ(state, str, "[2001:db8::1]:5000");
+
+  address.address_family = CHIF_NET_ADDRESS_FAMILY_UNSPECIFIED;
+  ALF_CHECK_TRUE(state,
+                 chif_net_address_key_from_address(&address, &ipv4_key) ==
+                   CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY);
+}
+
+void
+session_table(AlfTestState* state)
+{
+  enum
+  {
+    capacity = 1024,
+    count = capacity - capacity / 8
+  };
+  static chif_net_session sessions[capacity];
+  chif_net_session_table table;
+  ALF_CHECK_TRUE(state,
+                 chif_net_session_table_init(&table, sessions, 1000, 100) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  OK_OR_RET(chif_net_session_table_init(&table, sessions, capacity, 100));
+
+  // fill the table to its limit with peers that only differ in port and the
+  // last address byte, the common case for a server
+  static chif_net_address_key keys[count + 1];
+  for (size_t i = 0; i <= count; ++i) {
+    chif_net_ipv4_address address;
+    address.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    address.port = (chif_net_port)(40000 + i / 4);
+    address.address = 0x0a000000u | (uint32_t)(i % 4);
+    OK_OR_RET(chif_net_address_key_from_address((chif_net_address*)&address,
+                                                &keys[i]));
+  }
+
+  uint64_t now = 1000;
+  for (size_t i = 0; i < count; ++i) {
+    chif_net_session* session;
+    OK_OR_RET(chif_net_session_table_insert(&table, &keys[i], now, &session));
+    ALF_CHECK_TRUE(state, session->user_data == NULL);
+    session->user_data = &keys[i];
+  }
+  ALF_CHECK_TRUE(state, table.count == count);
+  chif_net_session* session;
+  ALF_CHECK_TRUE(
+    state,
+    chif_net_session_table_insert(&table, &keys[count], now, &session) ==
+      CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+
+  int found = 0;
+  for (size_t i = 0; i < count; ++i) {
+    session = chif_net_session_table_find(&table, &keys[i], now);
+    found += session && session->user_data == &keys[i];
+  }
+  ALF_CHECK_TRUE(state, found == count);
+  ALF_CHECK_TRUE(state,
+                 chif_net_session_table_find(&table, &keys[count], now) ==
+                   NULL);
+
+  // remove every other session, the rest must stay reachable
+  for (size_t i = 0; i < count; i += 2) {
+    session = chif_net_session_table_find(&table, &keys[i], now);
+    OK_OR_RET(chif_net_session_table_remove(&table, session));
+  }
+  found = 0;
+  int removed_found = 0;
+  for (size_t i = 0; i < count; ++i) {
+    session = chif_net_session_table_find(&table, &keys[i], now);
+    if (i % 2 == 0) {
+      removed_found += session != NULL;
+    } else {
+      found += session && session->user_data == &keys[i];
+    }
+  }
+  ALF_CHECK_TRUE(state, removed_found == 0);
+  ALF_CHECK_TRUE(state, found == count / 2);
+
+  // sessions that are found stay alive, the others expire
+  now += 60;
+  for (size_t i = 1; i < count; i += 4) {
+    ALF_CHECK_TRUE(state,
+                   chif_net_session_table_find(&table, &keys[i], now) != NULL);
+  }
+  now += 60;
+  ALF_CHECK_TRUE(state,
+                 chif_net_session_table_find(&table, &keys[3], now) == NULL);
+
+  int expired = 0;
+  size_t swept = 0;
+  // in small steps, as a server loop would
+  for (int step = 0; step < capacity / 64; ++step) {
+    swept += chif_net_session_table_expire(
+      &table, now, 64, count_expired, &expired);
+  }
+  ALF_CHECK_TRUE(state, swept == (size_t)expired);
+  ALF_CHECK_TRUE(state, table.count == count / 4);
+  found = 0;
+  for (size_t i = 1; i < count; i += 4) {
+    session = chif_net_session_table_find(&table, &keys[i], now);
+    found += session && session->user_data == &keys[i];
+  }
+  ALF_CHECK_TRUE(state, found == count / 4);
+
+  now += 1000;
+  ALF_CHECK_TRUE(
+    state,
+    chif_net_session_table_expire(&table, now, capacity, NULL, NULL) ==
+      count / 4);
+  ALF_CHECK_TRUE(state, table.count == 0);
+}
@@ -0,0 +1,303 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// for memfd_create
+#define _GNU_SOURCE
+#endif
+
+#include "tests.h"
+#include "util.h"
+#include <alf_thread.h>
+#include <chif_net.h>
+#include <chif_net_shm.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+enum
+{
+  shm_ring_size = 4096,
+  shm_message_count = 100000
+};
+
+typedef struct
+{
+  chif_net_shm_channel* channel;
+  int errors;
+} shm_thread_data;
+
+/**
+ * Open both ends of a channel in this process.
+ *
+ * @return 0 if not supported on the platform.
+ */
+static int
+open_channel(AlfTestState* state,
+             chif_net_shm_channel* creator,
+             chif_net_shm_channel* peer)
+{
+  chif_net_socket pair[2];
+  const chif_net_result pair_result =
+    chif_net_open_socket_pair(CHIF_NET_TRANSPORT_PROTOCOL_TCP, pair);
+  if (pair_result == CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED) {
+    return 0;
+  }
+  ALF_CHECK_TRUE(state, pair_result == CHIF_NET_RESULT_SUCCESS);
+  const chif_net_result create_result =
+    chif_net_shm_create(creator, pair[0], shm_ring_size);
+  int supported = create_result != CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED;
+  if (supported) {
+    ALF_CHECK_TRUE(state, create_result == CHIF_NET_RESULT_SUCCESS);
+    ALF_CHECK_TRUE(state,
+                   chif_net_shm_accept(peer, pair[1]) ==
+                     CHIF_NET_RESULT_SUCCESS);
+  }
+  chif_net_close_socket(&pair[0]);
+  chif_net_close_socket(&pair[1]);
+  return supported;
+}
+
+void
+shm_messages(AlfTestState* state)
+{
+  chif_net_shm_channel creator;
+  chif_net_shm_channel peer;
+  if (!open_channel(state, &creator, &peer)) {
+    return;
+  }
+
+  // both directions, with sizes that make the messages wrap around the ring
+  uint8_t buf[shm_ring_size];
+  uint8_t read_buf[shm_ring_size];
+  int bytes;
+  int errors = 0;
+  for (int i = 0; i < 1000; ++i) {
+    const size_t size = (size_t)(i * 37) % 1000;
+    memset(buf, i, size);
+    chif_net_shm_channel* from = i % 2 ? &creator : &peer;
+    chif_net_shm_channel* to = i % 2 ? &peer : &creator;
+    if (chif_net_shm_write(from, buf, size, &bytes) || bytes != (int)size ||
+        chif_net_shm_read(to, read_buf, sizeof(read_buf), &bytes) ||
+        bytes != (int)size || memcmp(read_buf, buf, size) != 0) {
+      ++errors;
+    }
+  }
+  ALF_CHECK_TRUE(state, errors == 0);
+  ALF_CHECK_TRUE(state,
+                 chif_net_shm_read(&peer, read_buf, sizeof(read_buf), &bytes) ==
+                   CHIF_NET_RESULT_WOULD_BLOCK);
+
+  // fill the ring, the message that does not fit is not written at all
+  int written = 0;
+  chif_net_result res;
+  while ((res = chif_net_shm_write(&creator, buf, 100, &bytes)) ==
+         CHIF_NET_RESULT_SUCCESS) {
+    ++written;
+  }
+  ALF_CHECK_TRUE(state, res == CHIF_NET_RESULT_WOULD_BLOCK);
+  ALF_CHECK_TRUE(state, written == shm_ring_size / (8 + 104));
+  ALF_CHECK_TRUE(state,
+                 chif_net_shm_write(&creator, buf, shm_ring_size, &bytes) ==
+                   CHIF_NET_RESULT_TOO_LONG_MSG_NOT_SENT);
+
+  // a message that does not fit the buffer is kept
+  ALF_CHECK_TRUE(state,
+                 chif_net_shm_read(&peer, read_buf, 10, &bytes) ==
+                   CHIF_NET_RESULT_BUFSIZE_INVALID);
+  ALF_CHECK_TRUE(state, bytes == 100);
+  for (int i = 0; i < written; ++i) {
+    if (chif_net_shm_read(&peer, read_buf, sizeof(read_buf), &bytes)) {
+      ++errors;
+    }
+  }
+  ALF_CHECK_TRUE(state, errors == 0);
+  OK_OR_RET(chif_net_shm_write(&creator, buf, 100, &bytes));
+
+  ALF_CHECK_TRUE(state,
+                 chif_net_shm_create(&creator, CHIF_NET_INVALID_SOCKET, 5000) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+
+  chif_net_shm_close(&creator);
+  chif_net_shm_close(&peer);
+}
+
+static uint32_t
+shm_writer(void* argument)
+{
+  shm_thread_data* data = (shm_thread_data*)argument;
+  for (uint32_t i = 0; i < shm_message_count; ++i) {
+    chif_net_result res;
+    while ((res = chif_net_shm_write(
+              data->channel, (const uint8_t*)&i, sizeof(i), NULL)) ==
+           CHIF_NET_RESULT_WOULD_BLOCK) {
+      short events;
+      if (chif_net_shm_poll(
+            data->channel, CHIF_NET_CHECK_EVENT_WRITE, &events, 5000) ||
+          !events) {
+        ++data->errors;
+        return 1;
+      }
+    }
+    if (res) {
+      ++data->errors;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void
+shm_poll(AlfTestState* state)
+{
+  chif_net_shm_channel creator;
+  chif_net_shm_channel peer;
+  if (!open_channel(state, &creator, &peer)) {
+    return;
+  }
+
+  short events;
+  OK_OR_RET(chif_net_shm_poll(&peer, CHIF_NET_CHECK_EVENT_READ, &events, 10));
+  ALF_CHECK_TRUE(state, events == 0);
+  OK_OR_RET(chif_net_shm_poll(&peer, CHIF_NET_CHECK_EVENT_WRITE, &events, 0));
+  ALF_CHECK_TRUE(state, events == CHIF_NET_CHECK_EVENT_WRITE);
+
+  // the writer outpaces the reader and waits for room, and the other way
+  shm_thread_data data = { .channel = &creator, .errors = 0 };
+  AlfThread* thread = alfCreateThread(shm_writer, &data);
+  uint32_t expected = 0;
+  while (expected < shm_message_count) {
+    uint32_t value;
+    int bytes;
+    const chif_net_result read_result =
+      chif_net_shm_read(&peer, (uint8_t*)&value, sizeof(value), &bytes);
+    if (read_result == CHIF_NET_RESULT_WOULD_BLOCK) {
+      if (chif_net_shm_poll(
+            &peer, CHIF_NET_CHECK_EVENT_READ, &events, 5000) ||
+          !events) {
+        break;
+      }
+      continue;
+    }
+    if (read_result || value != expected) {
+      break;
+    }
+    ++expected;
+  }
+  alfJoinThread(thread);
+  ALF_CHECK_TRUE(state, expected == shm_message_count);
+  ALF_CHECK_TRUE(state, data.errors == 0);
+
+  { // a blocked write larger than half the ring waits until it fits
+    uint8_t buf[3000] = { 0 };
+    uint8_t read_buf[3000];
+    int bytes;
+    for (int i = 0; i < 4; ++i) {
+      OK_OR_RET(chif_net_shm_write(&creator, buf, 1000, &bytes));
+    }
+    ALF_CHECK_TRUE(state,
+                   chif_net_shm_write(&creator, buf, sizeof(buf), &bytes) ==
+                     CHIF_NET_RESULT_WOULD_BLOCK);
+    chif_net_check check;
+    ALF_CHECK_TRUE(
+      state,
+      chif_net_shm_fill_check(&creator, CHIF_NET_CHECK_EVENT_WRITE, &check) ==
+        0);
+
+    // half the ring free is not enough, and does not wake the writer
+    for (int i = 0; i < 2; ++i) {
+      OK_OR_RET(chif_net_shm_read(&peer, read_buf, sizeof(read_buf), &bytes));
+    }
+    int ready_count;
+    OK_OR_RET(chif_net_poll(&check, 1, &ready_count, 0));
+    ALF_CHECK_TRUE(state, ready_count == 0);
+    OK_OR_RET(
+      chif_net_shm_poll(&creator, CHIF_NET_CHECK_EVENT_WRITE, &events, 0));
+    ALF_CHECK_TRUE(state, events == 0);
+
+    OK_OR_RET(chif_net_shm_read(&peer, read_buf, sizeof(read_buf), &bytes));
+    OK_OR_RET(chif_net_poll(&check, 1, &ready_count, 0));
+    ALF_CHECK_TRUE(state, ready_count == 1);
+    OK_OR_RET(
+      chif_net_shm_poll(&creator, CHIF_NET_CHECK_EVENT_WRITE, &events, 0));
+    ALF_CHECK_TRUE(state, events == CHIF_NET_CHECK_EVENT_WRITE);
+    OK_OR_RET(chif_net_shm_write(&creator, buf, sizeof(buf), &bytes));
+  }
+
+  chif_net_shm_close(&creator);
+  chif_net_shm_close(&peer);
+}
+
+void
+shm_untrusted(AlfTestState* state)
+{
+#if defined(__linux__)
+  chif_net_socket pair[2];
+  OK_OR_RET(chif_net_open_socket_pair(CHIF_NET_TRANSPORT_PROTOCOL_TCP, pair));
+
+  // a handshake as chif_net_shm_create sends it, but with memory that the
+  // sender could still shrink under the mapping of the peer
+  struct
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ring_size;
+    uint8_t padding[48];
+  } header;
+  memset(&header, 0, sizeof(header));
+  header.magic = 0x73666863;
+  header.version = 1;
+  header.ring_size = shm_ring_size;
+  const int memory_fd = memfd_create("chif_net_shm_test", MFD_CLOEXEC);
+  ALF_CHECK_TRUE(state, memory_fd != -1);
+  ALF_CHECK_TRUE(state,
+                 ftruncate(memory_fd, 64 + 2 * (192 + shm_ring_size)) == 0);
+
+  const chif_net_socket sockets[4] = {
+    memory_fd, memory_fd, memory_fd, memory_fd
+  };
+  chif_net_shm_channel channel;
+  OK_OR_RET(chif_net_send_sockets(
+    pair[0], sockets, 3, (const uint8_t*)&header, sizeof(header), NULL));
+  ALF_CHECK_TRUE(state,
+                 chif_net_shm_accept(&channel, pair[1]) ==
+                   CHIF_NET_RESULT_FAIL);
+
+  // and with more sockets than a channel has
+  OK_OR_RET(chif_net_send_sockets(
+    pair[0], sockets, 4, (const uint8_t*)&header, sizeof(header), NULL));
+  ALF_CHECK_TRUE(state,
+                 chif_net_shm_accept(&channel, pair[1]) ==
+                   CHIF_NET_RESULT_FAIL);
+
+  close(memory_fd);
+  chif_net_close_socket(&pair[0]);
+  chif_net_close_socket(&pair[1]);
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(state);
+#endif
+}
@@ -22,11 +22,21 @@
  * SOFTWARE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// for sched_setaffinity
+#define _GNU_SOURCE
+#endif
+
 #include "tests.h"
 #include "util.h"
 #include <chif_net.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 void
 tcp_test(AlfTestState* state)
@@ -89,3 +99,356 @@ tcp_test(AlfTestState* state)
   /* chif_net_close_socket(&clisock); */
   chif_net_close_socket(&sock);
 }
+
+// ============================================================ //
+
+/**
+ * @param listen_mode 0 to refuse connections, 1 to accept them, and 2 to
+ * fill the accept queue so connection attempts hang.
+ */
+static chif_net_result
+open_server(chif_net_socket* socket_out,
+            chif_net_socket* filler_out,
+            chif_net_address* address_out,
+            const int listen_mode)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  *filler_out = CHIF_NET_INVALID_SOCKET;
+  chif_net_result res = chif_net_open_socket(socket_out, proto, af);
+  if (res) {
+    return res;
+  }
+  res = chif_net_create_address_i(
+    address_out, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af);
+  if (!res) {
+    res = chif_net_bind(*socket_out, address_out);
+  }
+  if (!res) {
+    res = chif_net_address_from_socket(*socket_out, address_out);
+  }
+  if (res || listen_mode == 0) {
+    return res;
+  }
+
+  res = chif_net_listen(*socket_out, listen_mode == 1 ? 128 : 0);
+  if (res || listen_mode == 1) {
+    return res;
+  }
+  res = chif_net_open_socket(filler_out, proto, af);
+  if (res) {
+    return res;
+  }
+  return chif_net_connect(*filler_out, address_out);
+}
+
+void
+tcp_connect_timeout(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  chif_net_socket servers[3];
+  chif_net_socket fillers[3];
+  chif_net_address addresses[3];
+  for (int i = 0; i < 3; ++i) {
+    OK_OR_RET(open_server(&servers[i], &fillers[i], &addresses[i], i));
+  }
+  const chif_net_address* refusing = &addresses[0];
+  const chif_net_address* accepting = &addresses[1];
+  const chif_net_address* hanging = &addresses[2];
+
+  chif_net_socket sock;
+  OK_OR_RET(chif_net_open_socket(&sock, proto, af));
+  OK_OR_RET(chif_net_connect_timeout(sock, accepting, 1000));
+  int can_write;
+  OK_OR_RET(chif_net_can_write(sock, &can_write, 0));
+  ALF_CHECK_TRUE(state, can_write);
+  chif_net_close_socket(&sock);
+
+  OK_OR_RET(chif_net_open_socket(&sock, proto, af));
+  ALF_CHECK_TRUE(state,
+                 chif_net_connect_timeout(sock, refusing, 1000) ==
+                   CHIF_NET_RESULT_CONNECTION_REFUSED);
+  chif_net_close_socket(&sock);
+
+  OK_OR_RET(chif_net_open_socket(&sock, proto, af));
+  const uint64_t start = chif_net_time_ms();
+  ALF_CHECK_TRUE(state,
+                 chif_net_connect_timeout(sock, hanging, 100) ==
+                   CHIF_NET_RESULT_TIMEDOUT);
+  const uint64_t elapsed = chif_net_time_ms() - start;
+  ALF_CHECK_TRUE(state, elapsed >= 100 && elapsed < 2000);
+  chif_net_close_socket(&sock);
+
+  { // the error of a failed connect is reported, not only that there is one
+    OK_OR_RET(chif_net_open_socket(&sock, proto, af));
+    const chif_net_result start_res = chif_net_connect_start(sock, refusing);
+    ALF_CHECK_TRUE(state,
+                   start_res == CHIF_NET_RESULT_IN_PROGRESS ||
+                     start_res == CHIF_NET_RESULT_CONNECTION_REFUSED);
+    if (start_res == CHIF_NET_RESULT_IN_PROGRESS) {
+      ALF_CHECK_TRUE(state,
+                     chif_net_has_error(sock, 1000) ==
+                       CHIF_NET_RESULT_CONNECTION_REFUSED);
+    }
+    chif_net_close_socket(&sock);
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    chif_net_close_socket(&fillers[i]);
+    chif_net_close_socket(&servers[i]);
+  }
+}
+
+void
+tcp_connect_many(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  chif_net_socket servers[2];
+  chif_net_socket fillers[2];
+  chif_net_address addresses[2];
+  // accepting first, so even sockets connect and odd are refused
+  OK_OR_RET(open_server(&servers[0], &fillers[0], &addresses[0], 1));
+  OK_OR_RET(open_server(&servers[1], &fillers[1], &addresses[1], 0));
+
+  enum
+  {
+    count = 64
+  };
+  chif_net_check checks[count];
+  chif_net_result results[count];
+  for (size_t i = 0; i < count; ++i) {
+    OK_OR_RET(chif_net_open_socket(&checks[i].socket, proto, af));
+  }
+  const chif_net_socket first_socket = checks[0].socket;
+
+  size_t connected_count;
+  OK_OR_RET(chif_net_connect_many(
+    checks, results, count, addresses, 2, 2000, &connected_count));
+  ALF_CHECK_TRUE(state, connected_count == count / 2);
+  ALF_CHECK_TRUE(state, checks[0].socket == first_socket);
+  for (size_t i = 0; i < count; ++i) {
+    ALF_CHECK_TRUE(state,
+                   results[i] == (i % 2 == 0
+                                    ? CHIF_NET_RESULT_SUCCESS
+                                    : CHIF_NET_RESULT_CONNECTION_REFUSED));
+    chif_net_close_socket(&checks[i].socket);
+  }
+
+  { // a socket that cannot start is left out of the poll, so waiting on a
+    // hanging connect sleeps instead of spinning
+    chif_net_socket hanging_server;
+    chif_net_socket hanging_filler;
+    chif_net_address hanging;
+    OK_OR_RET(open_server(&hanging_server, &hanging_filler, &hanging, 2));
+    chif_net_check hang_checks[2];
+    chif_net_result hang_results[2];
+    hang_checks[0].socket = CHIF_NET_INVALID_SOCKET;
+    OK_OR_RET(chif_net_open_socket(&hang_checks[1].socket, proto, af));
+
+    const clock_t cpu_start = clock();
+    const uint64_t start = chif_net_time_ms();
+    OK_OR_RET(chif_net_connect_many(
+      hang_checks, hang_results, 2, &hanging, 1, 200, &connected_count));
+    const uint64_t elapsed_ms = chif_net_time_ms() - start;
+    const uint64_t cpu_ms =
+      (uint64_t)(clock() - cpu_start) * 1000 / CLOCKS_PER_SEC;
+    ALF_CHECK_TRUE(state, connected_count == 0);
+    ALF_CHECK_TRUE(state, hang_results[0] != CHIF_NET_RESULT_SUCCESS);
+    ALF_CHECK_TRUE(state, hang_results[1] == CHIF_NET_RESULT_TIMEDOUT);
+    ALF_CHECK_TRUE(state, hang_checks[0].socket == CHIF_NET_INVALID_SOCKET);
+    ALF_CHECK_TRUE(state, elapsed_ms >= 200 && cpu_ms < elapsed_ms / 2);
+    chif_net_close_socket(&hang_checks[1].socket);
+    chif_net_close_socket(&hanging_filler);
+    chif_net_close_socket(&hanging_server);
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    chif_net_close_socket(&fillers[i]);
+    chif_net_close_socket(&servers[i]);
+  }
+}
+
+void
+tcp_cpu_steering(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  enum
+  {
+    group_size = 2
+  };
+  chif_net_socket servers[group_size];
+  chif_net_address address;
+  OK_OR_RET(chif_net_create_address_i(
+    &address, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+  for (int i = 0; i < group_size; ++i) {
+    OK_OR_RET(chif_net_open_socket(&servers[i], proto, af));
+    OK_OR_RET(chif_net_set_reuse_port(servers[i], CHIF_NET_TRUE));
+    OK_OR_RET(chif_net_bind(servers[i], &address));
+    OK_OR_RET(chif_net_address_from_socket(servers[i], &address));
+    OK_OR_RET(chif_net_listen(servers[i], CHIF_NET_DEFAULT_BACKLOG));
+  }
+
+  const chif_net_result steering =
+    chif_net_set_reuse_port_cpu_steering(servers[0], group_size);
+  if (steering == CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED) {
+    chif_net_close_socket(&servers[0]);
+    chif_net_close_socket(&servers[1]);
+    return;
+  }
+  OK_OR_RET(steering);
+  ALF_CHECK_TRUE(state,
+                 chif_net_set_reuse_port_cpu_steering(servers[0], 0) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+
+#if defined(__linux__)
+  // stay on one CPU, so that the listener is picked and the connection is
+  // accepted on the same CPU even if the scheduler would move the thread
+  cpu_set_t old_cpus;
+  const int pinned = sched_getaffinity(0, sizeof(old_cpus), &old_cpus) == 0;
+  if (pinned) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(sched_getcpu(), &cpus);
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+  }
+#endif
+
+  // every connection lands on the listener of the CPU that received it
+  for (int n = 0; n < 8; ++n) {
+    chif_net_socket client;
+    OK_OR_RET(chif_net_open_socket(&client, proto, af));
+    OK_OR_RET(chif_net_connect(client, &address));
+
+    chif_net_check checks[group_size];
+    for (int i = 0; i < group_size; ++i) {
+      checks[i].socket = servers[i];
+      checks[i].request_events = CHIF_NET_CHECK_EVENT_READ;
+      checks[i].return_events = 0;
+    }
+    int ready_count;
+    OK_OR_RET(chif_net_poll(checks, group_size, &ready_count, 1000));
+    ALF_CHECK_TRUE(state, ready_count == 1);
+    const int index = checks[0].return_events ? 0 : 1;
+
+    chif_net_address client_address;
+    client_address.address_family = af;
+    chif_net_socket accepted;
+    OK_OR_RET(chif_net_accept(servers[index], &client_address, &accepted));
+    int cpu;
+    OK_OR_RET(chif_net_get_incoming_cpu(accepted, &cpu));
+    ALF_CHECK_TRUE(state, cpu >= 0);
+    ALF_CHECK_TRUE(state, cpu % group_size == index);
+
+    chif_net_close_socket(&accepted);
+    chif_net_close_socket(&client);
+  }
+
+#if defined(__linux__)
+  if (pinned) {
+    sched_setaffinity(0, sizeof(old_cpus), &old_cpus);
+  }
+#endif
+  for (int i = 0; i < group_size; ++i) {
+    chif_net_close_socket(&servers[i]);
+  }
+}
+
+void
+tcp_fastopen(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  chif_net_socket server;
+  chif_net_socket filler;
+  chif_net_address address;
+  OK_OR_RET(open_server(&server, &filler, &address, 1));
+  const chif_net_result fastopen = chif_net_tcp_set_fastopen(server, 16);
+  ALF_CHECK_TRUE(state,
+                 !fastopen ||
+                   fastopen == CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED);
+
+  // with or without a cookie, and with fast open turned off by the sysctl,
+  // the data arrives
+  const char* messages[] = { "hello", "again", "fresh" };
+  for (int i = 0; i < 3; ++i) {
+    chif_net_socket client;
+    OK_OR_RET(chif_net_open_socket(&client, proto, af));
+    int bytes = 0;
+    if (i < 2) {
+      OK_OR_RET(chif_net_tcp_connect_with_data(
+        client, &address, (const uint8_t*)messages[i], 5, &bytes));
+    } else {
+      const chif_net_result connect_option =
+        chif_net_tcp_set_fastopen_connect(client, CHIF_NET_TRUE);
+      ALF_CHECK_TRUE(state,
+                     !connect_option ||
+                       connect_option ==
+                         CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED);
+      OK_OR_RET(chif_net_connect(client, &address));
+      OK_OR_RET(
+        chif_net_write(client, (const uint8_t*)messages[i], 5, &bytes));
+    }
+    ALF_CHECK_TRUE(state, bytes == 5);
+
+    chif_net_address client_address;
+    client_address.address_family = af;
+    chif_net_socket accepted;
+    OK_OR_RET(chif_net_accept(server, &client_address, &accepted));
+    char buf[8] = { 0 };
+    OK_OR_RET(chif_net_read(accepted, (uint8_t*)buf, 5, &bytes));
+    ALF_CHECK_TRUE(state, bytes == 5);
+    ALF_CHECK_STREQ(state, buf, messages[i]);
+
+    chif_net_close_socket(&accepted);
+    chif_net_close_socket(&client);
+  }
+
+  chif_net_close_socket(&server);
+}
+
+void
+tcp_defer_accept(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  chif_net_socket server;
+  chif_net_socket filler;
+  chif_net_address address;
+  OK_OR_RET(open_server(&server, &filler, &address, 1));
+  const chif_net_result defer = chif_net_tcp_set_defer_accept(server, 5);
+  if (defer == CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED) {
+    chif_net_close_socket(&server);
+    return;
+  }
+  OK_OR_RET(defer);
+
+  chif_net_socket client;
+  OK_OR_RET(chif_net_open_socket(&client, proto, af));
+  OK_OR_RET(chif_net_connect(client, &address));
+
+  // connected, but nothing to accept until the client has sent something
+  int can_read;
+  OK_OR_RET(chif_net_can_read(server, &can_read, 200));
+  ALF_CHECK_FALSE(state, can_read);
+
+  const uint8_t request[4] = { 'p', 'i', 'n', 'g' };
+  int bytes;
+  OK_OR_RET(chif_net_write(client, request, sizeof(request), &bytes));
+  OK_OR_RET(chif_net_can_read(server, &can_read, 1000));
+  ALF_CHECK_TRUE(state, can_read);
+
+  chif_net_address client_address;
+  client_address.address_family = af;
+  chif_net_socket accepted;
+  OK_OR_RET(chif_net_accept(server, &client_address, &accepted));
+  unsigned long available;
+  OK_OR_RET(chif_net_get_bytes_available(accepted, &available));
+  ALF_CHECK_TRUE(state, available == sizeof(request));
+
+  chif_net_close_socket(&accepted);
+  chif_net_close_socket(&client);
+  chif_net_close_socket(&server);
+}
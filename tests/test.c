@@ -36,7 +36,7 @@ main(void)
 
   enum
   {
-    suites_count = 4
+    suites_count = 16
   };
   AlfTestSuite* suites[suites_count];
 
@@ -58,10 +58,20 @@ main(void)
   // ============================================================ //
   enum
   {
-    tcp_tests_count = 1
+    tcp_tests_count = 6
   };
   AlfTest tcp_tests[tcp_tests_count];
   tcp_tests[0] = (AlfTest){ .name = "tcp", .TestFunction = tcp_test };
+  tcp_tests[1] =
+    (AlfTest){ .name = "connect_timeout", .TestFunction = tcp_connect_timeout };
+  tcp_tests[2] =
+    (AlfTest){ .name = "connect_many", .TestFunction = tcp_connect_many };
+  tcp_tests[3] =
+    (AlfTest){ .name = "cpu_steering", .TestFunction = tcp_cpu_steering };
+  tcp_tests[4] =
+    (AlfTest){ .name = "fastopen", .TestFunction = tcp_fastopen };
+  tcp_tests[5] =
+    (AlfTest){ .name = "defer_accept", .TestFunction = tcp_defer_accept };
   suites[1] = alfCreateTestSuite("tcp", tcp_tests, tcp_tests_count);
 
   // ============================================================ //
@@ -69,10 +79,11 @@ main(void)
   // ============================================================ //
   enum
   {
-    poll_tests_count = 1
+    poll_tests_count = 2
   };
   AlfTest poll_tests[poll_tests_count];
   poll_tests[0] = (AlfTest){ .name = "poll", .TestFunction = poll_test };
+  poll_tests[1] = (AlfTest){ .name = "spin", .TestFunction = poll_spin };
   suites[2] = alfCreateTestSuite("poll", poll_tests, poll_tests_count);
 
   // ============================================================ //
@@ -89,6 +100,191 @@ main(void)
   echo_tests[3] = (AlfTest){ .name = "udp & ipv6", .TestFunction = udp_ipv6 };
   suites[3] = alfCreateTestSuite("Echo", echo_tests, echo_tests_count);
 
+  // ============================================================ //
+  // address
+  // ============================================================ //
+  enum
+  {
+    address_tests_count = 3
+  };
+  AlfTest address_tests[address_tests_count];
+  address_tests[0] =
+    (AlfTest){ .name = "numeric", .TestFunction = address_numeric };
+  address_tests[1] =
+    (AlfTest){ .name = "format", .TestFunction = address_format };
+  address_tests[2] = (AlfTest){ .name = "all", .TestFunction = address_all };
+  suites[4] =
+    alfCreateTestSuite("address", address_tests, address_tests_count);
+
+  // ============================================================ //
+  // resolver
+  // ============================================================ //
+  enum
+  {
+    resolver_tests_count = 3
+  };
+  AlfTest resolver_tests[resolver_tests_count];
+  resolver_tests[0] =
+    (AlfTest){ .name = "udp", .TestFunction = resolver_udp };
+  resolver_tests[1] = (AlfTest){ .name = "tcp_fallback",
+                                 .TestFunction = resolver_tcp_fallback };
+  resolver_tests[2] =
+    (AlfTest){ .name = "errors", .TestFunction = resolver_errors };
+  suites[5] =
+    alfCreateTestSuite("resolver", resolver_tests, resolver_tests_count);
+
+  // ============================================================ //
+  // cache
+  // ============================================================ //
+  enum
+  {
+    cache_tests_count = 2
+  };
+  AlfTest cache_tests[cache_tests_count];
+  cache_tests[0] = (AlfTest){ .name = "ttl", .TestFunction = cache_ttl };
+  cache_tests[1] =
+    (AlfTest){ .name = "threads", .TestFunction = cache_threads };
+  suites[6] = alfCreateTestSuite("cache", cache_tests, cache_tests_count);
+
+  // ============================================================ //
+  // happy eyeballs
+  // ============================================================ //
+  enum
+  {
+    happy_eyeballs_tests_count = 3
+  };
+  AlfTest happy_eyeballs_tests[happy_eyeballs_tests_count];
+  happy_eyeballs_tests[0] =
+    (AlfTest){ .name = "fallback", .TestFunction = happy_eyeballs_fallback };
+  happy_eyeballs_tests[1] =
+    (AlfTest){ .name = "errors", .TestFunction = happy_eyeballs_errors };
+  happy_eyeballs_tests[2] = (AlfTest){
+    .name = "interleave", .TestFunction = happy_eyeballs_interleave
+  };
+  suites[7] = alfCreateTestSuite(
+    "happy eyeballs", happy_eyeballs_tests, happy_eyeballs_tests_count);
+
+  // ============================================================ //
+  // session
+  // ============================================================ //
+  enum
+  {
+    session_tests_count = 2
+  };
+  AlfTest session_tests[session_tests_count];
+  session_tests[0] = (AlfTest){ .name = "key", .TestFunction = session_key };
+  session_tests[1] =
+    (AlfTest){ .name = "table", .TestFunction = session_table };
+  suites[8] =
+    alfCreateTestSuite("session", session_tests, session_tests_count);
+
+  // ============================================================ //
+  // filter
+  // ============================================================ //
+  enum
+  {
+    filter_tests_count = 4
+  };
+  AlfTest filter_tests[filter_tests_count];
+  filter_tests[0] = (AlfTest){ .name = "match", .TestFunction = filter_match };
+  filter_tests[1] = (AlfTest){ .name = "large", .TestFunction = filter_large };
+  filter_tests[2] =
+    (AlfTest){ .name = "large_ipv6", .TestFunction = filter_large_ipv6 };
+  filter_tests[3] = (AlfTest){ .name = "hooks", .TestFunction = filter_hooks };
+  suites[9] = alfCreateTestSuite("filter", filter_tests, filter_tests_count);
+
+  // ============================================================ //
+  // limiter
+  // ============================================================ //
+  enum
+  {
+    limiter_tests_count = 3
+  };
+  AlfTest limiter_tests[limiter_tests_count];
+  limiter_tests[0] = (AlfTest){ .name = "rate", .TestFunction = limiter_rate };
+  limiter_tests[1] =
+    (AlfTest){ .name = "flood", .TestFunction = limiter_flood };
+  limiter_tests[2] =
+    (AlfTest){ .name = "hooks", .TestFunction = limiter_hooks };
+  suites[10] =
+    alfCreateTestSuite("limiter", limiter_tests, limiter_tests_count);
+
+  // ============================================================ //
+  // profile
+  // ============================================================ //
+  enum
+  {
+    profile_tests_count = 2
+  };
+  AlfTest profile_tests[profile_tests_count];
+  profile_tests[0] =
+    (AlfTest){ .name = "option", .TestFunction = profile_option };
+  profile_tests[1] =
+    (AlfTest){ .name = "apply", .TestFunction = profile_apply };
+  suites[11] =
+    alfCreateTestSuite("profile", profile_tests, profile_tests_count);
+
+  // ============================================================ //
+  // pacer
+  // ============================================================ //
+  enum
+  {
+    pacer_tests_count = 3
+  };
+  AlfTest pacer_tests[pacer_tests_count];
+  pacer_tests[0] =
+    (AlfTest){ .name = "schedule", .TestFunction = pacer_schedule };
+  pacer_tests[1] =
+    (AlfTest){ .name = "writeto", .TestFunction = pacer_writeto };
+  pacer_tests[2] = (AlfTest){ .name = "txtime", .TestFunction = pacer_txtime };
+  suites[12] = alfCreateTestSuite("pacer", pacer_tests, pacer_tests_count);
+
+  // ============================================================ //
+  // timestamp
+  // ============================================================ //
+  enum
+  {
+    timestamp_tests_count = 2
+  };
+  AlfTest timestamp_tests[timestamp_tests_count];
+  timestamp_tests[0] =
+    (AlfTest){ .name = "udp", .TestFunction = timestamp_udp };
+  timestamp_tests[1] =
+    (AlfTest){ .name = "tcp", .TestFunction = timestamp_tcp };
+  suites[13] =
+    alfCreateTestSuite("timestamp", timestamp_tests, timestamp_tests_count);
+
+  // ============================================================ //
+  // unix
+  // ============================================================ //
+  enum
+  {
+    unix_tests_count = 4
+  };
+  AlfTest unix_tests[unix_tests_count];
+  unix_tests[0] = (AlfTest){ .name = "stream", .TestFunction = unix_stream };
+  unix_tests[1] =
+    (AlfTest){ .name = "datagram", .TestFunction = unix_datagram };
+  unix_tests[2] = (AlfTest){ .name = "pair", .TestFunction = unix_pair };
+  unix_tests[3] =
+    (AlfTest){ .name = "pass_sockets", .TestFunction = unix_pass_sockets };
+  suites[14] = alfCreateTestSuite("unix", unix_tests, unix_tests_count);
+
+  // ============================================================ //
+  // shm
+  // ============================================================ //
+  enum
+  {
+    shm_tests_count = 3
+  };
+  AlfTest shm_tests[shm_tests_count];
+  shm_tests[0] =
+    (AlfTest){ .name = "messages", .TestFunction = shm_messages };
+  shm_tests[1] = (AlfTest){ .name = "poll", .TestFunction = shm_poll };
+  shm_tests[2] =
+    (AlfTest){ .name = "untrusted", .TestFunction = shm_untrusted };
+  suites[15] = alfCreateTestSuite("shm", shm_tests, shm_tests_count);
+
   const uint32_t fails = alfRunSuites(suites, suites_count);
   for (int i = 0; i < suites_count; i++) {
     alfDestroyTestSuite(suites[i]);
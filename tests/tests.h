@@ -41,12 +41,168 @@ bad_site(AlfTestState* state);
 void
 tcp_test(AlfTestState* state);
 
+void
+tcp_connect_timeout(AlfTestState* state);
+
+void
+tcp_connect_many(AlfTestState* state);
+
+void
+tcp_cpu_steering(AlfTestState* state);
+
+void
+tcp_fastopen(AlfTestState* state);
+
+void
+tcp_defer_accept(AlfTestState* state);
+
 // ============================================================ //
 // poll
 // ============================================================ //
 void
 poll_test(AlfTestState* state);
 
+void
+poll_spin(AlfTestState* state);
+
+// ============================================================ //
+// address
+// ============================================================ //
+void
+address_numeric(AlfTestState* state);
+
+void
+address_format(AlfTestState* state);
+
+void
+address_all(AlfTestState* state);
+
+// ============================================================ //
+// resolver
+// ============================================================ //
+void
+resolver_udp(AlfTestState* state);
+
+void
+resolver_tcp_fallback(AlfTestState* state);
+
+void
+resolver_errors(AlfTestState* state);
+
+// ============================================================ //
+// cache
+// ============================================================ //
+void
+cache_ttl(AlfTestState* state);
+
+void
+cache_threads(AlfTestState* state);
+
+// ============================================================ //
+// happy eyeballs
+// ============================================================ //
+void
+happy_eyeballs_fallback(AlfTestState* state);
+
+void
+happy_eyeballs_errors(AlfTestState* state);
+
+void
+happy_eyeballs_interleave(AlfTestState* state);
+
+// ============================================================ //
+// session
+// ============================================================ //
+void
+session_key(AlfTestState* state);
+
+void
+session_table(AlfTestState* state);
+
+// ============================================================ //
+// filter
+// ============================================================ //
+void
+filter_match(AlfTestState* state);
+
+void
+filter_large(AlfTestState* state);
+
+void
+filter_large_ipv6(AlfTestState* state);
+
+void
+filter_hooks(AlfTestState* state);
+
+// ============================================================ //
+// limiter
+// ============================================================ //
+void
+limiter_rate(AlfTestState* state);
+
+void
+limiter_flood(AlfTestState* state);
+
+void
+limiter_hooks(AlfTestState* state);
+
+// ============================================================ //
+// profile
+// ============================================================ //
+void
+profile_option(AlfTestState* state);
+
+void
+profile_apply(AlfTestState* state);
+
+// ============================================================ //
+// pacer
+// ============================================================ //
+void
+pacer_schedule(AlfTestState* state);
+
+void
+pacer_writeto(AlfTestState* state);
+
+void
+pacer_txtime(AlfTestState* state);
+
+// ============================================================ //
+// timestamp
+// ============================================================ //
+void
+timestamp_udp(AlfTestState* state);
+
+void
+timestamp_tcp(AlfTestState* state);
+
+// ============================================================ //
+// unix
+// ============================================================ //
+void
+unix_stream(AlfTestState* state);
+
+void
+unix_datagram(AlfTestState* state);
+
+void
+unix_pair(AlfTestState* state);
+
+void
+unix_pass_sockets(AlfTestState* state);
+
+// ============================================================ //
+// shm
+// ============================================================ //
+void
+shm_messages(AlfTestState* state);
+
+void
+shm_poll(AlfTestState* state);
+
+void
+shm_untrusted(AlfTestState* state);
+
 // ============================================================ //
 // echo
 // ============================================================ //
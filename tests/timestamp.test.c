@@ -0,0 +1,175 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <time.h>
+
+static int
+is_recent(const uint64_t timestamp_ns)
+{
+  const uint64_t now_s = (uint64_t)time(NULL);
+  const uint64_t timestamp_s = timestamp_ns / 1000000000;
+  return timestamp_s + 10 >= now_s && timestamp_s <= now_s + 10;
+}
+
+void
+timestamp_udp(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_UDP;
+  chif_net_socket receiver;
+  OK_OR_RET(chif_net_open_socket(&receiver, proto, af));
+  chif_net_address address;
+  OK_OR_RET(chif_net_create_address_i(
+    &address, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+  OK_OR_RET(chif_net_bind(receiver, &address));
+  OK_OR_RET(chif_net_address_from_socket(receiver, &address));
+  chif_net_socket sender;
+  OK_OR_RET(chif_net_open_socket(&sender, proto, af));
+
+  const chif_net_result timestamping =
+    chif_net_set_timestamping(receiver, CHIF_NET_TIMESTAMPING_RX);
+  if (timestamping == CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED) {
+    chif_net_close_socket(&sender);
+    chif_net_close_socket(&receiver);
+    return;
+  }
+  OK_OR_RET(timestamping);
+  OK_OR_RET(chif_net_set_timestamping(sender, CHIF_NET_TIMESTAMPING_TX));
+
+  uint8_t buf[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  int bytes;
+  for (uint32_t i = 0; i < 2; ++i) {
+    OK_OR_RET(chif_net_writeto(sender, buf, sizeof(buf), &bytes, &address));
+
+    // the timestamp of when the kernel received it, not of the read, which
+    // can be missing if this is the first socket of the host to enable it
+    chif_net_address from;
+    from.address_family = af;
+    chif_net_timestamp rx;
+    const chif_net_result read_result = chif_net_readfrom_timestamp(
+      receiver, buf, sizeof(buf), &bytes, &from, &rx);
+    ALF_CHECK_TRUE(state,
+                   read_result == CHIF_NET_RESULT_SUCCESS ||
+                     read_result == CHIF_NET_RESULT_NO_TIMESTAMP);
+    ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+    ALF_CHECK_TRUE(state, from.address_family == CHIF_NET_ADDRESS_FAMILY_IPV4);
+    ALF_CHECK_TRUE(state,
+                   read_result == CHIF_NET_RESULT_NO_TIMESTAMP ||
+                     is_recent(rx.software_ns));
+    ALF_CHECK_TRUE(state,
+                   read_result == CHIF_NET_RESULT_SUCCESS ||
+                     rx.software_ns == 0);
+    ALF_CHECK_TRUE(state, rx.hardware_ns == 0);
+
+    // the send timestamp shows up on the error queue, numbered by write
+    chif_net_check check;
+    check.socket = sender;
+    check.request_events = 0;
+    check.return_events = 0;
+    int ready_count;
+    OK_OR_RET(chif_net_poll(&check, 1, &ready_count, 1000));
+    ALF_CHECK_TRUE(state, check.return_events & CHIF_NET_CHECK_EVENT_ERROR);
+    chif_net_timestamp tx;
+    OK_OR_RET(chif_net_read_tx_timestamp(sender, &tx));
+    ALF_CHECK_TRUE(state, is_recent(tx.software_ns));
+    ALF_CHECK_TRUE(state, tx.id == i);
+    ALF_CHECK_TRUE(state,
+                   read_result == CHIF_NET_RESULT_NO_TIMESTAMP ||
+                     tx.software_ns <= rx.software_ns);
+  }
+  chif_net_timestamp tx;
+  ALF_CHECK_TRUE(state,
+                 chif_net_read_tx_timestamp(sender, &tx) ==
+                   CHIF_NET_RESULT_WOULD_BLOCK);
+
+  { // an empty datagram is not a closed connection
+    OK_OR_RET(chif_net_writeto(sender, buf, 0, &bytes, &address));
+    chif_net_timestamp rx;
+    const chif_net_result read_result = chif_net_readfrom_timestamp(
+      receiver, buf, sizeof(buf), &bytes, NULL, &rx);
+    ALF_CHECK_TRUE(state,
+                   read_result == CHIF_NET_RESULT_SUCCESS ||
+                     read_result == CHIF_NET_RESULT_NO_TIMESTAMP);
+    ALF_CHECK_TRUE(state, bytes == 0);
+  }
+
+  chif_net_close_socket(&sender);
+  chif_net_close_socket(&receiver);
+}
+
+void
+timestamp_tcp(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  chif_net_socket server;
+  OK_OR_RET(chif_net_open_socket(&server, proto, af));
+  chif_net_address address;
+  OK_OR_RET(chif_net_create_address_i(
+    &address, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+  OK_OR_RET(chif_net_bind(server, &address));
+  OK_OR_RET(chif_net_address_from_socket(server, &address));
+  OK_OR_RET(chif_net_listen(server, CHIF_NET_DEFAULT_BACKLOG));
+  chif_net_socket client;
+  OK_OR_RET(chif_net_open_socket(&client, proto, af));
+  OK_OR_RET(chif_net_connect(client, &address));
+  chif_net_address client_address;
+  client_address.address_family = af;
+  chif_net_socket accepted;
+  OK_OR_RET(chif_net_accept(server, &client_address, &accepted));
+
+  const chif_net_result timestamping =
+    chif_net_set_timestamping(accepted, CHIF_NET_TIMESTAMPING_RX);
+  if (timestamping != CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED) {
+    OK_OR_RET(timestamping);
+    uint8_t buf[16] = { 0 };
+    int bytes;
+    OK_OR_RET(chif_net_write(client, buf, sizeof(buf), &bytes));
+    chif_net_timestamp rx;
+    const chif_net_result read_result = chif_net_readfrom_timestamp(
+      accepted, buf, sizeof(buf), &bytes, NULL, &rx);
+    ALF_CHECK_TRUE(state,
+                   read_result == CHIF_NET_RESULT_SUCCESS ||
+                     read_result == CHIF_NET_RESULT_NO_TIMESTAMP);
+    ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+    ALF_CHECK_TRUE(state,
+                   read_result == CHIF_NET_RESULT_NO_TIMESTAMP ||
+                     is_recent(rx.software_ns));
+
+    // as chif_net_read, the peer closing is not an empty read
+    chif_net_close_socket(&client);
+    ALF_CHECK_TRUE(state,
+                   chif_net_readfrom_timestamp(
+                     accepted, buf, sizeof(buf), &bytes, NULL, &rx) ==
+                     CHIF_NET_RESULT_TCP_CONNECTION_CLOSED);
+    ALF_CHECK_TRUE(state, bytes == 0);
+  }
+
+  chif_net_close_socket(&accepted);
+  chif_net_close_socket(&client);
+  chif_net_close_socket(&server);
+}
@@ -0,0 +1,336 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Christoffer Gustafsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "tests.h"
+#include "util.h"
+#include <chif_net.h>
+#include <stdio.h>
+#include <string.h>
+
+void
+unix_stream(AlfTestState* state)
+{
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_UNIX;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  const char* path = "chif_net_unix_stream.sock";
+  remove(path);
+
+  chif_net_socket server;
+  OK_OR_RET(chif_net_open_socket(&server, proto, af));
+  chif_net_unix_address address;
+  OK_OR_RET(chif_net_create_unix_address(&address, path));
+  OK_OR_RET(chif_net_bind(server, (chif_net_address*)&address));
+  OK_OR_RET(chif_net_listen(server, CHIF_NET_DEFAULT_BACKLOG));
+
+  chif_net_unix_address bound;
+  bound.address_family = af;
+  OK_OR_RET(chif_net_address_from_socket(server, (chif_net_address*)&bound));
+  char str[CHIF_NET_UNIX_STRING_LENGTH];
+  size_t length;
+  OK_OR_RET(chif_net_address_to_string(
+    (chif_net_address*)&bound, str, sizeof(str), &length));
+  ALF_CHECK_STREQ(state, str, path);
+  ALF_CHECK_TRUE(state, length == strlen(path));
+
+  chif_net_socket client;
+  OK_OR_RET(chif_net_open_socket(&client, proto, af));
+  OK_OR_RET(chif_net_connect(client, (chif_net_address*)&address));
+  chif_net_unix_address client_address;
+  client_address.address_family = af;
+  chif_net_socket accepted;
+  OK_OR_RET(
+    chif_net_accept(server, (chif_net_address*)&client_address, &accepted));
+  // the client did not bind, so it has no name
+  ALF_CHECK_TRUE(state, client_address.address_family == af);
+  OK_OR_RET(chif_net_address_to_string(
+    (chif_net_address*)&client_address, str, sizeof(str), &length));
+  ALF_CHECK_STREQ(state, str, "");
+  ALF_CHECK_TRUE(state, length == 0);
+
+  uint8_t buf[4] = { 1, 2, 3, 4 };
+  int bytes;
+  OK_OR_RET(chif_net_write(client, buf, sizeof(buf), &bytes));
+  uint8_t read_buf[4];
+  OK_OR_RET(chif_net_read(accepted, read_buf, sizeof(read_buf), &bytes));
+  ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+  ALF_CHECK_MEMEQ(state, read_buf, buf, sizeof(buf));
+
+  chif_net_close_socket(&accepted);
+  chif_net_close_socket(&client);
+  chif_net_close_socket(&server);
+
+  // the socket file outlives the socket
+  OK_OR_RET(chif_net_open_socket(&server, proto, af));
+  ALF_CHECK_TRUE(state,
+                 chif_net_bind(server, (chif_net_address*)&address) ==
+                   CHIF_NET_RESULT_SOCKET_ALREADY_IN_USE);
+  chif_net_close_socket(&server);
+  remove(path);
+}
+
+void
+unix_datagram(AlfTestState* state)
+{
+#if defined(__linux__)
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_UNIX;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_UDP;
+  chif_net_socket receiver;
+  OK_OR_RET(chif_net_open_socket(&receiver, proto, af));
+  chif_net_unix_address receiver_address;
+  OK_OR_RET(
+    chif_net_create_unix_address(&receiver_address, "@chif_net_receiver"));
+  OK_OR_RET(chif_net_bind(receiver, (chif_net_address*)&receiver_address));
+
+  chif_net_socket sender;
+  OK_OR_RET(chif_net_open_socket(&sender, proto, af));
+  chif_net_unix_address sender_address;
+  OK_OR_RET(chif_net_create_unix_address(&sender_address, "@chif_net_sender"));
+  OK_OR_RET(chif_net_bind(sender, (chif_net_address*)&sender_address));
+
+  uint8_t buf[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  int bytes;
+  OK_OR_RET(chif_net_writeto(
+    sender, buf, sizeof(buf), &bytes, (chif_net_address*)&receiver_address));
+  ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+
+  uint8_t read_buf[8];
+  chif_net_unix_address from;
+  from.address_family = af;
+  OK_OR_RET(chif_net_readfrom(
+    receiver, read_buf, sizeof(read_buf), &bytes, (chif_net_address*)&from));
+  ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+  ALF_CHECK_MEMEQ(state, read_buf, buf, sizeof(buf));
+  char str[CHIF_NET_UNIX_STRING_LENGTH];
+  OK_OR_RET(chif_net_address_to_string(
+    (chif_net_address*)&from, str, sizeof(str), NULL));
+  ALF_CHECK_STREQ(state, str, "@chif_net_sender");
+
+  // answer the address the datagram came from
+  OK_OR_RET(chif_net_writeto(
+    receiver, buf, sizeof(buf), &bytes, (chif_net_address*)&from));
+  OK_OR_RET(chif_net_read(sender, read_buf, sizeof(read_buf), &bytes));
+  ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+
+  { // the sender address does not fit an address with an IP family
+    OK_OR_RET(chif_net_writeto(sender,
+                               buf,
+                               sizeof(buf),
+                               &bytes,
+                               (chif_net_address*)&receiver_address));
+    chif_net_address ip_from;
+    ip_from.address_family = CHIF_NET_ADDRESS_FAMILY_IPV4;
+    ALF_CHECK_TRUE(
+      state,
+      chif_net_readfrom(
+        receiver, read_buf, sizeof(read_buf), &bytes, &ip_from) ==
+        CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+  }
+
+  chif_net_close_socket(&sender);
+  chif_net_close_socket(&receiver);
+#else
+  CHIF_NET_SUPPRESS_UNUSED_VAR_WARNING(state);
+#endif
+}
+
+void
+unix_pair(AlfTestState* state)
+{
+  chif_net_socket sockets[2];
+  const chif_net_result pair =
+    chif_net_open_socket_pair(CHIF_NET_TRANSPORT_PROTOCOL_TCP, sockets);
+  if (pair != CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED) {
+    OK_OR_RET(pair);
+    uint8_t buf[4] = { 4, 3, 2, 1 };
+    int bytes;
+    OK_OR_RET(chif_net_write(sockets[0], buf, sizeof(buf), &bytes));
+    uint8_t read_buf[4];
+    OK_OR_RET(chif_net_read(sockets[1], read_buf, sizeof(read_buf), &bytes));
+    ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+    ALF_CHECK_MEMEQ(state, read_buf, buf, sizeof(buf));
+
+    // the sockets of a pair are unnamed
+    chif_net_unix_address peer;
+    peer.address_family = CHIF_NET_ADDRESS_FAMILY_UNIX;
+    OK_OR_RET(chif_net_peer_address_from_socket(sockets[0],
+                                                (chif_net_address*)&peer));
+    char peer_str[CHIF_NET_UNIX_STRING_LENGTH];
+    OK_OR_RET(chif_net_address_to_string(
+      (chif_net_address*)&peer, peer_str, sizeof(peer_str), NULL));
+    ALF_CHECK_STREQ(state, peer_str, "");
+
+    // an address with an IP family has no room for it
+    chif_net_address ip_address;
+    ip_address.address_family = CHIF_NET_ADDRESS_FAMILY_IPV6;
+    ALF_CHECK_TRUE(state,
+                   chif_net_peer_address_from_socket(sockets[0], &ip_address) ==
+                     CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+    chif_net_close_socket(&sockets[0]);
+    chif_net_close_socket(&sockets[1]);
+  }
+
+  chif_net_unix_address address;
+  char long_path[CHIF_NET_UNIX_PATH_LENGTH + 1];
+  memset(long_path, 'a', sizeof(long_path) - 1);
+  long_path[sizeof(long_path) - 1] = '\0';
+  ALF_CHECK_TRUE(state,
+                 chif_net_create_unix_address(&address, long_path) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  ALF_CHECK_TRUE(state,
+                 chif_net_create_unix_address(&address, "@") ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+  ALF_CHECK_TRUE(state,
+                 chif_net_create_unix_address(&address, "") ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+
+  // the longest path that fits, with its null terminator
+  long_path[CHIF_NET_UNIX_PATH_LENGTH - 1] = '\0';
+  OK_OR_RET(chif_net_create_unix_address(&address, long_path));
+  char str[CHIF_NET_UNIX_STRING_LENGTH];
+  OK_OR_RET(chif_net_address_to_string(
+    (chif_net_address*)&address, str, sizeof(str), NULL));
+  ALF_CHECK_STREQ(state, str, long_path);
+  ALF_CHECK_TRUE(state,
+                 chif_net_address_to_string((chif_net_address*)&address,
+                                            str,
+                                            CHIF_NET_ADDRESS_STRING_LENGTH,
+                                            NULL) ==
+                   CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+  chif_net_port port;
+  ALF_CHECK_TRUE(state,
+                 chif_net_port_from_address((chif_net_address*)&address,
+                                            &port) ==
+                   CHIF_NET_RESULT_INVALID_ADDRESS_FAMILY);
+}
+
+void
+unix_pass_sockets(AlfTestState* state)
+{
+  enum
+  {
+    connection_count = 8
+  };
+  const chif_net_address_family af = CHIF_NET_ADDRESS_FAMILY_IPV4;
+  const chif_net_transport_protocol proto = CHIF_NET_TRANSPORT_PROTOCOL_TCP;
+  chif_net_socket pair[2];
+  const chif_net_result pair_result = chif_net_open_socket_pair(proto, pair);
+  if (pair_result == CHIF_NET_RESULT_PLATFORM_NOT_SUPPORTED) {
+    return;
+  }
+  OK_OR_RET(pair_result);
+
+  chif_net_socket server;
+  OK_OR_RET(chif_net_open_socket(&server, proto, af));
+  chif_net_address address;
+  OK_OR_RET(chif_net_create_address_i(
+    &address, "127.0.0.1", CHIF_NET_ANY_PORT, proto, af));
+  OK_OR_RET(chif_net_bind(server, &address));
+  OK_OR_RET(chif_net_address_from_socket(server, &address));
+  OK_OR_RET(chif_net_listen(server, CHIF_NET_DEFAULT_BACKLOG));
+
+  chif_net_socket clients[connection_count];
+  chif_net_socket accepted[connection_count];
+  for (int i = 0; i < connection_count; ++i) {
+    OK_OR_RET(chif_net_open_socket(&clients[i], proto, af));
+    OK_OR_RET(chif_net_connect(clients[i], &address));
+    chif_net_address client_address;
+    client_address.address_family = af;
+    OK_OR_RET(chif_net_accept(server, &client_address, &accepted[i]));
+  }
+
+  // hand all connections over in one message, and let go of them here
+  uint8_t buf[4] = { 'c', 'o', 'n', 'n' };
+  int bytes;
+  OK_OR_RET(chif_net_send_sockets(
+    pair[0], accepted, connection_count, buf, sizeof(buf), &bytes));
+  ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+  for (int i = 0; i < connection_count; ++i) {
+    chif_net_close_socket(&accepted[i]);
+  }
+
+  chif_net_socket received[connection_count];
+  size_t received_count;
+  uint8_t read_buf[4];
+  OK_OR_RET(chif_net_receive_sockets(pair[1],
+                                     received,
+                                     connection_count,
+                                     &received_count,
+                                     read_buf,
+                                     sizeof(read_buf),
+                                     &bytes));
+  ALF_CHECK_TRUE(state, received_count == connection_count);
+  ALF_CHECK_TRUE(state, bytes == (int)sizeof(buf));
+  ALF_CHECK_MEMEQ(state, read_buf, buf, sizeof(buf));
+
+  // the received sockets are the same connections, in the same order
+  for (size_t i = 0; i < received_count; ++i) {
+    uint8_t value = (uint8_t)i;
+    OK_OR_RET(chif_net_write(received[i], &value, 1, &bytes));
+    OK_OR_RET(chif_net_read(clients[i], &value, 1, &bytes));
+    ALF_CHECK_TRUE(state, bytes == 1 && value == (uint8_t)i);
+    chif_net_close_socket(&received[i]);
+  }
+
+  // without data, and with more sockets than fit
+  OK_OR_RET(chif_net_send_sockets(pair[0], clients, 4, NULL, 0, &bytes));
+  ALF_CHECK_TRUE(state, bytes == 1);
+  const chif_net_result truncated = chif_net_receive_sockets(
+    pair[1], received, 2, &received_count, NULL, 0, &bytes);
+  ALF_CHECK_TRUE(state, truncated == CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+  ALF_CHECK_TRUE(state, received_count == 2);
+  ALF_CHECK_TRUE(state, bytes == 1);
+  chif_net_close_socket(&received[0]);
+  chif_net_close_socket(&received[1]);
+
+  // an odd capacity, where alignment padding would have room for one more,
+  // and the socket that does not fit is not left open: the next socket
+  // opened gets the descriptor it would have taken
+  chif_net_socket probes[2];
+  OK_OR_RET(chif_net_open_socket(&probes[0], proto, af));
+  OK_OR_RET(chif_net_open_socket(&probes[1], proto, af));
+  const chif_net_socket free_socket = probes[1];
+  chif_net_close_socket(&probes[0]);
+  chif_net_close_socket(&probes[1]);
+  OK_OR_RET(chif_net_send_sockets(pair[0], clients, 2, NULL, 0, &bytes));
+  const chif_net_result odd = chif_net_receive_sockets(
+    pair[1], received, 1, &received_count, NULL, 0, &bytes);
+  ALF_CHECK_TRUE(state, odd == CHIF_NET_RESULT_NOT_ENOUGH_SPACE);
+  ALF_CHECK_TRUE(state, received_count == 1);
+  OK_OR_RET(chif_net_open_socket(&probes[0], proto, af));
+  ALF_CHECK_TRUE(state, probes[0] == free_socket);
+  chif_net_close_socket(&probes[0]);
+  chif_net_close_socket(&received[0]);
+
+  ALF_CHECK_TRUE(state,
+                 chif_net_send_sockets(pair[0], clients, 0, NULL, 0, NULL) ==
+                   CHIF_NET_RESULT_INVALID_INPUT_PARAM);
+
+  for (int i = 0; i < connection_count; ++i) {
+    chif_net_close_socket(&clients[i]);
+  }
+  chif_net_close_socket(&server);
+  chif_net_close_socket(&pair[0]);
+  chif_net_close_socket(&pair[1]);
+}